@@ -3,6 +3,12 @@
 #include "cinder/app/Renderer.h"
 #include "cinder/vk/Context.h"
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 namespace cinder::app {
@@ -28,6 +34,8 @@ public:
 		Options& enableComputeQueue(bool value = true) { mEnableComputeQueue = value; return *this; }
 		Options& enableTransferQueue(bool value = true) { mEnableTransferQueue = value; return *this; }
 		Options& numFramesInFlight(uint32_t value) { mNumFramesInFlight = value; return *this; }
+		Options& presentThread(bool value = true) { mPresentThread = value; return *this; }
+		Options& transientAttachments(bool value = true) { mTransientAttachments = value; return *this; }
 
 		Options& msaa( uint32_t samples ) { mSamples = samples; return *this; }
 
@@ -40,6 +48,8 @@ public:
 		bool							getEnableComputeQueue() const { return mEnableComputeQueue; }
 		bool							getEnableTransferQueue() const { return mEnableTransferQueue; }
 		uint32_t						getNumFramesInFlight() const { return mNumFramesInFlight; }
+		bool							getPresentThread() const { return mPresentThread; }
+		bool							getTransientAttachments() const { return mTransientAttachments; }
 
 		uint32_t getMsaa() const { return mSamples; }
 
@@ -53,10 +63,19 @@ public:
 		bool						mEnableComputeQueue = false;
 		bool						mEnableTransferQueue = false;
 		uint32_t					mNumFramesInFlight = 2;
+		bool						mPresentThread = false;
+		bool						mTransientAttachments = false;
 		uint32_t					mSamples = 1;
 	};
 	// clang-format on
 
+	struct PresentStats
+	{
+		uint64_t frameCount		  = 0;	 // Frame the stats were recorded for
+		double	 gpuLatencyMs	  = 0.0; // Time from swapBuffers() until the GPU finished the frame
+		double	 presentLatencyMs = 0.0; // Time from swapBuffers() until the present was queued
+	};
+
 protected:
 	RendererVk( const RendererVk &renderer );
 
@@ -76,6 +95,9 @@ public:
 	//! Return pointer to renderer's swapchain, null if cloned renderer
 	vk::SwapchainRef getSwapchain() const;
 
+	//! Returns the latencies of the most recently presented frame, only recorded with Options::presentThread()
+	PresentStats getPresentStats() const;
+
 	// Clone this renderer, cloned renderers do not have a swapchain
 	RendererRef clone() const override;
 
@@ -104,6 +126,27 @@ public:
 private:
 	void setupDevice( const std::string &appName, RendererRef sharedRenderer );
 	void setupFrames( uint32_t windowWidth, uint32_t windowHeight );
+	void startPresentThread();
+	void stopPresentThread();
+	void presentThreadFn();
+
+	struct AcquiredImage
+	{
+		uint32_t		 imageIndex = UINT32_MAX;
+		vk::SemaphoreRef imageReady;
+	};
+
+	struct PresentRequest
+	{
+		uint32_t							  imageIndex = UINT32_MAX;
+		vk::SemaphoreRef					  presentReady;
+		uint64_t							  readyValue = 0; // mPresentSync value the frame's submit signals
+		uint64_t							  frameCount = 0;
+		std::chrono::steady_clock::time_point handoffTime;
+	};
+
+	AcquiredImage acquireSwapchainImage();
+	void		  presentSwapchainImage( uint32_t imageIndex, const vk::SemaphoreRef &presentReady );
 
 private:
 	static thread_local RendererVk *sCurrentRenderer;
@@ -116,9 +159,22 @@ private:
 	vk::SwapchainRef mSwapchain;
 
 	struct Frame;
-	std::vector<Frame>		 mFrames;
-	vk::CountingSemaphoreRef mFrameSync;
-	vk::CommandPoolRef		 mCommandPool;
+	std::vector<Frame> mFrames;
+	uint32_t		   mSwapchainImageIndex = UINT32_MAX; // Acquired by makeCurrentContext(), presented by swapBuffers()
+
+	// Present thread, the render thread hands frames over with the timeline
+	// value its submit signals and takes acquired images in return
+	std::thread				   mPresentThread;
+	mutable std::mutex		   mPresentMutex;
+	std::condition_variable	   mPresentCondition;
+	bool					   mStopPresentThread = false;
+	std::deque<AcquiredImage>  mAcquiredImages;
+	std::deque<PresentRequest> mPresentRequests;
+	uint64_t				   mRequestedPresents = 0;
+	uint64_t				   mCompletedPresents = 0;
+	vk::CountingSemaphoreRef   mPresentSync;
+	PresentStats			   mPresentStats;
+	std::exception_ptr		   mPresentThreadExc; // Rethrown on the render thread
 
 	std::function<void( Renderer * )> mStartDrawFn;
 	std::function<void( Renderer * )> mFinishDrawFn;
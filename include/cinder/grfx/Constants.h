@@ -65,13 +65,15 @@
 #define CINDER_CONTEXT_STAGE_INDEX_HS 2
 #define CINDER_CONTEXT_STAGE_INDEX_DS 3
 #define CINDER_CONTEXT_STAGE_INDEX_GS 4
-#define CINDER_CONTEXT_STAGE_COUNT	  5
+#define CINDER_CONTEXT_STAGE_INDEX_CS 5
+#define CINDER_CONTEXT_STAGE_COUNT	  6
 
 #define CINDER_CONTEXT_STAGE_SHIFT_START_VS ( CINDER_CONTEXT_STAGE_INDEX_VS * CINDER_CONTEXT_WHOLE_STAGE_SHIFT_AMOUNT )
 #define CINDER_CONTEXT_STAGE_SHIFT_START_PS ( CINDER_CONTEXT_STAGE_INDEX_PS * CINDER_CONTEXT_WHOLE_STAGE_SHIFT_AMOUNT )
 #define CINDER_CONTEXT_STAGE_SHIFT_START_HS ( CINDER_CONTEXT_STAGE_INDEX_HS * CINDER_CONTEXT_WHOLE_STAGE_SHIFT_AMOUNT )
 #define CINDER_CONTEXT_STAGE_SHIFT_START_DS ( CINDER_CONTEXT_STAGE_INDEX_DS * CINDER_CONTEXT_WHOLE_STAGE_SHIFT_AMOUNT )
 #define CINDER_CONTEXT_STAGE_SHIFT_START_GS ( CINDER_CONTEXT_STAGE_INDEX_GS * CINDER_CONTEXT_WHOLE_STAGE_SHIFT_AMOUNT )
+#define CINDER_CONTEXT_STAGE_SHIFT_START_CS ( CINDER_CONTEXT_STAGE_INDEX_CS * CINDER_CONTEXT_WHOLE_STAGE_SHIFT_AMOUNT )
 
 #define CINDER_CONTEXT_VS_BINDING_SHIFT_TEXTURE ( CINDER_CONTEXT_STAGE_SHIFT_START_VS + CINDER_CONTEXT_PER_STAGE_OFFSET_TEXTURE )
 #define CINDER_CONTEXT_VS_BINDING_SHIFT_UBO		( CINDER_CONTEXT_STAGE_SHIFT_START_VS + CINDER_CONTEXT_PER_STAGE_OFFSET_UBO )
@@ -108,6 +110,13 @@
 #define CINDER_CONTEXT_GS_BINDING_SHIFT_SSBO	( CINDER_CONTEXT_STAGE_SHIFT_START_GS + CINDER_CONTEXT_PER_STAGE_OFFSET_SSBO )
 #define CINDER_CONTEXT_GS_BINDING_SHIFT_UAV		( CINDER_CONTEXT_STAGE_SHIFT_START_GS + CINDER_CONTEXT_PER_STAGE_OFFSET_UAV )
 
+#define CINDER_CONTEXT_CS_BINDING_SHIFT_TEXTURE ( CINDER_CONTEXT_STAGE_SHIFT_START_CS + CINDER_CONTEXT_PER_STAGE_OFFSET_TEXTURE )
+#define CINDER_CONTEXT_CS_BINDING_SHIFT_UBO		( CINDER_CONTEXT_STAGE_SHIFT_START_CS + CINDER_CONTEXT_PER_STAGE_OFFSET_UBO )
+#define CINDER_CONTEXT_CS_BINDING_SHIFT_IMAGE	( CINDER_CONTEXT_STAGE_SHIFT_START_CS + CINDER_CONTEXT_PER_STAGE_OFFSET_IMAGE )
+#define CINDER_CONTEXT_CS_BINDING_SHIFT_SAMPLER ( CINDER_CONTEXT_STAGE_SHIFT_START_CS + CINDER_CONTEXT_PER_STAGE_OFFSET_SAMPLER )
+#define CINDER_CONTEXT_CS_BINDING_SHIFT_SSBO	( CINDER_CONTEXT_STAGE_SHIFT_START_CS + CINDER_CONTEXT_PER_STAGE_OFFSET_SSBO )
+#define CINDER_CONTEXT_CS_BINDING_SHIFT_UAV		( CINDER_CONTEXT_STAGE_SHIFT_START_CS + CINDER_CONTEXT_PER_STAGE_OFFSET_UAV )
+
 //#define CINDER_CONTEXT_BINDING_SHIFT_SAMPLER 0
 //#define CINDER_CONTEXT_BINDING_SHIFT_TEXTURE ( CINDER_CONTEXT_BINDING_SHIFT_SAMPLER + CINDER_CONTEXT_MAX_SAMPLER_COUNT )
 //#define CINDER_CONTEXT_BINDING_SHIFT_IMAGE	 ( CINDER_CONTEXT_BINDING_SHIFT_TEXTURE + CINDER_CONTEXT_MAX_TEXTURE_COUNT )
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "cinder/vk/ChildObject.h"
+#include "cinder/vk/Context.h"
+
+namespace cinder::vk {
+
+//! @class AsyncCompute
+//!
+//! Records compute work into its own command buffers and submits them to
+//! the device's compute queue so they can overlap with the graphics work
+//! of the same frame. Each submitted batch signals a timeline semaphore
+//! value; graphics only waits for it at the stages that read the batch's
+//! results, see acquire().
+//!
+//! Buffers and images a batch writes for graphics are declared with
+//! handoff(). If the compute queue belongs to another queue family the
+//! batch ends with their queue family ownership release and acquire()
+//! records the matching acquire into the context. Ownership isn't handed
+//! back, so the next batch writing a handed off resource must not depend
+//! on its previous contents and images restart from
+//! VK_IMAGE_LAYOUT_UNDEFINED. Use one set of resources per batch in flight,
+//! or make submit() wait for the graphics work reading them, so compute
+//! doesn't overwrite what graphics is still reading.
+//!
+//! Without a separate compute queue (Device::Options::enableComputeQueue()
+//! isn't set, or the device has a single queue family like lavapipe)
+//! batches are submitted to the graphics queue. Results are the same, the
+//! work just doesn't overlap. Semaphores passed to submit() must then be
+//! signaled by work that was already submitted.
+//!
+class AsyncCompute
+	: public vk::DeviceChildObject
+{
+public:
+	virtual ~AsyncCompute();
+
+	static AsyncComputeRef create( uint32_t numBatchesInFlight = 2, vk::DeviceRef device = vk::DeviceRef() );
+
+	//! Returns true if batches run on a queue separate from graphics
+	bool isAsync() const;
+
+	//! Starts recording a batch. Blocks until the GPU is done with the batch that last used the same command buffer.
+	vk::CommandBuffer *begin();
+	//! Returns the command buffer of the batch being recorded, null outside of begin() and submit()
+	vk::CommandBuffer *getCommandBuffer() const;
+
+	//! Hands \a buffer to graphics commands reading it at \a dstStageMask with \a dstAccessMask, after the batch wrote it at \a srcStageMask with \a srcAccessMask
+	void handoff( const vk::BufferRef &buffer, VkPipelineStageFlags2KHR srcStageMask, VkAccessFlags2KHR srcAccessMask, VkPipelineStageFlags2KHR dstStageMask, VkAccessFlags2KHR dstAccessMask );
+	//! Hands \a image to graphics like a buffer, transitioning it from \a oldLayout to \a newLayout
+	void handoff( const vk::ImageRef &image, VkImageLayout oldLayout, VkImageLayout newLayout, VkPipelineStageFlags2KHR srcStageMask, VkAccessFlags2KHR srcAccessMask, VkPipelineStageFlags2KHR dstStageMask, VkAccessFlags2KHR dstAccessMask );
+
+	//! Ends the batch and submits it after \a waits. Returns the timeline value signaled when the batch completes.
+	uint64_t submit( const std::vector<vk::Context::SemaphoreInfo> &waits = {} );
+
+	//! Makes the next submit of \a ctx wait for the last submitted batch at the stages its handoffs are read at, all commands if there were none, and records the ownership acquires. Call before the first command of \a ctx that reads the results.
+	void acquire( vk::Context *ctx );
+
+	//! Returns the timeline semaphore signaled by submit()
+	vk::Semaphore *getSemaphore() const;
+	//! Returns the value signaled by the last submit(), 0 if nothing was submitted
+	uint64_t getSubmittedValue() const { return mSubmittedValue; }
+	//! Returns true if the batch that signals \a value has completed
+	bool isComplete( uint64_t value ) const;
+	//! Waits on the CPU for the batch that signals \a value
+	void wait( uint64_t value, uint64_t timeout = UINT64_MAX );
+
+private:
+	AsyncCompute( vk::DeviceRef device, uint32_t numBatchesInFlight );
+
+	struct Handoff
+	{
+		vk::BufferRef			 buffer;
+		vk::ImageRef			 image;
+		VkImageLayout			 oldLayout;
+		VkImageLayout			 newLayout;
+		VkPipelineStageFlags2KHR srcStageMask;
+		VkAccessFlags2KHR		 srcAccessMask;
+		VkPipelineStageFlags2KHR dstStageMask;
+		VkAccessFlags2KHR		 dstAccessMask;
+	};
+
+	struct Batch
+	{
+		vk::CommandBufferRef commandBuffer;
+		uint64_t			 signaledValue = 0;
+	};
+
+	//! Records the release or, if \a acquire is true, the acquire barriers of \a handoffs
+	void recordHandoffs( vk::CommandBuffer *pCommandBuffer, const std::vector<Handoff> &handoffs, bool acquire ) const;
+
+private:
+	vk::CommandPoolRef		 mCommandPool;
+	std::vector<Batch>		 mBatches;
+	uint32_t				 mBatchIndex = 0;
+	vk::CountingSemaphoreRef mSemaphore;
+	uint64_t				 mSubmittedValue = 0;
+	std::vector<Handoff>	 mHandoffs;		   // Declared by the batch being recorded
+	std::vector<Handoff>	 mPendingAcquires; // Submitted but not acquired by graphics yet
+};
+
+} // namespace cinder::vk
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "cinder/vk/ChildObject.h"
+#include "cinder/vk/Mesh.h"
 #include "cinder/GeomIo.h"
 
 namespace cinder::vk {
@@ -16,9 +17,16 @@ public:
 
 	//! Builds a Batch from a geom::Source and a GlslProg. Attributes defined in \a attributeMapping override the default mapping
 	static BatchRef create( const geom::Source &source, const vk::ShaderProgRef &shaderProg, const AttributeMapping &attributeMapping = AttributeMapping(), vk::DeviceRef device = vk::DeviceRef() );
+	//! Builds a Batch from an existing BufferedMesh, which may have per instance buffers, and a GlslProg
+	static BatchRef create( const vk::BufferedMeshRef &mesh, const vk::ShaderProgRef &shaderProg, vk::DeviceRef device = vk::DeviceRef() );
 
 	//! Draws the Batch. Optionally specify a \a first vertex/element and a \a count. Otherwise the entire geometry will be drawn.
 	void draw( int32_t first = 0, int32_t count = -1 );
+	//! Draws \a instanceCount instances of the Batch in a single draw call. Per instance attributes are read from the mesh's instance buffers.
+	void drawInstanced( uint32_t instanceCount, int32_t first = 0, int32_t count = -1 );
+
+	//! Appends a per instance vertex buffer to the Batch's mesh. See BufferedMesh::appendInstanceBuffer().
+	void appendInstanceBuffer( const vk::BufferedMesh::Layout &layout, const vk::BufferRef &buffer );
 
 	//! Returns the VboMesh associated with the Batch
 	vk::BufferedMeshRef getMesh() const { return mMesh; }
@@ -28,6 +36,7 @@ public:
 
 private:
 	Batch( vk::DeviceRef device, const geom::Source &source, const vk::ShaderProgRef &shaderProg, const AttributeMapping &attributeMapping );
+	Batch( vk::DeviceRef device, const vk::BufferedMeshRef &mesh, const vk::ShaderProgRef &shaderProg );
 
 private:
 	vk::ShaderProgRef	mShaderProg;
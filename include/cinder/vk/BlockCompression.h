@@ -0,0 +1,35 @@
+#pragma once
+
+#include "cinder/vk/vk_config.h"
+
+namespace cinder::vk {
+
+//! Returns the block compressed format produced for \a compression, VK_FORMAT_UNDEFINED for TextureCompression::NONE
+VkFormat toVkFormat( TextureCompression compression );
+
+//! Encodes a 4x4 block of RGBA8 texels (64 bytes, row major) to 8 bytes of BC1. Alpha is ignored.
+void encodeBlockBc1( const uint8_t *pRgba, uint8_t *pDst );
+//! Encodes a 4x4 block of RGBA8 texels to 16 bytes of BC3
+void encodeBlockBc3( const uint8_t *pRgba, uint8_t *pDst );
+//! Encodes \a channel of a 4x4 block of RGBA8 texels to 8 bytes of BC4
+void encodeBlockBc4( const uint8_t *pRgba, uint8_t *pDst, uint32_t channel = 0 );
+//! Encodes the red and green channels of a 4x4 block of RGBA8 texels to 16 bytes of BC5
+void encodeBlockBc5( const uint8_t *pRgba, uint8_t *pDst );
+//! Encodes a 4x4 block of RGBA8 texels to 16 bytes of BC7 using mode 6
+void encodeBlockBc7( const uint8_t *pRgba, uint8_t *pDst );
+
+//! Encodes a \a width x \a height RGBA8 image to \a pDst, which must hold
+//! formatDataSize( toVkFormat( compression ), width, height ) bytes. Edge
+//! blocks are padded by clamping. Rows of blocks are split across
+//! \a numThreads threads, 0 uses one thread per hardware thread. Pass 1
+//! when calling from a thread pool that already keeps the cores busy.
+void compressImage(
+	TextureCompression compression,
+	uint32_t		   width,
+	uint32_t		   height,
+	size_t			   rowBytes,
+	const uint8_t	  *pSrc,
+	uint8_t			*pDst,
+	uint32_t		   numThreads = 0 );
+
+} // namespace cinder::vk
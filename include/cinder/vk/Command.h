@@ -4,6 +4,41 @@
 
 namespace cinder::vk {
 
+//! Last access of an image subresource or buffer, used to work out the
+//! barrier the next access needs. Shared by CommandBuffer::BarrierBatch and
+//! RenderGraph so both follow the same hazard rules.
+struct AccessState
+{
+	static constexpr VkAccessFlags2KHR WRITE_ACCESS_MASK = VK_ACCESS_2_SHADER_WRITE_BIT_KHR |
+														   VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR |
+														   VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR |
+														   VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR |
+														   VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR |
+														   VK_ACCESS_2_HOST_WRITE_BIT_KHR |
+														   VK_ACCESS_2_MEMORY_WRITE_BIT_KHR;
+
+	//! Masks and layouts of the barrier an access needs
+	struct Barrier
+	{
+		VkPipelineStageFlags2KHR srcStageMask  = 0;
+		VkAccessFlags2KHR		 srcAccessMask = 0;
+		VkPipelineStageFlags2KHR dstStageMask  = 0;
+		VkAccessFlags2KHR		 dstAccessMask = 0;
+		VkImageLayout			 oldLayout	   = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkImageLayout			 newLayout	   = VK_IMAGE_LAYOUT_UNDEFINED;
+	};
+
+	VkImageLayout			 layout		   = VK_IMAGE_LAYOUT_UNDEFINED;
+	VkPipelineStageFlags2KHR writeStages   = 0; // Stages of the last write or layout transition
+	VkAccessFlags2KHR		 writeAccess   = 0;
+	VkPipelineStageFlags2KHR readStages	   = 0; // Stages that read since the last write
+	VkPipelineStageFlags2KHR visibleStages = 0; // Stages and accesses the last write is visible to
+	VkAccessFlags2KHR		 visibleAccess = 0;
+
+	//! Updates the state for an access at \a stageMask with \a accessMask in \a newLayout and fills in \a pBarrier, buffers pass VK_IMAGE_LAYOUT_UNDEFINED. Writes and layout transitions wait for every earlier access, reads only wait for a last write that isn't visible to them yet. Returns false if the access doesn't depend on anything earlier.
+	bool transition( VkImageLayout newLayout, VkPipelineStageFlags2KHR stageMask, VkAccessFlags2KHR accessMask, Barrier *pBarrier );
+};
+
 //! @class CommandBuffer
 //!
 //!
@@ -31,6 +66,10 @@ public:
 		RenderingInfo &addColorAttachment( const vk::ImageViewRef &attachment, const ColorA &clearValue, const vk::ImageViewRef &resolve = nullptr);
 		RenderingInfo &setDepthStencilAttachment( const vk::ImageViewRef &attachment, const vk::ImageViewRef &resolve = nullptr );
 		RenderingInfo &setDepthStencilAttachment( const vk::ImageViewRef &attachment, float depthClearValue, uint32_t stencilClearValue, const vk::ImageViewRef &resolve = nullptr );
+		//! Overrides the load and store ops of an attachment that's already been added, the clear value is used with VK_ATTACHMENT_LOAD_OP_CLEAR
+		RenderingInfo &setColorAttachmentOps( uint32_t index, VkAttachmentLoadOp loadOp, VkAttachmentStoreOp storeOp, const VkClearColorValue &clearValue = {} );
+		RenderingInfo &setDepthAttachmentOps( VkAttachmentLoadOp loadOp, VkAttachmentStoreOp storeOp, float clearValue = CINDER_DEFAULT_DEPTH );
+		RenderingInfo &setStencilAttachmentOps( VkAttachmentLoadOp loadOp, VkAttachmentStoreOp storeOp, uint32_t clearValue = CINDER_DEFAULT_STENCIL );
 		// clang-format on
 
 	private:
@@ -53,6 +92,76 @@ public:
 		friend CommandBuffer;
 	};
 
+	//! @class BarrierBatch
+	//!
+	//! Collects image, buffer and memory barriers and records them with a
+	//! single vkCmdPipelineBarrier2KHR. The layout and last access of every
+	//! image subresource is tracked across flushes, so image barriers only
+	//! name the new layout and access. Transitions that don't change the
+	//! layout are dropped if the last write is already visible to the new
+	//! access, as are buffer and memory barriers between reads. Barriers on
+	//! the same subresource before a flush are folded into one.
+	//!
+	//! Subresources start out in VK_IMAGE_LAYOUT_UNDEFINED with no earlier
+	//! access, use setImageState() for images used before. Barriers recorded
+	//! by other means aren't seen by the batch.
+	//!
+	class BarrierBatch
+	{
+	public:
+		BarrierBatch() {}
+
+		//! Replaces the tracked state of subresources, along with their barriers that weren't flushed. Accesses in \a stageMask and \a accessMask may still be in flight.
+		BarrierBatch &setImageState( const vk::Image *pImage, VkImageLayout layout, VkPipelineStageFlags2KHR stageMask, VkAccessFlags2KHR accessMask, uint32_t baseMipLevel = 0, uint32_t levelCount = VK_REMAINING_MIP_LEVELS, uint32_t baseArrayLayer = 0, uint32_t layerCount = VK_REMAINING_ARRAY_LAYERS );
+		//! Transitions subresources to \a newLayout for access at \a dstStageMask with \a dstAccessMask
+		BarrierBatch &imageBarrier( const vk::Image *pImage, VkImageLayout newLayout, VkPipelineStageFlags2KHR dstStageMask, VkAccessFlags2KHR dstAccessMask, uint32_t baseMipLevel = 0, uint32_t levelCount = VK_REMAINING_MIP_LEVELS, uint32_t baseArrayLayer = 0, uint32_t layerCount = VK_REMAINING_ARRAY_LAYERS );
+		BarrierBatch &bufferBarrier( const vk::Buffer *pBuffer, VkPipelineStageFlags2KHR srcStageMask, VkAccessFlags2KHR srcAccessMask, VkPipelineStageFlags2KHR dstStageMask, VkAccessFlags2KHR dstAccessMask, uint64_t offset = 0, uint64_t size = VK_WHOLE_SIZE );
+		//! Memory barriers are merged into one
+		BarrierBatch &memoryBarrier( VkPipelineStageFlags2KHR srcStageMask, VkAccessFlags2KHR srcAccessMask, VkPipelineStageFlags2KHR dstStageMask, VkAccessFlags2KHR dstAccessMask );
+
+		//! Returns the tracked layout of a subresource, VK_IMAGE_LAYOUT_UNDEFINED if the image isn't tracked
+		VkImageLayout getImageLayout( const vk::Image *pImage, uint32_t mipLevel = 0, uint32_t arrayLayer = 0 ) const;
+
+		//! Returns true if flush() has barriers to record
+		bool hasPendingBarriers() const;
+
+		//! Records the pending barriers with one vkCmdPipelineBarrier2KHR, nothing if there are none
+		void flush( vk::CommandBuffer *pCommandBuffer );
+		//! Same as above for command buffers that aren't wrapped by vk::CommandBuffer
+		void flush( const vk::Device *pDevice, VkCommandBuffer commandBuffer );
+
+		//! Forgets all tracked state and pending barriers
+		void reset();
+
+	private:
+		struct Subresource
+		{
+			vk::AccessState			 state;
+			bool					 pending = false; // Barrier below hasn't been flushed, its new layout is state.layout
+			vk::AccessState::Barrier barrier;
+		};
+
+		struct ImageState
+		{
+			VkImage					 image		 = VK_NULL_HANDLE;
+			VkImageAspectFlags		 aspectMask	 = 0;
+			uint32_t				 mipLevels	 = 0;
+			uint32_t				 arrayLayers = 0;
+			std::vector<Subresource> subresources; // Mip level major
+		};
+
+		ImageState &getImageState( const vk::Image *pImage, uint32_t baseMipLevel, uint32_t &levelCount, uint32_t baseArrayLayer, uint32_t &layerCount );
+		//! Fills \a dependencyInfo and returns true if there's anything to record
+		bool		prepare( VkDependencyInfoKHR &dependencyInfo );
+		void		clearPending();
+
+	private:
+		std::vector<ImageState>				   mImages;
+		std::vector<VkBufferMemoryBarrier2KHR> mBufferBarriers;
+		VkMemoryBarrier2KHR					   mMemoryBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER_2_KHR };
+		std::vector<VkImageMemoryBarrier2KHR>  mImageBarrierScratch;
+	};
+
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 	virtual ~CommandBuffer();
@@ -65,6 +174,12 @@ public:
 	bool isRendering() const { return mRendering; }
 
 	void begin( VkCommandBufferUsageFlags usageFlags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT );
+	//! Begins a secondary command buffer that continues a dynamic rendering instance with matching attachment formats. isRendering() returns true until end().
+	void beginSecondary(
+		const std::vector<VkFormat> &colorFormats,
+		VkFormat					 depthStencilFormat,
+		VkSampleCountFlagBits		 rasterizationSamples,
+		VkCommandBufferUsageFlags	 usageFlags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT );
 	void end();
 
 	void pushConstants(
@@ -81,6 +196,12 @@ public:
 		uint32_t				  set,
 		const vk::TextureBase	  *pTexture );
 
+	void pushDescriptors(
+		VkPipelineBindPoint						 pipelineBindPoint,
+		const vk::PipelineLayout				*pipelineLayout,
+		uint32_t								 set,
+		const std::vector<VkWriteDescriptorSet> &writes );
+
 	void bindDescriptorSets(
 		VkPipelineBindPoint						 pipelineBindPoint,
 		const vk::PipelineLayoutRef				&pipelineLayout,
@@ -93,9 +214,12 @@ public:
 		VkPipelineBindPoint	   pipelineBindPoint,
 		const vk::PipelineRef &pipeline );
 
-	void beginRendering( const RenderingInfo &ri );
+	//! Pass VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR in \a flags if the render pass instance is recorded with executeCommands()
+	void beginRendering( const RenderingInfo &ri, VkRenderingFlagsKHR flags = 0 );
 	void endRendering();
 
+	void executeCommands( const std::vector<vk::CommandBufferRef> &commandBuffers );
+
 	void setScissor( int32_t x, int32_t y, uint32_t width, uint32_t height );
 	void setViewport( float x, float y, float width, float height, float minDepth = 0.0f, float maxDepth = 1.0f );
 
@@ -114,6 +238,20 @@ public:
 
 	void draw( uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance );
 	void drawIndexed( uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance );
+	void drawIndexedIndirect( const vk::BufferRef &buffer, uint64_t offset, uint32_t drawCount, uint32_t stride );
+	//! Requires VK_KHR_draw_indirect_count, see Device::isDrawIndirectCountSupported()
+	void drawIndexedIndirectCount( const vk::BufferRef &buffer, uint64_t offset, const vk::BufferRef &countBuffer, uint64_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride );
+
+	void dispatch( uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ );
+	//! Reads the group counts from the VkDispatchIndirectCommand at \a offset in \a buffer
+	void dispatchIndirect( const vk::BufferRef &buffer, uint64_t offset );
+
+	void fillBuffer( const vk::BufferRef &buffer, uint64_t offset, uint64_t size, uint32_t data );
+
+	void pipelineBarrier2( const VkDependencyInfoKHR &dependencyInfo );
+
+	void resetQueryPool( const vk::QueryPoolRef &queryPool, uint32_t firstQuery, uint32_t queryCount );
+	void writeTimestamp( VkPipelineStageFlags2KHR stage, const vk::QueryPoolRef &queryPool, uint32_t query );
 
 	void transitionImageLayout(
 		VkImage				 image,
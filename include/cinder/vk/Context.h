@@ -37,12 +37,51 @@ private:
 		vk::ImageViewRef			  dsv;
 		vk::CommandBufferRef		  commandBuffer;
 		uint64_t					  frameSignaledValue;
+		std::vector<ContextRef>		  executedRecorders;  // Keeps recorders' command buffers alive until the frame completes
+		vk::QueryPoolRef			  timestampQueryPool; // Null if the device can't write timestamps
+		bool						  statsPending	  = false; // Submitted, stats are finished when the frame is reused
+		uint64_t					  statsFrameCount = 0;
+		double						  cpuWaitMs		  = 0.0;
+
+		// Set by setPresentImage() for presentable contexts
+		vk::ImageViewRef presentView;
+		vk::SemaphoreRef presentImageReady;
+		vk::SemaphoreRef presentReady;
+
+		// Rendering begins lazily with the first draw, clears recorded before
+		// that are folded into the load ops of the pass
+		bool						   renderingPending			 = false;
+		uint32_t					   pendingColorClears		 = 0; // Bit per render target
+		VkImageAspectFlags			   pendingDepthStencilClears = 0;
+		std::vector<VkClearColorValue> colorClearValues;
+		VkClearDepthStencilValue	   depthStencilClearValue = {};
+		uint32_t					   storedColors			  = 0; // Bit per render target whose contents the last pass kept
+		bool						   storedDepthStencil	  = false;
 
 		void resetDrawCalls();
 		void nextDrawCall( const vk::DescriptorSetLayoutRef &defaultSetLayout );
 	};
 
 public:
+	//! Load and store ops of the rendering passes the context begins.
+	//! Attachments cleared before the first draw of a pass are loaded with
+	//! VK_ATTACHMENT_LOAD_OP_CLEAR instead, and attachments the previous
+	//! pass didn't store with VK_ATTACHMENT_LOAD_OP_DONT_CARE.
+	//!
+	//! Store ops only apply to the pass that submit() closes. Passes ended by
+	//! suspendRendering() or executeRecorders() always store, so nothing drawn
+	//! earlier in the frame is lost. Contexts that never suspend rendering can
+	//! set depthStencilStoreOp to VK_ATTACHMENT_STORE_OP_DONT_CARE to skip
+	//! writing depth back at the end of the frame, unless it's read after the
+	//! frame, see getPreviousDepthStencil().
+	struct AttachmentOps
+	{
+		VkAttachmentLoadOp	colorLoadOp			= VK_ATTACHMENT_LOAD_OP_LOAD;
+		VkAttachmentStoreOp colorStoreOp		= VK_ATTACHMENT_STORE_OP_STORE;
+		VkAttachmentLoadOp	depthStencilLoadOp	= VK_ATTACHMENT_LOAD_OP_LOAD;
+		VkAttachmentStoreOp depthStencilStoreOp = VK_ATTACHMENT_STORE_OP_STORE;
+	};
+
 	struct Options
 	{
 		Options() {}
@@ -50,17 +89,25 @@ public:
 		Options( VkFormat renderTargetFormat, VkFormat depthStencilFormat, uint32_t samples );
 
 		// clang-format off
-		Options &numInFlightFrames( uint32_t value ) { mNumInFlightFrames = std::max<uint32_t>( 1, value ); return *this; }
+		Options &numInFlightFrames( uint32_t value ) { mNumInFlightFrames = std::clamp<uint32_t>( value, 2, 4 ); return *this; }
 		Options &setRenderTargets( std::vector<VkFormat> formats ) { mRenderTargetFormats = formats; return *this; }
 		Options &setDepthStencil( VkFormat format ) { mDepthStencilFormat = format; return *this; }
 		Options &sampleCount( uint32_t value );
+		//! Render target 0 is a swapchain image set each frame with setPresentImage(). Single sampled contexts draw into it directly and don't allocate their own, multisampled ones resolve into it.
+		Options &presentable( bool value = true ) { mPresentable = value; return *this; }
+		Options &attachmentOps( const AttachmentOps &value ) { mAttachmentOps = value; return *this; }
+		//! The depth stencil and, for presentable multisampled contexts, render target 0 are only used within a frame. They're created as transient attachments in lazily allocated memory where the device has it, and one image is shared by all frames in flight. They can't be sampled and getPreviousDepthStencil() returns null.
+		Options &transientAttachments( bool value = true ) { mTransientAttachments = value; return *this; }
 		// clang-format on
 
 	private:
-		uint32_t			  mNumInFlightFrames   = 2;
-		std::vector<VkFormat> mRenderTargetFormats = { VK_FORMAT_R8G8B8A8_UNORM };
-		VkFormat			  mDepthStencilFormat  = VK_FORMAT_D32_SFLOAT_S8_UINT;
-		VkSampleCountFlagBits mSampleCount		   = VK_SAMPLE_COUNT_1_BIT;
+		uint32_t			  mNumInFlightFrames	= 2;
+		std::vector<VkFormat> mRenderTargetFormats	= { VK_FORMAT_R8G8B8A8_UNORM };
+		VkFormat			  mDepthStencilFormat	= VK_FORMAT_D32_SFLOAT_S8_UINT;
+		VkSampleCountFlagBits mSampleCount			= VK_SAMPLE_COUNT_1_BIT;
+		bool				  mPresentable			= false;
+		AttachmentOps		  mAttachmentOps		= {};
+		bool				  mTransientAttachments	= false;
 
 		friend class Context;
 	};
@@ -69,8 +116,24 @@ public:
 
 	struct SemaphoreInfo
 	{
-		vk::Semaphore *semaphore;
-		uint64_t	   value = 0;
+		vk::Semaphore			*semaphore;
+		uint64_t				 value	   = 0;
+		VkPipelineStageFlags2KHR stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR; // Stages that wait, only used for waits
+	};
+
+	struct AttachmentMemory
+	{
+		uint32_t numImages			  = 0; // Images shared by frames in flight are counted once
+		uint64_t allocatedBytes		  = 0; // Memory bound to the render targets and depth stencils
+		uint64_t lazilyAllocatedBytes = 0; // Part of allocatedBytes that's only committed if the GPU needs it
+		uint64_t sharedBytes		  = 0; // Part of allocatedBytes shared by all frames in flight
+	};
+
+	struct FrameStats
+	{
+		uint64_t frameCount	= 0;   // Frame the stats were recorded for
+		double	 cpuWaitMs	= 0.0; // Time makeCurrent() blocked on the GPU finishing the frame's previous use
+		double	 gpuBusyMs	= 0.0; // Time between the frame's first and last command on the GPU, 0 without timestamp support
 	};
 
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -80,12 +143,65 @@ public:
 	static ContextRef create( const Options &options = Options(), vk::DeviceRef device = vk::DeviceRef() );
 	static ContextRef create( uint32_t width, uint32_t height, const Options &options = Options(), vk::DeviceRef device = vk::DeviceRef() );
 
+	//! Makes this the current context of the calling thread. Each thread
+	//! has its own current context. For a recorder this starts recording
+	//! its secondary command buffer for the parent's current frame.
+	//!
+	//! The CPU only blocks until the GPU is done with the oldest frame in
+	//! flight, whose resources this frame reuses. \a externalWaits must be
+	//! timeline semaphores, they're waited on by the GPU when the frame is
+	//! submitted.
 	void			makeCurrent( const std::vector<SemaphoreInfo> &externalWaits = std::vector<SemaphoreInfo>() );
 	static Context *getCurrentContext();
 	void			submit( const std::vector<SemaphoreInfo> &waits, const std::vector<SemaphoreInfo> &signals );
+	//! Adds a wait on the timeline semaphore \a wait to the next submit(), like the external waits passed to makeCurrent()
+	void			addSubmitWait( const SemaphoreInfo &wait );
 	void			waitForCompletion();
 
+	//! Returns the stats of the most recent frame the GPU has finished
+	const FrameStats &getFrameStats() const { return mFrameStats; }
+	//! Returns the memory used by the context's attachments across all frames in flight, swapchain images aren't included
+	AttachmentMemory getAttachmentMemory() const;
+
+	//! Returns true if the context was created with Options::presentable()
+	bool isPresentable() const { return mPresentable; }
+	//! Sets the swapchain image the next frame renders into, must be called
+	//! before makeCurrent() starts the frame. The GPU waits on \a imageReady
+	//! before writing color, and submit() transitions the image for present
+	//! and signals \a presentReady.
+	void setPresentImage( const vk::ImageViewRef &view, const vk::SemaphoreRef &imageReady, const vk::SemaphoreRef &presentReady );
+
+	//! Returns a recorder for multi-threaded command recording. A recorder
+	//! is a context that records into secondary command buffers from its own
+	//! command pool and draws into this context's attachments. Each worker
+	//! thread calls makeCurrent() on its own recorder after this context's
+	//! makeCurrent(), draws as usual, and the render thread then calls
+	//! executeRecorders(). A recorder records at most once per frame.
+	ContextRef createRecorder();
+	//! Returns true if this context was created with createRecorder()
+	bool	   isRecorder() const { return mParent != nullptr; }
+	//! Executes the commands of \a recorders in the order given, after anything
+	//! recorded into this context so far. Recorders that haven't been made
+	//! current this frame are skipped. Must be called on the render thread
+	//! once the workers have finished recording.
+	void	   executeRecorders( const std::vector<ContextRef> &recorders );
+
+	//! Ends dynamic rendering so commands that aren't allowed inside a render pass, like dispatches and transfers, can be recorded. Clears that no draw has picked up yet are kept for the next pass.
+	void suspendRendering();
+	//! Restarts dynamic rendering after suspendRendering() with the next draw. Attachment contents are preserved.
+	void resumeRendering();
+
+	//! Sets the load and store ops of rendering passes begun after this call
+	void				 setAttachmentOps( const AttachmentOps &ops ) { mAttachmentOps = ops; }
+	const AttachmentOps &getAttachmentOps() const { return mAttachmentOps; }
+
 	vk::StockShaderManager *getStockShaderManager();
+	//! Returns the batcher used by vk::drawLine(), vk::drawSolidRect() and friends
+	vk::ShapeBatch *getShapeBatch();
+	//! Draws any pending shapes. Called by the vk:: draw wrappers and the
+	//! context's own commands, but not by draw() and the other raw draw
+	//! calls. Call it before binding state for a raw draw.
+	void flushShapes();
 
 	bool isRenderable() const { return ( mWidth > 0 ) && ( mHeight > 0 ); }
 
@@ -100,6 +216,8 @@ public:
 	void enableDepthWrite( bool enable ) { mDynamicStates.depthWrite = enable; }
 	void enableDepthTest( bool enable ) { mDynamicStates.depthTest = enable; }
 	void enableStencilTest( bool enable ) { mDynamicStates.stencilTest = enable; }
+	bool isDepthWriteEnabled() const { return mDynamicStates.depthWrite.getValue(); }
+	bool isDepthTestEnabled() const { return mDynamicStates.depthTest.getValue(); }
 	// clang-format on
 
 	std::vector<ci::mat4> &getModelMatrixStack() { return mModelMatrixStack; }
@@ -135,6 +253,13 @@ public:
 	void				   popTextureBinding( uint32_t binding, bool forceRestore = false );
 	const vk::TextureBase *getTextureBinding( uint32_t binding );
 
+	//! Binds \a buffer as a storage buffer at \a binding for the vertex, fragment and compute stages
+	void bindStorageBuffer( const vk::Buffer *buffer, uint32_t binding );
+	void unbindStorageBuffer( uint32_t binding );
+	//! Binds \a imageView as a storage image at \a binding for the fragment and compute stages. The image must be in VK_IMAGE_LAYOUT_GENERAL when it's accessed.
+	void bindStorageImage( const vk::ImageView *imageView, uint32_t binding );
+	void unbindStorageImage( uint32_t binding );
+
 	void	 setActiveTexture( uint32_t binding );
 	void	 pushActiveTexture( uint32_t binding );
 	void	 pushActiveTexture();
@@ -143,6 +268,7 @@ public:
 
 	void enableBlend( bool enable = true, uint32_t attachmentIndex = 0 );
 	void disableBlend( uint32_t attachmentIndex = 0 ) { enableBlend( false, attachmentIndex ); }
+	bool isBlendEnabled( uint32_t attachmentIndex = 0 ) const { return mGraphicsState.cb.attachments[attachmentIndex].blendEnable; }
 	void blendFunc( VkBlendFactor sfactor, VkBlendFactor dfactor, uint32_t attachmentIndex = 0 );
 	void blendFuncSeparate( VkBlendFactor srcRGB, VkBlendFactor dstRGB, VkBlendFactor srcAlpha, VkBlendFactor dstAlpha, uint32_t attachmentIndex = 0 );
 	void pushBlendFuncSeparate( VkBlendFactor srcRGB, VkBlendFactor dstRGB, VkBlendFactor srcAlpha, VkBlendFactor dstAlpha, uint32_t attachmentIndex = 0 );
@@ -165,16 +291,39 @@ public:
 	uint32_t			 getNumRenderTargets() const { return countU32( mRenderTargetFormats ); }
 	const vk::ImageView *getRenderTargetView( uint32_t index ) const { return getCurrentFrame().rtvs[index].get(); }
 	const vk::ImageView *getDepthStencilView() const { return getCurrentFrame().dsv.get(); }
+	VkSampleCountFlagBits getSampleCount() const { return mSampleCount; }
+
+	//! Returns the depth stencil image of the last submitted frame, null before the first submit. Its contents are only defined if AttachmentOps::depthStencilStoreOp is VK_ATTACHMENT_STORE_OP_STORE.
+	vk::ImageRef getPreviousDepthStencil() const;
 
 	void clearColorAttachment( uint32_t index );
 	void clearDepthStencilAttachment( VkImageAspectFlags aspectMask );
 
-	void bindDefaultDescriptorSet();
+	void bindDefaultDescriptorSet( VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS );
 	void bindIndexBuffers( const vk::BufferedMeshRef &mesh );
 	void bindVertexBuffers( const vk::BufferedMeshRef &mesh );
+	//! Binds \a vertexBuffers, \a vertexFormats holds the format of each buffer's attributes. Bindings at or after \a firstInstanceBinding are per instance.
+	void bindVertexBuffers( const std::vector<std::pair<geom::BufferLayout, vk::BufferRef>> &vertexBuffers, const std::vector<std::vector<VkFormat>> &vertexFormats, const std::vector<uint64_t> &offsets = {}, uint32_t firstInstanceBinding = UINT32_MAX );
 	void bindGraphicsPipeline( const vk::PipelineLayout *pipelineLayout = nullptr );
-	void draw( int32_t firstVertex, int32_t vertexCount );
-	void drawIndexed( int32_t firstIndex, int32_t indexCount );
+	//! Binds the pipeline for the bound program's compute shader, created on first use and cached by hash like graphics pipelines
+	void bindComputePipeline( const vk::PipelineLayout *pipelineLayout = nullptr );
+	//! Raw draws record with the state bound by the caller and don't flush pending shapes, see flushShapes()
+	void draw( int32_t firstVertex, int32_t vertexCount, uint32_t instanceCount = 1 );
+	void drawIndexed( int32_t firstIndex, int32_t indexCount, uint32_t instanceCount = 1 );
+	//! Issues \a drawCount VkDrawIndexedIndirectCommands read from \a buffer starting at \a offset
+	void drawIndexedIndirect( const vk::BufferRef &buffer, uint64_t offset, uint32_t drawCount, uint32_t stride = sizeof( VkDrawIndexedIndirectCommand ) );
+	//! Issues up to \a maxDrawCount draws from \a buffer, the actual count is read from \a countBuffer on the GPU. Requires Device::isDrawIndirectCountSupported().
+	void drawIndexedIndirectCount( const vk::BufferRef &buffer, uint64_t offset, const vk::BufferRef &countBuffer, uint64_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride = sizeof( VkDrawIndexedIndirectCommand ) );
+	//! Dispatches the bound compute pipeline. Rendering is suspended around the
+	//! dispatch and resumed with the next draw. Storage writes are made visible
+	//! to later draws and dispatches, and the dispatch waits for earlier draws,
+	//! with one memory barrier each. Copies and layout transitions of what the
+	//! dispatch writes still need their own barriers. Pending shapes must be
+	//! flushed before the descriptor set is bound, vk::dispatch() takes care of
+	//! all of this.
+	void dispatch( uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ );
+	//! Like dispatch(), the group counts are read from the VkDispatchIndirectCommand at \a offset in \a buffer
+	void dispatchIndirect( const vk::BufferRef &buffer, uint64_t offset );
 
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -182,13 +331,25 @@ public:
 	void unregisterChild( vk::ContextChildObject *child );
 
 private:
-	Context( vk::DeviceRef device, uint32_t width, uint32_t height, const Options &options );
+	Context( vk::DeviceRef device, uint32_t width, uint32_t height, const Options &options, Context *parent = nullptr );
 
 	void		 initializeDescriptorSetLayouts();
 	void		 initializePipelineLayout();
 	void		 initializeFrame( vk::CommandBufferRef commandBuffer, Frame &frame );
+	void		 beginRecorderFrame();
+	//! Begins rendering to \a frame's attachments. Render target 0 resolves into the present image if the context is presentable and multisampled.
+	void		 beginFrameRendering( Frame &frame, VkRenderingFlagsKHR flags = 0 );
+	//! Begins rendering if makeCurrent() or resumeRendering() deferred it, called before each draw
+	void		 beginPendingRendering();
+	//! Returns true if render target \a index is a transient attachment shared by all frames
+	bool		 isTransientRenderTarget( uint32_t index ) const;
 	Frame		  &getCurrentFrame();
 	const Frame &getCurrentFrame() const;
+	//! Suspends rendering for a dispatch, returns true if it has to be resumed afterwards
+	bool		 beginDispatch();
+	void		 endDispatch( bool resume );
+	//! Records the barrier between earlier dispatches (and draws, if \a beforeDispatch) and the next draw or dispatch, if there's anything to wait on
+	void		 computeBarrier( bool beforeDispatch );
 
 	void assignVertexAttributeLocations();
 	void initTextureBindingStack( uint32_t binding );
@@ -265,6 +426,9 @@ private:
 		~DescriptorState() {}
 
 		void bindUniformBuffer( uint32_t bindingNumber, const vk::Buffer *buffer );
+		void bindStorageBuffer( uint32_t bindingNumber, const vk::Buffer *buffer );
+		void bindStorageImage( uint32_t bindingNumber, const vk::ImageView *imageView );
+		void unbind( uint32_t bindingNumber );
 		void bindCombinedImageSampler( uint32_t bindingNumber, const vk::ImageView *imageView, const vk::Sampler *sampler );
 
 	private:
@@ -295,8 +459,14 @@ private:
 			Descriptor( uint32_t aBindingNumber, const vk::Buffer *aBuffer )
 				: type( VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER ), bindingNumber( aBindingNumber ), bufferInfo( { aBuffer } ) {}
 
+			Descriptor( uint32_t aBindingNumber, VkDescriptorType aType, const vk::Buffer *aBuffer )
+				: type( aType ), bindingNumber( aBindingNumber ), bufferInfo( { aBuffer } ) {}
+
 			Descriptor( uint32_t aBindingNumber, const vk::ImageView *aImageView, const vk::Sampler *aSampler )
 				: type( VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ), bindingNumber( aBindingNumber ), imageInfo( { aImageView, aSampler } ) {}
+
+			Descriptor( uint32_t aBindingNumber, VkDescriptorType aType, const vk::ImageView *aImageView )
+				: type( aType ), bindingNumber( aBindingNumber ), imageInfo( { aImageView, nullptr } ) {}
 		};
 
 		std::map<uint32_t, Descriptor> mDescriptors;
@@ -305,21 +475,32 @@ private:
 	};
 
 	std::unique_ptr<vk::StockShaderManager> mStockShaderManager;
+	std::unique_ptr<vk::ShapeBatch>			mShapeBatch;
 	std::vector<vk::ContextChildObject *>	mChildren;
 
-	uint32_t			  mNumFramesInFlight   = 0;
-	uint32_t			  mWidth			   = 0;
-	uint32_t			  mHeight			   = 0;
-	std::vector<VkFormat> mRenderTargetFormats = {};
-	VkFormat			  mDepthStencilFormat  = VK_FORMAT_UNDEFINED;
-	VkSampleCountFlagBits mSampleCount		   = VK_SAMPLE_COUNT_1_BIT;
-
-	CommandPoolRef			 mCommandPool;
-	std::vector<Frame>		 mFrames;
-	uint64_t				 mFrameCount		 = 0;
-	uint32_t				 mFrameIndex		 = 0;
-	uint32_t				 mPreviousFrameIndex = 0;
-	vk::CountingSemaphoreRef mFrameSyncSemaphore;
+	uint32_t			  mNumFramesInFlight	= 0;
+	uint32_t			  mWidth				= 0;
+	uint32_t			  mHeight				= 0;
+	std::vector<VkFormat> mRenderTargetFormats	= {};
+	VkFormat			  mDepthStencilFormat	= VK_FORMAT_UNDEFINED;
+	VkSampleCountFlagBits mSampleCount			= VK_SAMPLE_COUNT_1_BIT;
+	bool				  mPresentable			= false;
+	AttachmentOps		  mAttachmentOps		= {};
+	bool				  mTransientAttachments	= false;
+	bool				  mSuspendsRendering	= false; // Set by the first suspendRendering() that ends a pass, its passes store from then on
+
+	CommandPoolRef			   mCommandPool;
+	std::vector<Frame>		   mFrames;
+	uint64_t				   mFrameCount		   = 0;
+	uint32_t				   mFrameIndex		   = 0;
+	uint32_t				   mPreviousFrameIndex = 0;
+	vk::CountingSemaphoreRef   mFrameSyncSemaphore;
+	std::vector<SemaphoreInfo> mPendingWaits; // External waits for the next submit()
+	FrameStats				   mFrameStats;
+
+	// Recorders only, see createRecorder()
+	ContextRef mParent;
+	uint64_t   mExecutedFrameCount = 0; // Parent frame count + 1 when last executed
 
 	// descriptor bindig -> combined image / sampler
 	std::map<uint32_t, std::vector<const vk::TextureBase *>> mTextureBindingStack;
@@ -338,6 +519,8 @@ private:
 	std::vector<ci::mat4> mProjectionMatrixStack;
 
 	std::vector<std::pair<geom::BufferLayout, vk::BufferRef>> mVertexBuffers;
+	std::vector<std::vector<VkFormat>>						  mVertexFormats; // Parallel to mVertexBuffers' attributes
+	uint32_t												  mFirstInstanceBinding = 0; // Bindings at or after this are per instance
 	const vk::ShaderProg									 *mShaderProg;
 	std::vector<const vk::GlslProg *>						  mGlslProgStack;
 	vk::Pipeline::GraphicsPipelineCreateInfo				  mGraphicsState;
@@ -353,6 +536,9 @@ private:
 	DescriptorState						mDescriptorState;
 	vk::PipelineRef						mGraphicsPipeline;
 	std::map<uint64_t, vk::PipelineRef> mGraphicsPipelines;
+	std::map<uint64_t, vk::PipelineRef> mComputePipelines;
+	bool								mComputeWritesPending  = false; // Dispatches stored something later commands haven't waited on
+	bool								mGraphicsAccessPending = false; // Draws since the last dispatch may read what the next one writes
 };
 
 } // namespace cinder::vk
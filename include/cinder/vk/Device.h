@@ -23,18 +23,16 @@ public:
 	SubmitInfo() {}
 
 	SubmitInfo &addCommandBuffer( const vk::CommandBufferRef &commandBuffer );
-	SubmitInfo &addWait( const vk::Semaphore *semaphore, uint64_t value = 0 );
-	SubmitInfo &addWait( const vk::SemaphoreRef &semaphore, uint64_t value = 0 ) { return addWait( semaphore.get(), value ); }
+	//! Commands in \a stageMask and later stages wait for \a semaphore on the GPU
+	SubmitInfo &addWait( const vk::Semaphore *semaphore, uint64_t value = 0, VkPipelineStageFlags2KHR stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR );
+	SubmitInfo &addWait( const vk::SemaphoreRef &semaphore, uint64_t value = 0, VkPipelineStageFlags2KHR stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR ) { return addWait( semaphore.get(), value, stageMask ); }
 	SubmitInfo &addSignal( const vk::Semaphore *semaphore, uint64_t value = 0 );
 	SubmitInfo &addSignal( const vk::SemaphoreRef &semaphore, uint64_t value = 0 ) { return addSignal( semaphore.get(), value ); }
 
 private:
-	std::vector<VkCommandBuffer>	  mCommandBuffers;
-	std::vector<VkSemaphore>		  mWaitSemaphores;
-	std::vector<uint64_t>			  mWaitValues;
-	std::vector<VkPipelineStageFlags> mWaitDstStageMasks;
-	std::vector<VkSemaphore>		  mSignalSemaphores;
-	std::vector<uint64_t>			  mSignalValues;
+	std::vector<VkCommandBufferSubmitInfoKHR> mCommandBuffers;
+	std::vector<VkSemaphoreSubmitInfoKHR>	  mWaits;
+	std::vector<VkSemaphoreSubmitInfoKHR>	  mSignals;
 
 	friend class Device;
 };
@@ -63,6 +61,7 @@ public:
 	private:
 		vk::Device						*mDevice = nullptr;
 		std::map<uint64_t, vk::SamplerRef> mSamplerMap;
+		std::mutex						   mMutex;
 	};
 
 	class Options
@@ -107,6 +106,8 @@ public:
 	const vk::QueueFamilyIndices			 &getQueueFamilyIndices() const;
 	VkQueue									 getGraphicsQueueHandle() const;
 	VkQueue									 getComputeQueueHandle() const;
+	//! Returns the family of the compute queue, the graphics family if compute falls back to the graphics queue
+	uint32_t								 getComputeQueueFamilyIndex() const;
 	VkQueue									 getTransferQueueHandle() const;
 	VmaAllocator							 getAllocatorHandle() const;
 
@@ -119,11 +120,28 @@ public:
 	//! Returns max sample count possible for render, depth, and stencil targets
 	VkSampleCountFlagBits getMaxOutputSampleCount() const;
 
+	//! Returns format features for images created with tiling
+	VkFormatFeatureFlags getFormatFeatures( VkFormat format, VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL ) const;
+	//! Returns true if format supports all bits in requiredFeatures for optimal tiling
+	bool isFormatSupported( VkFormat format, VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT ) const;
+
+	//! Returns true if VK_KHR_draw_indirect_count is enabled
+	bool isDrawIndirectCountSupported() const { return mDrawIndirectCountSupported; }
+	//! Returns true if the device has a lazily allocated memory type for MemoryUsage::GPU_LAZILY_ALLOCATED
+	bool isLazilyAllocatedMemorySupported() const { return mLazilyAllocatedMemorySupported; }
+	//! Returns true if compute work is submitted to a queue of its own. Requires Options::enableComputeQueue() and a compute only queue family, otherwise compute work goes to the graphics queue.
+	bool isAsyncComputeSupported() const { return mComputeQueueHandle != mGraphicsQueueHandle; }
+
 	//! Submit work to graphics queue
 	VkResult submitGraphics( const VkSubmitInfo *pSubmitInfo, VkFence fence = VK_NULL_HANDLE, bool waitForIdle = false );
+	//! Submits with vkQueueSubmit2KHR
 	VkResult submitGraphics( const vk::SubmitInfo &submitInfo, VkFence fence = VK_NULL_HANDLE, bool waitForIdle = false );
+	//! Present on graphics queue, serialized with submitGraphics() so it can be called from another thread
+	VkResult presentGraphics( const VkPresentInfoKHR *pPresentInfo );
 	//! Submit work to compute queue
 	VkResult submitCompute( const VkSubmitInfo *pSubmitInfo, VkFence fence = VK_NULL_HANDLE, bool waitForIdle = false );
+	//! Submits with vkQueueSubmit2KHR
+	VkResult submitCompute( const vk::SubmitInfo &submitInfo, VkFence fence = VK_NULL_HANDLE, bool waitForIdle = false );
 	//! Submit work to transfer queue
 	VkResult submitTransfer( const VkSubmitInfo *pSubmitInfo, VkFence fence = VK_NULL_HANDLE, bool waitForIdle = false );
 
@@ -174,6 +192,29 @@ public:
 		uint32_t	dstArrayLayer,
 		vk::Image  *pDstImage );
 
+	//! Use this to upload pre-laid out data (ex: compressed mip chains). Each region's bufferOffset
+	//! is relative to pSrcData. All regions are copied with a single submit.
+	void copyToImage(
+		uint64_t							  srcDataSize,
+		const void							 *pSrcData,
+		const std::vector<VkBufferImageCopy> &regions,
+		vk::Image							 *pDstImage );
+
+	//! Non-blocking version of copyToImage. The data is copied to a dedicated staging buffer and the
+	//! copy is submitted without waiting. Returns the async copy timeline value that is signaled when
+	//! the copy completes. Safe to call from worker threads.
+	uint64_t copyToImageAsync(
+		uint64_t							  srcDataSize,
+		const void							 *pSrcData,
+		const std::vector<VkBufferImageCopy> &regions,
+		vk::Image							 *pDstImage );
+	//! Returns true if the async copy that returned \a value has completed on the GPU
+	bool isAsyncCopyComplete( uint64_t value ) const;
+	//! Blocks until the async copy that returned \a value has completed on the GPU
+	void waitAsyncCopy( uint64_t value, uint64_t timeout = UINT64_MAX );
+	//! Returns the timeline semaphore signaled by async copies, submits can wait on it instead of the CPU
+	VkSemaphore getAsyncCopySemaphoreHandle() const { return mAsyncCopySemaphore; }
+
 	//! Use these if copy requires using mapped pointer from staging buffer as storage
 	void *beginCopyToImage(
 		uint32_t   srcWidth,
@@ -221,19 +262,34 @@ private:
 		uint32_t	dstArrayLayer,
 		vk::Image  *pDstImage );
 
+	void internalCopyToImage(
+		vk::Buffer							 *pSrcBuffer,
+		const std::vector<VkBufferImageCopy> &regions,
+		vk::Image							 *pDstImage );
+
+	void recordCopyToImage(
+		VkCommandBuffer						  commandBuffer,
+		vk::Buffer							 *pSrcBuffer,
+		const std::vector<VkBufferImageCopy> &regions,
+		vk::Image							 *pDstImage );
+
+	void retireAsyncCopies();
+
 private:
-	DeviceDispatchTable				  mVkFn						 = {};
-	VkPhysicalDevice				  mGpuHandle				 = VK_NULL_HANDLE;
-	VkPhysicalDeviceProperties		  mDeviceProperties			 = {};
-	ExtensionPhysicalDeviceProperties mExtensionDeviceProperties = {};
-	VkPhysicalDeviceFeatures		  mDeviceFeatures			 = {};
-	VkDevice						  mDeviceHandle				 = VK_NULL_HANDLE;
-	vk::QueueFamilyIndices			  mQueueFamilyIndices		 = {};
-	VkQueue							  mGraphicsQueueHandle		 = VK_NULL_HANDLE;
-	VkQueue							  mComputeQueueHandle		 = VK_NULL_HANDLE;
-	VkQueue							  mTransferQueueHandle		 = VK_NULL_HANDLE;
-	VmaAllocator					  mVmaAllocatorHandle		 = VK_NULL_HANDLE;
-	vk::Swapchain					*mSwapchain				 = nullptr;
+	DeviceDispatchTable				  mVkFn							  = {};
+	VkPhysicalDevice				  mGpuHandle					  = VK_NULL_HANDLE;
+	VkPhysicalDeviceProperties		  mDeviceProperties				  = {};
+	ExtensionPhysicalDeviceProperties mExtensionDeviceProperties	  = {};
+	VkPhysicalDeviceFeatures		  mDeviceFeatures				  = {};
+	VkDevice						  mDeviceHandle					  = VK_NULL_HANDLE;
+	vk::QueueFamilyIndices			  mQueueFamilyIndices			  = {};
+	VkQueue							  mGraphicsQueueHandle			  = VK_NULL_HANDLE;
+	VkQueue							  mComputeQueueHandle			  = VK_NULL_HANDLE;
+	VkQueue							  mTransferQueueHandle			  = VK_NULL_HANDLE;
+	VmaAllocator					  mVmaAllocatorHandle			  = VK_NULL_HANDLE;
+	bool							  mDrawIndirectCountSupported	  = false;
+	bool							  mLazilyAllocatedMemorySupported = false;
+	vk::Swapchain					*mSwapchain						  = nullptr;
 	std::mutex						  mGraphicsQueueMutex;
 	std::mutex						  mComputeQueueMutex;
 	std::mutex						  mTransferQueueMutex;
@@ -248,6 +304,19 @@ private:
 	std::mutex			  mTransitionMutex;
 	std::mutex			  mCopyMutex;
 
+	struct AsyncCopy
+	{
+		uint64_t		value		  = 0;
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		vk::BufferRef	stagingBuffer;
+	};
+
+	VkCommandPool		   mAsyncCopyCommandPool = VK_NULL_HANDLE;
+	VkSemaphore			   mAsyncCopySemaphore	 = VK_NULL_HANDLE;
+	uint64_t			   mAsyncCopyValue		 = 0;
+	std::vector<AsyncCopy> mPendingAsyncCopies;
+	std::mutex			   mAsyncCopyMutex;
+
 	std::unique_ptr<SamplerCache> mSamplerCache;
 	std::vector<VkFence>		  mFenceHandles;
 	std::vector<VkSemaphore>	  mSemaphoreHandles;
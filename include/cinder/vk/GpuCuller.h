@@ -0,0 +1,125 @@
+#pragma once
+
+#include "cinder/vk/ChildObject.h"
+
+namespace cinder::vk {
+
+//! @class GpuCuller
+//!
+//! Culls objects on the GPU with a compute shader and writes the surviving
+//! draws into an indirect buffer. Each object is tested against the view
+//! frustum and, optionally, against a hierarchical-Z pyramid built from
+//! the previous frame's depth buffer. Objects that were hidden behind
+//! last frame's depth are dropped; since the pyramid lags one frame,
+//! objects that appear from behind an occluder can pop in a frame late.
+//!
+//! If VK_KHR_draw_indirect_count is available the surviving draws are
+//! compacted and their count is written to getCountBuffer(). Otherwise
+//! every object keeps its slot and culled draws get an instanceCount of
+//! zero. drawIndirect() picks the right draw call for either case.
+//!
+//! Object N is transformed by transforms[N]. cull() must be called while
+//! recording a frame and before the draws that consume the results, and at
+//! most once per frame. Use a GpuCuller for each view or object set.
+//!
+class GpuCuller
+	: public vk::DeviceChildObject
+{
+public:
+	//! Per object input, matches the std430 layout used by the cull shader
+	struct Object
+	{
+		vec4						 boundingSphere; // xyz = center in object space, w = radius
+		VkDrawIndexedIndirectCommand command;
+		uint32_t					 reserved[3];
+	};
+
+	struct Options
+	{
+		Options() {}
+
+		// clang-format off
+		//! Disables the Hi-Z test and only culls against the frustum
+		Options& occlusionCulling( bool value = true ) { mOcclusionCulling = value; return *this; }
+		// clang-format on
+
+	private:
+		bool mOcclusionCulling = true;
+
+		friend class GpuCuller;
+	};
+
+	virtual ~GpuCuller();
+
+	static GpuCullerRef create( const Options &options = Options(), vk::DeviceRef device = vk::DeviceRef() );
+
+	//! Culls \a objectCount objects from \a objects (vk::GpuCuller::Object) transformed by \a transforms (mat4). \a viewProjection maps the transforms' space to clip space. Throws if called twice in the same frame.
+	void cull( vk::Context *ctx, const vk::Buffer *objects, const vk::Buffer *transforms, uint32_t objectCount, const mat4 &viewProjection );
+
+	//! Issues the draws written by the last cull(). The caller binds the pipeline, index and vertex buffers.
+	void drawIndirect( vk::Context *ctx );
+
+	//! Returns true if surviving draws are compacted and counted in getCountBuffer()
+	bool isCompacting() const { return mCompacting; }
+
+	//! Returns the indirect buffer written by the last cull()
+	const vk::BufferRef &getDrawBuffer() const { return mFrames[mFrameIndex].draws; }
+	//! Returns the buffer holding the number of surviving draws, only valid if isCompacting() returns true
+	const vk::BufferRef &getCountBuffer() const { return mFrames[mFrameIndex].count; }
+
+private:
+	GpuCuller( vk::DeviceRef device, const Options &options );
+
+	void initPipelines( vk::Context *ctx );
+	void updateFrame( vk::Context *ctx, uint32_t objectCount );
+	bool buildHiZ( vk::Context *ctx );
+
+private:
+	struct Frame
+	{
+		vk::BufferRef params;
+		vk::BufferRef draws;
+		vk::BufferRef count;
+		uint32_t	  capacity = 0;
+	};
+
+	struct HiZ
+	{
+		vk::ImageRef				  image;
+		vk::ImageViewRef			  view;
+		std::vector<vk::ImageViewRef> mipViews;
+		vk::ImageRef				  depthImage; // Source of depthView
+		vk::ImageViewRef			  depthView;
+		VkExtent2D					  depthExtent = {};
+	};
+
+	bool mOcclusionCulling = true;
+	bool mCompacting	   = false;
+
+	vk::GlslProgRef			   mReduceProg;
+	vk::GlslProgRef			   mCullProg;
+	vk::DescriptorSetLayoutRef mReduceSetLayout;
+	vk::DescriptorSetLayoutRef mCullSetLayout;
+	vk::PipelineLayoutRef	   mReducePipelineLayout;
+	vk::PipelineLayoutRef	   mCullPipelineLayout;
+	vk::PipelineRef			   mReducePipeline;
+	vk::PipelineRef			   mCullPipeline;
+	vk::SamplerRef			   mSampler;
+
+	std::vector<Frame> mFrames;
+	uint32_t		   mFrameIndex	= 0;
+	uint32_t		   mObjectCount = 0;
+	HiZ				   mHiZ;
+	vk::ImageRef	   mDummyHiZ;
+	vk::ImageViewRef   mDummyHiZView;
+
+	// Frame tracking, cull() runs at most once per frame
+	bool	 mHasCulled				  = false;
+	uint64_t mCullFrame				  = 0;
+	mat4	 mViewProjection		  = mat4();
+	mat4	 mPrevViewProjection	  = mat4();
+	bool	 mPrevViewProjectionValid = false;
+	bool	 mHiZValid				  = false;
+};
+
+} // namespace cinder::vk
@@ -28,6 +28,7 @@ public:
 		Usage& storageImage(bool value = true) { mUsage |= value ? VK_IMAGE_USAGE_STORAGE_BIT : 0; return *this; }
 		Usage& renderTarget(bool value = true) { mUsage |= value ? VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT : 0; return *this; }
 		Usage& depthStencil(bool value = true) { mUsage |= value ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT : 0; return *this; }
+		Usage& transientAttachment(bool value = true) { mUsage |= value ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0; return *this; }
 		// clang-format on
 
 	private:
@@ -156,6 +157,12 @@ public:
 
 	bool getCubeMap() const { return mCubeMap; }
 
+	//! Returns the size of the memory bound to the image, 0 for external images
+	uint64_t getAllocationSize() const { return static_cast<uint64_t>( mAllocationinfo.size ); }
+
+	//! Returns true if the image's memory is lazily allocated, it's only committed if the GPU needs it
+	bool isLazilyAllocated() const;
+
 private:
 	Image(
 		vk::DeviceRef		device,
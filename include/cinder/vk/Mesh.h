@@ -4,6 +4,7 @@
 #include "cinder/vk/ChildObject.h"
 
 #include "cinder/Color.h"
+#include "cinder/Filesystem.h"
 #include "cinder/Vector.h"
 #include "cinder/TriMesh.h"
 #include "cinder/GeomIo.h"
@@ -32,31 +33,126 @@ public:
 		Layout&		attrib( geom::Attrib attrib, uint8_t dims );
 		//! Appends an attribute using a geom::AttribInfo. Replaces AttribInfo if it exists for \a attribInfo.getAttrib()
 		Layout&		attrib( const geom::AttribInfo &attribInfo );
+		//! Appends an attribute of semantic \a attrib which is \a dims-dimensional and stored with \a encoding. UNORM16 values are divided by \a scale, the shader multiplies by it to dequantize.
+		Layout&		attrib( geom::Attrib attrib, uint8_t dims, vk::VertexEncoding encoding, float scale = 1.0f );
 		// clang-format on
 
 		std::vector<geom::AttribInfo>		  &getAttribs() { return mAttribInfos; }
 		const std::vector<geom::AttribInfo> &getAttribs() const { return mAttribInfos; }
 		//! Clears all attributes in the Layout
-		void								 clearAttribs() { mAttribInfos.clear(); }
+		void								 clearAttribs() { mAttribInfos.clear(); mEncodings.clear(); }
 
 		bool hasAttrib( geom::Attrib attrib ) const;
 
+		//! Returns the encoding of \a attrib, FLOAT32 unless it was added with an encoding
+		vk::VertexEncoding getEncoding( geom::Attrib attrib ) const;
+		//! Returns the dequantization scale of \a attrib
+		float			   getEncodingScale( geom::Attrib attrib ) const;
+		//! Returns the vertex input format \a attribInfo is stored in
+		VkFormat		   getFormat( const geom::AttribInfo &attribInfo ) const;
+
 	protected:
 		//! If \a resultVbo is null then no VBO is allocated
-		void allocate( vk::DeviceRef device, size_t numVertices, geom::BufferLayout *resultBufferLayout, vk::BufferRef *resultVertexBuffer ) const;
+		void allocate( vk::DeviceRef device, size_t numVertices, geom::BufferLayout *resultBufferLayout, vk::BufferRef *resultVertexBuffer, size_t *resultDataBytes = nullptr ) const;
+
+		struct Encoding
+		{
+			vk::VertexEncoding encoding = vk::VertexEncoding::FLOAT32;
+			float			   scale	= 1.0f;
+		};
+
+		bool							 mInterleave;
+		std::vector<geom::AttribInfo>	 mAttribInfos;
+		std::map<geom::Attrib, Encoding> mEncodings;
+
+		friend class vk::BufferedMesh;
+	};
+
+	class CI_API Options
+	{
+	public:
+		Options() {}
+
+		// clang-format off
+		//! Reorders triangles for the post transform cache and overdraw, then reorders vertices in fetch order. Only applies to indexed geom::TRIANGLES sources.
+		Options&	optimize( bool value = true ) { mOptimize = value; return *this; }
+		bool		getOptimize() const { return mOptimize; }
+		//! Number of entries in the simulated FIFO post transform cache. Default is 16.
+		Options&	vertexCacheSize( uint32_t value ) { mVertexCacheSize = value; return *this; }
+		uint32_t	getVertexCacheSize() const { return mVertexCacheSize; }
+		//! How much overdraw ordering may raise the ACMR, as a ratio. Default is 1.05.
+		Options&	overdrawThreshold( float value ) { mOverdrawThreshold = value; return *this; }
+		float		getOverdrawThreshold() const { return mOverdrawThreshold; }
+		//! Keeps vertex data in a ring of host visible memory with a region per frame in flight so it can be updated every frame with bufferAttrib() and mapAttrib*(). Indices stay GPU only.
+		Options&	dynamic( bool value = true ) { mDynamic = value; return *this; }
+		bool		getDynamic() const { return mDynamic; }
+		// clang-format on
+
+	private:
+		bool	 mOptimize			= false;
+		uint32_t mVertexCacheSize	= 16;
+		float	 mOverdrawThreshold = 1.05f;
+		bool	 mDynamic			= false;
+	};
+
+	//! Strided view of one attribute in a dynamic BufferedMesh, see mapAttrib3f(). The mapped range is marked dirty when the view is destroyed, it must not outlive the mesh.
+	template <typename T>
+	class MappedAttrib
+	{
+	public:
+		MappedAttrib( const MappedAttrib & )			= delete;
+		MappedAttrib &operator=( const MappedAttrib & ) = delete;
+		MappedAttrib( MappedAttrib &&rhs )
+			: mMesh( rhs.mMesh ), mBufferIndex( rhs.mBufferIndex ), mBegin( rhs.mBegin ), mData( rhs.mData ), mStride( rhs.mStride ), mCount( rhs.mCount ) { rhs.mMesh = nullptr; }
+		MappedAttrib &operator=( MappedAttrib && ) = delete;
+		~MappedAttrib()
+		{
+			if ( mMesh ) {
+				mMesh->markDirty( mBufferIndex, mBegin, mBegin + ( mCount - 1 ) * mStride + sizeof( T ) );
+			}
+		}
+
+		T	  &operator[]( size_t i ) { return *reinterpret_cast<T *>( mData + i * mStride ); }
+		size_t size() const { return mCount; }
 
-		bool						  mInterleave;
-		std::vector<geom::AttribInfo> mAttribInfos;
+	private:
+		MappedAttrib( BufferedMesh *mesh, size_t bufferIndex, uint64_t begin, uint8_t *data, size_t stride, size_t count )
+			: mMesh( mesh ), mBufferIndex( bufferIndex ), mBegin( begin ), mData( data ), mStride( stride ), mCount( count ) {}
+
+		BufferedMesh *mMesh;
+		size_t		  mBufferIndex;
+		uint64_t	  mBegin;
+		uint8_t		 *mData;
+		size_t		  mStride;
+		size_t		  mCount;
 
 		friend class vk::BufferedMesh;
 	};
 
+	//! Post transform cache efficiency before and after Options::optimize(). ACMR is transformed vertices per triangle, ATVR is transformed vertices per vertex.
+	struct OptimizeStats
+	{
+		bool  optimized	 = false;
+		float acmrBefore = 0.0f;
+		float acmrAfter	 = 0.0f;
+		float atvrBefore = 0.0f;
+		float atvrAfter	 = 0.0f;
+	};
+
 	//! Creates a VboMesh which represents the geom::Source \a source. Layout is derived from the contents of \a source.
 	static vk::BufferedMeshRef create( const geom::Source &source, vk::DeviceRef device = nullptr );
 	//! Creates a BufferedMesh which represents the geom::Source \a source using 1 or more BufferedMesh::Layouts for vertex data.
 	static vk::BufferedMeshRef create( const geom::Source &source, const std::vector<vk::BufferedMesh::Layout> &layouts, vk::DeviceRef device = nullptr );
 	//! Creates a BufferedMesh which represents the geom::Source \a source using \a layout.
 	static vk::BufferedMeshRef create( const geom::Source &source, const vk::BufferedMesh::Layout &layout, vk::DeviceRef device = nullptr );
+	//! Creates a BufferedMesh which represents the geom::Source \a source. Layout is derived from the contents of \a source.
+	static vk::BufferedMeshRef create( const geom::Source &source, const Options &options, vk::DeviceRef device = nullptr );
+	//! Creates a BufferedMesh which represents the geom::Source \a source using 1 or more BufferedMesh::Layouts for vertex data.
+	static vk::BufferedMeshRef create( const geom::Source &source, const std::vector<vk::BufferedMesh::Layout> &layouts, const Options &options, vk::DeviceRef device = nullptr );
+	//! Creates a BufferedMesh which represents the geom::Source \a source using \a layout.
+	static vk::BufferedMeshRef create( const geom::Source &source, const vk::BufferedMesh::Layout &layout, const Options &options, vk::DeviceRef device = nullptr );
+	//! Creates a BufferedMesh of \a numVertices uninitialized vertices without indices. Meant for Options::dynamic() meshes that are filled with bufferAttrib() or mapAttrib*().
+	static vk::BufferedMeshRef create( uint32_t numVertices, geom::Primitive primitive, const std::vector<vk::BufferedMesh::Layout> &layouts, const Options &options, vk::DeviceRef device = nullptr );
 
 	////! Creates a VboMesh which represents the geom::Source \a source. Layout is derived from the contents of \a source.
 	// static BufferedMeshRef create( const geom::Source &source, vk::DeviceRef device = vk::DeviceRef() );
@@ -82,20 +178,97 @@ public:
 
 	const std::vector<std::pair<geom::BufferLayout, vk::BufferRef>> &getVertexBuffers() const { return mVertexBuffers; }
 
+	//! Appends \a buffer as a per instance vertex stream described by \a layout. Its attributes are read at VK_VERTEX_INPUT_RATE_INSTANCE and bound after the per vertex buffers. Use geom::CUSTOM_0-9 semantics to avoid clashing with per vertex attributes.
+	void appendInstanceBuffer( const Layout &layout, const vk::BufferRef &buffer );
+	//! Returns the per instance vertex buffers added with appendInstanceBuffer()
+	const std::vector<std::pair<geom::BufferLayout, vk::BufferRef>> &getInstanceBuffers() const { return mInstanceBuffers; }
+
+	//! Returns the vertex input format of each attribute in getVertexBuffers()
+	const std::vector<std::vector<VkFormat>> &getVertexFormats() const { return mVertexFormats; }
+	//! Returns the vertex input format of each attribute in getInstanceBuffers()
+	const std::vector<std::vector<VkFormat>> &getInstanceFormats() const { return mInstanceFormats; }
+
+	//! Returns how \a attr is stored in the vertex buffers, see Layout::attrib()
+	vk::VertexEncoding getAttribEncoding( geom::Attrib attr ) const;
+	//! Returns the scale the shader multiplies \a attr by to dequantize it, 1 unless it's UNORM16 encoded
+	float			   getAttribEncodingScale( geom::Attrib attr ) const;
+
 	VkIndexType getIndexType() const { return mIndexType; }
 
+	//! Returns true if the mesh was created with Options::dynamic()
+	bool isDynamic() const { return !mDynamicBuffers.empty(); }
+
+	//! Writes \a dataSizeBytes of tightly packed \a attr data, in the format the attribute is stored in, starting at vertex \a firstVertex. Only dynamic meshes can be updated. Changes reach the GPU the next time the mesh is bound, frames already in flight keep their data. A mesh holds one copy per frame in flight, so it can be updated once per frame: binding it with new changes after it was already bound with changes in the same frame throws.
+	void bufferAttrib( geom::Attrib attr, size_t dataSizeBytes, const void *data, uint32_t firstVertex = 0 );
+	template <typename T>
+	void bufferAttrib( geom::Attrib attr, const std::vector<T> &data, uint32_t firstVertex = 0 ) { bufferAttrib( attr, data.size() * sizeof( T ), data.data(), firstVertex ); }
+
+	//! Returns a writable view of \a count vertices of the FLOAT32 attribute \a attr starting at \a firstVertex, 0 means up to the last vertex. Only dynamic meshes can be mapped. Writes through the view reach the GPU the next time the mesh is bound after the view is destroyed, with the same once per frame limit as bufferAttrib().
+	MappedAttrib<float> mapAttrib1f( geom::Attrib attr, uint32_t firstVertex = 0, uint32_t count = 0 ) { return mapAttrib<float>( attr, 1, firstVertex, count ); }
+	MappedAttrib<vec2>	mapAttrib2f( geom::Attrib attr, uint32_t firstVertex = 0, uint32_t count = 0 ) { return mapAttrib<vec2>( attr, 2, firstVertex, count ); }
+	MappedAttrib<vec3>	mapAttrib3f( geom::Attrib attr, uint32_t firstVertex = 0, uint32_t count = 0 ) { return mapAttrib<vec3>( attr, 3, firstVertex, count ); }
+	MappedAttrib<vec4>	mapAttrib4f( geom::Attrib attr, uint32_t firstVertex = 0, uint32_t count = 0 ) { return mapAttrib<vec4>( attr, 4, firstVertex, count ); }
+
+	//! Returns the cache statistics from Options::optimize(), optimized is false if the mesh wasn't optimized
+	const OptimizeStats &getOptimizeStats() const { return mOptimizeStats; }
+
+	//! Writes the vertex and index buffers and their layouts to \a path. Buffer data is stored as is and page aligned so load() can copy it straight to the GPU. Instance buffers aren't saved. Throws on failure.
+	void save( const fs::path &path ) const;
+	//! Creates a BufferedMesh from a file written by save(). The file is memory mapped and its buffers are copied to the GPU without any processing. Throws if the file is missing, truncated or from a different version.
+	static vk::BufferedMeshRef load( const fs::path &path, vk::DeviceRef device = nullptr );
+
 private:
-	BufferedMesh( vk::DeviceRef device, const geom::Source &source, std::vector<std::pair<Layout, vk::BufferRef>> vertexBuffers, const vk::BufferRef &indexBuffer );
+	BufferedMesh( vk::DeviceRef device );
+	BufferedMesh( vk::DeviceRef device, const geom::Source &source, std::vector<std::pair<Layout, vk::BufferRef>> vertexBuffers, const vk::BufferRef &indexBuffer, const Options &options );
+
+	//! Allocates a vertex buffer for each layout that doesn't have one, or a ring and shadow copy for dynamic meshes
+	void allocateVertexBuffers( const std::vector<std::pair<Layout, vk::BufferRef>> &vertexBuffers, const Options &options );
+
+	//! Finds \a attr, returns the index of its vertex buffer and sets \a pAttribInfo and \a pFormat. Throws if the mesh isn't dynamic or doesn't have \a attr.
+	size_t findDynamicAttrib( geom::Attrib attr, geom::AttribInfo *pAttribInfo, VkFormat *pFormat ) const;
+	//! Adds [begin, end) of vertex buffer \a bufferIndex to every frame's dirty range
+	void markDirty( size_t bufferIndex, uint64_t begin, uint64_t end );
+	//! Copies what changed since frame \a frameIndex was last bound into its region of each ring and appends the regions' offsets to \a pOffsets, 0 for static buffers. Throws if the context has more frames in flight than the mesh has regions, or if a region already written during \a frameCount would be overwritten.
+	void syncFrame( uint32_t frameIndex, uint64_t frameCount, uint32_t numFramesInFlight, std::vector<uint64_t> *pOffsets );
+
+	//! Checks that \a attr is \a dims FLOAT32 components and returns its first vertex in the shadow copy. The view marks the range dirty once it's released.
+	uint8_t *mapAttribData( geom::Attrib attr, uint8_t dims, uint32_t firstVertex, uint32_t *pCount, size_t *pStride, size_t *pBufferIndex, uint64_t *pBegin );
+
+	template <typename T>
+	MappedAttrib<T> mapAttrib( geom::Attrib attr, uint8_t dims, uint32_t firstVertex, uint32_t count )
+	{
+		size_t	 stride		 = 0;
+		size_t	 bufferIndex = 0;
+		uint64_t begin		 = 0;
+		uint8_t *pData		 = mapAttribData( attr, dims, firstVertex, &count, &stride, &bufferIndex, &begin );
+		return MappedAttrib<T>( this, bufferIndex, begin, pData, stride, count );
+	}
+
+	struct DynamicBuffer
+	{
+		std::vector<uint8_t>					   shadow;		// Current contents
+		uint64_t								   frameStride; // Size of each frame's region in the ring
+		std::vector<std::pair<uint64_t, uint64_t>> dirty;		// Per frame byte range that's not in its region yet
+		std::vector<uint64_t>					   written;		// Per frame count its region was last written in
+	};
 
 private:
 	uint32_t												  mNumVertices = 0;
 	uint32_t												  mNumIndices  = 0;
 	std::vector<std::pair<geom::BufferLayout, vk::BufferRef>> mVertexBuffers;
+	std::vector<std::pair<geom::BufferLayout, vk::BufferRef>> mInstanceBuffers;
+	std::vector<Layout>										  mVertexLayouts;
+	std::vector<std::vector<VkFormat>>						  mVertexFormats;
+	std::vector<std::vector<VkFormat>>						  mInstanceFormats;
 	vk::BufferRef											  mIndices;
 	VkPrimitiveTopology										  mPrimitive;
 	VkIndexType												  mIndexType = VK_INDEX_TYPE_UINT16;
+	OptimizeStats											  mOptimizeStats;
+	std::vector<DynamicBuffer>								  mDynamicBuffers; // Parallel to mVertexBuffers if dynamic
+	uint32_t												  mNumDynamicFrames = 0; // Regions in each dynamic ring
 
 	friend class BufferedMeshGeomTarget;
+	friend class vk::Context;
 };
 
 } // namespace cinder::vk
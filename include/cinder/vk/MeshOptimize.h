@@ -0,0 +1,43 @@
+#pragma once
+
+#include "cinder/vk/vk_config.h"
+
+namespace cinder::vk {
+
+//! Returns the average cache miss ratio (transformed vertices per
+//! triangle) of the triangle list \a pIndices for a FIFO post transform
+//! cache with \a cacheSize entries. 3 is the worst case, around 0.5-0.7
+//! is typical for well ordered meshes.
+float calcAcmr( const uint32_t *pIndices, size_t numIndices, uint32_t numVertices, uint32_t cacheSize = 16 );
+//! Returns the average transformed vertex ratio (transformed vertices per vertex) of the triangle list \a pIndices. 1 is ideal.
+float calcAtvr( const uint32_t *pIndices, size_t numIndices, uint32_t numVertices, uint32_t cacheSize = 16 );
+
+//! Reorders the triangles in \a pIndices in place for post transform cache
+//! locality using Tipsify (Sander, Nehab, Barczak 2007). If \a pClusters
+//! is not null it receives the first triangle of each run that started
+//! from a dead end. Runs can be reordered without hurting the cache much
+//! and are the input to optimizeOverdraw().
+void optimizeVertexCache( uint32_t *pIndices, size_t numIndices, uint32_t numVertices, uint32_t cacheSize = 16, std::vector<uint32_t> *pClusters = nullptr );
+
+//! Reorders the clusters of a cache optimized triangle list so clusters
+//! facing away from the mesh's center are drawn first, which lets them
+//! occlude the inner surfaces. Clusters from optimizeVertexCache() are
+//! split further as long as each piece's ACMR stays within \a threshold
+//! times the ACMR of the whole list. \a pPositions holds \a positionDims
+//! floats per vertex.
+void optimizeOverdraw(
+	uint32_t					*pIndices,
+	size_t						 numIndices,
+	const float					*pPositions,
+	uint32_t					 positionDims,
+	uint32_t					 numVertices,
+	const std::vector<uint32_t> &clusters,
+	uint32_t					 cacheSize = 16,
+	float						 threshold = 1.05f );
+
+//! Renumbers vertices in the order \a pIndices first references them and
+//! rewrites the indices in place. Unreferenced vertices are moved to the
+//! end. Returns the remap table, the new index of vertex i is remap[i].
+std::vector<uint32_t> optimizeVertexFetch( uint32_t *pIndices, size_t numIndices, uint32_t numVertices );
+
+} // namespace cinder::vk
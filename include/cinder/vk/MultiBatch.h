@@ -0,0 +1,129 @@
+#pragma once
+
+#include "cinder/vk/ChildObject.h"
+#include "cinder/vk/GpuCuller.h"
+#include "cinder/vk/Mesh.h"
+#include "cinder/GeomIo.h"
+
+namespace cinder::vk {
+
+//! @class MultiBatch
+//!
+//! Packs meshes that are drawn with the same ShaderProg into a single
+//! vertex and index buffer and draws all of them with one
+//! vkCmdDrawIndexedIndirect. Each draw's transform is stored in a
+//! storage buffer at \a transformsBinding. Draw N is issued with
+//! firstInstance = N so the vertex shader can fetch its transform with
+//! gl_InstanceIndex. Don't use gl_DrawIndex, GPU culling compacts the
+//! surviving draws so their draw index no longer matches N:
+//!
+//!   layout( std430, binding = 0 ) readonly buffer ciDrawTransforms { mat4 ciDrawTransform[]; };
+//!   gl_Position = ciModelViewProjection * ciDrawTransform[gl_InstanceIndex] * ciPosition;
+//!
+//! Meshes only need to be uploaded once and can be drawn any number of
+//! times with different transforms. Adding meshes or draws re-uploads the
+//! shared buffers and is meant for setup; transforms are written to a
+//! per frame buffer and can change every frame.
+//!
+//! With enableGpuCulling() each draw's bounding sphere is tested on the
+//! GPU against the frustum and the previous frame's depth before drawing,
+//! see vk::GpuCuller. Culled draws are skipped without a CPU round trip.
+//!
+class MultiBatch
+	: public vk::DeviceChildObject
+{
+public:
+	//! Default storage buffer binding for the per draw transforms
+	static const uint32_t DEFAULT_TRANSFORMS_BINDING = 0;
+
+	virtual ~MultiBatch();
+
+	//! Creates an empty MultiBatch. The vertex layout is derived from \a shaderProg's vertex attributes.
+	static MultiBatchRef create( const vk::ShaderProgRef &shaderProg, uint32_t transformsBinding = DEFAULT_TRANSFORMS_BINDING, vk::DeviceRef device = vk::DeviceRef() );
+
+	//! Packs \a source into the shared buffers and returns its mesh index. Source must be geom::TRIANGLES.
+	uint32_t addMesh( const geom::Source &source );
+	//! Adds a draw of mesh \a meshIndex with \a transform and returns its draw index
+	uint32_t addDraw( uint32_t meshIndex, const mat4 &transform = mat4() );
+	//! Shorthand for addDraw( addMesh( source ), transform )
+	uint32_t append( const geom::Source &source, const mat4 &transform = mat4() ) { return addDraw( addMesh( source ), transform ); }
+
+	void		setTransform( uint32_t drawIndex, const mat4 &transform );
+	const mat4 &getTransform( uint32_t drawIndex ) const;
+
+	uint32_t getNumMeshes() const { return countU32( mMeshes ); }
+	uint32_t getNumDraws() const { return countU32( mDraws ); }
+
+	//! Draws every draw added with addDraw() in a single indirect draw call
+	void draw();
+
+	//! Culls draws on the GPU before drawing. The bounds of each mesh are computed from its positions when it's added. A culled MultiBatch can be drawn once per frame, see GpuCuller::cull().
+	void enableGpuCulling( const vk::GpuCuller::Options &options = vk::GpuCuller::Options() );
+	void disableGpuCulling();
+	bool isGpuCullingEnabled() const { return mCuller ? true : false; }
+
+	//! Returns the packed mesh, uploading any pending meshes first
+	vk::BufferedMeshRef getMesh();
+
+	const vk::ShaderProgRef &getShaderProg() const { return mShaderProg; }
+
+private:
+	MultiBatch( vk::DeviceRef device, const vk::ShaderProgRef &shaderProg, uint32_t transformsBinding );
+
+	struct DrawBuffers
+	{
+		vk::BufferRef indirect;
+		vk::BufferRef cullObjects;
+		uint64_t	  drawsVersion = 0;
+	};
+
+	vec4			   calcBoundingSphere( uint32_t vertexOffset, uint32_t numVertices ) const;
+	void			   updateMesh();
+	const DrawBuffers &updateDrawBuffers( vk::Context *ctx );
+	vk::Buffer		  *updateTransformBuffer( vk::Context *ctx );
+
+private:
+	struct MeshRange
+	{
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		int32_t	 vertexOffset;
+		vec4	 boundingSphere; // xyz = center, w = radius
+	};
+
+	struct DrawInfo
+	{
+		uint32_t meshIndex;
+		mat4	 transform;
+	};
+
+	struct PackedAttrib
+	{
+		uint8_t			   dims;
+		std::vector<float> data;
+	};
+
+	class PackingTarget;
+	class PackedSource;
+
+	vk::ShaderProgRef					 mShaderProg;
+	uint32_t							 mTransformsBinding = DEFAULT_TRANSFORMS_BINDING;
+	vk::BufferedMesh::Layout			 mLayout;
+	std::map<geom::Attrib, PackedAttrib> mAttribs;
+	std::vector<uint32_t>				 mIndices;
+	uint32_t							 mNumVertices	  = 0;
+	uint32_t							 mMaxMeshVertices = 0;
+	std::vector<MeshRange>				 mMeshes;
+	std::vector<DrawInfo>				 mDraws;
+
+	vk::BufferedMeshRef		   mMesh;
+	vk::GpuCullerRef		   mCuller;
+	std::vector<DrawBuffers>   mDrawBuffers; // Per frame in flight
+	uint64_t				   mDrawsVersion = 1;
+	std::vector<vk::BufferRef> mTransformBuffers;
+	std::vector<uint64_t>	   mTransformBufferVersions;
+	uint64_t				   mTransformsVersion = 1;
+	bool					   mMeshDirty		  = false;
+};
+
+} // namespace cinder::vk
@@ -226,6 +226,15 @@ public:
 		OutputMergerState		  om;			  // = {};
 	};
 
+	// ComputePipelineCreateInfo follows the same hashing rules
+	// as GraphicsPipelineCreateInfo.
+	//
+	struct ComputePipelineCreateInfo
+	{
+		const vk::ShaderModule   *comp;			  // = nullptr;
+		const vk::PipelineLayout *pipelineLayout; // = nullptr;
+	};
+
 	// struct Options
 	//{
 	//	Options() {}
@@ -254,13 +263,16 @@ public:
 	static void setDefaults( GraphicsPipelineCreateInfo *createInfo );
 
 	static vk::PipelineRef create( const GraphicsPipelineCreateInfo &createInfo, vk::DeviceRef device = nullptr );
+	static vk::PipelineRef create( const ComputePipelineCreateInfo &createInfo, vk::DeviceRef device = nullptr );
 
 	static uint64_t calculateHash( const GraphicsPipelineCreateInfo *createInfo );
+	static uint64_t calculateHash( const ComputePipelineCreateInfo *createInfo );
 
 	VkPipeline getPipelineHandle() const { return mPipelineHandle; }
 
 private:
 	Pipeline( vk::DeviceRef device, const GraphicsPipelineCreateInfo &createInfo );
+	Pipeline( vk::DeviceRef device, const ComputePipelineCreateInfo &createInfo );
 
 	void initShaderStages(
 		const GraphicsPipelineCreateInfo			 &createInfo,
@@ -293,6 +305,7 @@ private:
 		VkPipelineDynamicStateCreateInfo &stateCreateInfo );
 
 	void initGraphicsPipeline( const GraphicsPipelineCreateInfo &createInfo );
+	void initComputePipeline( const ComputePipelineCreateInfo &createInfo );
 
 private:
 	VkPipeline mPipelineHandle = VK_NULL_HANDLE;
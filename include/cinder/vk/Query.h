@@ -0,0 +1,34 @@
+#pragma once
+
+#include "cinder/vk/ChildObject.h"
+
+namespace cinder::vk {
+
+//! @class QueryPool
+//!
+//!
+class QueryPool
+	: public vk::DeviceChildObject
+{
+public:
+	virtual ~QueryPool();
+
+	static QueryPoolRef create( VkQueryType queryType, uint32_t queryCount, vk::DeviceRef device = vk::DeviceRef() );
+
+	VkQueryPool getQueryPoolHandle() const { return mQueryPoolHandle; }
+	VkQueryType getQueryType() const { return mQueryType; }
+	uint32_t	getQueryCount() const { return mQueryCount; }
+
+	//! Reads \a queryCount 64-bit results starting at \a firstQuery into \a pResults without waiting. Returns VK_NOT_READY if any of them aren't available yet.
+	VkResult getResults( uint32_t firstQuery, uint32_t queryCount, uint64_t *pResults ) const;
+
+private:
+	QueryPool( vk::DeviceRef device, VkQueryType queryType, uint32_t queryCount );
+
+private:
+	VkQueryPool mQueryPoolHandle = VK_NULL_HANDLE;
+	VkQueryType mQueryType		 = VK_QUERY_TYPE_TIMESTAMP;
+	uint32_t	mQueryCount		 = 0;
+};
+
+} // namespace cinder::vk
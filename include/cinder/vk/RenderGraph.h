@@ -0,0 +1,272 @@
+#pragma once
+
+#include "cinder/vk/ChildObject.h"
+#include "cinder/vk/Command.h"
+
+#include <functional>
+
+namespace cinder::vk {
+
+//! @class RenderGraph
+//!
+//! Frame graph that records a fixed sequence of passes into a context's
+//! command buffer. Passes declare the images and buffers they read and
+//! write, and compile() derives the synchronization2 barriers between
+//! them from those declarations. All barriers needed before a pass are
+//! issued as one vkCmdPipelineBarrier2, and a barrier is only placed
+//! where an access actually depends on an earlier one: read after read
+//! in the same layout needs nothing.
+//!
+//! Images from createImage() are transient. They're owned by the graph,
+//! their contents don't survive past the last pass that uses them and
+//! their usage flags are derived from the passes. Transient images with
+//! the same description whose lifetimes don't overlap share one image.
+//! Imported images, textures and buffers are owned by the caller and are
+//! returned to their final layout after the last pass.
+//!
+//! Graphics passes are recorded inside a dynamic rendering instance over
+//! their attachments, with the viewport and scissor covering the render
+//! area. Attachments are stored only if a later pass reads them or they're
+//! imported. Pass callbacks record straight into the command buffer; the
+//! context's own draw functions target the context's attachments and
+//! can't be used inside a pass.
+//!
+//! The graph is compiled once and executed every frame. Transient images
+//! are shared between frames in flight, the first barrier of each frame
+//! waits for the previous frame's last use.
+//!
+class RenderGraph
+	: public vk::DeviceChildObject
+{
+public:
+	//! Identifies an image declared with createImage(), importImage() or importTexture()
+	struct ImageHandle
+	{
+		uint32_t index = UINT32_MAX;
+
+		bool isValid() const { return index != UINT32_MAX; }
+	};
+
+	//! Identifies a buffer declared with importBuffer()
+	struct BufferHandle
+	{
+		uint32_t index = UINT32_MAX;
+
+		bool isValid() const { return index != UINT32_MAX; }
+	};
+
+	enum class PassType
+	{
+		GRAPHICS,
+		COMPUTE,
+		TRANSFER,
+	};
+
+	//! Describes a transient image
+	struct ImageDesc
+	{
+		ImageDesc() {}
+
+		ImageDesc( uint32_t width, uint32_t height, VkFormat format )
+			: mExtent( { width, height, 1 } ), mFormat( format ) {}
+
+		// clang-format off
+		ImageDesc& samples( VkSampleCountFlagBits value ) { mSamples = value; return *this; }
+		ImageDesc& mipLevels( uint32_t value ) { mMipLevels = value; return *this; }
+		// clang-format on
+
+		bool operator==( const ImageDesc &rhs ) const;
+		bool operator!=( const ImageDesc &rhs ) const { return !( *this == rhs ); }
+
+	private:
+		VkExtent3D			  mExtent	 = {};
+		VkFormat			  mFormat	 = VK_FORMAT_UNDEFINED;
+		VkSampleCountFlagBits mSamples	 = VK_SAMPLE_COUNT_1_BIT;
+		uint32_t			  mMipLevels = 1;
+
+		friend class RenderGraph;
+	};
+
+	using ExecuteFn = std::function<void( vk::CommandBuffer *cmd, const vk::RenderGraph &graph )>;
+
+	//! Declares the resources of a pass, returned by addPass()
+	class PassBuilder
+	{
+	public:
+		//! Renders into \a image. VK_ATTACHMENT_LOAD_OP_LOAD keeps the previous contents and makes the pass depend on earlier writes.
+		PassBuilder &colorAttachment( ImageHandle image, VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_LOAD, const VkClearColorValue &clearValue = {} );
+		//! Depth tests and writes against \a image
+		PassBuilder &depthStencilAttachment( ImageHandle image, VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR, float depthClearValue = CINDER_DEFAULT_DEPTH, uint32_t stencilClearValue = CINDER_DEFAULT_STENCIL );
+		//! Samples \a image from the pass's shaders
+		PassBuilder &sampledImage( ImageHandle image );
+		//! Loads from and, if \a write is true, stores to \a image from the pass's shaders
+		PassBuilder &storageImage( ImageHandle image, bool write = true );
+		PassBuilder &storageBuffer( BufferHandle buffer, bool write = true );
+		PassBuilder &uniformBuffer( BufferHandle buffer );
+		PassBuilder &vertexBuffer( BufferHandle buffer );
+		PassBuilder &indexBuffer( BufferHandle buffer );
+		PassBuilder &indirectBuffer( BufferHandle buffer );
+		PassBuilder &transferSrc( ImageHandle image );
+		PassBuilder &transferDst( ImageHandle image );
+		PassBuilder &transferSrc( BufferHandle buffer );
+		PassBuilder &transferDst( BufferHandle buffer );
+
+	private:
+		PassBuilder( vk::RenderGraph *graph, uint32_t passIndex )
+			: mGraph( graph ), mPassIndex( passIndex ) {}
+
+		PassBuilder &image( ImageHandle image, VkPipelineStageFlags2KHR stageMask, VkAccessFlags2KHR accessMask, VkImageLayout layout );
+		PassBuilder &buffer( BufferHandle buffer, VkPipelineStageFlags2KHR stageMask, VkAccessFlags2KHR accessMask );
+
+	private:
+		vk::RenderGraph *mGraph		= nullptr;
+		uint32_t		 mPassIndex = 0;
+
+		friend class RenderGraph;
+	};
+
+	struct Stats
+	{
+		uint32_t numPasses			= 0;
+		uint32_t numBarrierBatches	= 0; // vkCmdPipelineBarrier2 calls per execute()
+		uint32_t numImageBarriers	= 0;
+		uint32_t numBufferBarriers	= 0;
+		uint32_t numTransientImages = 0; // Images declared with createImage()
+		uint32_t numAllocatedImages = 0; // Images allocated for them after aliasing
+		uint64_t transientBytes		= 0;
+	};
+
+	virtual ~RenderGraph();
+
+	static RenderGraphRef create( vk::DeviceRef device = vk::DeviceRef() );
+
+	//! Declares a transient image owned by the graph
+	ImageHandle	 createImage( const std::string &name, const ImageDesc &desc );
+	//! Declares \a image. It must be in \a initialLayout when execute() is called and is left in \a finalLayout, which defaults to \a initialLayout.
+	ImageHandle	 importImage( const std::string &name, const vk::ImageRef &image, VkImageLayout initialLayout, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED );
+	//! Declares the image of \a texture, which is expected to be in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+	ImageHandle	 importTexture( const std::string &name, const vk::TextureBaseRef &texture );
+	BufferHandle importBuffer( const std::string &name, const vk::BufferRef &buffer );
+
+	//! Replaces the image behind an imported handle without recompiling, e.g. when the window is resized. The GPU must be done with the previous image.
+	void setImportedImage( ImageHandle handle, const vk::ImageRef &image );
+	void setImportedBuffer( BufferHandle handle, const vk::BufferRef &buffer );
+
+	//! Appends a pass, passes execute in the order they're added
+	PassBuilder addPass( const std::string &name, PassType type, ExecuteFn fn );
+
+	//! Computes resource lifetimes, aliases transient images and places barriers. Called by execute() if the graph changed.
+	void compile();
+	bool isCompiled() const { return mCompiled; }
+
+	//! Records all passes into \a ctx's command buffer. Rendering into the context's attachments is suspended while the graph executes.
+	void execute( vk::Context *ctx );
+
+	//! Returns the image behind \a handle, transient images are only valid after compile()
+	const vk::Image		*getImage( ImageHandle handle ) const;
+	const vk::ImageView *getImageView( ImageHandle handle ) const;
+	const vk::Buffer	 *getBuffer( BufferHandle handle ) const;
+
+	const Stats &getStats() const { return mStats; }
+
+	//! Returns the compiled graph as text: passes, barriers, resource lifetimes and aliasing
+	std::string toString() const;
+
+private:
+	RenderGraph( vk::DeviceRef device );
+
+	//! Resource state while compiling, tracks what later accesses have to wait for
+	using State = vk::AccessState;
+
+	struct Access
+	{
+		uint32_t				 resource	= 0;
+		VkPipelineStageFlags2KHR stageMask	= 0;
+		VkAccessFlags2KHR		 accessMask = 0;
+		VkImageLayout			 layout		= VK_IMAGE_LAYOUT_UNDEFINED;
+	};
+
+	struct Barrier : vk::AccessState::Barrier
+	{
+		uint32_t resource = 0;
+		bool	 image	  = false;
+	};
+
+	struct Attachment
+	{
+		uint32_t			image	= UINT32_MAX;
+		VkAttachmentLoadOp	loadOp	= VK_ATTACHMENT_LOAD_OP_LOAD;
+		VkAttachmentStoreOp storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		VkClearValue		clearValue;
+	};
+
+	struct Pass
+	{
+		std::string				name;
+		PassType				type;
+		ExecuteFn				fn;
+		std::vector<Access>		imageAccesses;
+		std::vector<Access>		bufferAccesses;
+		std::vector<Attachment> colorAttachments;
+		Attachment				depthStencilAttachment;
+		std::vector<Barrier>	barriers; // Issued before the pass
+	};
+
+	struct ImageResource
+	{
+		std::string		   name;
+		ImageDesc		   desc;
+		bool			   imported		 = false;
+		vk::ImageRef	   image;
+		vk::TextureBaseRef texture;
+		const vk::Image	  *pImage		 = nullptr;
+		vk::ImageViewRef   view;
+		VkImageLayout	   initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkImageLayout	   finalLayout	 = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkImageUsageFlags  usage		 = 0;
+		uint32_t		   firstPass	 = UINT32_MAX;
+		uint32_t		   lastPass		 = UINT32_MAX;
+		uint32_t		   physical		 = UINT32_MAX; // Index into mPhysicalImages for transient images
+	};
+
+	struct BufferResource
+	{
+		std::string	  name;
+		vk::BufferRef buffer;
+		uint32_t	  firstPass = UINT32_MAX;
+		uint32_t	  lastPass	= UINT32_MAX;
+	};
+
+	//! Image allocated for one or more transient images with disjoint lifetimes
+	struct PhysicalImage
+	{
+		ImageDesc			  desc;
+		VkImageUsageFlags	  usage	   = 0;
+		uint32_t			  lastPass = 0;
+		std::vector<uint32_t> aliases;
+		vk::ImageRef		  image;
+		vk::ImageViewRef	  view;
+	};
+
+	Pass &getPass( uint32_t passIndex );
+	void  checkImage( ImageHandle handle ) const;
+	void  checkBuffer( BufferHandle handle ) const;
+	void  computeLifetimes();
+	void  aliasTransientImages();
+	void  placeBarriers();
+	void  recordBarriers( vk::CommandBuffer *cmd, const std::vector<Barrier> &barriers );
+	void  recordPass( vk::CommandBuffer *cmd, const Pass &pass );
+
+private:
+	std::vector<Pass>					   mPasses;
+	std::vector<ImageResource>			   mImages;
+	std::vector<BufferResource>			   mBuffers;
+	std::vector<PhysicalImage>			   mPhysicalImages;
+	std::vector<Barrier>				   mFinalBarriers; // Returns imported resources to their final state
+	bool								   mCompiled = false;
+	Stats								   mStats;
+	std::vector<VkImageMemoryBarrier2KHR>  mImageBarrierScratch;
+	std::vector<VkBufferMemoryBarrier2KHR> mBufferBarrierScratch;
+};
+
+} // namespace cinder::vk
@@ -193,7 +193,7 @@ public:
 	const vk::ShaderModule *getGeometryShader() const { return mGs.get(); }
 	const vk::ShaderModule *getTessellationEvalShader() const { return mDs.get(); }
 	const vk::ShaderModule *getTessellationCtrlShader() const { return mHs.get(); }
-	const vk::ShaderModule *getComputeShader() const { return mVs.get(); }
+	const vk::ShaderModule *getComputeShader() const { return mCs.get(); }
 
 	const vk::ShaderModule *getPixelShader() const { return getFragmentShader(); }
 	const vk::ShaderModule *getDomainShader() const { return getTessellationEvalShader(); }
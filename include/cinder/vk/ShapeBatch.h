@@ -0,0 +1,122 @@
+#pragma once
+
+#include "cinder/vk/Buffer.h"
+#include "cinder/vk/ChildObject.h"
+#include "cinder/Rect.h"
+
+namespace cinder::vk {
+
+//! @class ShapeBatch
+//!
+//! Collects immediate mode shapes (lines, rects, circles, polylines) and
+//! textured quads into per frame rings and draws them with as few draw
+//! calls as possible. Shapes are transformed by the current model matrix
+//! and colored with the current color on the CPU when they're appended.
+//! Textured quads become one instance each. Consecutive shapes, or
+//! consecutive quads using the same texture, only need a new draw if the
+//! view projection, blend or depth state changes between them. Draw order
+//! is preserved, runs are never reordered.
+//!
+//! Pending shapes are flushed by the vk:: draw wrappers, Batch and
+//! MultiBatch draws, viewport and scissor changes, clears,
+//! suspendRendering() and submit(). Context::draw() and the other raw
+//! Context draw calls don't flush, since flushing binds the shape
+//! pipeline and buffers over whatever the caller bound. Code that records
+//! raw draws calls Context::flushShapes() before binding its own state.
+//! Each frame's rings are rewound once the context reuses that frame and
+//! keep the largest size they needed.
+//!
+//! Each Context owns one ShapeBatch, see Context::getShapeBatch().
+//!
+class ShapeBatch
+	: public vk::ContextChildObject
+{
+public:
+	//! Matches the vertex layout of StockShaderManager::getDrawColorProg()
+	struct Vertex
+	{
+		vec3	 position;
+		uint32_t color; // RGBA8
+	};
+
+	//! Matches the instance layout of StockShaderManager::getDrawTextureProg()
+	struct Sprite
+	{
+		vec3 origin;
+		vec3 axisX;
+		vec3 axisY;
+		vec4 texCoords; // xy = offset, zw = scale
+	};
+
+	ShapeBatch( vk::ContextRef context );
+	virtual ~ShapeBatch();
+
+	//! Appends a triangle list of \a numVertices 2D positions and \a numIndices indices relative to \a pPositions
+	void appendTriangles( const vec2 *pPositions, uint32_t numVertices, const uint32_t *pIndices, uint32_t numIndices );
+	//! Appends a quad covering \a dstRect textured with the \a texCoords region of \a texture
+	void appendTexturedQuad( const vk::Texture2dRef &texture, const Rectf &texCoords, const Rectf &dstRect );
+
+	//! Records one draw per run of shapes sharing the same state
+	void flush();
+
+	//! Returns true if there are shapes that haven't been flushed
+	bool hasPendingShapes() const { return !mRuns.empty(); }
+
+	//! Returns the number of draws recorded by flush() since the context started this frame
+	uint32_t getNumDrawsThisFrame() const { return mNumDrawsThisFrame; }
+
+private:
+	virtual void flightSync( uint32_t currentFrameIndex, uint32_t previousFrameIndex ) override;
+
+	//! Pipeline state a run of shapes is drawn with
+	struct RunState
+	{
+		const vk::Texture2d *texture; // Null for untextured shapes
+		mat4				 viewProjection;
+		bool				 blendEnable;
+		VkBlendFactor		 blendFactors[4];
+		bool				 depthTest;
+		bool				 depthWrite;
+
+		bool operator==( const RunState &rhs ) const;
+		bool operator!=( const RunState &rhs ) const { return !( *this == rhs ); }
+	};
+
+	struct Run
+	{
+		RunState		 state;
+		vk::Texture2dRef texture;
+		uint32_t		 first; // Index for shapes, instance for textured quads
+		uint32_t		 count;
+	};
+
+	//! Persistently mapped buffer that's filled front to back each frame
+	struct Ring
+	{
+		vk::BufferRef buffer;
+		uint8_t		 *pData	   = nullptr;
+		uint32_t	  capacity = 0;
+		uint32_t	  count	   = 0;
+	};
+
+	struct Frame
+	{
+		Ring					   vertices;
+		Ring					   indices;
+		Ring					   sprites;
+		std::vector<vk::BufferRef> retiredBuffers; // Outgrown buffers still referenced by this frame's commands
+	};
+
+	RunState currentState( const vk::Texture2d *texture ) const;
+	void	 reserve( uint32_t numVertices, uint32_t numIndices, uint32_t numSprites );
+	void	 grow( Frame &frame, Ring &ring, uint32_t count, uint32_t initialCapacity, uint32_t elementSize, const vk::Buffer::Usage &usage );
+	void	 appendRun( const RunState &state, const vk::Texture2dRef &texture, uint32_t first, uint32_t count );
+
+private:
+	std::vector<Frame> mFrames;
+	std::vector<Run>   mRuns;
+	bool			   mFlushing		  = false;
+	uint32_t		   mNumDrawsThisFrame = 0;
+};
+
+} // namespace cinder::vk
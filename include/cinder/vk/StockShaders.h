@@ -44,8 +44,12 @@ public:
 	StockShaderManager( vk::ContextRef context );
 	~StockShaderManager();
 
+	//! Instanced quads, one ShapeBatch::Sprite per instance
 	const vk::PipelineLayout *getDrawTexturePipelineLayout() const;
 	const vk::GlslProg	   *getDrawTextureProg( bool rectangle = false ) const;
+	//! Per vertex position and color, used by ShapeBatch
+	const vk::PipelineLayout *getDrawColorPipelineLayout() const;
+	const vk::GlslProg	   *getDrawColorProg() const;
 
 private:
 	virtual void flightSync( uint32_t currentFrameIndex, uint32_t previousFrameIndex ) override {}
@@ -56,6 +60,8 @@ private:
 	vk::PipelineLayoutRef	   mDrawTexturePipelineLayout;
 	vk::GlslProgRef			   mDrawTextureProg;
 	vk::GlslProgRef			   mDrawTextureRectangleProg;
+	vk::PipelineLayoutRef	   mDrawColorPipelineLayout;
+	vk::GlslProgRef			   mDrawColorProg;
 };
 
 } // namespace cinder::vk
@@ -6,6 +6,7 @@ namespace cinder::vk {
 
 using FenceRef	   = std::shared_ptr<class Fence>;
 using ImageRef	   = std::shared_ptr<class Image>;
+using ImageViewRef = std::shared_ptr<class ImageView>;
 using SemaphoreRef = std::shared_ptr<class Semaphore>;
 using SwapchainRef = std::shared_ptr<class Swapchain>;
 
@@ -20,11 +21,14 @@ public:
 		Options() {}
 
 		Options& numBuffers(uint32_t value) { mNumBuffers = value; return *this; }
+		//! Creates the surface's minImageCount plus \a value images, so up to \a value images can be held acquired at once. Overrides numBuffers().
+		Options& numAcquiredImages(uint32_t value) { mNumAcquiredImages = value; return *this; }
 		Options& format(VkFormat value) { mFormat = value; return *this; }
 		Options& presentMode(VkPresentModeKHR value) { mPresentMode = value; return *this; }
 
 	private:
 		uint32_t			mNumBuffers		= 2;
+		uint32_t			mNumAcquiredImages = 0;
 		VkFormat			mFormat			= VK_FORMAT_B8G8R8A8_UNORM;
 		VkPresentModeKHR	mPresentMode	= VK_PRESENT_MODE_FIFO_KHR;
 
@@ -55,6 +59,13 @@ public:
 	const VkSurfaceFormatKHR &getSurfaceFormat() const { return mSurfaceFormat; }
 
 	const std::vector<ImageRef> &getImages() const { return mImages; }
+	//! Color attachment views of getImages()
+	const std::vector<ImageViewRef> &getImageViews() const { return mImageViews; }
+
+	//! Number of images acquired and not yet presented
+	uint32_t getNumAcquiredImages() const { return static_cast<uint32_t>( mAcquireCount - mPresentCount ); }
+	//! Returns true if acquireNextImage() may be called with a timeout of UINT64_MAX. The spec forbids it once more than imageCount - minImageCount images are acquired, since it could block forever.
+	bool canAcquireWithoutTimeout() const { return getNumAcquiredImages() <= ( static_cast<uint32_t>( mImages.size() ) - mMinImageCount ); }
 
 	VkResult acquireNextImage( uint64_t timeout, AcquireInfo *pAcquireInfo );
 
@@ -76,14 +87,17 @@ private:
 		FenceRef	 imageReadyFence;
 	};
 
-	VkSurfaceKHR		  mSurfaceHandle   = VK_NULL_HANDLE;
-	VkSwapchainKHR		  mSwapchainHandle = VK_NULL_HANDLE;
-	VkSurfaceFormatKHR	  mSurfaceFormat   = {};
-	uint32_t			  mNumBuffers	   = 0;
-	VkImageUsageFlags	  mUsageFlags	   = 0;
-	std::vector<ImageRef> mImages		   = {};
-	std::vector<Sync>	  mSyncs		   = {};
-	uint64_t			  mPresentCount	   = 0;
+	VkSurfaceKHR			  mSurfaceHandle   = VK_NULL_HANDLE;
+	VkSwapchainKHR			  mSwapchainHandle = VK_NULL_HANDLE;
+	VkSurfaceFormatKHR		  mSurfaceFormat   = {};
+	uint32_t				  mNumBuffers	   = 0;
+	uint32_t				  mMinImageCount   = 0;
+	VkImageUsageFlags		  mUsageFlags	   = 0;
+	std::vector<ImageRef>	  mImages		   = {};
+	std::vector<ImageViewRef> mImageViews	   = {};
+	std::vector<Sync>		  mSyncs		   = {};
+	uint64_t				  mAcquireCount	   = 0;
+	uint64_t				  mPresentCount	   = 0;
 };
 
 } // namespace cinder::vk
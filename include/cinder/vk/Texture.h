@@ -6,6 +6,8 @@
 #include "cinder/Rect.h"
 #include "cinder/Surface.h"
 
+#include <future>
+
 namespace cinder::vk {
 
 class Texture2d;
@@ -15,6 +17,13 @@ using Texture1dRef = std::shared_ptr<class Texture1d>;
 using Texture2dRef = std::shared_ptr<class Texture2d>;
 using Texture3dRef = std::shared_ptr<class Texture3d>;
 
+struct PrecompressedTextureData;
+
+template <typename TextureT>
+class TextureFuture;
+using Texture2dFuture	   = TextureFuture<class Texture2d>;
+using TextureCubeMapFuture = TextureFuture<class TextureCubeMap>;
+
 class TextureBase
 	: public vk::DeviceChildObject
 {
@@ -29,6 +38,12 @@ public:
 		void arrayLayers( uint32_t value ) { mArrayLayers = value; }
 		void imageUsage( VkImageUsageFlags value ) { mImageUsageFlags = value; }
 		void memoryUsage( MemoryUsage value ) { mMemoryUsage = value; }
+		//! Converts 32-bit float data to half float on upload, halves memory and bandwidth for HDR data
+		void halfFloat( bool value ) { mHalfFloat = value; }
+		//! Block compresses 8-bit data on worker threads before upload. Ignored for other data types or if the device can't sample the compressed format.
+		void compression( TextureCompression value ) { mCompression = value; }
+		//! Directory used to cache block compressed results between runs, keyed by a hash of the source texels. Disabled if empty.
+		void compressionCacheDirectory( const fs::path &value ) { mCompressionCacheDirectory = value; }
 
 		void setSampler( vk::SamplerRef sampler ) { mSampler = sampler; }
 		void minFilter( VkFilter value ) { mMinFilter = value; }
@@ -48,6 +63,9 @@ public:
 		VkImageTiling		  getTiling() const { return mTiling; }
 		VkImageUsageFlags	  getImageUsage() const { return mImageUsageFlags; }
 		MemoryUsage			  getMemoryUsage() const { return mMemoryUsage; }
+		bool				  getHalfFloat() const { return mHalfFloat; }
+		TextureCompression	  getCompression() const { return mCompression; }
+		const fs::path		 &getCompressionCacheDirectory() const { return mCompressionCacheDirectory; }
 
 		vk::SamplerRef		 getSampler() const { return mSampler; }
 		VkFilter			 getMinFilter() const { return mMinFilter; }
@@ -69,6 +87,9 @@ public:
 		VkImageTiling		  mTiling		   = VK_IMAGE_TILING_OPTIMAL;
 		VkImageUsageFlags	  mImageUsageFlags = 0;
 		MemoryUsage			  mMemoryUsage	   = MemoryUsage::GPU_ONLY;
+		bool				  mHalfFloat	   = false;
+		TextureCompression	  mCompression	   = TextureCompression::NONE;
+		fs::path			  mCompressionCacheDirectory;
 
 		// Sampler properties
 		vk::SamplerRef		 mSampler;
@@ -104,6 +125,11 @@ public:
 	const VkComponentMapping &getComponentMapping() const { return mComponentMapping; }
 	bool					  getUnnormalizedCoordinates() const { return mUnnormalizedCoordinates; }
 
+	//! Returns true once all uploads issued by createAsync have completed on the GPU. Always true for textures created synchronously.
+	bool isUploadComplete() const;
+	//! Blocks until all uploads issued by createAsync have completed on the GPU
+	void waitForUpload() const;
+
 	const vk::Image		*getImage() const { return mImage.get(); }
 	const vk::Sampler	  *getSampler() const { return mSampler.get(); }
 	const vk::ImageView *getSampledImageView() const { return mSampledImage.get(); }
@@ -121,6 +147,10 @@ protected:
 	void		 initImage( VkImageCreateFlags createFlags, VkFormat imageFormat, const Format &format );
 	void		 initSampler( const Format &format );
 	virtual void initViews() = 0;
+	//! Creates the image using the format and mip count stored in \a data and uploads all of its levels as is
+	void		 initPrecompressed( VkImageCreateFlags createFlags, const PrecompressedTextureData &data, Format format, bool asyncUpload = false );
+	//! Uploads the subresources of \a data that exist in the image with a single copy
+	void		 uploadData( const PrecompressedTextureData &data, bool asyncUpload = false );
 
 protected:
 	VkExtent3D		   mExtent		= {};
@@ -131,6 +161,7 @@ protected:
 	vk::ImageRef	   mImage;
 	vk::SamplerRef	   mSampler;
 	bool			   mDisposeSampler = false;
+	uint64_t		   mUploadValue	   = 0; // Async copy value, see Device::copyToImageAsync
 
 	vk::ImageViewRef mSampledImage;
 	vk::ImageViewRef mStorageImage;
@@ -151,6 +182,9 @@ public:
 		// clang-format off
 		Format& mipmap( uint32_t numLevels = CINDER_REMAINING_MIP_LEVELS ) { TextureBase::Format::mipmap(numLevels); return *this; }
 		Format& arrayLayers( uint32_t numLayers = CINDER_REMAINING_MIP_LEVELS ) { TextureBase::Format::arrayLayers(numLayers); return *this; }
+		Format& halfFloat( bool value = true ) { TextureBase::Format::halfFloat(value); return *this; }
+		Format& compression( TextureCompression value ) { TextureBase::Format::compression(value); return *this; }
+		Format& compressionCacheDirectory( const fs::path &value ) { TextureBase::Format::compressionCacheDirectory(value); return *this; }
 		//! Specifies whether the Texture should store scanlines top-down in memory. Default is \c false. Also marks Texture as top-down when \c true.
 		Format& loadTopDown( bool loadTopDown = true ) { mLoadTopDown = loadTopDown; return *this; }
 		// clang-format on
@@ -181,15 +215,15 @@ public:
 	//! Constructs a Texture based on \a imageSource. A default value of -1 for \a internalFormat chooses an appropriate internal format based on the contents of \a imageSource. Uses a Format's intermediate PBO when available, which is resized as necessary.
 	static Texture2dRef create( ImageSourceRef imageSource, const Format &format = Format(), vk::DeviceRef device = nullptr );
 
-	// @TODO: Implement these
-	/*
-	//! Constructs a Texture based on an instance of TextureData
-	static Texture2dRef create( const TextureData &data, const Format &format );
-	//! Constructs a Texture from an optionally compressed KTX file. Enables mipmapping if KTX file contains mipmaps and Format has not specified \c false for mipmapping. Uses Format's intermediate PBO if supplied; requires it to be large enough to hold all MIP levels and throws if it is not. (http://www.khronos.org/opengles/sdk/tools/KTX/file_format_spec/)
-	static Texture2dRef createFromKtx( const DataSourceRef &dataSource, const Format &format = Format() );
-	//! Constructs a Texture from a DDS file.
-	static Texture2dRef createFromDds( const DataSourceRef &dataSource, const Format &format = Format() );
-*/
+	//! Constructs a Texture from \a dataSource without blocking the calling thread. Decoding, conversion to RGBA and mip generation run on a worker thread and the upload is submitted without waiting. The returned handle yields the texture once its upload has completed.
+	static Texture2dFuture createAsync( const DataSourceRef &dataSource, const Format &format = Format(), vk::DeviceRef device = nullptr );
+	//! Constructs a Texture from \a imageSource without blocking the calling thread. See createAsync( const DataSourceRef& ).
+	static Texture2dFuture createAsync( const ImageSourceRef &imageSource, const Format &format = Format(), vk::DeviceRef device = nullptr );
+
+	//! Constructs a Texture from an optionally compressed KTX2 file. All mip levels stored in the file are uploaded without conversion. Throws if the device cannot sample the file's format. (https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html)
+	static Texture2dRef createFromKtx( const DataSourceRef &dataSource, const Format &format = Format(), vk::DeviceRef device = nullptr );
+	//! Constructs a Texture from a DDS file. Supports BC1-BC7 (legacy FourCC and DX10 headers) and common uncompressed formats. Throws if the device cannot sample the file's format.
+	static Texture2dRef createFromDds( const DataSourceRef &dataSource, const Format &format = Format(), vk::DeviceRef device = nullptr );
 
 	virtual void bind( uint32_t binding = 0 ) override;
 
@@ -218,10 +252,18 @@ protected:
 	Texture2d( vk::DeviceRef device, const Channel16u &channel, Format format = Format() );
 	Texture2d( vk::DeviceRef device, const Channel32f &channel, Format format = Format() );
 	Texture2d( vk::DeviceRef device, const ImageSourceRef &imageSource, Format format = Format() );
+	Texture2d( vk::DeviceRef device, const PrecompressedTextureData &data, Format format = Format(), bool asyncUpload = false );
 
 	virtual void initViews() override;
 
 private:
+	template <typename T>
+	void initFromSurface( const SurfaceT<T> &surface, const Format &format );
+	template <typename T>
+	void initFromChannel( const ChannelT<T> &channel, const Format &format );
+	template <typename T>
+	void initFromGrayAlpha( const ImageSourceRef &imageSource, const Format &format );
+
 	Area mCleanBounds; // relative to upper-left origin regardless of top-down
 };
 
@@ -238,6 +280,7 @@ public:
 
 		// clang-format off
 		Format& mipmap( uint32_t numLevels = CINDER_REMAINING_MIP_LEVELS ) { TextureBase::Format::mipmap(numLevels); return *this; }
+		Format& halfFloat( bool value = true ) { TextureBase::Format::halfFloat(value); return *this; }
 		// clang-format on
 
 	private:
@@ -250,6 +293,14 @@ public:
 
 	//! Automatically infers Horizontal Cross, Vertical Cross, Row, or Column based on image aspect ratio
 	static vk::TextureCubeMapRef create( const ImageSourceRef &imageSource, const Format &format = Format(), vk::DeviceRef device = nullptr );
+	//! Constructs a cube map from \a dataSource without blocking the calling thread. Face extraction, mip generation and upload work like Texture2d::createAsync.
+	static TextureCubeMapFuture createAsync( const DataSourceRef &dataSource, const Format &format = Format(), vk::DeviceRef device = nullptr );
+	//! Constructs a cube map from \a imageSource without blocking the calling thread.
+	static TextureCubeMapFuture createAsync( const ImageSourceRef &imageSource, const Format &format = Format(), vk::DeviceRef device = nullptr );
+	//! Constructs a cube map from a KTX2 file with 6 faces. All mip levels stored in the file are uploaded without conversion.
+	static vk::TextureCubeMapRef createFromKtx( const DataSourceRef &dataSource, const Format &format = Format(), vk::DeviceRef device = nullptr );
+	//! Constructs a cube map from a DDS cube map file. All mip levels stored in the file are uploaded without conversion.
+	static vk::TextureCubeMapRef createFromDds( const DataSourceRef &dataSource, const Format &format = Format(), vk::DeviceRef device = nullptr );
 
 	virtual void bind( uint32_t binding = 0 ) override;
 
@@ -263,11 +314,69 @@ public:
 private:
 	template <typename T>
 	TextureCubeMap( vk::DeviceRef device, const SurfaceT<T> images[6], Format format );
+	TextureCubeMap( vk::DeviceRef device, const PrecompressedTextureData &data, Format format, bool asyncUpload = false );
 
 	template <typename T>
 	static TextureCubeMapRef createTextureCubeMapImpl( const ImageSourceRef &imageSource, const Format &format, vk::DeviceRef device );
+	static TextureCubeMapRef createAsyncImpl( const ImageSourceRef &imageSource, const Format &format, vk::DeviceRef device );
 
 	virtual void initViews() override;
 };
 
+//! @class TextureFuture
+//!
+//! Handle returned by createAsync. The texture is only handed out once
+//! its upload has completed on the GPU, so it is always safe to bind.
+template <typename TextureT>
+class TextureFuture
+{
+public:
+	TextureFuture() {}
+	TextureFuture( const std::shared_future<std::shared_ptr<TextureT>> &future )
+		: mFuture( future ) {}
+
+	//! Returns true if this handle refers to a load
+	bool isValid() const { return mFuture.valid(); }
+	//! Returns true once the texture can be bound or if loading failed
+	bool isReady() const;
+	//! Returns the texture if it is ready, nullptr otherwise. Rethrows any exception thrown while loading.
+	std::shared_ptr<TextureT> tryGet() const { return isReady() ? get() : nullptr; }
+	//! Blocks until the texture is ready and returns it. Rethrows any exception thrown while loading.
+	std::shared_ptr<TextureT> get() const;
+
+private:
+	std::shared_future<std::shared_ptr<TextureT>> mFuture;
+};
+
+template <typename TextureT>
+bool TextureFuture<TextureT>::isReady() const
+{
+	if ( !mFuture.valid() || ( mFuture.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready ) ) {
+		return false;
+	}
+
+	// A failed load is also ready, get() rethrows the exception
+	try {
+		std::shared_ptr<TextureT> texture = mFuture.get();
+		return ( !texture || texture->isUploadComplete() );
+	}
+	catch ( ... ) {
+		return true;
+	}
+}
+
+template <typename TextureT>
+std::shared_ptr<TextureT> TextureFuture<TextureT>::get() const
+{
+	if ( !mFuture.valid() ) {
+		return nullptr;
+	}
+
+	std::shared_ptr<TextureT> texture = mFuture.get();
+	if ( texture ) {
+		texture->waitForUpload();
+	}
+	return texture;
+}
+
 } // namespace cinder::vk
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "cinder/vk/vk_config.h"
+#include "cinder/Filesystem.h"
 #include "cinder/GeomIo.h"
 
 namespace cinder::vk {
@@ -89,6 +90,15 @@ uint32_t formatSize( VkFormat format );
 //! Returns the number of components of format
 uint32_t formatComponentCount( VkFormat format );
 
+//! Returns true if format is a block compressed format (BCn, ETC2/EAC, ASTC, PVRTC)
+bool isCompressedFormat( VkFormat format );
+
+//! Returns the texel block extent of format, uncompressed formats return 1x1
+VkExtent2D formatBlockExtent( VkFormat format );
+
+//! Returns the size in bytes of a tightly packed mip level of width x height for format
+uint64_t formatDataSize( VkFormat format, uint32_t width, uint32_t height );
+
 // Determines the image aspect mask for format
 VkImageAspectFlags determineAspectMask( VkFormat format );
 
@@ -109,4 +119,9 @@ VkResult cmdTransitionImageLayout(
 	VkImageLayout			 newLayout,
 	VkPipelineStageFlags	 newPipelineStageFlags );
 
+//! Returns \a path with a suffix that's unique across processes, threads
+//! and calls. Files are written there first and renamed over \a path once
+//! complete, so concurrent writers never share a temporary file.
+fs::path uniqueTempPath( const fs::path &path );
+
 } // namespace cinder::vk
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "cinder/vk/vk_config.h"
+
+namespace cinder::vk {
+
+//! Returns the vertex input format a \a dims component attribute is
+//! stored in with \a encoding, VK_FORMAT_UNDEFINED if the combination
+//! isn't supported. 3 component FLOAT16 and UNORM16 attributes are padded
+//! to 4 components. Octahedral encodings store unit vectors in 2
+//! components; 4 component vectors (tangents) keep the sign of w in the
+//! 4th component. Shaders decode them with:
+//!
+//!   vec3 n = vec3( e.xy, 1.0 - abs( e.x ) - abs( e.y ) );
+//!   float t = max( -n.z, 0.0 );
+//!   n.xy += vec2( ( n.x >= 0.0 ) ? -t : t, ( n.y >= 0.0 ) ? -t : t );
+//!   n = normalize( n );
+//!
+VkFormat toVkFormat( vk::VertexEncoding encoding, uint8_t dims );
+
+//! Encodes \a count vertices of \a srcDims floats from \a pSrc into
+//! \a pDst, \a dstStride bytes apart. Missing components are 0, or 1 for
+//! w. UNORM16 values are divided by \a scale before they're clamped to
+//! [0, 1]. Conversion uses F16C/SSE2 where available.
+void encodeVertexData(
+	vk::VertexEncoding encoding,
+	float			   scale,
+	uint8_t			   srcDims,
+	const float		  *pSrc,
+	size_t			   count,
+	uint8_t			   dims,
+	size_t			   dstStride,
+	uint8_t			  *pDst );
+
+//! Converts a float to a half float, rounding to nearest even
+uint16_t floatToHalf( float value );
+//! Converts \a count floats from \a pSrc to half floats in \a pDst, using
+//! F16C, SSE2 or NEON where available
+void packHalf( const float *pSrc, size_t count, uint16_t *pDst );
+
+} // namespace cinder::vk
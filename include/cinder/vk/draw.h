@@ -4,6 +4,7 @@
 
 #include "cinder/Camera.h"
 #include "cinder/GeomIo.h"
+#include "cinder/PolyLine.h"
 
 namespace cinder::vk {
 
@@ -11,10 +12,38 @@ using BufferedMeshRef = std::shared_ptr<class BufferedMesh>;
 
 //! Draws the VboMesh \a mesh. Consider a vk::Batch as a faster alternative. Optionally specify a \a first vertex index and a \a count of vertices.
 CI_API void draw( const vk::BufferedMeshRef &mesh, int32_t first = 0, int32_t count = -1 );
-//! Draws a Texture2d \a texture, fitting it to \a dstRect. Ignores currently bound shader.
+//! Draws a Texture2d \a texture, fitting it to \a dstRect. Ignores currently bound shader. Consecutive draws of the same texture are batched into one instanced draw, see vk::ShapeBatch.
 CI_API void draw( const vk::Texture2dRef &texture, const Rectf &dstRect );
 //! Draws a subregion \a srcArea of a Texture (expressed as upper-left origin pixels).
 CI_API void draw( const vk::Texture2dRef &texture, const Area &srcArea, const Rectf &dstRect );
 CI_API void draw( const vk::Texture2dRef &texture, const vec2 &dstOffset = vec2() );
 
+// Shapes are batched, consecutive shapes drawn with the same view projection,
+// blend and depth state are merged into a single draw. See vk::ShapeBatch.
+
+//! Draws a line from \a start to \a end, \a width pixels wide
+CI_API void drawLine( const vec2 &start, const vec2 &end, float width = 1.0f );
+//! Draws \a polyLine as a mitered strip \a lineWidth wide
+CI_API void draw( const PolyLine2f &polyLine, float lineWidth = 1.0f );
+//! Draws a filled rectangle with dimensions \a r.
+CI_API void drawSolidRect( const Rectf &r );
+//! Draws a stroked rectangle centered on the edges of \a rect, \a lineWidth wide
+CI_API void drawStrokedRect( const Rectf &rect, float lineWidth = 1.0f );
+//! Draws a filled circle centered around \a center with a radius of \a radius. Default \a numSegments requests a conservative (high-quality but slow) number based on radius.
+CI_API void drawSolidCircle( const vec2 &center, float radius, int numSegments = -1 );
+//! Draws a stroked circle centered around \a center with a radius of \a radius and a line \a lineWidth wide. Default \a numSegments requests a conservative (high-quality but slow) number based on radius.
+CI_API void drawStrokedCircle( const vec2 &center, float radius, float lineWidth = 1.0f, int numSegments = -1 );
+//! Draws a filled triangle with vertices \a pt0, \a pt1, \a pt2
+CI_API void drawSolidTriangle( const vec2 &pt0, const vec2 &pt1, const vec2 &pt2 );
+//! Draws any shapes that are still pending. The vk:: draw wrappers and the context flush them automatically, raw Context draws don't, see vk::ShapeBatch.
+CI_API void flushShapes();
+
+//! Dispatches the compute shader of the bound program with the default
+//! descriptor set: textures, uniform blocks, storage buffers and storage
+//! images bound to the context. Later draws and dispatches see what it
+//! stores, see Context::dispatch().
+CI_API void dispatch( uint32_t groupCountX, uint32_t groupCountY = 1, uint32_t groupCountZ = 1 );
+//! Like dispatch(), the group counts are read from the VkDispatchIndirectCommand at \a offset in \a buffer
+CI_API void dispatchIndirect( const vk::BufferRef &buffer, uint64_t offset = 0 );
+
 } // namespace cinder::vk
@@ -1,13 +1,17 @@
 #pragma once
 
+#include "cinder/vk/AsyncCompute.h"
 #include "cinder/vk/Batch.h"
 #include "cinder/vk/Buffer.h"
 #include "cinder/vk/Device.h"
 #include "cinder/vk/draw.h"
 #include "cinder/vk/GlslProg.h"
+#include "cinder/vk/GpuCuller.h"
 #include "cinder/vk/HlslProg.h"
 #include "cinder/vk/Mesh.h"
+#include "cinder/vk/MultiBatch.h"
 #include "cinder/vk/Pipeline.h"
+#include "cinder/vk/RenderGraph.h"
 #include "cinder/vk/Texture.h"
 #include "cinder/vk/scoped.h"
 #include "cinder/vk/wrapper.h"
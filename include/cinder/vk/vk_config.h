@@ -129,8 +129,30 @@ enum class MemoryUsage
 	CPU_TO_GPU,
 	GPU_ONLY,
 	GPU_TO_CPU,
+	GPU_LAZILY_ALLOCATED, // Transient attachments, see Device::isLazilyAllocatedMemorySupported()
 };
 
+enum class TextureCompression
+{
+	NONE = 0,
+	BC1,
+	BC3,
+	BC4,
+	BC5,
+	BC7,
+};
+
+//! Storage of a vertex attribute in a BufferedMesh, see BufferedMesh::Layout::attrib()
+enum class VertexEncoding
+{
+	FLOAT32 = 0,
+	FLOAT16,
+	OCTAHEDRAL_SNORM16,
+	OCTAHEDRAL_SNORM8,
+	UNORM16,
+};
+
+class AsyncCompute;
 class Batch;
 class Buffer;
 class BufferedMesh;
@@ -146,17 +168,22 @@ class Device;
 class Fence;
 class Framebuffer;
 class GlslProg;
+class GpuCuller;
 class HlslProg;
 class Image;
 class ImageView;
+class MultiBatch;
 class MutableBuffer;
 class Pipeline;
 class PipelineLayout;
+class QueryPool;
+class RenderGraph;
 class RenderPass;
 class Sampler;
 class Semaphore;
 class ShaderModule;
 class ShaderProg;
+class ShapeBatch;
 class Swapchain;
 class TextureBase;
 class Texture1d;
@@ -165,6 +192,7 @@ class Texture3d;
 class TextureCubeMap;
 class UniformBuffer;
 
+using AsyncComputeRef		 = std::shared_ptr<AsyncCompute>;
 using BatchRef				 = std::shared_ptr<Batch>;
 using BufferRef				 = std::shared_ptr<Buffer>;
 using BufferedMeshRef		 = std::shared_ptr<BufferedMesh>;
@@ -180,12 +208,16 @@ using DeviceRef				 = std::shared_ptr<Device>;
 using FenceRef				 = std::shared_ptr<Fence>;
 using FramebufferRef		 = std::shared_ptr<Framebuffer>;
 using GlslProgRef			 = std::shared_ptr<GlslProg>;
+using GpuCullerRef			 = std::shared_ptr<GpuCuller>;
 using HlslProgRef			 = std::shared_ptr<HlslProg>;
 using ImageRef				 = std::shared_ptr<Image>;
 using ImageViewRef			 = std::shared_ptr<ImageView>;
+using MultiBatchRef			 = std::shared_ptr<MultiBatch>;
 using MutableBufferRef		 = std::shared_ptr<MutableBuffer>;
 using PipelineRef			 = std::shared_ptr<Pipeline>;
 using PipelineLayoutRef		 = std::shared_ptr<PipelineLayout>;
+using QueryPoolRef			 = std::shared_ptr<QueryPool>;
+using RenderGraphRef		 = std::shared_ptr<RenderGraph>;
 using RenderPassRef			 = std::shared_ptr<RenderPass>;
 using SamplerRef			 = std::shared_ptr<Sampler>;
 using SemaphoreRef			 = std::shared_ptr<Semaphore>;
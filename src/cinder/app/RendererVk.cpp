@@ -22,11 +22,14 @@ thread_local RendererVk *RendererVk::sCurrentRenderer = nullptr;
 
 struct RendererVk::Frame
 {
-	vk::CommandBufferRef commandBuffer;
-	vk::SemaphoreRef	 presentReady;
-	uint64_t			 signaledValue = 0;
+	vk::SemaphoreRef presentReady;
 };
 
+static double elapsedMs( std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end )
+{
+	return std::chrono::duration<double, std::milli>( end - start ).count();
+}
+
 RendererVk::RendererVk( const RendererVk &renderer )
 	: mOptions( renderer.mOptions ),
 	  mDevice( renderer.mDevice )
@@ -62,6 +65,12 @@ vk::SwapchainRef RendererVk::getSwapchain() const
 	return mSwapchain;
 }
 
+RendererVk::PresentStats RendererVk::getPresentStats() const
+{
+	std::lock_guard<std::mutex> lock( mPresentMutex );
+	return mPresentStats;
+}
+
 RendererRef RendererVk::clone() const
 {
 	return RendererVkRef( new RendererVk( *this ) );
@@ -109,14 +118,142 @@ void RendererVk::setupDevice( const std::string &appName, RendererRef sharedRend
 
 void RendererVk::setupFrames( uint32_t windowWidth, uint32_t windowHeight )
 {
-	const uint32_t numFrames = getOptions().getNumFramesInFlight();
+	// Frames are indexed by the context's frame index
+	const uint32_t numFrames = mContext->getNumFramesInFlight();
 
 	mFrames.resize( numFrames );
 
 	for ( uint32_t i = 0; i < numFrames; ++i ) {
-		Frame &frame		= mFrames[i];
-		frame.commandBuffer = vk::CommandBuffer::create( mCommandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, mDevice );
-		frame.presentReady	= vk::Semaphore::create( mDevice );
+		Frame &frame	   = mFrames[i];
+		frame.presentReady = vk::Semaphore::create( mDevice );
+	}
+}
+
+void RendererVk::startPresentThread()
+{
+	if ( !mSwapchain || !mOptions.getPresentThread() ) {
+		return;
+	}
+
+	mPresentSync	   = vk::CountingSemaphore::create( 0, mDevice );
+	mStopPresentThread = false;
+	mPresentThread	   = std::thread( &RendererVk::presentThreadFn, this );
+}
+
+void RendererVk::stopPresentThread()
+{
+	if ( !mPresentThread.joinable() ) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( mPresentMutex );
+		mStopPresentThread = true;
+	}
+	mPresentCondition.notify_all();
+	mPresentThread.join();
+
+	// Anything left behind was acquired or submitted, the device is idled before the swapchain goes away
+	mAcquiredImages.clear();
+	mPresentRequests.clear();
+}
+
+void RendererVk::presentThreadFn()
+{
+	// Frames still waiting on the GPU or present share mFrames' presentReady
+	// semaphores with the frame being recorded, so only numFrames - 1 can be
+	// outstanding before the render thread has to wait
+	const uint64_t maxPendingPresents = mFrames.size() - 1;
+
+	std::unique_lock<std::mutex> lock( mPresentMutex );
+	while ( !mStopPresentThread && !mPresentThreadExc ) {
+		try {
+			// Queued presents go first, they release the images an acquire
+			// may be waiting for. Only this thread acquires and presents, so
+			// the swapchain's count of acquired images is stable here.
+			if ( mPresentRequests.empty() ) {
+				// Acquire ahead so the render thread doesn't wait on the display
+				const uint64_t pendingPresents = mRequestedPresents - mCompletedPresents;
+				if ( mAcquiredImages.empty() && ( pendingPresents <= maxPendingPresents ) && mSwapchain->canAcquireWithoutTimeout() ) {
+					lock.unlock();
+					AcquiredImage image = acquireSwapchainImage();
+					lock.lock();
+
+					mAcquiredImages.push_back( image );
+					mPresentCondition.notify_all();
+					continue;
+				}
+
+				mPresentCondition.wait( lock );
+				continue;
+			}
+
+			PresentRequest request = mPresentRequests.front();
+			mPresentRequests.pop_front();
+			lock.unlock();
+
+			// Present is queued once the GPU is done with the frame, so a
+			// display that's slow to release images only stalls this thread
+			mPresentSync->wait( request.readyValue );
+			auto gpuDoneTime = std::chrono::steady_clock::now();
+
+			presentSwapchainImage( request.imageIndex, request.presentReady );
+			auto presentTime = std::chrono::steady_clock::now();
+
+			lock.lock();
+			++mCompletedPresents;
+			mPresentStats.frameCount	   = request.frameCount;
+			mPresentStats.gpuLatencyMs	   = elapsedMs( request.handoffTime, gpuDoneTime );
+			mPresentStats.presentLatencyMs = elapsedMs( request.handoffTime, presentTime );
+			mPresentCondition.notify_all();
+		}
+		catch ( ... ) {
+			// Rethrown on the render thread
+			if ( !lock.owns_lock() ) {
+				lock.lock();
+			}
+			mPresentThreadExc = std::current_exception();
+			mPresentCondition.notify_all();
+		}
+	}
+}
+
+RendererVk::AcquiredImage RendererVk::acquireSwapchainImage()
+{
+	vk::Swapchain::AcquireInfo acquireInfo = {};
+
+	VkResult vkres = getSwapchain()->acquireNextImage( UINT64_MAX, &acquireInfo );
+	if ( vkres != VK_SUCCESS ) {
+		// An error actually happened
+		if ( vkres < VK_SUCCESS ) {
+			throw vk::VulkanFnFailedExc( "acquire next image wrapper", vkres );
+		}
+		else {
+			// @TODO: recreate swapchain
+		}
+	}
+
+	AcquiredImage image = {};
+	image.imageIndex	= acquireInfo.imageIndex;
+	image.imageReady	= acquireInfo.imageReady;
+	return image;
+}
+
+void RendererVk::presentSwapchainImage( uint32_t imageIndex, const vk::SemaphoreRef &presentReady )
+{
+	vk::Swapchain::PresentInfo presentInfo = {};
+	presentInfo.imageIndex				   = imageIndex;
+	presentInfo.presentReady			   = presentReady;
+
+	VkResult vkres = getSwapchain()->present( &presentInfo );
+	if ( vkres != VK_SUCCESS ) {
+		// An error actually happened
+		if ( vkres < VK_SUCCESS ) {
+			throw vk::VulkanFnFailedExc( "swapchain present wrapper", vkres );
+		}
+		else {
+			// @TODO: recreate swapchain
+		}
 	}
 }
 
@@ -130,6 +267,11 @@ void RendererVk::setup( WindowImplMsw *windowImpl, RendererRef sharedRenderer )
 	// Setup swapchain for window
 	{
 		vk::Swapchain::Options options = vk::Swapchain::Options();
+		// The present thread holds up to numFramesInFlight - 1 images waiting
+		// for present, the one being rendered and one acquired ahead
+		if ( mOptions.getPresentThread() ) {
+			options.numAcquiredImages( mOptions.getNumFramesInFlight() + 1 );
+		}
 
 		mSwapchain = vk::Swapchain::create( windowImpl, options, getDevice() );
 	}
@@ -138,7 +280,10 @@ void RendererVk::setup( WindowImplMsw *windowImpl, RendererRef sharedRenderer )
 	{
 		vk::Context::Options options = vk::Context::Options()
 										   .setRenderTargets( { mSwapchain->getSurfaceFormat().format } )
-										   .sampleCount( mOptions.getMsaa() );
+										   .sampleCount( mOptions.getMsaa() )
+										   .numInFlightFrames( mOptions.getNumFramesInFlight() )
+										   .transientAttachments( mOptions.getTransientAttachments() )
+										   .presentable();
 
 		mContext = vk::Context::create(
 			static_cast<uint32_t>( windowImpl->getSize().x ),
@@ -147,14 +292,10 @@ void RendererVk::setup( WindowImplMsw *windowImpl, RendererRef sharedRenderer )
 			mDevice );
 	}
 
-	// Frame sync
-	mFrameSync = vk::CountingSemaphore::create( 0, mDevice );
-
-	// Command pool
-	mCommandPool = vk::CommandPool::create( mDevice->getQueueFamilyIndices().graphics, vk::CommandPool::Options(), mDevice );
-
 	// Setup frames
 	setupFrames( windowImpl->getSize().x, windowImpl->getSize().y );
+
+	startPresentThread();
 }
 
 HWND RendererVk::getHwnd() const
@@ -181,6 +322,8 @@ void RendererVk::setup( void *nativeWindow, RendererRef sharedRenderer )
 
 void RendererVk::kill()
 {
+	stopPresentThread();
+
 	mDevice->waitIdle();
 	mSwapchain.reset();
 	mDevice.reset();
@@ -231,124 +374,84 @@ void RendererVk::makeCurrentContext( bool force )
 	(void)force;
 	sCurrentRenderer = this;
 
-	// Frame data
-	const uint32_t contextFrameIndex = mContext->getFrameIndex();
-	Frame		  &frame			 = mFrames[contextFrameIndex];
+	// Acquire the swapchain image the context renders into, once per frame
+	if ( mSwapchain && ( mSwapchainImageIndex == UINT32_MAX ) ) {
+		AcquiredImage image = {};
+		if ( mPresentThread.joinable() ) {
+			// Take the image the present thread acquired once this frame's
+			// presentReady is no longer used by a pending present
+			const uint64_t maxPendingPresents = mFrames.size() - 1;
+
+			std::unique_lock<std::mutex> lock( mPresentMutex );
+			mPresentCondition.wait( lock, [this, maxPendingPresents]() {
+				return mPresentThreadExc || ( !mAcquiredImages.empty() && ( ( mRequestedPresents - mCompletedPresents ) <= maxPendingPresents ) );
+			} );
+			if ( mPresentThreadExc ) {
+				std::rethrow_exception( mPresentThreadExc );
+			}
 
-	// Waits for frame's work to complete (i.e. present work)
-	std::vector<vk::Context::SemaphoreInfo> waits;
+			image = mAcquiredImages.front();
+			mAcquiredImages.pop_front();
+			lock.unlock();
+			mPresentCondition.notify_all();
+		}
+		else {
+			image = acquireSwapchainImage();
+		}
 
-	// Avoid unnecessary waits
-	uint64_t counterValue = mFrameSync->getCounterValue();
-	if ( counterValue < frame.signaledValue ) {
-		waits.push_back( { mFrameSync.get(), frame.signaledValue } );
+		const Frame &frame	 = mFrames[mContext->getFrameIndex()];
+		mSwapchainImageIndex = image.imageIndex;
+		mContext->setPresentImage( mSwapchain->getImageViews()[mSwapchainImageIndex], image.imageReady, frame.presentReady );
 	}
 
-	mContext->makeCurrent( waits );
+	mContext->makeCurrent();
 }
 
 void RendererVk::swapBuffers()
 {
-	// Value to signal when context's work is complete
-	uint64_t contextWorkCompleteValue = mFrameSync->incrementCounter();
+	// Current renderer frame, get it before submit increments the context's frame index
+	const Frame	  &frame	  = mFrames[mContext->getFrameIndex()];
+	const uint64_t frameCount = mContext->getFrameCount();
 
-	// Get current context data before submit
-	uint32_t	 contextFrameIndex = mContext->getFrameIndex();
-	vk::ImageRef contextImage	   = mContext->getRenderTargetView( 0 )->getImage();
+	// Hand the frame to the present thread, it presents once the GPU signals readyValue
+	if ( mPresentThread.joinable() && ( mSwapchainImageIndex != UINT32_MAX ) ) {
+		PresentRequest request = {};
+		request.imageIndex	   = mSwapchainImageIndex;
+		request.presentReady   = frame.presentReady;
+		request.readyValue	   = mPresentSync->incrementCounter();
+		request.frameCount	   = frameCount;
 
-	// Submit context frame's work - this will increment frame index
-	std::vector<vk::Context::SemaphoreInfo> waits;
-	std::vector<vk::Context::SemaphoreInfo> signals = { { mFrameSync.get(), contextWorkCompleteValue } };
-	mContext->submit( waits, signals );
+		// The context rendered straight into the swapchain image, submit
+		// transitions it for present and signals the frame's presentReady
+		mContext->submit( std::vector<vk::Context::SemaphoreInfo>(), { { mPresentSync.get(), request.readyValue } } );
+		request.handoffTime = std::chrono::steady_clock::now();
 
-	// Acquire next swapchain image
-	vk::Swapchain::AcquireInfo acquireInfo = {};
+		mSwapchainImageIndex = UINT32_MAX;
 
-	VkResult vkres = getSwapchain()->acquireNextImage( UINT64_MAX, &acquireInfo );
-	if ( vkres != VK_SUCCESS ) {
-		// An error actually happened
-		if ( vkres < VK_SUCCESS ) {
-			throw vk::VulkanFnFailedExc( "acquire next image wrapper", vkres );
-		}
-		else {
-			// @TODO: recreate swapchain
+		{
+			std::lock_guard<std::mutex> lock( mPresentMutex );
+			if ( mPresentThreadExc ) {
+				std::rethrow_exception( mPresentThreadExc );
+			}
+			mPresentRequests.push_back( request );
+			++mRequestedPresents;
 		}
+		mPresentCondition.notify_all();
+		return;
 	}
 
-	// Current renderer frame
-	Frame			  &frame		   = mFrames[contextFrameIndex];
-	const vk::ImageRef &swapchainImage = acquireInfo.image;
+	// The context rendered straight into the swapchain image, submit
+	// transitions it for present and signals the frame's presentReady
+	mContext->submit( std::vector<vk::Context::SemaphoreInfo>(), std::vector<vk::Context::SemaphoreInfo>() );
 
-	// Build commnad buffer to copy context render target to swapchain
-	frame.commandBuffer->begin();
-	{
-		// Resolve if needed othewise just copy
-		if ( mOptions.getMsaa() > 1 ) {
-			VkImageResolve region = {};
-			region.srcSubresource = { contextImage->getAspectMask(), 0, 0, 1 };
-			region.srcOffset	  = {};
-			region.dstSubresource = { swapchainImage->getAspectMask(), 0, 0, 1 };
-			region.dstOffset	  = {};
-			region.extent		  = swapchainImage->getExtent();
-
-			CI_VK_DEVICE_FN( CmdResolveImage(
-				frame.commandBuffer->getCommandBufferHandle(),
-				contextImage->getImageHandle(),
-				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-				swapchainImage->getImageHandle(),
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				1,
-				&region ) );
-		}
-		else {
-			VkImageCopy region	  = {};
-			region.srcSubresource = { contextImage->getAspectMask(), 0, 0, 1 };
-			region.srcOffset	  = {};
-			region.dstSubresource = { swapchainImage->getAspectMask(), 0, 0, 1 };
-			region.dstOffset	  = {};
-			region.extent		  = swapchainImage->getExtent();
-
-			CI_VK_DEVICE_FN( CmdCopyImage(
-				frame.commandBuffer->getCommandBufferHandle(),
-				contextImage->getImageHandle(),
-				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-				swapchainImage->getImageHandle(),
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				1,
-				&region ) );
-		}
-	}
-	frame.commandBuffer->end();
-
-	frame.signaledValue = mFrameSync->incrementCounter();
-
-	// Submit command buffer
-	vk::SubmitInfo submitInfo = vk::SubmitInfo()
-									.addCommandBuffer( frame.commandBuffer )
-									.addWait( acquireInfo.imageReady )
-									.addWait( mFrameSync, contextWorkCompleteValue )
-									.addSignal( frame.presentReady )
-									.addSignal( mFrameSync, frame.signaledValue );
-	vkres = mDevice->submitGraphics( submitInfo );
-	if ( vkres != VK_SUCCESS ) {
-		throw vk::VulkanFnFailedExc( "vkQueueSumbit", vkres );
+	if ( mSwapchainImageIndex == UINT32_MAX ) {
+		return;
 	}
 
 	// Queue present
-	vk::Swapchain::PresentInfo presentInfo = {};
-	presentInfo.imageIndex				   = acquireInfo.imageIndex;
-	presentInfo.presentReady			   = frame.presentReady;
-
-	vkres = getSwapchain()->present( &presentInfo );
-	if ( vkres != VK_SUCCESS ) {
-		// An error actually happened
-		if ( vkres < VK_SUCCESS ) {
-			throw vk::VulkanFnFailedExc( "swapchain present wrapper", vkres );
-		}
-		else {
-			// @TODO: recreate swapchain
-		}
-	}
+	const uint32_t imageIndex = mSwapchainImageIndex;
+	mSwapchainImageIndex	  = UINT32_MAX;
+	presentSwapchainImage( imageIndex, frame.presentReady );
 }
 
 Surface8u RendererVk::copyWindowSurface( const Area &area, int32_t windowHeightPixels )
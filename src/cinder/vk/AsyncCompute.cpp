@@ -0,0 +1,268 @@
+#include "cinder/vk/AsyncCompute.h"
+#include "cinder/vk/Buffer.h"
+#include "cinder/vk/Command.h"
+#include "cinder/vk/Device.h"
+#include "cinder/vk/Image.h"
+#include "cinder/vk/Sync.h"
+#include "cinder/app/RendererVk.h"
+
+namespace cinder::vk {
+
+AsyncComputeRef AsyncCompute::create( uint32_t numBatchesInFlight, vk::DeviceRef device )
+{
+	if ( !device ) {
+		device = app::RendererVk::getCurrentRenderer()->getDevice();
+	}
+
+	return AsyncComputeRef( new AsyncCompute( device, numBatchesInFlight ) );
+}
+
+AsyncCompute::AsyncCompute( vk::DeviceRef device, uint32_t numBatchesInFlight )
+	: vk::DeviceChildObject( device )
+{
+	numBatchesInFlight = std::max<uint32_t>( numBatchesInFlight, 1 );
+
+	mCommandPool = vk::CommandPool::create( device->getComputeQueueFamilyIndex(), vk::CommandPool::Options(), device );
+	mSemaphore	 = vk::CountingSemaphore::create( 0, device );
+
+	std::vector<vk::CommandBufferRef> commandBuffers = mCommandPool->allocateCommandBuffers( numBatchesInFlight );
+
+	mBatches.resize( numBatchesInFlight );
+	for ( uint32_t i = 0; i < numBatchesInFlight; ++i ) {
+		mBatches[i].commandBuffer = commandBuffers[i];
+	}
+	// First begin() starts at batch 0
+	mBatchIndex = numBatchesInFlight - 1;
+}
+
+AsyncCompute::~AsyncCompute()
+{
+	// Command buffers can't be freed while the GPU is using them
+	if ( mSubmittedValue > 0 ) {
+		mSemaphore->wait( mSubmittedValue );
+	}
+}
+
+bool AsyncCompute::isAsync() const
+{
+	return getDevice()->isAsyncComputeSupported();
+}
+
+vk::CommandBuffer *AsyncCompute::begin()
+{
+	if ( getCommandBuffer() != nullptr ) {
+		throw VulkanExc( "async compute batch already recording, call submit() before begin()" );
+	}
+
+	mBatchIndex	 = ( mBatchIndex + 1 ) % countU32( mBatches );
+	Batch &batch = mBatches[mBatchIndex];
+	if ( batch.signaledValue > 0 ) {
+		mSemaphore->wait( batch.signaledValue );
+	}
+
+	mHandoffs.clear();
+	batch.commandBuffer->begin();
+
+	return batch.commandBuffer.get();
+}
+
+vk::CommandBuffer *AsyncCompute::getCommandBuffer() const
+{
+	vk::CommandBuffer *pCommandBuffer = mBatches[mBatchIndex].commandBuffer.get();
+	return pCommandBuffer->isRecording() ? pCommandBuffer : nullptr;
+}
+
+void AsyncCompute::handoff( const vk::BufferRef &buffer, VkPipelineStageFlags2KHR srcStageMask, VkAccessFlags2KHR srcAccessMask, VkPipelineStageFlags2KHR dstStageMask, VkAccessFlags2KHR dstAccessMask )
+{
+	if ( getCommandBuffer() == nullptr ) {
+		throw VulkanExc( "handoff() called outside of an async compute batch" );
+	}
+
+	Handoff handoff		  = {};
+	handoff.buffer		  = buffer;
+	handoff.oldLayout	  = VK_IMAGE_LAYOUT_UNDEFINED;
+	handoff.newLayout	  = VK_IMAGE_LAYOUT_UNDEFINED;
+	handoff.srcStageMask  = srcStageMask;
+	handoff.srcAccessMask = srcAccessMask;
+	handoff.dstStageMask  = dstStageMask;
+	handoff.dstAccessMask = dstAccessMask;
+	mHandoffs.push_back( handoff );
+}
+
+void AsyncCompute::handoff( const vk::ImageRef &image, VkImageLayout oldLayout, VkImageLayout newLayout, VkPipelineStageFlags2KHR srcStageMask, VkAccessFlags2KHR srcAccessMask, VkPipelineStageFlags2KHR dstStageMask, VkAccessFlags2KHR dstAccessMask )
+{
+	if ( getCommandBuffer() == nullptr ) {
+		throw VulkanExc( "handoff() called outside of an async compute batch" );
+	}
+
+	Handoff handoff		  = {};
+	handoff.image		  = image;
+	handoff.oldLayout	  = oldLayout;
+	handoff.newLayout	  = newLayout;
+	handoff.srcStageMask  = srcStageMask;
+	handoff.srcAccessMask = srcAccessMask;
+	handoff.dstStageMask  = dstStageMask;
+	handoff.dstAccessMask = dstAccessMask;
+	mHandoffs.push_back( handoff );
+}
+
+uint64_t AsyncCompute::submit( const std::vector<vk::Context::SemaphoreInfo> &waits )
+{
+	vk::CommandBuffer *pCommandBuffer = getCommandBuffer();
+	if ( pCommandBuffer == nullptr ) {
+		throw VulkanExc( "submit() called without begin()" );
+	}
+
+	// Releases go last so they cover everything the batch recorded
+	recordHandoffs( pCommandBuffer, mHandoffs, false );
+	pCommandBuffer->end();
+
+	Batch &batch		= mBatches[mBatchIndex];
+	batch.signaledValue = mSemaphore->incrementCounter();
+
+	vk::SubmitInfo submitInfo = vk::SubmitInfo().addCommandBuffer( batch.commandBuffer ).addSignal( mSemaphore.get(), batch.signaledValue );
+	for ( const auto &wait : waits ) {
+		submitInfo.addWait( wait.semaphore, wait.value, wait.stageMask );
+	}
+
+	VkResult vkres = getDevice()->submitCompute( submitInfo );
+	if ( vkres != VK_SUCCESS ) {
+		throw VulkanFnFailedExc( "vkQueueSubmit2KHR", vkres );
+	}
+
+	mSubmittedValue = batch.signaledValue;
+	mPendingAcquires.insert( mPendingAcquires.end(), mHandoffs.begin(), mHandoffs.end() );
+	mHandoffs.clear();
+
+	return mSubmittedValue;
+}
+
+void AsyncCompute::acquire( vk::Context *ctx )
+{
+	if ( mSubmittedValue == 0 ) {
+		return;
+	}
+
+	// Waiting for the last value covers every earlier batch
+	VkPipelineStageFlags2KHR stageMask = 0;
+	for ( const auto &handoff : mPendingAcquires ) {
+		stageMask |= handoff.dstStageMask;
+	}
+	if ( stageMask == 0 ) {
+		stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR;
+	}
+	ctx->addSubmitWait( { mSemaphore.get(), mSubmittedValue, stageMask } );
+
+	// Same queue family: the semaphore makes the writes visible and layouts
+	// were transitioned by the batch itself
+	if ( isAsync() && !mPendingAcquires.empty() ) {
+		vk::CommandBuffer *pCommandBuffer = ctx->getCurrentCommandBuffer();
+
+		// Barriers can't be recorded inside dynamic rendering
+		const bool rendering = pCommandBuffer->isRendering();
+		if ( rendering ) {
+			ctx->suspendRendering();
+		}
+
+		recordHandoffs( pCommandBuffer, mPendingAcquires, true );
+
+		if ( rendering ) {
+			ctx->resumeRendering();
+		}
+	}
+
+	mPendingAcquires.clear();
+}
+
+vk::Semaphore *AsyncCompute::getSemaphore() const
+{
+	return mSemaphore.get();
+}
+
+bool AsyncCompute::isComplete( uint64_t value ) const
+{
+	return mSemaphore->getCounterValue() >= value;
+}
+
+void AsyncCompute::wait( uint64_t value, uint64_t timeout )
+{
+	mSemaphore->wait( value, timeout );
+}
+
+void AsyncCompute::recordHandoffs( vk::CommandBuffer *pCommandBuffer, const std::vector<Handoff> &handoffs, bool acquire ) const
+{
+	// A separate compute queue always comes from a compute only family
+	const bool	   transfer		  = isAsync();
+	const uint32_t computeFamily  = getDevice()->getComputeQueueFamilyIndex();
+	const uint32_t graphicsFamily = getDevice()->getQueueFamilyIndices().graphics;
+
+	std::vector<VkBufferMemoryBarrier2KHR> bufferBarriers;
+	std::vector<VkImageMemoryBarrier2KHR>  imageBarriers;
+	for ( const auto &handoff : handoffs ) {
+		// Same queue family: the semaphore makes the writes visible, only layouts change
+		if ( !transfer && ( !handoff.image || ( handoff.oldLayout == handoff.newLayout ) ) ) {
+			continue;
+		}
+
+		// The release's second scope is empty for ownership transfers. The
+		// acquire chains with the semaphore wait through its first scope.
+		VkPipelineStageFlags2KHR srcStageMask  = acquire ? handoff.dstStageMask : handoff.srcStageMask;
+		VkAccessFlags2KHR		 srcAccessMask = acquire ? 0 : handoff.srcAccessMask;
+		VkPipelineStageFlags2KHR dstStageMask  = acquire ? handoff.dstStageMask : ( transfer ? VK_PIPELINE_STAGE_2_NONE_KHR : VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR );
+		VkAccessFlags2KHR		 dstAccessMask = acquire ? handoff.dstAccessMask : 0;
+		uint32_t				 srcFamily	   = transfer ? computeFamily : VK_QUEUE_FAMILY_IGNORED;
+		uint32_t				 dstFamily	   = transfer ? graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+
+		if ( handoff.image ) {
+			VkImageMemoryBarrier2KHR vkimb		  = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR };
+			vkimb.pNext							  = nullptr;
+			vkimb.srcStageMask					  = srcStageMask;
+			vkimb.srcAccessMask					  = srcAccessMask;
+			vkimb.dstStageMask					  = dstStageMask;
+			vkimb.dstAccessMask					  = dstAccessMask;
+			vkimb.oldLayout						  = handoff.oldLayout;
+			vkimb.newLayout						  = handoff.newLayout;
+			vkimb.srcQueueFamilyIndex			  = srcFamily;
+			vkimb.dstQueueFamilyIndex			  = dstFamily;
+			vkimb.image							  = handoff.image->getImageHandle();
+			vkimb.subresourceRange.aspectMask	  = handoff.image->getAspectMask();
+			vkimb.subresourceRange.baseMipLevel	  = 0;
+			vkimb.subresourceRange.levelCount	  = VK_REMAINING_MIP_LEVELS;
+			vkimb.subresourceRange.baseArrayLayer = 0;
+			vkimb.subresourceRange.layerCount	  = VK_REMAINING_ARRAY_LAYERS;
+			imageBarriers.push_back( vkimb );
+		}
+		else {
+			VkBufferMemoryBarrier2KHR vkbmb = { VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR };
+			vkbmb.pNext						= nullptr;
+			vkbmb.srcStageMask				= srcStageMask;
+			vkbmb.srcAccessMask				= srcAccessMask;
+			vkbmb.dstStageMask				= dstStageMask;
+			vkbmb.dstAccessMask				= dstAccessMask;
+			vkbmb.srcQueueFamilyIndex		= srcFamily;
+			vkbmb.dstQueueFamilyIndex		= dstFamily;
+			vkbmb.buffer					= handoff.buffer->getBufferHandle();
+			vkbmb.offset					= 0;
+			vkbmb.size						= VK_WHOLE_SIZE;
+			bufferBarriers.push_back( vkbmb );
+		}
+	}
+
+	if ( bufferBarriers.empty() && imageBarriers.empty() ) {
+		return;
+	}
+
+	VkDependencyInfoKHR dependencyInfo		= { VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR };
+	dependencyInfo.pNext					= nullptr;
+	dependencyInfo.dependencyFlags			= 0;
+	dependencyInfo.memoryBarrierCount		= 0;
+	dependencyInfo.pMemoryBarriers			= nullptr;
+	dependencyInfo.bufferMemoryBarrierCount = countU32( bufferBarriers );
+	dependencyInfo.pBufferMemoryBarriers	= dataPtr( bufferBarriers );
+	dependencyInfo.imageMemoryBarrierCount	= countU32( imageBarriers );
+	dependencyInfo.pImageMemoryBarriers		= dataPtr( imageBarriers );
+
+	pCommandBuffer->pipelineBarrier2( dependencyInfo );
+}
+
+} // namespace cinder::vk
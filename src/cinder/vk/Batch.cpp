@@ -16,6 +16,15 @@ BatchRef Batch::create( const geom::Source &source, const vk::ShaderProgRef &sha
 	return BatchRef( new Batch( device, source, shaderProg, attributeMapping ) );
 }
 
+BatchRef Batch::create( const vk::BufferedMeshRef &mesh, const vk::ShaderProgRef &shaderProg, vk::DeviceRef device )
+{
+	if ( !device ) {
+		device = app::RendererVk::getCurrentRenderer()->getDevice();
+	}
+
+	return BatchRef( new Batch( device, mesh, shaderProg ) );
+}
+
 Batch::Batch( vk::DeviceRef device, const geom::Source &source, const vk::ShaderProgRef &shaderProg, const AttributeMapping &attributeMapping )
 	: vk::DeviceChildObject( device ),
 	  mShaderProg( shaderProg )
@@ -35,6 +44,13 @@ Batch::Batch( vk::DeviceRef device, const geom::Source &source, const vk::Shader
 		//
 		geom::Attrib semantic = attrib.getSemantic();
 		uint32_t	 dims	  = vk::formatComponentCount( attrib.getFormat() );
+		// Custom attributes the source doesn't have are expected
+		// to come from a per instance buffer appended later.
+		//
+		const bool isCustom = ( semantic >= geom::Attrib::CUSTOM_0 ) && ( semantic <= geom::Attrib::CUSTOM_9 );
+		if ( isCustom && ( source.getAttribDims( semantic ) == 0 ) ) {
+			continue;
+		}
 		layout.attrib( semantic, dims );
 	}
 
@@ -122,13 +138,31 @@ Batch::Batch( vk::DeviceRef device, const geom::Source &source, const vk::Shader
 */
 }
 
+Batch::Batch( vk::DeviceRef device, const vk::BufferedMeshRef &mesh, const vk::ShaderProgRef &shaderProg )
+	: vk::DeviceChildObject( device ),
+	  mShaderProg( shaderProg ),
+	  mMesh( mesh )
+{
+}
+
 Batch::~Batch()
 {
 }
 
+void Batch::appendInstanceBuffer( const vk::BufferedMesh::Layout &layout, const vk::BufferRef &buffer )
+{
+	mMesh->appendInstanceBuffer( layout, buffer );
+}
+
 void Batch::draw( int32_t first, int32_t count )
+{
+	drawInstanced( 1, first, count );
+}
+
+void Batch::drawInstanced( uint32_t instanceCount, int32_t first, int32_t count )
 {
 	auto ctx = vk::context();
+	ctx->flushShapes();
 	ctx->bindShaderProg( mShaderProg );
 	ctx->setDefaultShaderVars();
 	ctx->bindDefaultDescriptorSet();
@@ -157,7 +191,7 @@ void Batch::draw( int32_t first, int32_t count )
 	}
 
 	// ctx->draw( first, count );
-	ctx->drawIndexed( first, count );
+	ctx->drawIndexed( first, count, instanceCount );
 }
 
 } // namespace cinder::vk
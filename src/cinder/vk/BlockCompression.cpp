@@ -0,0 +1,596 @@
+#include "cinder/vk/BlockCompression.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && ( _M_IX86_FP >= 2 ) )
+#define CI_VK_BLOCK_COMPRESSION_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace cinder::vk {
+
+namespace {
+
+const uint32_t kBlockTexelCount = 16;
+
+//! BC7 4-bit index interpolation weights, out of 64
+const uint32_t kBc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct BitWriter
+{
+	uint64_t lo	 = 0;
+	uint64_t hi	 = 0;
+	uint32_t pos = 0;
+
+	void put( uint32_t value, uint32_t numBits )
+	{
+		for ( uint32_t i = 0; i < numBits; ++i, ++pos ) {
+			const uint64_t bit = ( value >> i ) & 1;
+			if ( pos < 64 ) {
+				lo |= bit << pos;
+			}
+			else {
+				hi |= bit << ( pos - 64 );
+			}
+		}
+	}
+
+	void store( uint8_t *pDst ) const
+	{
+		for ( uint32_t i = 0; i < 8; ++i ) {
+			pDst[i]		= static_cast<uint8_t>( lo >> ( i * 8 ) );
+			pDst[i + 8] = static_cast<uint8_t>( hi >> ( i * 8 ) );
+		}
+	}
+};
+
+//! Writes the index of the closest of \a paletteSize RGBA entries in
+//! \a pPalette for each texel in \a pRgba to \a pIndices. Returns the sum of
+//! squared errors.
+static uint32_t selectIndices( const uint8_t *pRgba, const uint8_t *pPalette, uint32_t paletteSize, uint8_t *pIndices )
+{
+#if defined( CI_VK_BLOCK_COMPRESSION_SSE2 )
+	const __m128i zero	   = _mm_setzero_si128();
+	uint32_t	  totalErr = 0;
+	for ( uint32_t i = 0; i < kBlockTexelCount; i += 4 ) {
+		const __m128i texels   = _mm_loadu_si128( reinterpret_cast<const __m128i *>( pRgba + i * 4 ) );
+		const __m128i texelsLo = _mm_unpacklo_epi8( texels, zero );
+		const __m128i texelsHi = _mm_unpackhi_epi8( texels, zero );
+
+		__m128i bestErr	  = _mm_set1_epi32( INT32_MAX );
+		__m128i bestIndex = zero;
+		for ( uint32_t p = 0; p < paletteSize; ++p ) {
+			uint32_t entry;
+			std::memcpy( &entry, pPalette + p * 4, 4 );
+			const __m128i color = _mm_unpacklo_epi8( _mm_set1_epi32( static_cast<int>( entry ) ), zero );
+			// Squared differences summed in pairs: (r+g, b+a) for each texel
+			__m128i diffLo = _mm_sub_epi16( texelsLo, color );
+			__m128i diffHi = _mm_sub_epi16( texelsHi, color );
+			__m128i errLo  = _mm_madd_epi16( diffLo, diffLo );
+			__m128i errHi  = _mm_madd_epi16( diffHi, diffHi );
+			errLo		   = _mm_add_epi32( errLo, _mm_shuffle_epi32( errLo, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+			errHi		   = _mm_add_epi32( errHi, _mm_shuffle_epi32( errHi, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+			__m128i err	   = _mm_castps_si128( _mm_shuffle_ps( _mm_castsi128_ps( errLo ), _mm_castsi128_ps( errHi ), _MM_SHUFFLE( 2, 0, 2, 0 ) ) );
+			// Keep the lower error
+			__m128i less = _mm_cmplt_epi32( err, bestErr );
+			bestErr		 = _mm_or_si128( _mm_and_si128( less, err ), _mm_andnot_si128( less, bestErr ) );
+			bestIndex	 = _mm_or_si128( _mm_and_si128( less, _mm_set1_epi32( static_cast<int>( p ) ) ), _mm_andnot_si128( less, bestIndex ) );
+		}
+
+		alignas( 16 ) uint32_t errs[4];
+		alignas( 16 ) uint32_t indices[4];
+		_mm_store_si128( reinterpret_cast<__m128i *>( errs ), bestErr );
+		_mm_store_si128( reinterpret_cast<__m128i *>( indices ), bestIndex );
+		for ( uint32_t j = 0; j < 4; ++j ) {
+			pIndices[i + j] = static_cast<uint8_t>( indices[j] );
+			totalErr += errs[j];
+		}
+	}
+	return totalErr;
+#else
+	uint32_t totalErr = 0;
+	for ( uint32_t i = 0; i < kBlockTexelCount; ++i ) {
+		const uint8_t *pTexel  = pRgba + i * 4;
+		uint32_t	   bestErr = UINT32_MAX;
+		for ( uint32_t p = 0; p < paletteSize; ++p ) {
+			const uint8_t *pColor = pPalette + p * 4;
+			uint32_t	   err	  = 0;
+			for ( uint32_t c = 0; c < 4; ++c ) {
+				int32_t d = static_cast<int32_t>( pTexel[c] ) - static_cast<int32_t>( pColor[c] );
+				err += static_cast<uint32_t>( d * d );
+			}
+			if ( err < bestErr ) {
+				bestErr		= err;
+				pIndices[i] = static_cast<uint8_t>( p );
+			}
+		}
+		totalErr += bestErr;
+	}
+	return totalErr;
+#endif
+}
+
+//! Finds the endpoints of the line through the first \a numChannels
+//! channels of the block that best fits its texels. Uses the principal axis
+//! of the texel covariance, falls back to the bounding box diagonal for
+//! blocks where it is degenerate.
+static void fitEndpoints( const uint8_t *pRgba, uint32_t numChannels, float *pMin, float *pMax )
+{
+	float mean[4] = {};
+	for ( uint32_t i = 0; i < kBlockTexelCount; ++i ) {
+		for ( uint32_t c = 0; c < numChannels; ++c ) {
+			mean[c] += pRgba[i * 4 + c];
+		}
+	}
+	for ( uint32_t c = 0; c < numChannels; ++c ) {
+		mean[c] /= static_cast<float>( kBlockTexelCount );
+	}
+
+	float cov[4][4] = {};
+	for ( uint32_t i = 0; i < kBlockTexelCount; ++i ) {
+		float d[4] = {};
+		for ( uint32_t c = 0; c < numChannels; ++c ) {
+			d[c] = pRgba[i * 4 + c] - mean[c];
+		}
+		for ( uint32_t r = 0; r < numChannels; ++r ) {
+			for ( uint32_t c = 0; c < numChannels; ++c ) {
+				cov[r][c] += d[r] * d[c];
+			}
+		}
+	}
+
+	// Power iteration starting from the bounding box diagonal
+	float lo[4] = { 255.0f, 255.0f, 255.0f, 255.0f };
+	float hi[4] = {};
+	for ( uint32_t i = 0; i < kBlockTexelCount; ++i ) {
+		for ( uint32_t c = 0; c < numChannels; ++c ) {
+			lo[c] = std::min<float>( lo[c], pRgba[i * 4 + c] );
+			hi[c] = std::max<float>( hi[c], pRgba[i * 4 + c] );
+		}
+	}
+	float axis[4] = {};
+	for ( uint32_t c = 0; c < numChannels; ++c ) {
+		axis[c] = hi[c] - lo[c];
+	}
+	for ( uint32_t iter = 0; iter < 8; ++iter ) {
+		float next[4] = {};
+		float len	  = 0.0f;
+		for ( uint32_t r = 0; r < numChannels; ++r ) {
+			for ( uint32_t c = 0; c < numChannels; ++c ) {
+				next[r] += cov[r][c] * axis[c];
+			}
+			len = std::max( len, std::fabs( next[r] ) );
+		}
+		if ( len < 1e-6f ) {
+			break;
+		}
+		for ( uint32_t c = 0; c < numChannels; ++c ) {
+			axis[c] = next[c] / len;
+		}
+	}
+
+	float axisLenSq = 0.0f;
+	for ( uint32_t c = 0; c < numChannels; ++c ) {
+		axisLenSq += axis[c] * axis[c];
+	}
+	if ( axisLenSq < 1e-6f ) {
+		// Solid block
+		for ( uint32_t c = 0; c < numChannels; ++c ) {
+			pMin[c] = pMax[c] = mean[c];
+		}
+		return;
+	}
+
+	float tMin = FLT_MAX;
+	float tMax = -FLT_MAX;
+	for ( uint32_t i = 0; i < kBlockTexelCount; ++i ) {
+		float t = 0.0f;
+		for ( uint32_t c = 0; c < numChannels; ++c ) {
+			t += ( pRgba[i * 4 + c] - mean[c] ) * axis[c];
+		}
+		tMin = std::min( tMin, t );
+		tMax = std::max( tMax, t );
+	}
+	tMin /= axisLenSq;
+	tMax /= axisLenSq;
+
+	// Inset slightly, the extremes are rarely hit exactly after quantization
+	const float inset = ( tMax - tMin ) / 32.0f;
+	tMin += inset;
+	tMax -= inset;
+
+	for ( uint32_t c = 0; c < numChannels; ++c ) {
+		pMin[c] = std::clamp( mean[c] + tMin * axis[c], 0.0f, 255.0f );
+		pMax[c] = std::clamp( mean[c] + tMax * axis[c], 0.0f, 255.0f );
+	}
+}
+
+//! Least squares fit of two endpoints given per texel weights of the first
+//! endpoint. Returns false if the system is singular.
+static bool refineEndpoints( const uint8_t *pRgba, uint32_t numChannels, const float *pWeights, float *pE0, float *pE1 )
+{
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	float ax[4] = {};
+	float bx[4] = {};
+	for ( uint32_t i = 0; i < kBlockTexelCount; ++i ) {
+		const float a = pWeights[i];
+		const float b = 1.0f - a;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for ( uint32_t c = 0; c < numChannels; ++c ) {
+			ax[c] += a * pRgba[i * 4 + c];
+			bx[c] += b * pRgba[i * 4 + c];
+		}
+	}
+
+	const float det = aa * bb - ab * ab;
+	if ( std::fabs( det ) < 1e-6f ) {
+		return false;
+	}
+
+	const float invDet = 1.0f / det;
+	for ( uint32_t c = 0; c < numChannels; ++c ) {
+		pE0[c] = std::clamp( ( ax[c] * bb - bx[c] * ab ) * invDet, 0.0f, 255.0f );
+		pE1[c] = std::clamp( ( bx[c] * aa - ax[c] * ab ) * invDet, 0.0f, 255.0f );
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// BC1
+
+static uint16_t packRgb565( const float *pColor )
+{
+	uint32_t r = static_cast<uint32_t>( pColor[0] * 31.0f / 255.0f + 0.5f );
+	uint32_t g = static_cast<uint32_t>( pColor[1] * 63.0f / 255.0f + 0.5f );
+	uint32_t b = static_cast<uint32_t>( pColor[2] * 31.0f / 255.0f + 0.5f );
+	return static_cast<uint16_t>( ( r << 11 ) | ( g << 5 ) | b );
+}
+
+static void unpackRgb565( uint16_t value, uint8_t *pColor )
+{
+	uint32_t r = ( value >> 11 ) & 0x1F;
+	uint32_t g = ( value >> 5 ) & 0x3F;
+	uint32_t b = value & 0x1F;
+	pColor[0]  = static_cast<uint8_t>( ( r << 3 ) | ( r >> 2 ) );
+	pColor[1]  = static_cast<uint8_t>( ( g << 2 ) | ( g >> 4 ) );
+	pColor[2]  = static_cast<uint8_t>( ( b << 3 ) | ( b >> 2 ) );
+	pColor[3]  = 0;
+}
+
+//! Builds the 4 color palette in index order: c0, c1, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1
+static void buildBc1Palette( uint16_t c0, uint16_t c1, uint8_t *pPalette )
+{
+	unpackRgb565( c0, pPalette + 0 );
+	unpackRgb565( c1, pPalette + 4 );
+	for ( uint32_t c = 0; c < 3; ++c ) {
+		pPalette[8 + c]	 = static_cast<uint8_t>( ( 2 * pPalette[c] + pPalette[4 + c] ) / 3 );
+		pPalette[12 + c] = static_cast<uint8_t>( ( pPalette[c] + 2 * pPalette[4 + c] ) / 3 );
+	}
+	pPalette[11] = 0;
+	pPalette[15] = 0;
+}
+
+static uint32_t encodeBc1Endpoints( const uint8_t *pRgb, const float *pE0, const float *pE1, uint16_t *pC0, uint16_t *pC1, uint8_t *pIndices )
+{
+	uint16_t c0 = packRgb565( pE0 );
+	uint16_t c1 = packRgb565( pE1 );
+	// 4 color mode requires c0 > c1
+	if ( c0 < c1 ) {
+		std::swap( c0, c1 );
+	}
+
+	uint32_t err = 0;
+	if ( c0 == c1 ) {
+		std::memset( pIndices, 0, kBlockTexelCount );
+		uint8_t palette[16];
+		buildBc1Palette( c0, c1, palette );
+		err = selectIndices( pRgb, palette, 1, pIndices );
+	}
+	else {
+		uint8_t palette[16];
+		buildBc1Palette( c0, c1, palette );
+		err = selectIndices( pRgb, palette, 4, pIndices );
+	}
+
+	*pC0 = c0;
+	*pC1 = c1;
+	return err;
+}
+
+static void encodeColorBlock( const uint8_t *pRgba, uint8_t *pDst )
+{
+	// Alpha is zeroed so it doesn't contribute to the index search
+	alignas( 16 ) uint8_t rgb[kBlockTexelCount * 4];
+	std::memcpy( rgb, pRgba, sizeof( rgb ) );
+	for ( uint32_t i = 0; i < kBlockTexelCount; ++i ) {
+		rgb[i * 4 + 3] = 0;
+	}
+
+	float e0[4] = {};
+	float e1[4] = {};
+	fitEndpoints( rgb, 3, e1, e0 );
+
+	uint16_t c0		 = 0;
+	uint16_t c1		 = 0;
+	uint8_t	 indices[kBlockTexelCount];
+	uint32_t err = encodeBc1Endpoints( rgb, e0, e1, &c0, &c1, indices );
+
+	// One refinement pass using the selected indices
+	if ( ( err > 0 ) && ( c0 != c1 ) ) {
+		static const float kWeights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		float			   weights[kBlockTexelCount];
+		for ( uint32_t i = 0; i < kBlockTexelCount; ++i ) {
+			weights[i] = kWeights[indices[i]];
+		}
+		float r0[4] = {};
+		float r1[4] = {};
+		if ( refineEndpoints( rgb, 3, weights, r0, r1 ) ) {
+			uint16_t rc0 = 0;
+			uint16_t rc1 = 0;
+			uint8_t	 rindices[kBlockTexelCount];
+			uint32_t rerr = encodeBc1Endpoints( rgb, r0, r1, &rc0, &rc1, rindices );
+			if ( rerr < err ) {
+				c0 = rc0;
+				c1 = rc1;
+				std::memcpy( indices, rindices, kBlockTexelCount );
+			}
+		}
+	}
+
+	uint32_t bits = 0;
+	for ( uint32_t i = 0; i < kBlockTexelCount; ++i ) {
+		bits |= static_cast<uint32_t>( indices[i] ) << ( i * 2 );
+	}
+
+	pDst[0] = static_cast<uint8_t>( c0 );
+	pDst[1] = static_cast<uint8_t>( c0 >> 8 );
+	pDst[2] = static_cast<uint8_t>( c1 );
+	pDst[3] = static_cast<uint8_t>( c1 >> 8 );
+	for ( uint32_t i = 0; i < 4; ++i ) {
+		pDst[4 + i] = static_cast<uint8_t>( bits >> ( i * 8 ) );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// BC7
+
+//! Quantizes an 8-bit endpoint to 7 bits plus a shared p-bit, picking the
+//! p-bit with the lower error
+static void quantizeBc7Endpoint( const float *pEndpoint, uint32_t *pValues, uint32_t *pPBit )
+{
+	float bestErr = FLT_MAX;
+	for ( uint32_t p = 0; p < 2; ++p ) {
+		uint32_t values[4];
+		float	 err = 0.0f;
+		for ( uint32_t c = 0; c < 4; ++c ) {
+			int32_t v = static_cast<int32_t>( std::floor( ( pEndpoint[c] - p ) / 2.0f + 0.5f ) );
+			values[c] = static_cast<uint32_t>( std::clamp( v, 0, 127 ) );
+			float d	  = static_cast<float>( ( values[c] << 1 ) | p ) - pEndpoint[c];
+			err += d * d;
+		}
+		if ( err < bestErr ) {
+			bestErr = err;
+			*pPBit	= p;
+			std::memcpy( pValues, values, sizeof( values ) );
+		}
+	}
+}
+
+struct Bc7Mode6
+{
+	uint32_t e0[4];
+	uint32_t e1[4];
+	uint32_t p0;
+	uint32_t p1;
+	uint8_t	 indices[kBlockTexelCount];
+	uint32_t err;
+};
+
+static void encodeBc7Endpoints( const uint8_t *pRgba, const float *pE0, const float *pE1, Bc7Mode6 *pResult )
+{
+	quantizeBc7Endpoint( pE0, pResult->e0, &pResult->p0 );
+	quantizeBc7Endpoint( pE1, pResult->e1, &pResult->p1 );
+
+	uint8_t palette[16 * 4];
+	for ( uint32_t c = 0; c < 4; ++c ) {
+		uint32_t a = ( pResult->e0[c] << 1 ) | pResult->p0;
+		uint32_t b = ( pResult->e1[c] << 1 ) | pResult->p1;
+		for ( uint32_t i = 0; i < 16; ++i ) {
+			palette[i * 4 + c] = static_cast<uint8_t>( ( ( 64 - kBc7Weights4[i] ) * a + kBc7Weights4[i] * b + 32 ) >> 6 );
+		}
+	}
+
+	pResult->err = selectIndices( pRgba, palette, 16, pResult->indices );
+}
+
+} // namespace
+
+VkFormat toVkFormat( TextureCompression compression )
+{
+	// clang-format off
+	switch ( compression ) {
+		default: break;
+		case TextureCompression::BC1: return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+		case TextureCompression::BC3: return VK_FORMAT_BC3_UNORM_BLOCK;
+		case TextureCompression::BC4: return VK_FORMAT_BC4_UNORM_BLOCK;
+		case TextureCompression::BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+		case TextureCompression::BC7: return VK_FORMAT_BC7_UNORM_BLOCK;
+	}
+	// clang-format on
+	return VK_FORMAT_UNDEFINED;
+}
+
+void encodeBlockBc1( const uint8_t *pRgba, uint8_t *pDst )
+{
+	encodeColorBlock( pRgba, pDst );
+}
+
+void encodeBlockBc3( const uint8_t *pRgba, uint8_t *pDst )
+{
+	encodeBlockBc4( pRgba, pDst, 3 );
+	encodeColorBlock( pRgba, pDst + 8 );
+}
+
+void encodeBlockBc4( const uint8_t *pRgba, uint8_t *pDst, uint32_t channel )
+{
+	uint32_t lo = 255;
+	uint32_t hi = 0;
+	for ( uint32_t i = 0; i < kBlockTexelCount; ++i ) {
+		lo = std::min<uint32_t>( lo, pRgba[i * 4 + channel] );
+		hi = std::max<uint32_t>( hi, pRgba[i * 4 + channel] );
+	}
+
+	// 8 value mode (e0 > e1): indices 0 and 1 are the endpoints, 2-7 step
+	// from e0 towards e1
+	uint64_t bits = 0;
+	if ( hi > lo ) {
+		const uint32_t range = hi - lo;
+		for ( uint32_t i = 0; i < kBlockTexelCount; ++i ) {
+			uint32_t v	  = pRgba[i * 4 + channel];
+			uint32_t step = ( ( hi - v ) * 14 + range ) / ( 2 * range );
+			uint32_t index = ( step == 0 ) ? 0 : ( ( step == 7 ) ? 1 : step + 1 );
+			bits |= static_cast<uint64_t>( index ) << ( i * 3 );
+		}
+	}
+
+	pDst[0] = static_cast<uint8_t>( hi );
+	pDst[1] = static_cast<uint8_t>( lo );
+	for ( uint32_t i = 0; i < 6; ++i ) {
+		pDst[2 + i] = static_cast<uint8_t>( bits >> ( i * 8 ) );
+	}
+}
+
+void encodeBlockBc5( const uint8_t *pRgba, uint8_t *pDst )
+{
+	encodeBlockBc4( pRgba, pDst, 0 );
+	encodeBlockBc4( pRgba, pDst + 8, 1 );
+}
+
+void encodeBlockBc7( const uint8_t *pRgba, uint8_t *pDst )
+{
+	float e0[4] = {};
+	float e1[4] = {};
+	fitEndpoints( pRgba, 4, e0, e1 );
+
+	Bc7Mode6 best = {};
+	encodeBc7Endpoints( pRgba, e0, e1, &best );
+
+	// One refinement pass using the selected indices
+	if ( best.err > 0 ) {
+		float weights[kBlockTexelCount];
+		for ( uint32_t i = 0; i < kBlockTexelCount; ++i ) {
+			weights[i] = ( 64 - kBc7Weights4[best.indices[i]] ) / 64.0f;
+		}
+		float r0[4] = {};
+		float r1[4] = {};
+		if ( refineEndpoints( pRgba, 4, weights, r0, r1 ) ) {
+			Bc7Mode6 refined = {};
+			encodeBc7Endpoints( pRgba, r0, r1, &refined );
+			if ( refined.err < best.err ) {
+				best = refined;
+			}
+		}
+	}
+
+	// The MSB of the anchor index is implied 0, swap endpoints if it is set
+	if ( best.indices[0] & 0x8 ) {
+		std::swap( best.e0, best.e1 );
+		std::swap( best.p0, best.p1 );
+		for ( uint32_t i = 0; i < kBlockTexelCount; ++i ) {
+			best.indices[i] = static_cast<uint8_t>( 15 - best.indices[i] );
+		}
+	}
+
+	BitWriter writer;
+	writer.put( 1 << 6, 7 );
+	for ( uint32_t c = 0; c < 4; ++c ) {
+		writer.put( best.e0[c], 7 );
+		writer.put( best.e1[c], 7 );
+	}
+	writer.put( best.p0, 1 );
+	writer.put( best.p1, 1 );
+	writer.put( best.indices[0], 3 );
+	for ( uint32_t i = 1; i < kBlockTexelCount; ++i ) {
+		writer.put( best.indices[i], 4 );
+	}
+	writer.store( pDst );
+}
+
+void compressImage(
+	TextureCompression compression,
+	uint32_t		   width,
+	uint32_t		   height,
+	size_t			   rowBytes,
+	const uint8_t	  *pSrc,
+	uint8_t			*pDst,
+	uint32_t		   numThreads )
+{
+	void ( *encodeBlock )( const uint8_t *, uint8_t * ) = nullptr;
+	uint32_t blockSize								   = 16;
+	// clang-format off
+	switch ( compression ) {
+		default: throw VulkanExc( "unsupported texture compression" );
+		case TextureCompression::BC1: encodeBlock = encodeBlockBc1; blockSize = 8; break;
+		case TextureCompression::BC3: encodeBlock = encodeBlockBc3; break;
+		case TextureCompression::BC4: encodeBlock = []( const uint8_t *pRgba, uint8_t *pDst ) { encodeBlockBc4( pRgba, pDst, 0 ); }; blockSize = 8; break;
+		case TextureCompression::BC5: encodeBlock = encodeBlockBc5; break;
+		case TextureCompression::BC7: encodeBlock = encodeBlockBc7; break;
+	}
+	// clang-format on
+
+	const uint32_t blocksX = ( std::max<uint32_t>( width, 1 ) + 3 ) / 4;
+	const uint32_t blocksY = ( std::max<uint32_t>( height, 1 ) + 3 ) / 4;
+
+	auto encodeRow = [=]( uint32_t by ) {
+		alignas( 16 ) uint8_t block[kBlockTexelCount * 4];
+		uint8_t			   *pDstRow = pDst + static_cast<size_t>( by ) * blocksX * blockSize;
+		for ( uint32_t bx = 0; bx < blocksX; ++bx ) {
+			// Clamp to the edge for partial blocks
+			for ( uint32_t y = 0; y < 4; ++y ) {
+				const uint32_t sy	   = std::min( by * 4 + y, height - 1 );
+				const uint8_t *pSrcRow = pSrc + sy * rowBytes;
+				for ( uint32_t x = 0; x < 4; ++x ) {
+					const uint32_t sx = std::min( bx * 4 + x, width - 1 );
+					std::memcpy( block + ( y * 4 + x ) * 4, pSrcRow + sx * 4, 4 );
+				}
+			}
+			encodeBlock( block, pDstRow + bx * blockSize );
+		}
+	};
+
+	if ( numThreads == 0 ) {
+		numThreads = std::max<uint32_t>( std::thread::hardware_concurrency(), 1 );
+	}
+	numThreads = std::min( numThreads, blocksY );
+
+	if ( numThreads <= 1 ) {
+		for ( uint32_t by = 0; by < blocksY; ++by ) {
+			encodeRow( by );
+		}
+		return;
+	}
+
+	// Rows are handed out one at a time so threads finishing early pick up the slack
+	std::atomic<uint32_t>	 nextRow = 0;
+	std::vector<std::thread> threads;
+	threads.reserve( numThreads );
+	for ( uint32_t i = 0; i < numThreads; ++i ) {
+		threads.emplace_back( [&]() {
+			for ( uint32_t by = nextRow++; by < blocksY; by = nextRow++ ) {
+				encodeRow( by );
+			}
+		} );
+	}
+	for ( auto &thread : threads ) {
+		thread.join();
+	}
+}
+
+} // namespace cinder::vk
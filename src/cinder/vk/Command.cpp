@@ -4,10 +4,14 @@
 #include "cinder/vk/Device.h"
 #include "cinder/vk/Image.h"
 #include "cinder/vk/Pipeline.h"
+#include "cinder/vk/Query.h"
 #include "cinder/vk/Sampler.h"
 #include "cinder/vk/Texture.h"
+#include "cinder/vk/Util.h"
 #include "cinder/app/RendererVk.h"
 
+#include <algorithm>
+
 namespace cinder::vk {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -182,6 +186,369 @@ CommandBuffer::RenderingInfo &CommandBuffer::RenderingInfo::setDepthStencilAttac
 	return *this;
 }
 
+CommandBuffer::RenderingInfo &CommandBuffer::RenderingInfo::setColorAttachmentOps( uint32_t index, VkAttachmentLoadOp loadOp, VkAttachmentStoreOp storeOp, const VkClearColorValue &clearValue )
+{
+	if ( index >= countU32( mColorAttachments ) ) {
+		throw VulkanExc( "color attachment index out of range" );
+	}
+
+	VkRenderingAttachmentInfoKHR &vkai = mColorAttachments[index];
+	vkai.loadOp						   = loadOp;
+	vkai.storeOp					   = storeOp;
+	vkai.clearValue.color			   = clearValue;
+
+	return *this;
+}
+
+CommandBuffer::RenderingInfo &CommandBuffer::RenderingInfo::setDepthAttachmentOps( VkAttachmentLoadOp loadOp, VkAttachmentStoreOp storeOp, float clearValue )
+{
+	mDepthAttachment.loadOp						   = loadOp;
+	mDepthAttachment.storeOp					   = storeOp;
+	mDepthAttachment.clearValue.depthStencil.depth = clearValue;
+
+	return *this;
+}
+
+CommandBuffer::RenderingInfo &CommandBuffer::RenderingInfo::setStencilAttachmentOps( VkAttachmentLoadOp loadOp, VkAttachmentStoreOp storeOp, uint32_t clearValue )
+{
+	mStencilAttachment.loadOp						   = loadOp;
+	mStencilAttachment.storeOp						   = storeOp;
+	mStencilAttachment.clearValue.depthStencil.stencil = clearValue;
+
+	return *this;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// AccessState
+
+bool AccessState::transition( VkImageLayout newLayout, VkPipelineStageFlags2KHR stageMask, VkAccessFlags2KHR accessMask, Barrier *pBarrier )
+{
+	const bool write		= ( accessMask & WRITE_ACCESS_MASK ) != 0;
+	const bool layoutChange = ( layout != newLayout );
+
+	pBarrier->dstStageMask	= stageMask;
+	pBarrier->dstAccessMask = accessMask;
+	pBarrier->oldLayout		= layout;
+	pBarrier->newLayout		= newLayout;
+
+	// Writes and layout transitions wait for every earlier access, reads after
+	// reads in the same layout need nothing.
+	if ( layoutChange || write ) {
+		pBarrier->srcStageMask	= writeStages | readStages;
+		pBarrier->srcAccessMask = writeAccess;
+
+		const bool needed = layoutChange || ( pBarrier->srcStageMask != 0 );
+
+		layout		  = newLayout;
+		writeStages	  = stageMask;
+		writeAccess	  = accessMask & WRITE_ACCESS_MASK;
+		readStages	  = write ? 0 : stageMask;
+		visibleStages = write ? 0 : stageMask;
+		visibleAccess = write ? 0 : accessMask;
+		return needed;
+	}
+
+	readStages |= stageMask;
+
+	if ( writeStages == 0 ) {
+		return false;
+	}
+
+	const bool visible = ( ( stageMask & ~visibleStages ) == 0 ) && ( ( accessMask & ~visibleAccess ) == 0 );
+	if ( visible ) {
+		return false;
+	}
+
+	// Widening the destination to everything that's already visible keeps
+	// the visible set a plain stage x access product.
+	visibleStages |= stageMask;
+	visibleAccess |= accessMask;
+
+	pBarrier->srcStageMask	= writeStages;
+	pBarrier->srcAccessMask = writeAccess;
+	pBarrier->dstStageMask	= visibleStages;
+	pBarrier->dstAccessMask = visibleAccess;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CommandBuffer::BarrierBatch
+
+static bool isSameTransition( const VkImageMemoryBarrier2KHR &a, const VkImageMemoryBarrier2KHR &b )
+{
+	return ( a.image == b.image ) &&
+		   ( a.srcStageMask == b.srcStageMask ) &&
+		   ( a.srcAccessMask == b.srcAccessMask ) &&
+		   ( a.dstStageMask == b.dstStageMask ) &&
+		   ( a.dstAccessMask == b.dstAccessMask ) &&
+		   ( a.oldLayout == b.oldLayout ) &&
+		   ( a.newLayout == b.newLayout );
+}
+
+CommandBuffer::BarrierBatch::ImageState &CommandBuffer::BarrierBatch::getImageState( const vk::Image *pImage, uint32_t baseMipLevel, uint32_t &levelCount, uint32_t baseArrayLayer, uint32_t &layerCount )
+{
+	const uint32_t mipLevels   = pImage->getMipLevels();
+	const uint32_t arrayLayers = pImage->getArrayLayers();
+
+	if ( levelCount == VK_REMAINING_MIP_LEVELS ) {
+		levelCount = ( baseMipLevel < mipLevels ) ? ( mipLevels - baseMipLevel ) : 0;
+	}
+	if ( layerCount == VK_REMAINING_ARRAY_LAYERS ) {
+		layerCount = ( baseArrayLayer < arrayLayers ) ? ( arrayLayers - baseArrayLayer ) : 0;
+	}
+	if ( ( levelCount == 0 ) || ( layerCount == 0 ) || ( ( baseMipLevel + levelCount ) > mipLevels ) || ( ( baseArrayLayer + layerCount ) > arrayLayers ) ) {
+		throw VulkanExc( "barrier subresource range is outside of the image" );
+	}
+
+	VkImage imageHandle = pImage->getImageHandle();
+
+	auto it = std::find_if(
+		mImages.begin(),
+		mImages.end(),
+		[imageHandle]( const ImageState &image ) -> bool { return image.image == imageHandle; } );
+	if ( it != mImages.end() ) {
+		return *it;
+	}
+
+	ImageState image  = {};
+	image.image		  = imageHandle;
+	image.aspectMask  = pImage->getAspectMask();
+	image.mipLevels	  = mipLevels;
+	image.arrayLayers = arrayLayers;
+	image.subresources.resize( mipLevels * arrayLayers );
+	mImages.push_back( image );
+
+	return mImages.back();
+}
+
+CommandBuffer::BarrierBatch &CommandBuffer::BarrierBatch::setImageState( const vk::Image *pImage, VkImageLayout layout, VkPipelineStageFlags2KHR stageMask, VkAccessFlags2KHR accessMask, uint32_t baseMipLevel, uint32_t levelCount, uint32_t baseArrayLayer, uint32_t layerCount )
+{
+	ImageState &image = getImageState( pImage, baseMipLevel, levelCount, baseArrayLayer, layerCount );
+
+	Subresource subresource		  = {};
+	subresource.state.layout	  = layout;
+	subresource.state.writeStages = ( ( accessMask & vk::AccessState::WRITE_ACCESS_MASK ) != 0 ) ? stageMask : 0;
+	subresource.state.writeAccess = accessMask & vk::AccessState::WRITE_ACCESS_MASK;
+	subresource.state.readStages  = stageMask;
+
+	for ( uint32_t mipLevel = baseMipLevel; mipLevel < ( baseMipLevel + levelCount ); ++mipLevel ) {
+		for ( uint32_t arrayLayer = baseArrayLayer; arrayLayer < ( baseArrayLayer + layerCount ); ++arrayLayer ) {
+			image.subresources[mipLevel * image.arrayLayers + arrayLayer] = subresource;
+		}
+	}
+
+	return *this;
+}
+
+CommandBuffer::BarrierBatch &CommandBuffer::BarrierBatch::imageBarrier( const vk::Image *pImage, VkImageLayout newLayout, VkPipelineStageFlags2KHR dstStageMask, VkAccessFlags2KHR dstAccessMask, uint32_t baseMipLevel, uint32_t levelCount, uint32_t baseArrayLayer, uint32_t layerCount )
+{
+	ImageState &image = getImageState( pImage, baseMipLevel, levelCount, baseArrayLayer, layerCount );
+
+	for ( uint32_t mipLevel = baseMipLevel; mipLevel < ( baseMipLevel + levelCount ); ++mipLevel ) {
+		for ( uint32_t arrayLayer = baseArrayLayer; arrayLayer < ( baseArrayLayer + layerCount ); ++arrayLayer ) {
+			Subresource &subresource = image.subresources[mipLevel * image.arrayLayers + arrayLayer];
+
+			vk::AccessState::Barrier barrier = {};
+			const bool				 needed	 = subresource.state.transition( newLayout, dstStageMask, dstAccessMask, &barrier );
+
+			if ( subresource.pending ) {
+				// Nothing was recorded since the barrier that hasn't been flushed,
+				// widen it instead of adding another one.
+				subresource.barrier.dstStageMask |= barrier.dstStageMask;
+				subresource.barrier.dstAccessMask |= barrier.dstAccessMask;
+			}
+			else if ( needed ) {
+				subresource.pending = true;
+				subresource.barrier = barrier;
+			}
+		}
+	}
+
+	return *this;
+}
+
+CommandBuffer::BarrierBatch &CommandBuffer::BarrierBatch::bufferBarrier( const vk::Buffer *pBuffer, VkPipelineStageFlags2KHR srcStageMask, VkAccessFlags2KHR srcAccessMask, VkPipelineStageFlags2KHR dstStageMask, VkAccessFlags2KHR dstAccessMask, uint64_t offset, uint64_t size )
+{
+	// Reads after reads need nothing
+	if ( ( ( srcAccessMask | dstAccessMask ) & vk::AccessState::WRITE_ACCESS_MASK ) == 0 ) {
+		return *this;
+	}
+
+	VkBufferMemoryBarrier2KHR vkbmb = { VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR };
+	vkbmb.pNext						= nullptr;
+	vkbmb.srcStageMask				= srcStageMask;
+	vkbmb.srcAccessMask				= srcAccessMask;
+	vkbmb.dstStageMask				= dstStageMask;
+	vkbmb.dstAccessMask				= dstAccessMask;
+	vkbmb.srcQueueFamilyIndex		= VK_QUEUE_FAMILY_IGNORED;
+	vkbmb.dstQueueFamilyIndex		= VK_QUEUE_FAMILY_IGNORED;
+	vkbmb.buffer					= pBuffer->getBufferHandle();
+	vkbmb.offset					= offset;
+	vkbmb.size						= size;
+	mBufferBarriers.push_back( vkbmb );
+
+	return *this;
+}
+
+CommandBuffer::BarrierBatch &CommandBuffer::BarrierBatch::memoryBarrier( VkPipelineStageFlags2KHR srcStageMask, VkAccessFlags2KHR srcAccessMask, VkPipelineStageFlags2KHR dstStageMask, VkAccessFlags2KHR dstAccessMask )
+{
+	// Reads after reads need nothing
+	if ( ( ( srcAccessMask | dstAccessMask ) & vk::AccessState::WRITE_ACCESS_MASK ) == 0 ) {
+		return *this;
+	}
+
+	mMemoryBarrier.srcStageMask  |= srcStageMask;
+	mMemoryBarrier.srcAccessMask |= srcAccessMask;
+	mMemoryBarrier.dstStageMask  |= dstStageMask;
+	mMemoryBarrier.dstAccessMask |= dstAccessMask;
+
+	return *this;
+}
+
+VkImageLayout CommandBuffer::BarrierBatch::getImageLayout( const vk::Image *pImage, uint32_t mipLevel, uint32_t arrayLayer ) const
+{
+	for ( const auto &image : mImages ) {
+		if ( image.image == pImage->getImageHandle() ) {
+			return image.subresources[mipLevel * image.arrayLayers + arrayLayer].state.layout;
+		}
+	}
+	return VK_IMAGE_LAYOUT_UNDEFINED;
+}
+
+bool CommandBuffer::BarrierBatch::hasPendingBarriers() const
+{
+	if ( !mBufferBarriers.empty() || ( mMemoryBarrier.srcStageMask != 0 ) || ( mMemoryBarrier.dstStageMask != 0 ) ) {
+		return true;
+	}
+
+	for ( const auto &image : mImages ) {
+		for ( const auto &subresource : image.subresources ) {
+			if ( subresource.pending ) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+bool CommandBuffer::BarrierBatch::prepare( VkDependencyInfoKHR &dependencyInfo )
+{
+	mImageBarrierScratch.clear();
+
+	for ( const auto &image : mImages ) {
+		for ( uint32_t mipLevel = 0; mipLevel < image.mipLevels; ++mipLevel ) {
+			const size_t firstInLevel = mImageBarrierScratch.size();
+
+			for ( uint32_t arrayLayer = 0; arrayLayer < image.arrayLayers; ++arrayLayer ) {
+				const Subresource &subresource = image.subresources[mipLevel * image.arrayLayers + arrayLayer];
+				if ( !subresource.pending ) {
+					continue;
+				}
+
+				VkImageMemoryBarrier2KHR vkimb		  = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR };
+				vkimb.pNext							  = nullptr;
+				vkimb.srcStageMask					  = subresource.barrier.srcStageMask;
+				vkimb.srcAccessMask					  = subresource.barrier.srcAccessMask;
+				vkimb.dstStageMask					  = subresource.barrier.dstStageMask;
+				vkimb.dstAccessMask					  = subresource.barrier.dstAccessMask;
+				vkimb.oldLayout						  = subresource.barrier.oldLayout;
+				vkimb.newLayout						  = subresource.state.layout;
+				vkimb.srcQueueFamilyIndex			  = VK_QUEUE_FAMILY_IGNORED;
+				vkimb.dstQueueFamilyIndex			  = VK_QUEUE_FAMILY_IGNORED;
+				vkimb.image							  = image.image;
+				vkimb.subresourceRange.aspectMask	  = image.aspectMask;
+				vkimb.subresourceRange.baseMipLevel	  = mipLevel;
+				vkimb.subresourceRange.levelCount	  = 1;
+				vkimb.subresourceRange.baseArrayLayer = arrayLayer;
+				vkimb.subresourceRange.layerCount	  = 1;
+
+				// Consecutive array layers with the same transition share a barrier
+				if ( mImageBarrierScratch.size() > firstInLevel ) {
+					VkImageMemoryBarrier2KHR &last = mImageBarrierScratch.back();
+					if ( isSameTransition( last, vkimb ) && ( ( last.subresourceRange.baseArrayLayer + last.subresourceRange.layerCount ) == arrayLayer ) ) {
+						last.subresourceRange.layerCount += 1;
+						continue;
+					}
+				}
+
+				mImageBarrierScratch.push_back( vkimb );
+			}
+
+			// So do consecutive mip levels if the level ended up as a single
+			// barrier covering the same layers as the one before it
+			if ( ( mImageBarrierScratch.size() == ( firstInLevel + 1 ) ) && ( firstInLevel > 0 ) ) {
+				VkImageMemoryBarrier2KHR	   &prev  = mImageBarrierScratch[firstInLevel - 1];
+				const VkImageMemoryBarrier2KHR &level = mImageBarrierScratch[firstInLevel];
+				if ( isSameTransition( prev, level ) &&
+					 ( ( prev.subresourceRange.baseMipLevel + prev.subresourceRange.levelCount ) == mipLevel ) &&
+					 ( prev.subresourceRange.baseArrayLayer == level.subresourceRange.baseArrayLayer ) &&
+					 ( prev.subresourceRange.layerCount == level.subresourceRange.layerCount ) ) {
+					prev.subresourceRange.levelCount += 1;
+					mImageBarrierScratch.pop_back();
+				}
+			}
+		}
+	}
+
+	const bool hasMemoryBarrier = ( mMemoryBarrier.srcStageMask != 0 ) || ( mMemoryBarrier.dstStageMask != 0 );
+
+	dependencyInfo							= { VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR };
+	dependencyInfo.pNext					= nullptr;
+	dependencyInfo.dependencyFlags			= 0;
+	dependencyInfo.memoryBarrierCount		= hasMemoryBarrier ? 1 : 0;
+	dependencyInfo.pMemoryBarriers			= hasMemoryBarrier ? &mMemoryBarrier : nullptr;
+	dependencyInfo.bufferMemoryBarrierCount = countU32( mBufferBarriers );
+	dependencyInfo.pBufferMemoryBarriers	= dataPtr( mBufferBarriers );
+	dependencyInfo.imageMemoryBarrierCount	= countU32( mImageBarrierScratch );
+	dependencyInfo.pImageMemoryBarriers		= dataPtr( mImageBarrierScratch );
+
+	return hasMemoryBarrier || !mBufferBarriers.empty() || !mImageBarrierScratch.empty();
+}
+
+void CommandBuffer::BarrierBatch::clearPending()
+{
+	for ( auto &image : mImages ) {
+		for ( auto &subresource : image.subresources ) {
+			subresource.pending = false;
+		}
+	}
+
+	mBufferBarriers.clear();
+
+	mMemoryBarrier				 = { VK_STRUCTURE_TYPE_MEMORY_BARRIER_2_KHR };
+	mMemoryBarrier.srcStageMask	 = 0;
+	mMemoryBarrier.srcAccessMask = 0;
+	mMemoryBarrier.dstStageMask	 = 0;
+	mMemoryBarrier.dstAccessMask = 0;
+}
+
+void CommandBuffer::BarrierBatch::flush( vk::CommandBuffer *pCommandBuffer )
+{
+	VkDependencyInfoKHR dependencyInfo = {};
+	if ( prepare( dependencyInfo ) ) {
+		pCommandBuffer->pipelineBarrier2( dependencyInfo );
+	}
+
+	clearPending();
+}
+
+void CommandBuffer::BarrierBatch::flush( const vk::Device *pDevice, VkCommandBuffer commandBuffer )
+{
+	VkDependencyInfoKHR dependencyInfo = {};
+	if ( prepare( dependencyInfo ) ) {
+		pDevice->vkfn()->CmdPipelineBarrier2KHR( commandBuffer, &dependencyInfo );
+	}
+
+	clearPending();
+}
+
+void CommandBuffer::BarrierBatch::reset()
+{
+	mImages.clear();
+
+	clearPending();
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // CommandBuffer
 
@@ -241,6 +608,48 @@ void CommandBuffer::begin( VkCommandBufferUsageFlags usageFlags )
 	mRecording = true;
 }
 
+void CommandBuffer::beginSecondary(
+	const std::vector<VkFormat> &colorFormats,
+	VkFormat					 depthStencilFormat,
+	VkSampleCountFlagBits		 rasterizationSamples,
+	VkCommandBufferUsageFlags	 usageFlags )
+{
+	const VkImageAspectFlags aspectMask = ( depthStencilFormat != VK_FORMAT_UNDEFINED ) ? determineAspectMask( depthStencilFormat ) : 0;
+
+	VkCommandBufferInheritanceRenderingInfoKHR vkiri = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR };
+	vkiri.pNext										 = nullptr;
+	vkiri.flags										 = 0;
+	vkiri.viewMask									 = 0;
+	vkiri.colorAttachmentCount						 = countU32( colorFormats );
+	vkiri.pColorAttachmentFormats					 = dataPtr( colorFormats );
+	vkiri.depthAttachmentFormat						 = ( aspectMask & VK_IMAGE_ASPECT_DEPTH_BIT ) ? depthStencilFormat : VK_FORMAT_UNDEFINED;
+	vkiri.stencilAttachmentFormat					 = ( aspectMask & VK_IMAGE_ASPECT_STENCIL_BIT ) ? depthStencilFormat : VK_FORMAT_UNDEFINED;
+	vkiri.rasterizationSamples						 = rasterizationSamples;
+
+	VkCommandBufferInheritanceInfo vkii = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
+	vkii.pNext							= &vkiri;
+	vkii.renderPass						= VK_NULL_HANDLE;
+	vkii.subpass						= 0;
+	vkii.framebuffer					= VK_NULL_HANDLE;
+	vkii.occlusionQueryEnable			= VK_FALSE;
+	vkii.queryFlags						= 0;
+	vkii.pipelineStatistics				= 0;
+
+	VkCommandBufferBeginInfo vkbi = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	vkbi.pNext					  = nullptr;
+	vkbi.flags					  = usageFlags | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	vkbi.pInheritanceInfo		  = &vkii;
+
+	VkResult vkres = CI_VK_DEVICE_FN( BeginCommandBuffer( getCommandBufferHandle(), &vkbi ) );
+	if ( vkres != VK_SUCCESS ) {
+		throw VulkanFnFailedExc( "vkBeginCommandBuffer", vkres );
+	}
+
+	mRecording = true;
+	// Everything recorded is inside the primary's render pass instance
+	mRendering = true;
+}
+
 void CommandBuffer::end()
 {
 	VkResult vkres = CI_VK_DEVICE_FN( EndCommandBuffer( getCommandBufferHandle() ) );
@@ -249,6 +658,7 @@ void CommandBuffer::end()
 	}
 
 	mRecording = false;
+	mRendering = false;
 }
 void CommandBuffer::pushConstants(
 	const vk::PipelineLayout *pipelineLayout,
@@ -298,6 +708,21 @@ void CommandBuffer::pushDescriptor(
 		&write ) );
 }
 
+void CommandBuffer::pushDescriptors(
+	VkPipelineBindPoint						 pipelineBindPoint,
+	const vk::PipelineLayout				*pipelineLayout,
+	uint32_t								 set,
+	const std::vector<VkWriteDescriptorSet> &writes )
+{
+	CI_VK_DEVICE_FN( CmdPushDescriptorSetKHR(
+		getCommandBufferHandle(),
+		pipelineBindPoint,
+		pipelineLayout->getPipelineLayoutHandle(),
+		set,
+		countU32( writes ),
+		dataPtr( writes ) ) );
+}
+
 void CommandBuffer::bindDescriptorSets(
 	VkPipelineBindPoint						 pipelineBindPoint,
 	const vk::PipelineLayoutRef				&pipelineLayout,
@@ -332,7 +757,7 @@ void CommandBuffer::bindPipeline(
 		pipeline->getPipelineHandle() ) );
 }
 
-void CommandBuffer::beginRendering( const RenderingInfo &renderingInfo )
+void CommandBuffer::beginRendering( const RenderingInfo &renderingInfo, VkRenderingFlagsKHR flags )
 {
 	if ( mRendering ) {
 		endRendering();
@@ -340,7 +765,7 @@ void CommandBuffer::beginRendering( const RenderingInfo &renderingInfo )
 
 	VkRenderingInfoKHR vkri	  = { VK_STRUCTURE_TYPE_RENDERING_INFO_KHR };
 	vkri.pNext				  = nullptr;
-	vkri.flags				  = 0;
+	vkri.flags				  = flags;
 	vkri.renderArea			  = renderingInfo.mRenderArea;
 	vkri.layerCount			  = 1;
 	vkri.viewMask			  = 0;
@@ -360,6 +785,21 @@ void CommandBuffer::endRendering()
 	mRendering = false;
 }
 
+void CommandBuffer::executeCommands( const std::vector<vk::CommandBufferRef> &commandBuffers )
+{
+	if ( commandBuffers.empty() ) {
+		return;
+	}
+
+	std::vector<VkCommandBuffer> handles;
+	handles.reserve( commandBuffers.size() );
+	for ( const auto &commandBuffer : commandBuffers ) {
+		handles.push_back( commandBuffer->getCommandBufferHandle() );
+	}
+
+	CI_VK_DEVICE_FN( CmdExecuteCommands( getCommandBufferHandle(), countU32( handles ), dataPtr( handles ) ) );
+}
+
 void CommandBuffer::setScissor( int32_t x, int32_t y, uint32_t width, uint32_t height )
 {
 	VkRect2D rect = { { x, y }, { width, height } };
@@ -489,6 +929,46 @@ void CommandBuffer::drawIndexed( uint32_t indexCount, uint32_t instanceCount, ui
 	CI_VK_DEVICE_FN( CmdDrawIndexed( getCommandBufferHandle(), indexCount, instanceCount, firstIndex, vertexOffset, firstInstance ) );
 }
 
+void CommandBuffer::drawIndexedIndirect( const vk::BufferRef &buffer, uint64_t offset, uint32_t drawCount, uint32_t stride )
+{
+	CI_VK_DEVICE_FN( CmdDrawIndexedIndirect( getCommandBufferHandle(), buffer->getBufferHandle(), offset, drawCount, stride ) );
+}
+
+void CommandBuffer::drawIndexedIndirectCount( const vk::BufferRef &buffer, uint64_t offset, const vk::BufferRef &countBuffer, uint64_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride )
+{
+	CI_VK_DEVICE_FN( CmdDrawIndexedIndirectCountKHR( getCommandBufferHandle(), buffer->getBufferHandle(), offset, countBuffer->getBufferHandle(), countBufferOffset, maxDrawCount, stride ) );
+}
+
+void CommandBuffer::dispatch( uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ )
+{
+	CI_VK_DEVICE_FN( CmdDispatch( getCommandBufferHandle(), groupCountX, groupCountY, groupCountZ ) );
+}
+
+void CommandBuffer::dispatchIndirect( const vk::BufferRef &buffer, uint64_t offset )
+{
+	CI_VK_DEVICE_FN( CmdDispatchIndirect( getCommandBufferHandle(), buffer->getBufferHandle(), offset ) );
+}
+
+void CommandBuffer::fillBuffer( const vk::BufferRef &buffer, uint64_t offset, uint64_t size, uint32_t data )
+{
+	CI_VK_DEVICE_FN( CmdFillBuffer( getCommandBufferHandle(), buffer->getBufferHandle(), offset, size, data ) );
+}
+
+void CommandBuffer::pipelineBarrier2( const VkDependencyInfoKHR &dependencyInfo )
+{
+	CI_VK_DEVICE_FN( CmdPipelineBarrier2KHR( getCommandBufferHandle(), &dependencyInfo ) );
+}
+
+void CommandBuffer::resetQueryPool( const vk::QueryPoolRef &queryPool, uint32_t firstQuery, uint32_t queryCount )
+{
+	CI_VK_DEVICE_FN( CmdResetQueryPool( getCommandBufferHandle(), queryPool->getQueryPoolHandle(), firstQuery, queryCount ) );
+}
+
+void CommandBuffer::writeTimestamp( VkPipelineStageFlags2KHR stage, const vk::QueryPoolRef &queryPool, uint32_t query )
+{
+	CI_VK_DEVICE_FN( CmdWriteTimestamp2KHR( getCommandBufferHandle(), stage, queryPool->getQueryPoolHandle(), query ) );
+}
+
 void CommandBuffer::transitionImageLayout(
 	VkImage				 image,
 	VkImageAspectFlags	 aspectMask,
@@ -6,8 +6,10 @@
 #include "cinder/vk/Image.h"
 #include "cinder/vk/Mesh.h"
 #include "cinder/vk/Pipeline.h"
+#include "cinder/vk/Query.h"
 #include "cinder/vk/Sampler.h"
 #include "cinder/vk/ShaderProg.h"
+#include "cinder/vk/ShapeBatch.h"
 #include "cinder/vk/Sync.h"
 #include "cinder/vk/Texture.h"
 #include "cinder/vk/UniformBuffer.h"
@@ -17,9 +19,11 @@
 #include "cinder/app/RendererVk.h"
 #include "cinder/Log.h"
 
+#include <chrono>
+
 namespace cinder::vk {
 
-static Context *sCurrentContext = nullptr;
+static thread_local Context *sCurrentContext = nullptr;
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
 // Context::Frame
@@ -87,6 +91,21 @@ void Context::DescriptorState::bindUniformBuffer( uint32_t bindingNumber, const
 	mDescriptors.insert_or_assign( bindingNumber, Descriptor( bindingNumber, buffer ) );
 }
 
+void Context::DescriptorState::bindStorageBuffer( uint32_t bindingNumber, const vk::Buffer *buffer )
+{
+	mDescriptors.insert_or_assign( bindingNumber, Descriptor( bindingNumber, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, buffer ) );
+}
+
+void Context::DescriptorState::bindStorageImage( uint32_t bindingNumber, const vk::ImageView *imageView )
+{
+	mDescriptors.insert_or_assign( bindingNumber, Descriptor( bindingNumber, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, imageView ) );
+}
+
+void Context::DescriptorState::unbind( uint32_t bindingNumber )
+{
+	mDescriptors.erase( bindingNumber );
+}
+
 void Context::DescriptorState::bindCombinedImageSampler( uint32_t bindingNumber, const vk::ImageView *imageView, const vk::Sampler *sampler )
 {
 	bool bind = true;
@@ -104,6 +123,48 @@ void Context::DescriptorState::bindCombinedImageSampler( uint32_t bindingNumber,
 /////////////////////////////////////////////////////////////////////////////////////////////////
 // Context
 
+static void attachmentBarrier(
+	vk::CommandBuffer		*pCommandBuffer,
+	const vk::Image			*pImage,
+	VkImageLayout			 oldLayout,
+	VkImageLayout			 newLayout,
+	VkPipelineStageFlags2KHR srcStageMask,
+	VkAccessFlags2KHR		 srcAccessMask,
+	VkPipelineStageFlags2KHR dstStageMask,
+	VkAccessFlags2KHR		 dstAccessMask )
+{
+	VkImageMemoryBarrier2KHR barrier		= { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR };
+	barrier.pNext							= nullptr;
+	barrier.srcStageMask					= srcStageMask;
+	barrier.srcAccessMask					= srcAccessMask;
+	barrier.dstStageMask					= dstStageMask;
+	barrier.dstAccessMask					= dstAccessMask;
+	barrier.oldLayout						= oldLayout;
+	barrier.newLayout						= newLayout;
+	barrier.srcQueueFamilyIndex				= VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex				= VK_QUEUE_FAMILY_IGNORED;
+	barrier.image							= pImage->getImageHandle();
+	barrier.subresourceRange.aspectMask		= pImage->getAspectMask();
+	barrier.subresourceRange.baseMipLevel	= 0;
+	barrier.subresourceRange.levelCount		= 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount		= 1;
+
+	VkDependencyInfoKHR dependencyInfo	   = { VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR };
+	dependencyInfo.pNext				   = nullptr;
+	dependencyInfo.dependencyFlags		   = 0;
+	dependencyInfo.imageMemoryBarrierCount = 1;
+	dependencyInfo.pImageMemoryBarriers	   = &barrier;
+
+	pCommandBuffer->pipelineBarrier2( dependencyInfo );
+}
+
+// Stages and reads of draws and dispatches that can touch what a dispatch stores, see Context::computeBarrier()
+static const VkPipelineStageFlags2KHR DRAW_STAGES		   = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT_KHR | VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT_KHR | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR;
+static const VkAccessFlags2KHR		  DRAW_READ_ACCESS	   = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT_KHR | VK_ACCESS_2_INDEX_READ_BIT_KHR | VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT_KHR | VK_ACCESS_2_UNIFORM_READ_BIT_KHR | VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR | VK_ACCESS_2_SHADER_STORAGE_READ_BIT_KHR;
+static const VkPipelineStageFlags2KHR DISPATCH_STAGES	   = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR;
+static const VkAccessFlags2KHR		  DISPATCH_READ_ACCESS = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT_KHR | VK_ACCESS_2_UNIFORM_READ_BIT_KHR | VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR | VK_ACCESS_2_SHADER_STORAGE_READ_BIT_KHR;
+
 ContextRef Context::create( const Options &options, vk::DeviceRef device )
 {
 	if ( !device ) {
@@ -127,14 +188,18 @@ ContextRef Context::create( uint32_t width, uint32_t height, const Options &opti
 	return ContextRef( new Context( device, width, height, options ) );
 }
 
-Context::Context( vk::DeviceRef device, uint32_t width, uint32_t height, const Options &options )
+Context::Context( vk::DeviceRef device, uint32_t width, uint32_t height, const Options &options, Context *parent )
 	: vk::DeviceChildObject( device ),
 	  mNumFramesInFlight( options.mNumInFlightFrames ),
 	  mWidth( width ),
 	  mHeight( height ),
 	  mRenderTargetFormats( options.mRenderTargetFormats ),
 	  mDepthStencilFormat( options.mDepthStencilFormat ),
-	  mSampleCount( options.mSampleCount )
+	  mSampleCount( options.mSampleCount ),
+	  mPresentable( options.mPresentable ),
+	  mAttachmentOps( options.mAttachmentOps ),
+	  mTransientAttachments( options.mTransientAttachments ),
+	  mParent( parent ? parent->shared_from_this() : ContextRef() )
 {
 	initializeDescriptorSetLayouts();
 	initializePipelineLayout();
@@ -176,15 +241,19 @@ Context::Context( vk::DeviceRef device, uint32_t width, uint32_t height, const O
 	// Hash graphics pipeline state
 	mCurrentGraphicsPipelineHash = vk::Pipeline::calculateHash( &mGraphicsState );
 
-	// Command pool and command buffers
+	// Command pool and command buffers, recorders get their own pool so
+	// they can record on another thread
 	std::vector<vk::CommandBufferRef> commandBuffers;
 	{
-		mCommandPool   = vk::CommandPool::create( device->getQueueFamilyIndices().graphics, vk::CommandPool::Options(), device );
-		commandBuffers = mCommandPool->allocateCommandBuffers( mNumFramesInFlight );
+		VkCommandBufferLevel level = isRecorder() ? VK_COMMAND_BUFFER_LEVEL_SECONDARY : VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		mCommandPool			   = vk::CommandPool::create( device->getQueueFamilyIndices().graphics, vk::CommandPool::Options(), device );
+		commandBuffers			   = mCommandPool->allocateCommandBuffers( mNumFramesInFlight, level );
 	}
 
-	// Frame sync semaphore
-	mFrameSyncSemaphore = vk::CountingSemaphore::create( 0, getDevice() );
+	// Frame sync semaphore, recorders are synchronized by their parent
+	if ( !isRecorder() ) {
+		mFrameSyncSemaphore = vk::CountingSemaphore::create( 0, getDevice() );
+	}
 
 	// Frames
 	mFrames.resize( mNumFramesInFlight );
@@ -215,11 +284,13 @@ void Context::initializeDescriptorSetLayouts()
 		uint32_t hs = CINDER_CONTEXT_HS_BINDING_SHIFT_TEXTURE + i;
 		uint32_t ds = CINDER_CONTEXT_DS_BINDING_SHIFT_TEXTURE + i;
 		uint32_t gs = CINDER_CONTEXT_GS_BINDING_SHIFT_TEXTURE + i;
+		uint32_t cs = CINDER_CONTEXT_CS_BINDING_SHIFT_TEXTURE + i;
 		options.addCombinedImageSampler( vs );
 		options.addCombinedImageSampler( ps );
 		options.addCombinedImageSampler( hs );
 		options.addCombinedImageSampler( ds );
 		options.addCombinedImageSampler( gs );
+		options.addCombinedImageSampler( cs, 1, VK_SHADER_STAGE_COMPUTE_BIT );
 	}
 
 	for ( uint32_t i = 0; i < CINDER_CONTEXT_PER_STAGE_UBO_COUNT; ++i ) {
@@ -228,11 +299,36 @@ void Context::initializeDescriptorSetLayouts()
 		uint32_t hs = CINDER_CONTEXT_HS_BINDING_SHIFT_UBO + i;
 		uint32_t ds = CINDER_CONTEXT_DS_BINDING_SHIFT_UBO + i;
 		uint32_t gs = CINDER_CONTEXT_GS_BINDING_SHIFT_UBO + i;
+		uint32_t cs = CINDER_CONTEXT_CS_BINDING_SHIFT_UBO + i;
 		options.addUniformBuffer( vs );
 		options.addUniformBuffer( ps );
 		options.addUniformBuffer( hs );
 		options.addUniformBuffer( ds );
 		options.addUniformBuffer( gs );
+		options.addUniformBuffer( cs, 1, VK_SHADER_STAGE_COMPUTE_BIT );
+	}
+
+	for ( uint32_t i = 0; i < CINDER_CONTEXT_PER_STAGE_SSBO_COUNT; ++i ) {
+		uint32_t vs = CINDER_CONTEXT_VS_BINDING_SHIFT_SSBO + i;
+		uint32_t ps = CINDER_CONTEXT_PS_BINDING_SHIFT_SSBO + i;
+		uint32_t hs = CINDER_CONTEXT_HS_BINDING_SHIFT_SSBO + i;
+		uint32_t ds = CINDER_CONTEXT_DS_BINDING_SHIFT_SSBO + i;
+		uint32_t gs = CINDER_CONTEXT_GS_BINDING_SHIFT_SSBO + i;
+		uint32_t cs = CINDER_CONTEXT_CS_BINDING_SHIFT_SSBO + i;
+		options.addStorageBuffer( vs );
+		options.addStorageBuffer( ps );
+		options.addStorageBuffer( hs );
+		options.addStorageBuffer( ds );
+		options.addStorageBuffer( gs );
+		options.addStorageBuffer( cs, 1, VK_SHADER_STAGE_COMPUTE_BIT );
+	}
+
+	// Storage images are only bound for the stages that commonly write them
+	for ( uint32_t i = 0; i < CINDER_CONTEXT_PER_STAGE_IMAGE_COUNT; ++i ) {
+		uint32_t ps = CINDER_CONTEXT_PS_BINDING_SHIFT_IMAGE + i;
+		uint32_t cs = CINDER_CONTEXT_CS_BINDING_SHIFT_IMAGE + i;
+		options.addStorageImage( ps );
+		options.addStorageImage( cs, 1, VK_SHADER_STAGE_COMPUTE_BIT );
 	}
 
 	mDefaultSetLayout = vk::DescriptorSetLayout::create( options, getDevice() );
@@ -251,29 +347,78 @@ void Context::initializeFrame( vk::CommandBufferRef commandBuffer, Frame &frame
 
 	vk::DescriptorPool::Options options = vk::DescriptorPool::Options()
 											  .addCombinedImageSampler( 10 * CINDER_CONTEXT_PER_STAGE_TEXTURE_COUNT )
-											  .addUniformBuffer( 10 * CINDER_CONTEXT_PER_STAGE_UBO_COUNT );
+											  .addUniformBuffer( 10 * CINDER_CONTEXT_PER_STAGE_UBO_COUNT )
+											  .addStorageBuffer( 10 * CINDER_CONTEXT_PER_STAGE_SSBO_COUNT )
+											  .addStorageImage( 10 * CINDER_CONTEXT_PER_STAGE_IMAGE_COUNT );
 	frame.descriptorPool = vk::DescriptorPool::create( options, getDevice() );
 
+	// Start and end of frame timestamps for FrameStats::gpuBusyMs
+	if ( !isRecorder() && getDevice()->getDeviceLimits().timestampComputeAndGraphics ) {
+		frame.timestampQueryPool = vk::QueryPool::create( VK_QUERY_TYPE_TIMESTAMP, 2, getDevice() );
+	}
+
+	// Recorders draw into the parent's attachments, beginRecorderFrame()
+	// picks them up each frame
+	if ( isRecorder() ) {
+		return;
+	}
+
+	// Transient attachments are created once and shared by all frames
+	const Frame			 *pFirstFrame	  = ( &frame != mFrames.data() ) ? &mFrames[0] : nullptr;
+	const vk::MemoryUsage transientMemory = getDevice()->isLazilyAllocatedMemorySupported() ? vk::MemoryUsage::GPU_LAZILY_ALLOCATED : vk::MemoryUsage::GPU_ONLY;
+
 	uint32_t renderTargetCount = countU32( mRenderTargetFormats );
 	frame.renderTargets.resize( renderTargetCount );
 	frame.rtvs.resize( renderTargetCount );
+	frame.colorClearValues.resize( renderTargetCount );
 	for ( uint32_t i = 0; i < renderTargetCount; ++i ) {
-		vk::Image::Usage   usage   = vk::Image::Usage().renderTarget().sampledImage();
-		vk::Image::Options options = vk::Image::Options().samples( mSampleCount );
-		frame.renderTargets[i]	   = vk::Image::create( mWidth, mHeight, mRenderTargetFormats[i], usage, vk::MemoryUsage::GPU_ONLY, options, getDevice() );
+		// Single sampled presentable contexts draw straight into the swapchain image
+		if ( ( i == 0 ) && mPresentable && ( mSampleCount == VK_SAMPLE_COUNT_1_BIT ) ) {
+			continue;
+		}
+
+		if ( isTransientRenderTarget( i ) ) {
+			if ( pFirstFrame ) {
+				frame.renderTargets[i] = pFirstFrame->renderTargets[i];
+				frame.rtvs[i]		   = pFirstFrame->rtvs[i];
+				continue;
+			}
+
+			vk::Image::Usage   usage   = vk::Image::Usage().renderTarget().transientAttachment();
+			vk::Image::Options options = vk::Image::Options().samples( mSampleCount );
+			frame.renderTargets[i]	   = vk::Image::create( mWidth, mHeight, mRenderTargetFormats[i], usage, transientMemory, options, getDevice() );
+		}
+		else {
+			vk::Image::Usage   usage   = vk::Image::Usage().renderTarget().sampledImage();
+			vk::Image::Options options = vk::Image::Options().samples( mSampleCount );
+			frame.renderTargets[i]	   = vk::Image::create( mWidth, mHeight, mRenderTargetFormats[i], usage, vk::MemoryUsage::GPU_ONLY, options, getDevice() );
+		}
 
 		frame.rtvs[i] = vk::ImageView::create( frame.renderTargets[i], getDevice() );
 	}
 
 	if ( mDepthStencilFormat != VK_FORMAT_UNDEFINED ) {
-		vk::Image::Usage   usage   = vk::Image::Usage().depthStencil().sampledImage();
+		if ( mTransientAttachments && pFirstFrame ) {
+			frame.depthStencil = pFirstFrame->depthStencil;
+			frame.dsv		   = pFirstFrame->dsv;
+			return;
+		}
+
+		vk::Image::Usage   usage   = mTransientAttachments ? vk::Image::Usage().depthStencil().transientAttachment() : vk::Image::Usage().depthStencil().sampledImage();
 		vk::Image::Options options = vk::Image::Options().samples( mSampleCount );
-		frame.depthStencil		   = vk::Image::create( mWidth, mHeight, mDepthStencilFormat, usage, vk::MemoryUsage::GPU_ONLY, options, getDevice() );
+		frame.depthStencil		   = vk::Image::create( mWidth, mHeight, mDepthStencilFormat, usage, mTransientAttachments ? transientMemory : vk::MemoryUsage::GPU_ONLY, options, getDevice() );
 
 		frame.dsv = vk::ImageView::create( frame.depthStencil, getDevice() );
 	}
 }
 
+bool Context::isTransientRenderTarget( uint32_t index ) const
+{
+	// Only render target 0 of a multisampled presentable context is
+	// resolved away each frame, the others are the context's output
+	return mTransientAttachments && ( index == 0 ) && mPresentable && ( mSampleCount != VK_SAMPLE_COUNT_1_BIT );
+}
+
 void Context::registerChild( vk::ContextChildObject *child )
 {
 	auto it = std::find( mChildren.begin(), mChildren.end(), child );
@@ -350,33 +495,21 @@ void Context::makeCurrent( const std::vector<SemaphoreInfo> &externalWaits )
 {
 	sCurrentContext = this;
 
-	// Wait for any external semaphores
-	if ( !externalWaits.empty() ) {
-		std::vector<VkSemaphore> semaphores;
-		std::vector<uint64_t>	 values;
-		for ( const auto &wait : externalWaits ) {
-			if ( !wait.semaphore->isTimeline() ) {
-				throw VulkanExc( "all external waits must be timeline semaphores" );
-			}
-			semaphores.push_back( wait.semaphore->getSemaphoreHandle() );
-			values.push_back( wait.value );
-		}
-
-		VkSemaphoreWaitInfo vkswi = { VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
-		vkswi.pNext				  = nullptr;
-		vkswi.flags				  = 0;
-		vkswi.semaphoreCount	  = countU32( semaphores );
-		vkswi.pSemaphores		  = dataPtr( semaphores );
-		vkswi.pValues			  = dataPtr( values );
+	if ( isRecorder() ) {
+		beginRecorderFrame();
+		return;
+	}
 
-		VkResult vkres = CI_VK_DEVICE_FN( WaitSemaphores( getDeviceHandle(), &vkswi, UINT64_MAX ) );
-		if ( vkres != VK_SUCCESS ) {
-			throw VulkanFnFailedExc( "vkWaitSemaphores", vkres );
-		}
+	// External waits are forwarded to the GPU with the next submit
+	for ( const auto &wait : externalWaits ) {
+		addSubmitWait( wait );
 	}
 
-	// Wait for any pending work to complete
+	// The only CPU wait: the GPU has to be done with the oldest frame in
+	// flight before its command buffer and descriptors are reused
+	auto waitStart = std::chrono::steady_clock::now();
 	waitForCompletion();
+	auto waitEnd = std::chrono::steady_clock::now();
 
 	// Get current frame
 	Frame &frame = getCurrentFrame();
@@ -387,17 +520,102 @@ void Context::makeCurrent( const std::vector<SemaphoreInfo> &externalWaits )
 
 	// Start command buffer recording if it's not already started
 	if ( !frame.commandBuffer->isRecording() ) {
+		// The frame's previous submission has completed, release the
+		// recorders it executed and finish its stats
+		frame.executedRecorders.clear();
+
+		if ( frame.statsPending ) {
+			uint64_t timestamps[2] = {};
+			double	 gpuBusyMs	   = 0.0;
+			if ( frame.timestampQueryPool && ( frame.timestampQueryPool->getResults( 0, 2, timestamps ) == VK_SUCCESS ) ) {
+				const double period = static_cast<double>( getDevice()->getDeviceLimits().timestampPeriod );
+				gpuBusyMs			= static_cast<double>( timestamps[1] - timestamps[0] ) * period / 1000000.0;
+			}
+
+			mFrameStats.frameCount = frame.statsFrameCount;
+			mFrameStats.cpuWaitMs  = frame.cpuWaitMs;
+			mFrameStats.gpuBusyMs  = gpuBusyMs;
+			frame.statsPending	   = false;
+		}
+		frame.statsFrameCount = mFrameCount;
+		frame.cpuWaitMs		  = std::chrono::duration<double, std::milli>( waitEnd - waitStart ).count();
+
 		frame.commandBuffer->begin();
 
+		if ( frame.timestampQueryPool ) {
+			frame.commandBuffer->resetQueryPool( frame.timestampQueryPool, 0, 2 );
+			frame.commandBuffer->writeTimestamp( VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT_KHR, frame.timestampQueryPool, 0 );
+		}
+
+		if ( mPresentable ) {
+			if ( !frame.presentView ) {
+				throw VulkanExc( "setPresentImage() must be called before makeCurrent() on a presentable context" );
+			}
+
+			// The previous contents of the swapchain image aren't needed. The
+			// submit waits for the acquire at the color output stage, which
+			// this barrier's source scope chains onto.
+			attachmentBarrier(
+				frame.commandBuffer.get(),
+				frame.presentView->getImage().get(),
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+				VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR,
+				0,
+				VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR,
+				VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT_KHR | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR );
+
+			// Nothing to load from an image that just came from UNDEFINED
+			if ( mSampleCount == VK_SAMPLE_COUNT_1_BIT ) {
+				frame.storedColors &= ~1u;
+			}
+		}
+
+		// Shared transient attachments may still be in use by the previous
+		// frame. Queue submission order puts its attachment writes in this
+		// barrier's first scope, and their contents aren't needed.
+		if ( mTransientAttachments ) {
+			for ( uint32_t i = 0; i < countU32( frame.renderTargets ); ++i ) {
+				if ( !isTransientRenderTarget( i ) ) {
+					continue;
+				}
+
+				attachmentBarrier(
+					frame.commandBuffer.get(),
+					frame.renderTargets[i].get(),
+					VK_IMAGE_LAYOUT_UNDEFINED,
+					VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+					VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR,
+					VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR,
+					VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR,
+					VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT_KHR | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR );
+				frame.storedColors &= ~( 1u << i );
+			}
+
+			if ( frame.depthStencil ) {
+				const VkPipelineStageFlags2KHR depthStages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR;
+
+				attachmentBarrier(
+					frame.commandBuffer.get(),
+					frame.depthStencil.get(),
+					VK_IMAGE_LAYOUT_UNDEFINED,
+					VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+					depthStages,
+					VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR,
+					depthStages,
+					VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR );
+				frame.storedDepthStencil = false;
+			}
+		}
+
 		frame.commandBuffer->setViewport( 0, 0, static_cast<float>( mWidth ), static_cast<float>( mHeight ) );
 		frame.commandBuffer->setScissor( 0, 0, mWidth, mHeight );
 
 		setDynamicStates( true );
 	}
-	// Start rendering if it's not already started
+	// Rendering starts with the first draw so clears before it become load op clears
 	if ( !frame.commandBuffer->isRendering() ) {
-		vk::CommandBuffer::RenderingInfo ri = vk::CommandBuffer::RenderingInfo( frame.rtvs, frame.dsv );
-		frame.commandBuffer->beginRendering( ri );
+		frame.renderingPending = true;
 	}
 
 	if ( mFrameCount > 0 ) {
@@ -407,6 +625,227 @@ void Context::makeCurrent( const std::vector<SemaphoreInfo> &externalWaits )
 	}
 }
 
+void Context::beginRecorderFrame()
+{
+	// Follow the parent's frame, the parent's makeCurrent() has already
+	// waited for it so the recorder's command buffer is free as well
+	if ( mFrameCount != mParent->mFrameCount ) {
+		mFrameCount			= mParent->mFrameCount;
+		mPreviousFrameIndex = mFrameIndex;
+		mFrameIndex			= mParent->mFrameIndex;
+
+		if ( mFrameCount > 0 ) {
+			for ( auto &child : mChildren ) {
+				child->flightSync( mFrameIndex, mPreviousFrameIndex );
+			}
+		}
+	}
+
+	if ( mExecutedFrameCount == ( mFrameCount + 1 ) ) {
+		throw VulkanExc( "recorder has already been executed this frame" );
+	}
+
+	Frame &frame = getCurrentFrame();
+	if ( frame.commandBuffer->isRecording() ) {
+		return;
+	}
+
+	// Take the parent's attachments and extent as they are this frame. A
+	// single sampled presentable parent only gets its swapchain image in
+	// setPresentImage(), and the parent may have been resized.
+	const Frame &parentFrame = mParent->mFrames[mFrameIndex];
+	frame.renderTargets		 = parentFrame.renderTargets;
+	frame.rtvs				 = parentFrame.rtvs;
+	frame.depthStencil		 = parentFrame.depthStencil;
+	frame.dsv				 = parentFrame.dsv;
+	mWidth					 = mParent->mWidth;
+	mHeight					 = mParent->mHeight;
+
+	frame.resetDrawCalls();
+	frame.nextDrawCall( mDefaultSetLayout );
+
+	frame.commandBuffer->beginSecondary( mRenderTargetFormats, mDepthStencilFormat, mSampleCount );
+
+	// Dynamic state isn't inherited from the primary command buffer
+	frame.commandBuffer->setViewport( 0, 0, static_cast<float>( mWidth ), static_cast<float>( mHeight ) );
+	frame.commandBuffer->setScissor( 0, 0, mWidth, mHeight );
+	setDynamicStates( true );
+}
+
+ContextRef Context::createRecorder()
+{
+	if ( isRecorder() ) {
+		throw VulkanExc( "recorders can't create recorders" );
+	}
+
+	Options options				 = Options();
+	options.mNumInFlightFrames	 = mNumFramesInFlight;
+	options.mRenderTargetFormats = mRenderTargetFormats;
+	options.mDepthStencilFormat	 = mDepthStencilFormat;
+	options.mSampleCount		 = mSampleCount;
+
+	return ContextRef( new Context( getDevice(), mWidth, mHeight, options, this ) );
+}
+
+void Context::executeRecorders( const std::vector<ContextRef> &recorders )
+{
+	if ( isRecorder() ) {
+		throw VulkanExc( "executeRecorders() must be called on the recorders' parent" );
+	}
+
+	flushShapes();
+
+	Frame &frame = getCurrentFrame();
+
+	std::vector<vk::CommandBufferRef> commandBuffers;
+	for ( const auto &recorder : recorders ) {
+		if ( recorder->mParent.get() != this ) {
+			throw VulkanExc( "recorder was created by a different context" );
+		}
+
+		Frame &recorderFrame = recorder->getCurrentFrame();
+		if ( ( recorder->mFrameCount != mFrameCount ) || !recorderFrame.commandBuffer->isRecording() ) {
+			continue;
+		}
+
+		recorder->flushShapes();
+		recorderFrame.commandBuffer->end();
+		recorder->mExecutedFrameCount = mFrameCount + 1;
+
+		commandBuffers.push_back( recorderFrame.commandBuffer );
+		frame.executedRecorders.push_back( recorder );
+	}
+
+	if ( commandBuffers.empty() ) {
+		return;
+	}
+
+	// Secondary command buffers need a render pass instance of their own,
+	// pending clears are folded into it
+	if ( frame.commandBuffer->isRendering() ) {
+		frame.commandBuffer->endRendering();
+	}
+
+	beginFrameRendering( frame, VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR );
+	frame.commandBuffer->executeCommands( commandBuffers );
+	frame.commandBuffer->endRendering();
+
+	// Resume inline recording with the next draw, state set by dynamic
+	// commands is undefined after vkCmdExecuteCommands so restore it
+	frame.renderingPending = true;
+
+	auto viewport = getViewport();
+	frame.commandBuffer->setViewport(
+		static_cast<float>( viewport.first.x ),
+		static_cast<float>( viewport.first.y ),
+		static_cast<float>( viewport.second.x ),
+		static_cast<float>( viewport.second.y ),
+		0.0f,
+		1.0f );
+
+	auto scissor = getScissor();
+	frame.commandBuffer->setScissor(
+		scissor.first.x,
+		scissor.first.y,
+		static_cast<uint32_t>( scissor.second.x ),
+		static_cast<uint32_t>( scissor.second.y ) );
+
+	setDynamicStates( true );
+}
+
+void Context::beginFrameRendering( Frame &frame, VkRenderingFlagsKHR flags )
+{
+	// Draws in this pass see what dispatches recorded before it stored
+	computeBarrier( false );
+	mGraphicsAccessPending = true;
+
+	vk::CommandBuffer::RenderingInfo ri;
+	if ( mPresentable && ( mSampleCount != VK_SAMPLE_COUNT_1_BIT ) ) {
+		// Render target 0 is resolved into the swapchain image at the end of
+		// each rendering instance, the last one leaves the final result
+		ri = vk::CommandBuffer::RenderingInfo( frame.rtvs[0]->getImageArea() );
+		for ( uint32_t i = 0; i < countU32( frame.rtvs ); ++i ) {
+			ri.addColorAttachment( frame.rtvs[i], ( i == 0 ) ? frame.presentView : nullptr );
+		}
+		if ( frame.dsv ) {
+			ri.setDepthStencilAttachment( frame.dsv );
+		}
+	}
+	else {
+		ri = vk::CommandBuffer::RenderingInfo( frame.rtvs, frame.dsv );
+	}
+
+	// The pass executing recorders is always followed by an inline one, and
+	// once the context suspends rendering any pass may be followed by one.
+	// Only the pass submit() closes can use the configured store ops.
+	const bool			intermediate		= ( ( flags & VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR ) != 0 ) || mSuspendsRendering;
+	VkAttachmentStoreOp colorStoreOp		= intermediate ? VK_ATTACHMENT_STORE_OP_STORE : mAttachmentOps.colorStoreOp;
+	VkAttachmentStoreOp depthStencilStoreOp = intermediate ? VK_ATTACHMENT_STORE_OP_STORE : mAttachmentOps.depthStencilStoreOp;
+
+	for ( uint32_t i = 0; i < countU32( frame.rtvs ); ++i ) {
+		const uint32_t bit = 1u << i;
+
+		VkAttachmentLoadOp loadOp = ( frame.storedColors & bit ) ? mAttachmentOps.colorLoadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		if ( frame.pendingColorClears & bit ) {
+			loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		}
+		ri.setColorAttachmentOps( i, loadOp, colorStoreOp, frame.colorClearValues[i] );
+
+		if ( colorStoreOp == VK_ATTACHMENT_STORE_OP_STORE ) {
+			frame.storedColors |= bit;
+		}
+		else {
+			frame.storedColors &= ~bit;
+		}
+	}
+
+	if ( frame.dsv ) {
+		const VkAttachmentLoadOp loadOp = frame.storedDepthStencil ? mAttachmentOps.depthStencilLoadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+
+		const bool clearDepth	= ( frame.pendingDepthStencilClears & VK_IMAGE_ASPECT_DEPTH_BIT ) != 0;
+		const bool clearStencil = ( frame.pendingDepthStencilClears & VK_IMAGE_ASPECT_STENCIL_BIT ) != 0;
+		ri.setDepthAttachmentOps( clearDepth ? VK_ATTACHMENT_LOAD_OP_CLEAR : loadOp, depthStencilStoreOp, frame.depthStencilClearValue.depth );
+		ri.setStencilAttachmentOps( clearStencil ? VK_ATTACHMENT_LOAD_OP_CLEAR : loadOp, depthStencilStoreOp, frame.depthStencilClearValue.stencil );
+
+		frame.storedDepthStencil = ( depthStencilStoreOp == VK_ATTACHMENT_STORE_OP_STORE );
+	}
+
+	frame.commandBuffer->beginRendering( ri, flags );
+
+	frame.renderingPending			= false;
+	frame.pendingColorClears		= 0;
+	frame.pendingDepthStencilClears = 0;
+}
+
+void Context::beginPendingRendering()
+{
+	Frame &frame = getCurrentFrame();
+	if ( frame.renderingPending && !frame.commandBuffer->isRendering() ) {
+		beginFrameRendering( frame );
+	}
+}
+
+void Context::setPresentImage( const vk::ImageViewRef &view, const vk::SemaphoreRef &imageReady, const vk::SemaphoreRef &presentReady )
+{
+	if ( !mPresentable ) {
+		throw VulkanExc( "context was not created with Options::presentable()" );
+	}
+
+	Frame &frame = getCurrentFrame();
+	if ( frame.commandBuffer->isRecording() ) {
+		throw VulkanExc( "setPresentImage() must be called before makeCurrent() starts the frame" );
+	}
+
+	frame.presentView		= view;
+	frame.presentImageReady = imageReady;
+	frame.presentReady		= presentReady;
+
+	if ( mSampleCount == VK_SAMPLE_COUNT_1_BIT ) {
+		frame.renderTargets[0] = view->getImage();
+		frame.rtvs[0]		   = view;
+	}
+}
+
 Context *Context::getCurrentContext()
 {
 	return sCurrentContext;
@@ -424,16 +863,45 @@ const Context::Frame &Context::getCurrentFrame() const
 
 void Context::submit( const std::vector<SemaphoreInfo> &waits, const std::vector<SemaphoreInfo> &signals )
 {
+	if ( isRecorder() ) {
+		throw VulkanExc( "recorders are submitted by their parent's executeRecorders()" );
+	}
+
+	flushShapes();
+
 	Frame &frame = getCurrentFrame();
 
+	// Clears that no draw picked up still need a pass to happen in
+	if ( frame.commandBuffer->isRecording() && !frame.commandBuffer->isRendering() && ( frame.pendingColorClears || frame.pendingDepthStencilClears ) ) {
+		beginFrameRendering( frame );
+	}
+
 	// End rendeirng
 	if ( frame.commandBuffer->isRendering() ) {
 		frame.commandBuffer->endRendering();
 	}
+	frame.renderingPending = false;
 
 	// End command buffer recording
 	if ( frame.commandBuffer->isRecording() ) {
+		if ( frame.presentView ) {
+			attachmentBarrier(
+				frame.commandBuffer.get(),
+				frame.presentView->getImage().get(),
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+				VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+				VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR,
+				VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR,
+				VK_PIPELINE_STAGE_2_NONE_KHR,
+				0 );
+		}
+
+		if ( frame.timestampQueryPool ) {
+			frame.commandBuffer->writeTimestamp( VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT_KHR, frame.timestampQueryPool, 1 );
+		}
+
 		frame.commandBuffer->end();
+		frame.statsPending = true;
 	}
 
 	frame.frameSignaledValue = mFrameSyncSemaphore->incrementCounter();
@@ -441,9 +909,22 @@ void Context::submit( const std::vector<SemaphoreInfo> &waits, const std::vector
 	vk::SubmitInfo submitInfo = vk::SubmitInfo()
 									.addCommandBuffer( frame.commandBuffer )
 									.addSignal( mFrameSyncSemaphore, frame.frameSignaledValue );
-	// Waits
+	// Waits, including the external waits passed to makeCurrent()
+	for ( const auto &wait : mPendingWaits ) {
+		submitInfo.addWait( wait.semaphore, wait.value, wait.stageMask );
+	}
+	mPendingWaits.clear();
 	for ( const auto &wait : waits ) {
-		submitInfo.addWait( wait.semaphore, wait.value );
+		submitInfo.addWait( wait.semaphore, wait.value, wait.stageMask );
+	}
+	// Swapchain image acquire and present
+	if ( frame.presentView ) {
+		submitInfo.addWait( frame.presentImageReady, 0, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR );
+		submitInfo.addSignal( frame.presentReady );
+
+		frame.presentView.reset();
+		frame.presentImageReady.reset();
+		frame.presentReady.reset();
 	}
 	// Signals
 	for ( const auto &signal : signals ) {
@@ -462,8 +943,67 @@ void Context::submit( const std::vector<SemaphoreInfo> &waits, const std::vector
 	mFrameIndex			= static_cast<uint32_t>( mFrameCount % mNumFramesInFlight );
 }
 
+void Context::suspendRendering()
+{
+	if ( isRecorder() ) {
+		throw VulkanExc( "recorders can't suspend rendering" );
+	}
+
+	flushShapes();
+
+	Frame &frame = getCurrentFrame();
+	if ( frame.commandBuffer->isRendering() ) {
+		// A pass begun before the first suspend may not have stored its
+		// attachments, every pass from here on does
+		const uint32_t allColors = ( 1u << countU32( frame.rtvs ) ) - 1;
+		const bool	   discarded = ( ( frame.storedColors & allColors ) != allColors ) || ( frame.dsv && !frame.storedDepthStencil );
+		if ( discarded && !mSuspendsRendering ) {
+			CI_LOG_W( "suspendRendering() ended a pass that doesn't store all attachments, passes store them from now on. Don't use DONT_CARE store ops with contexts that suspend rendering." );
+		}
+		mSuspendsRendering = true;
+
+		frame.commandBuffer->endRendering();
+	}
+	frame.renderingPending = false;
+}
+
+void Context::resumeRendering()
+{
+	Frame &frame = getCurrentFrame();
+	if ( frame.commandBuffer->isRecording() && !frame.commandBuffer->isRendering() ) {
+		// Attachments stored by the previous pass are loaded, so nothing drawn before the suspend is lost
+		frame.renderingPending = true;
+	}
+}
+
+vk::ImageRef Context::getPreviousDepthStencil() const
+{
+	// A shared transient depth stencil doesn't outlive the frame
+	if ( ( mFrameCount == 0 ) || mTransientAttachments ) {
+		return vk::ImageRef();
+	}
+	return mFrames[mPreviousFrameIndex].depthStencil;
+}
+
+void Context::addSubmitWait( const SemaphoreInfo &wait )
+{
+	if ( isRecorder() ) {
+		throw VulkanExc( "recorders are submitted by their parent, add waits to the parent" );
+	}
+	if ( !wait.semaphore->isTimeline() ) {
+		throw VulkanExc( "all external waits must be timeline semaphores" );
+	}
+
+	mPendingWaits.push_back( wait );
+}
+
 void Context::waitForCompletion()
 {
+	if ( isRecorder() ) {
+		mParent->waitForCompletion();
+		return;
+	}
+
 	Frame &frame = getCurrentFrame();
 
 	// Avoid unncessary waits
@@ -473,6 +1013,43 @@ void Context::waitForCompletion()
 	}
 }
 
+Context::AttachmentMemory Context::getAttachmentMemory() const
+{
+	// Shared images appear in every frame, collect them once
+	std::vector<std::pair<const vk::Image *, bool>> images;
+	for ( const auto &frame : mFrames ) {
+		for ( uint32_t i = 0; i <= countU32( frame.renderTargets ); ++i ) {
+			const bool		 isDepthStencil = ( i == countU32( frame.renderTargets ) );
+			const vk::Image *pImage			= isDepthStencil ? frame.depthStencil.get() : frame.renderTargets[i].get();
+			// Swapchain images don't belong to the context
+			if ( !pImage || ( !isDepthStencil && ( i == 0 ) && mPresentable && ( mSampleCount == VK_SAMPLE_COUNT_1_BIT ) ) ) {
+				continue;
+			}
+
+			auto it = std::find_if( images.begin(), images.end(), [pImage]( const std::pair<const vk::Image *, bool> &elem ) { return elem.first == pImage; } );
+			if ( it == images.end() ) {
+				images.push_back( std::make_pair( pImage, isDepthStencil ? mTransientAttachments : isTransientRenderTarget( i ) ) );
+			}
+		}
+	}
+
+	AttachmentMemory memory = {};
+	for ( const auto &image : images ) {
+		const uint64_t size = image.first->getAllocationSize();
+
+		memory.numImages += 1;
+		memory.allocatedBytes += size;
+		if ( image.first->isLazilyAllocated() ) {
+			memory.lazilyAllocatedBytes += size;
+		}
+		if ( image.second ) {
+			memory.sharedBytes += size;
+		}
+	}
+
+	return memory;
+}
+
 vk::StockShaderManager *Context::getStockShaderManager()
 {
 	if ( !mStockShaderManager ) {
@@ -481,10 +1058,26 @@ vk::StockShaderManager *Context::getStockShaderManager()
 	return mStockShaderManager.get();
 }
 
+vk::ShapeBatch *Context::getShapeBatch()
+{
+	if ( !mShapeBatch ) {
+		mShapeBatch = std::make_unique<vk::ShapeBatch>( shared_from_this() );
+	}
+	return mShapeBatch.get();
+}
+
+void Context::flushShapes()
+{
+	if ( mShapeBatch ) {
+		mShapeBatch->flush();
+	}
+}
+
 //////////////////////////////////////////////////////////////////
 // Viewport
 void Context::viewport( const std::pair<ivec2, ivec2> &viewport )
 {
+	flushShapes();
 	if ( setStackState( mViewportStack, viewport ) ) {
 		getCurrentCommandBuffer()->setViewport(
 			static_cast<float>( viewport.first.x ),
@@ -498,6 +1091,7 @@ void Context::viewport( const std::pair<ivec2, ivec2> &viewport )
 
 void Context::pushViewport( const std::pair<ivec2, ivec2> &viewport )
 {
+	flushShapes();
 	if ( pushStackState( mViewportStack, viewport ) ) {
 		getCurrentCommandBuffer()->setViewport(
 			static_cast<float>( viewport.first.x ),
@@ -516,6 +1110,7 @@ void Context::pushViewport()
 
 void Context::popViewport( bool forceRestore )
 {
+	flushShapes();
 	if ( mViewportStack.empty() ) {
 		CI_LOG_E( "Viewport stack underflow" );
 	}
@@ -552,6 +1147,7 @@ std::pair<ivec2, ivec2> Context::getViewport()
 // Scissor Test
 void Context::setScissor( const std::pair<ivec2, ivec2> &scissor )
 {
+	flushShapes();
 	if ( setStackState( mScissorStack, scissor ) ) {
 		getCurrentCommandBuffer()->setScissor(
 			scissor.first.x,
@@ -563,6 +1159,7 @@ void Context::setScissor( const std::pair<ivec2, ivec2> &scissor )
 
 void Context::pushScissor( const std::pair<ivec2, ivec2> &scissor )
 {
+	flushShapes();
 	if ( pushStackState( mScissorStack, scissor ) ) {
 		getCurrentCommandBuffer()->setScissor(
 			scissor.first.x,
@@ -579,6 +1176,7 @@ void Context::pushScissor()
 
 void Context::popScissor( bool forceRestore )
 {
+	flushShapes();
 	if ( mScissorStack.empty() ) {
 		CI_LOG_E( "Scissor stack underflow" );
 	}
@@ -698,6 +1296,7 @@ void Context::bindTexture( const vk::TextureBase *texture, uint32_t binding )
 	// binding += CINDER_CONTEXT_BINDING_SHIFT_TEXTURE;
 	mDescriptorState.bindCombinedImageSampler( binding + CINDER_CONTEXT_VS_BINDING_SHIFT_TEXTURE, texture->getSampledImageView(), texture->getSampler() );
 	mDescriptorState.bindCombinedImageSampler( binding + CINDER_CONTEXT_PS_BINDING_SHIFT_TEXTURE, texture->getSampledImageView(), texture->getSampler() );
+	mDescriptorState.bindCombinedImageSampler( binding + CINDER_CONTEXT_CS_BINDING_SHIFT_TEXTURE, texture->getSampledImageView(), texture->getSampler() );
 }
 
 void Context::unbindTexture( uint32_t binding )
@@ -705,6 +1304,39 @@ void Context::unbindTexture( uint32_t binding )
 	// binding += CINDER_CONTEXT_BINDING_SHIFT_TEXTURE;
 	mDescriptorState.bindCombinedImageSampler( binding + CINDER_CONTEXT_VS_BINDING_SHIFT_TEXTURE, nullptr, nullptr );
 	mDescriptorState.bindCombinedImageSampler( binding + CINDER_CONTEXT_PS_BINDING_SHIFT_TEXTURE, nullptr, nullptr );
+	mDescriptorState.bindCombinedImageSampler( binding + CINDER_CONTEXT_CS_BINDING_SHIFT_TEXTURE, nullptr, nullptr );
+}
+
+//////////////////////////////////////////////////////////////////
+// Storage buffer
+
+void Context::bindStorageBuffer( const vk::Buffer *buffer, uint32_t binding )
+{
+	mDescriptorState.bindStorageBuffer( binding + CINDER_CONTEXT_VS_BINDING_SHIFT_SSBO, buffer );
+	mDescriptorState.bindStorageBuffer( binding + CINDER_CONTEXT_PS_BINDING_SHIFT_SSBO, buffer );
+	mDescriptorState.bindStorageBuffer( binding + CINDER_CONTEXT_CS_BINDING_SHIFT_SSBO, buffer );
+}
+
+void Context::unbindStorageBuffer( uint32_t binding )
+{
+	mDescriptorState.unbind( binding + CINDER_CONTEXT_VS_BINDING_SHIFT_SSBO );
+	mDescriptorState.unbind( binding + CINDER_CONTEXT_PS_BINDING_SHIFT_SSBO );
+	mDescriptorState.unbind( binding + CINDER_CONTEXT_CS_BINDING_SHIFT_SSBO );
+}
+
+//////////////////////////////////////////////////////////////////
+// Storage image
+
+void Context::bindStorageImage( const vk::ImageView *imageView, uint32_t binding )
+{
+	mDescriptorState.bindStorageImage( binding + CINDER_CONTEXT_PS_BINDING_SHIFT_IMAGE, imageView );
+	mDescriptorState.bindStorageImage( binding + CINDER_CONTEXT_CS_BINDING_SHIFT_IMAGE, imageView );
+}
+
+void Context::unbindStorageImage( uint32_t binding )
+{
+	mDescriptorState.unbind( binding + CINDER_CONTEXT_PS_BINDING_SHIFT_IMAGE );
+	mDescriptorState.unbind( binding + CINDER_CONTEXT_CS_BINDING_SHIFT_IMAGE );
 }
 
 void Context::initTextureBindingStack( uint32_t binding )
@@ -1072,27 +1704,58 @@ void Context::setDefaultShaderVars()
 
 void Context::clearColorAttachment( uint32_t index )
 {
-	VkRect2D rect = getCurrentFrame().renderTargets[index]->getArea();
+	flushShapes();
+
+	Frame &frame = getCurrentFrame();
 
 	const ColorA	 &value		 = mClearValues.color;
 	VkClearColorValue clearValue = { value.r, value.g, value.b, value.a };
 
-	getCurrentCommandBuffer()->clearColorAttachment( index, clearValue, rect );
+	// Outside a pass the clear becomes the next pass's load op
+	if ( !frame.commandBuffer->isRendering() ) {
+		frame.pendingColorClears |= ( 1u << index );
+		frame.colorClearValues[index] = clearValue;
+		return;
+	}
+
+	VkRect2D rect = frame.renderTargets[index]->getArea();
+
+	frame.commandBuffer->clearColorAttachment( index, clearValue, rect );
 }
 
 void Context::clearDepthStencilAttachment( VkImageAspectFlags aspectMask )
 {
-	VkRect2D rect = getCurrentFrame().depthStencil->getArea();
+	flushShapes();
 
-	getCurrentCommandBuffer()->clearDepthStencilAttachment( mClearValues.depth, mClearValues.stencil, rect, aspectMask );
+	Frame &frame = getCurrentFrame();
+
+	// Outside a pass the clear becomes the next pass's load op
+	if ( !frame.commandBuffer->isRendering() ) {
+		frame.pendingDepthStencilClears |= ( aspectMask & ( VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT ) );
+		if ( aspectMask & VK_IMAGE_ASPECT_DEPTH_BIT ) {
+			frame.depthStencilClearValue.depth = mClearValues.depth;
+		}
+		if ( aspectMask & VK_IMAGE_ASPECT_STENCIL_BIT ) {
+			frame.depthStencilClearValue.stencil = mClearValues.stencil;
+		}
+		return;
+	}
+
+	VkRect2D rect = frame.depthStencil->getArea();
+
+	frame.commandBuffer->clearDepthStencilAttachment( mClearValues.depth, mClearValues.stencil, rect, aspectMask );
 }
 
-void Context::bindDefaultDescriptorSet()
+void Context::bindDefaultDescriptorSet( VkPipelineBindPoint bindPoint )
 {
 	std::array<VkDescriptorBufferInfo, CINDER_CONTEXT_STAGE_COUNT * CINDER_CONTEXT_PER_STAGE_UBO_COUNT>	   uboBufferInfos;
+	std::array<VkDescriptorBufferInfo, CINDER_CONTEXT_STAGE_COUNT * CINDER_CONTEXT_PER_STAGE_SSBO_COUNT>   ssboBufferInfos;
 	std::array<VkDescriptorImageInfo, CINDER_CONTEXT_STAGE_COUNT * CINDER_CONTEXT_PER_STAGE_TEXTURE_COUNT> textureImageInfos;
-	uint32_t																							   uboCount		= 0;
-	uint32_t																							   textureCount = 0;
+	std::array<VkDescriptorImageInfo, CINDER_CONTEXT_STAGE_COUNT * CINDER_CONTEXT_PER_STAGE_IMAGE_COUNT>   storageImageInfos;
+	uint32_t																							   uboCount			 = 0;
+	uint32_t																							   ssboCount		 = 0;
+	uint32_t																							   textureCount		 = 0;
+	uint32_t																							   storageImageCount = 0;
 
 	std::vector<VkWriteDescriptorSet> writes;
 	for ( const auto &it : mDescriptorState.mDescriptors ) {
@@ -1118,6 +1781,17 @@ void Context::bindDefaultDescriptorSet()
 
 				++uboCount;
 			} break;
+			case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER: {
+				VkDescriptorBufferInfo *pInfo = &ssboBufferInfos[ssboCount];
+				pInfo->buffer				  = descriptor.bufferInfo.buffer->getBufferHandle();
+				pInfo->offset				  = 0;
+				pInfo->range				  = VK_WHOLE_SIZE;
+
+				write.pBufferInfo = pInfo;
+				writes.push_back( write );
+
+				++ssboCount;
+			} break;
 			case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: {
 				VkDescriptorImageInfo *pInfo = &textureImageInfos[textureCount];
 				pInfo->sampler				 = descriptor.imageInfo.sampler->getSamplerHandle();
@@ -1129,6 +1803,17 @@ void Context::bindDefaultDescriptorSet()
 
 				++textureCount;
 			} break;
+			case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE: {
+				VkDescriptorImageInfo *pInfo = &storageImageInfos[storageImageCount];
+				pInfo->sampler				 = VK_NULL_HANDLE;
+				pInfo->imageView			 = descriptor.imageInfo.imageView->getImageViewHandle();
+				pInfo->imageLayout			 = VK_IMAGE_LAYOUT_GENERAL;
+
+				write.pImageInfo = pInfo;
+				writes.push_back( write );
+
+				++storageImageCount;
+			} break;
 		}
 	}
 
@@ -1142,7 +1827,7 @@ void Context::bindDefaultDescriptorSet()
 	}
 
 	getCurrentCommandBuffer()->bindDescriptorSets(
-		VK_PIPELINE_BIND_POINT_GRAPHICS,
+		bindPoint,
 		mDefaultPipelineLayout,
 		0,
 		{ getCurrentFrame().currentDrawCall->descriptorSet } );
@@ -1161,10 +1846,11 @@ void Context::assignVertexAttributeLocations()
 	for ( uint32_t i = 0; i < numBuffers; ++i ) {
 		const auto &attribs = mVertexBuffers[i].first.getAttribs();
 
+		const VkVertexInputRate inputRate = ( i >= mFirstInstanceBinding ) ? VK_VERTEX_INPUT_RATE_INSTANCE : VK_VERTEX_INPUT_RATE_VERTEX;
+
 		const uint32_t attribCount = countU32( attribs );
-		for ( uint32_t j = 0; j < attribCount; ++j, ++vertexAttribCount ) {
-			const auto &attrib		 = attribs[j];
-			auto		 &vertexAttrib = mGraphicsState.ia.attributes[vertexAttribCount];
+		for ( uint32_t j = 0; j < attribCount; ++j ) {
+			const auto &attrib = attribs[j];
 
 			geom::Attrib semantic = attrib.getAttrib();
 			// Find semantic in program vertex attributes
@@ -1182,16 +1868,25 @@ void Context::assignVertexAttributeLocations()
 
 			const uint32_t location = it->getLocation();
 
+			// Only count attributes the shader uses so there are no stale entries
+			auto &vertexAttrib = mGraphicsState.ia.attributes[vertexAttribCount++];
+
 			// VkFormat format = it->getFormat();
-			VkFormat format = toVkFormat( attrib );
+			// Formats come from the mesh so encoded attributes get their packed format
+			VkFormat format = mVertexFormats[i][j];
 			vertexAttrib.format( format );
 			vertexAttrib.location( location );
 			vertexAttrib.offset( static_cast<uint32_t>( attrib.getOffset() ) );
 			vertexAttrib.binding( i );
-			vertexAttrib.inputRate( VK_VERTEX_INPUT_RATE_VERTEX );
+			vertexAttrib.inputRate( inputRate );
 		}
 	}
 	mGraphicsState.ia.attributeCount = vertexAttribCount;
+
+	// Clear unused entries, the pipeline hash covers the whole array
+	for ( uint32_t i = vertexAttribCount; i < CINDER_MAX_VERTEX_INPUTS; ++i ) {
+		mGraphicsState.ia.attributes[i] = vk::Pipeline::Attribute();
+	}
 }
 
 void Context::bindIndexBuffers( const vk::BufferedMeshRef &mesh )
@@ -1201,7 +1896,32 @@ void Context::bindIndexBuffers( const vk::BufferedMeshRef &mesh )
 
 void Context::bindVertexBuffers( const vk::BufferedMeshRef &mesh )
 {
-	mVertexBuffers = mesh->getVertexBuffers();
+	// Per instance buffers are bound after the per vertex buffers
+	mVertexBuffers		  = mesh->getVertexBuffers();
+	mVertexFormats		  = mesh->getVertexFormats();
+	mFirstInstanceBinding = countU32( mVertexBuffers );
+	mVertexBuffers.insert( mVertexBuffers.end(), mesh->getInstanceBuffers().begin(), mesh->getInstanceBuffers().end() );
+	mVertexFormats.insert( mVertexFormats.end(), mesh->getInstanceFormats().begin(), mesh->getInstanceFormats().end() );
+	assignVertexAttributeLocations();
+
+	std::vector<vk::BufferRef> buffers;
+	for ( auto &it : mVertexBuffers ) {
+		buffers.push_back( it.second );
+	}
+
+	// Dynamic meshes are bound at this frame's region of their rings
+	std::vector<uint64_t> offsets;
+	mesh->syncFrame( mFrameIndex, mFrameCount, mNumFramesInFlight, &offsets );
+	offsets.resize( buffers.size(), 0 );
+
+	getCurrentCommandBuffer()->bindVertexBuffers( 0, buffers, offsets );
+}
+
+void Context::bindVertexBuffers( const std::vector<std::pair<geom::BufferLayout, vk::BufferRef>> &vertexBuffers, const std::vector<std::vector<VkFormat>> &vertexFormats, const std::vector<uint64_t> &offsets, uint32_t firstInstanceBinding )
+{
+	mVertexBuffers		  = vertexBuffers;
+	mVertexFormats		  = vertexFormats;
+	mFirstInstanceBinding = std::min( firstInstanceBinding, countU32( mVertexBuffers ) );
 	assignVertexAttributeLocations();
 
 	std::vector<vk::BufferRef> buffers;
@@ -1209,7 +1929,7 @@ void Context::bindVertexBuffers( const vk::BufferedMeshRef &mesh )
 		buffers.push_back( it.second );
 	}
 
-	getCurrentCommandBuffer()->bindVertexBuffers( 0, buffers );
+	getCurrentCommandBuffer()->bindVertexBuffers( 0, buffers, offsets );
 }
 
 void Context::bindGraphicsPipeline( const vk::PipelineLayout *pipelineLayout )
@@ -1233,6 +1953,28 @@ void Context::bindGraphicsPipeline( const vk::PipelineLayout *pipelineLayout )
 	getCurrentCommandBuffer()->bindPipeline( VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline );
 }
 
+void Context::bindComputePipeline( const vk::PipelineLayout *pipelineLayout )
+{
+	if ( ( mShaderProg == nullptr ) || ( mShaderProg->getComputeShader() == nullptr ) ) {
+		throw VulkanExc( "bound shader program has no compute shader" );
+	}
+
+	vk::Pipeline::ComputePipelineCreateInfo createInfo = {};
+	createInfo.comp									   = mShaderProg->getComputeShader();
+	createInfo.pipelineLayout						   = ( pipelineLayout != nullptr ) ? pipelineLayout : mDefaultPipelineLayout.get();
+
+	uint64_t hash = vk::Pipeline::calculateHash( &createInfo );
+
+	auto it = mComputePipelines.find( hash );
+	if ( it == mComputePipelines.end() ) {
+		auto pipeline			= vk::Pipeline::create( createInfo, getDevice() );
+		mComputePipelines[hash] = pipeline;
+	}
+
+	auto &pipeline = mComputePipelines[hash];
+	getCurrentCommandBuffer()->bindPipeline( VK_PIPELINE_BIND_POINT_COMPUTE, pipeline );
+}
+
 void Context::setDynamicStates( bool force )
 {
 	if ( mDynamicStates.depthWrite.isDirty() || force ) {
@@ -1251,20 +1993,124 @@ void Context::setDynamicStates( bool force )
 	}
 }
 
-void Context::draw( int32_t firstVertex, int32_t vertexCount )
+void Context::draw( int32_t firstVertex, int32_t vertexCount, uint32_t instanceCount )
 {
+	beginPendingRendering();
 	setDynamicStates();
-	getCurrentCommandBuffer()->draw( static_cast<uint32_t>( vertexCount ), 1, static_cast<uint32_t>( firstVertex ), 0 );
+	getCurrentCommandBuffer()->draw( static_cast<uint32_t>( vertexCount ), instanceCount, static_cast<uint32_t>( firstVertex ), 0 );
 
 	getCurrentFrame().nextDrawCall( mDefaultSetLayout );
 }
 
-void Context::drawIndexed( int32_t firstIndex, int32_t indexCount )
+void Context::drawIndexed( int32_t firstIndex, int32_t indexCount, uint32_t instanceCount )
 {
+	beginPendingRendering();
 	setDynamicStates();
-	getCurrentCommandBuffer()->drawIndexed( static_cast<uint32_t>( indexCount ), 1, static_cast<uint32_t>( firstIndex ), 0, 0 );
+	getCurrentCommandBuffer()->drawIndexed( static_cast<uint32_t>( indexCount ), instanceCount, static_cast<uint32_t>( firstIndex ), 0, 0 );
 
 	getCurrentFrame().nextDrawCall( mDefaultSetLayout );
 }
 
+void Context::drawIndexedIndirect( const vk::BufferRef &buffer, uint64_t offset, uint32_t drawCount, uint32_t stride )
+{
+	beginPendingRendering();
+	setDynamicStates();
+
+	// Split the draws if the device can't take them all in one call
+	const uint32_t maxDrawCount = std::max<uint32_t>( 1, getDevice()->getDeviceLimits().maxDrawIndirectCount );
+	while ( drawCount > 0 ) {
+		uint32_t count = std::min( drawCount, maxDrawCount );
+		getCurrentCommandBuffer()->drawIndexedIndirect( buffer, offset, count, stride );
+		offset += static_cast<uint64_t>( count ) * stride;
+		drawCount -= count;
+	}
+
+	getCurrentFrame().nextDrawCall( mDefaultSetLayout );
+}
+
+void Context::drawIndexedIndirectCount( const vk::BufferRef &buffer, uint64_t offset, const vk::BufferRef &countBuffer, uint64_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride )
+{
+	beginPendingRendering();
+	setDynamicStates();
+
+	getCurrentCommandBuffer()->drawIndexedIndirectCount( buffer, offset, countBuffer, countBufferOffset, maxDrawCount, stride );
+
+	getCurrentFrame().nextDrawCall( mDefaultSetLayout );
+}
+
+void Context::dispatch( uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ )
+{
+	const bool resume = beginDispatch();
+	getCurrentCommandBuffer()->dispatch( groupCountX, groupCountY, groupCountZ );
+	endDispatch( resume );
+}
+
+void Context::dispatchIndirect( const vk::BufferRef &buffer, uint64_t offset )
+{
+	const bool resume = beginDispatch();
+	getCurrentCommandBuffer()->dispatchIndirect( buffer, offset );
+	endDispatch( resume );
+}
+
+bool Context::beginDispatch()
+{
+	if ( isRecorder() ) {
+		throw VulkanExc( "recorders can't dispatch, they record inside the parent's rendering pass" );
+	}
+
+	Frame	  &frame  = getCurrentFrame();
+	const bool resume = frame.renderingPending || frame.commandBuffer->isRendering();
+	suspendRendering();
+	computeBarrier( true );
+	return resume;
+}
+
+void Context::endDispatch( bool resume )
+{
+	mComputeWritesPending = true;
+
+	getCurrentFrame().nextDrawCall( mDefaultSetLayout );
+
+	if ( resume ) {
+		resumeRendering();
+	}
+}
+
+void Context::computeBarrier( bool beforeDispatch )
+{
+	VkMemoryBarrier2KHR barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER_2_KHR };
+	barrier.pNext				= nullptr;
+
+	// Reads and writes after the stores of earlier dispatches
+	if ( mComputeWritesPending ) {
+		barrier.srcStageMask  |= VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR;
+		barrier.srcAccessMask |= VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR;
+	}
+	// Dispatch writes after the reads of earlier draws, fragment shaders may have stored too
+	if ( beforeDispatch && mGraphicsAccessPending ) {
+		barrier.srcStageMask  |= DRAW_STAGES;
+		barrier.srcAccessMask |= VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR;
+	}
+
+	if ( barrier.srcStageMask == 0 ) {
+		return;
+	}
+
+	barrier.dstStageMask  = beforeDispatch ? DISPATCH_STAGES : DRAW_STAGES;
+	barrier.dstAccessMask = ( beforeDispatch ? DISPATCH_READ_ACCESS : DRAW_READ_ACCESS ) | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR;
+
+	VkDependencyInfoKHR dependencyInfo = { VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR };
+	dependencyInfo.pNext			   = nullptr;
+	dependencyInfo.dependencyFlags	   = 0;
+	dependencyInfo.memoryBarrierCount  = 1;
+	dependencyInfo.pMemoryBarriers	   = &barrier;
+
+	getCurrentCommandBuffer()->pipelineBarrier2( dependencyInfo );
+
+	mComputeWritesPending = false;
+	if ( beforeDispatch ) {
+		mGraphicsAccessPending = false;
+	}
+}
+
 } // namespace cinder::vk
@@ -16,6 +16,7 @@
 #include "xxh3.h"
 
 #include <algorithm>
+#include <cstring>
 
 // Staging buffers must use CPU_ONLY so it correctly
 // translates to VMA's CPU_ONLY value. We use CPU_ONLY
@@ -34,22 +35,29 @@ namespace cinder::vk {
 
 SubmitInfo &SubmitInfo::addCommandBuffer( const vk::CommandBufferRef &commandBuffer )
 {
-	mCommandBuffers.push_back( commandBuffer->getCommandBufferHandle() );
+	VkCommandBufferSubmitInfoKHR info = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO_KHR };
+	info.commandBuffer				  = commandBuffer->getCommandBufferHandle();
+	mCommandBuffers.push_back( info );
 	return *this;
 }
 
-SubmitInfo &SubmitInfo::addWait( const vk::Semaphore *semaphore, uint64_t value )
+SubmitInfo &SubmitInfo::addWait( const vk::Semaphore *semaphore, uint64_t value, VkPipelineStageFlags2KHR stageMask )
 {
-	mWaitSemaphores.push_back( semaphore->getSemaphoreHandle() );
-	mWaitValues.push_back( value );
-	mWaitDstStageMasks.push_back( VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT );
+	VkSemaphoreSubmitInfoKHR info = { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO_KHR };
+	info.semaphore				  = semaphore->getSemaphoreHandle();
+	info.value					  = value;
+	info.stageMask				  = stageMask;
+	mWaits.push_back( info );
 	return *this;
 }
 
 SubmitInfo &SubmitInfo::addSignal( const vk::Semaphore *semaphore, uint64_t value )
 {
-	mSignalSemaphores.push_back( semaphore->getSemaphoreHandle() );
-	mSignalValues.push_back( value );
+	VkSemaphoreSubmitInfoKHR info = { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO_KHR };
+	info.semaphore				  = semaphore->getSemaphoreHandle();
+	info.value					  = value;
+	info.stageMask				  = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR;
+	mSignals.push_back( info );
 	return *this;
 }
 
@@ -89,7 +97,11 @@ vk::SamplerRef Device::SamplerCache::createSampler( const vk::SamplerHashKey &ke
 	szKey.unnormalizedCoordinates = key.unnormalizedCoordinates;
 
 	uint64_t hash = static_cast<uint64_t>( XXH64( &szKey, size, 0x4cffabac5e25a3ac ) );
-	auto	 it	  = mSamplerMap.find( hash );
+
+	// Textures can be created from worker threads (see Texture2d::createAsync)
+	std::lock_guard<std::mutex> lock( mMutex );
+
+	auto it = mSamplerMap.find( hash );
 	if ( it != mSamplerMap.end() ) {
 		return it->second;
 	}
@@ -197,6 +209,11 @@ static void configureExtensions(
 			throw VulkanExtensionNotFoundExc( name );
 		}
 	}
+
+	// Optional extensions
+	if ( vk::hasExtension( VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME, foundExtensions ) ) {
+		extensions.push_back( VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME ); // No participation in VkDeviceCreateInfo::pNext chain
+	}
 }
 
 #define CHECK_VK_FEATURE( FOUND, FEATURE )                      \
@@ -253,8 +270,9 @@ Device::Device( VkPhysicalDevice gpuHandle, const Options &options )
 		createInfo.pQueuePriorities		   = &queuePriority;
 		queueCreateInfos.push_back( createInfo );
 	}
-	// Compute
-	if ( options.getEnableComputeQueue() ) {
+	// Compute, devices without a compute only family (lavapipe for one) fall back to the graphics queue
+	const bool computeQueue = options.getEnableComputeQueue() && ( mQueueFamilyIndices.compute != VK_QUEUE_FAMILY_IGNORED );
+	if ( computeQueue ) {
 		VkDeviceQueueCreateInfo createInfo = { VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO };
 		createInfo.pNext				   = nullptr;
 		createInfo.flags				   = 0;
@@ -280,6 +298,11 @@ Device::Device( VkPhysicalDevice gpuHandle, const Options &options )
 #endif
 	configureExtensions( Environment::get()->getApiVersion(), mGpuHandle, options, extensions );
 
+	mDrawIndirectCountSupported = std::any_of(
+		extensions.begin(),
+		extensions.end(),
+		[]( const char *name ) -> bool { return strcmp( name, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME ) == 0; } );
+
 	// Minimum feature requirements
 	mDeviceFeatures							  = {};
 	mDeviceFeatures.fullDrawIndexUint32		  = CHECK_VK_FEATURE( foundFeatures, fullDrawIndexUint32 );
@@ -324,7 +347,7 @@ Device::Device( VkPhysicalDevice gpuHandle, const Options &options )
 	CI_VK_DEVICE_FN( GetDeviceQueue( mDeviceHandle, mQueueFamilyIndices.graphics, 0, &mGraphicsQueueHandle ) );
 	mComputeQueueHandle	 = mGraphicsQueueHandle;
 	mTransferQueueHandle = mGraphicsQueueHandle;
-	if ( options.getEnableComputeQueue() ) {
+	if ( computeQueue ) {
 		CI_VK_DEVICE_FN( GetDeviceQueue( mDeviceHandle, mQueueFamilyIndices.compute, 0, &mComputeQueueHandle ) );
 	}
 	if ( options.getEnableTransferQueue() ) {
@@ -376,6 +399,16 @@ Device::Device( VkPhysicalDevice gpuHandle, const Options &options )
 		if ( vkres != VK_SUCCESS ) {
 			throw grfx::GraphicsApiExc( "vmaCreateAllocator faield" );
 		}
+
+		// Tile based GPUs can back transient attachments with memory that's only committed if needed
+		const VkPhysicalDeviceMemoryProperties *pMemoryProperties = nullptr;
+		vmaGetMemoryProperties( mVmaAllocatorHandle, &pMemoryProperties );
+		for ( uint32_t i = 0; i < pMemoryProperties->memoryTypeCount; ++i ) {
+			if ( pMemoryProperties->memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT ) {
+				mLazilyAllocatedMemorySupported = true;
+				break;
+			}
+		}
 	}
 
 	// Create a command pool and command buffer for transient operations
@@ -407,6 +440,33 @@ Device::Device( VkPhysicalDevice gpuHandle, const Options &options )
 		mCopyCommandBuffer		= commandBuffers[1];
 	}
 
+	// Create a command pool and timeline semaphore for async copies
+	{
+		VkCommandPoolCreateInfo poolCreateInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+		poolCreateInfo.pNext				   = nullptr;
+		poolCreateInfo.flags				   = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolCreateInfo.queueFamilyIndex		   = mQueueFamilyIndices.graphics;
+
+		vkres = CI_VK_DEVICE_FN( CreateCommandPool( mDeviceHandle, &poolCreateInfo, nullptr, &mAsyncCopyCommandPool ) );
+		if ( vkres != VK_SUCCESS ) {
+			throw VulkanFnFailedExc( "vkCreateCommandPool", vkres );
+		}
+
+		VkSemaphoreTypeCreateInfo typeCreateInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO };
+		typeCreateInfo.pNext					 = nullptr;
+		typeCreateInfo.semaphoreType			 = VK_SEMAPHORE_TYPE_TIMELINE;
+		typeCreateInfo.initialValue				 = 0;
+
+		VkSemaphoreCreateInfo semaphoreCreateInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+		semaphoreCreateInfo.pNext				  = &typeCreateInfo;
+		semaphoreCreateInfo.flags				  = 0;
+
+		vkres = createSemaphore( &semaphoreCreateInfo, &mAsyncCopySemaphore );
+		if ( vkres != VK_SUCCESS ) {
+			throw VulkanFnFailedExc( "vkCreateSemaphore", vkres );
+		}
+	}
+
 	// Sampler cache
 	mSamplerCache = std::make_unique<SamplerCache>( this );
 	if ( !mSamplerCache ) {
@@ -451,6 +511,13 @@ Device::~Device()
 		mTransientCommandPool = VK_NULL_HANDLE;
 	}
 
+	// Device is idle so all pending async copies have completed
+	mPendingAsyncCopies.clear();
+	if ( mAsyncCopyCommandPool != VK_NULL_HANDLE ) {
+		CI_VK_DEVICE_FN( DestroyCommandPool( mDeviceHandle, mAsyncCopyCommandPool, nullptr ) );
+		mAsyncCopyCommandPool = VK_NULL_HANDLE;
+	}
+
 	destroyAllHandles( mDeviceHandle, mFenceHandles, mVkFn.DestroyFence );
 	destroyAllHandles( mDeviceHandle, mSemaphoreHandles, mVkFn.DestroySemaphore );
 
@@ -520,6 +587,11 @@ VkQueue Device::getComputeQueueHandle() const
 	return mComputeQueueHandle;
 }
 
+uint32_t Device::getComputeQueueFamilyIndex() const
+{
+	return isAsyncComputeSupported() ? mQueueFamilyIndices.compute : mQueueFamilyIndices.graphics;
+}
+
 VkQueue Device::getTransferQueueHandle() const
 {
 	return mTransferQueueHandle;
@@ -613,6 +685,25 @@ VkSampleCountFlagBits Device::getMaxOutputSampleCount() const
 	return std::min( rt, std::min( dt, st ) );
 }
 
+VkFormatFeatureFlags Device::getFormatFeatures( VkFormat format, VkImageTiling tiling ) const
+{
+	VkFormatProperties properties = {};
+	CI_VK_INSTANCE_FN( GetPhysicalDeviceFormatProperties( mGpuHandle, format, &properties ) );
+
+	VkFormatFeatureFlags features = ( tiling == VK_IMAGE_TILING_LINEAR ) ? properties.linearTilingFeatures : properties.optimalTilingFeatures;
+	return features;
+}
+
+bool Device::isFormatSupported( VkFormat format, VkFormatFeatureFlags requiredFeatures ) const
+{
+	if ( format == VK_FORMAT_UNDEFINED ) {
+		return false;
+	}
+
+	VkFormatFeatureFlags features = getFormatFeatures( format, VK_IMAGE_TILING_OPTIMAL );
+	return ( ( features & requiredFeatures ) == requiredFeatures );
+}
+
 VkResult Device::submitGraphics( const VkSubmitInfo *pSubmitInfo, VkFence fence, bool waitForIdle )
 {
 	std::lock_guard<std::mutex> lock( mGraphicsQueueMutex );
@@ -634,25 +725,38 @@ VkResult Device::submitGraphics( const VkSubmitInfo *pSubmitInfo, VkFence fence,
 
 VkResult Device::submitGraphics( const vk::SubmitInfo &submitInfo, VkFence fence, bool waitForIdle )
 {
-	VkTimelineSemaphoreSubmitInfo vktssi = { VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
-	vktssi.pNext						 = nullptr;
-	vktssi.waitSemaphoreValueCount		 = countU32( submitInfo.mWaitValues );
-	vktssi.pWaitSemaphoreValues			 = dataPtr( submitInfo.mWaitValues );
-	vktssi.signalSemaphoreValueCount	 = countU32( submitInfo.mSignalValues );
-	vktssi.pSignalSemaphoreValues		 = dataPtr( submitInfo.mSignalValues );
-
-	VkSubmitInfo vksi		  = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
-	vksi.pNext				  = &vktssi;
-	vksi.waitSemaphoreCount	  = countU32( submitInfo.mWaitSemaphores );
-	vksi.pWaitSemaphores	  = dataPtr( submitInfo.mWaitSemaphores );
-	vksi.pWaitDstStageMask	  = dataPtr( submitInfo.mWaitDstStageMasks );
-	vksi.commandBufferCount	  = countU32( submitInfo.mCommandBuffers );
-	vksi.pCommandBuffers	  = dataPtr( submitInfo.mCommandBuffers );
-	vksi.signalSemaphoreCount = countU32( submitInfo.mSignalSemaphores );
-	vksi.pSignalSemaphores	  = dataPtr( submitInfo.mSignalSemaphores );
-
-	VkResult vkres = this->submitGraphics( &vksi, fence, waitForIdle );
-	return vkres;
+	VkSubmitInfo2KHR vksi		  = { VK_STRUCTURE_TYPE_SUBMIT_INFO_2_KHR };
+	vksi.pNext					  = nullptr;
+	vksi.flags					  = 0;
+	vksi.waitSemaphoreInfoCount	  = countU32( submitInfo.mWaits );
+	vksi.pWaitSemaphoreInfos	  = dataPtr( submitInfo.mWaits );
+	vksi.commandBufferInfoCount	  = countU32( submitInfo.mCommandBuffers );
+	vksi.pCommandBufferInfos	  = dataPtr( submitInfo.mCommandBuffers );
+	vksi.signalSemaphoreInfoCount = countU32( submitInfo.mSignals );
+	vksi.pSignalSemaphoreInfos	  = dataPtr( submitInfo.mSignals );
+
+	std::lock_guard<std::mutex> lock( mGraphicsQueueMutex );
+
+	VkResult vkres = CI_VK_DEVICE_FN( QueueSubmit2KHR( mGraphicsQueueHandle, 1, &vksi, fence ) );
+	if ( vkres != VK_SUCCESS ) {
+		return vkres;
+	}
+
+	if ( waitForIdle ) {
+		vkres = CI_VK_DEVICE_FN( QueueWaitIdle( mGraphicsQueueHandle ) );
+		if ( vkres != VK_SUCCESS ) {
+			return vkres;
+		}
+	}
+
+	return VK_SUCCESS;
+}
+
+VkResult Device::presentGraphics( const VkPresentInfoKHR *pPresentInfo )
+{
+	std::lock_guard<std::mutex> lock( mGraphicsQueueMutex );
+
+	return CI_VK_DEVICE_FN( QueuePresentKHR( mGraphicsQueueHandle, pPresentInfo ) );
 }
 
 VkResult Device::submitCompute( const VkSubmitInfo *pSubmitInfo, VkFence fence, bool waitForIdle )
@@ -678,6 +782,39 @@ VkResult Device::submitCompute( const VkSubmitInfo *pSubmitInfo, VkFence fence,
 	return VK_SUCCESS;
 }
 
+VkResult Device::submitCompute( const vk::SubmitInfo &submitInfo, VkFence fence, bool waitForIdle )
+{
+	if ( mComputeQueueHandle == mGraphicsQueueHandle ) {
+		return submitGraphics( submitInfo, fence, waitForIdle );
+	}
+
+	VkSubmitInfo2KHR vksi		  = { VK_STRUCTURE_TYPE_SUBMIT_INFO_2_KHR };
+	vksi.pNext					  = nullptr;
+	vksi.flags					  = 0;
+	vksi.waitSemaphoreInfoCount	  = countU32( submitInfo.mWaits );
+	vksi.pWaitSemaphoreInfos	  = dataPtr( submitInfo.mWaits );
+	vksi.commandBufferInfoCount	  = countU32( submitInfo.mCommandBuffers );
+	vksi.pCommandBufferInfos	  = dataPtr( submitInfo.mCommandBuffers );
+	vksi.signalSemaphoreInfoCount = countU32( submitInfo.mSignals );
+	vksi.pSignalSemaphoreInfos	  = dataPtr( submitInfo.mSignals );
+
+	std::lock_guard<std::mutex> lock( mComputeQueueMutex );
+
+	VkResult vkres = CI_VK_DEVICE_FN( QueueSubmit2KHR( mComputeQueueHandle, 1, &vksi, fence ) );
+	if ( vkres != VK_SUCCESS ) {
+		return vkres;
+	}
+
+	if ( waitForIdle ) {
+		vkres = CI_VK_DEVICE_FN( QueueWaitIdle( mComputeQueueHandle ) );
+		if ( vkres != VK_SUCCESS ) {
+			return vkres;
+		}
+	}
+
+	return VK_SUCCESS;
+}
+
 VkResult Device::submitTransfer( const VkSubmitInfo *pSubmitInfo, VkFence fence, bool waitForIdle )
 {
 	if ( mTransferQueueHandle == mGraphicsQueueHandle ) {
@@ -987,68 +1124,83 @@ void Device::internalCopyToImage(
 	uint32_t	dstArrayLayer,
 	vk::Image  *pDstImage )
 {
-	VkImageAspectFlags aspectMask = pDstImage->getAspectMask();
-
-	// Begin command buffer
-	VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
-	beginInfo.flags					   = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-	beginInfo.pInheritanceInfo		   = nullptr;
-
-	VkResult vkres = CI_VK_DEVICE_FN( BeginCommandBuffer( mCopyCommandBuffer, &beginInfo ) );
-	if ( vkres != VK_SUCCESS ) {
-		throw VulkanFnFailedExc( "vkBeginCommandBuffer", vkres );
-	}
-
-	const uint32_t dstNumMipLevels	 = pDstImage->getMipLevels();
-	const uint32_t dstNumArrayLayers = pDstImage->getArrayLayers();
-
-	// Transition image layout to VK_IMAGE_LAYOUT_TRANSFER_DST
-	vk::cmdTransitionImageLayout(
-		vkfn()->CmdPipelineBarrier,
-		mCopyCommandBuffer,
-		pDstImage->getImageHandle(),
-		aspectMask,
-		0,
-		dstNumMipLevels,
-		0,
-		dstNumArrayLayers,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		VK_PIPELINE_STAGE_TRANSFER_BIT );
-
-	// Copy command
 	VkBufferImageCopy region			   = {};
 	region.bufferOffset					   = 0;
 	region.bufferRowLength				   = srcWidth;
 	region.bufferImageHeight			   = srcHeight;
-	region.imageSubresource.aspectMask	   = aspectMask;
+	region.imageSubresource.aspectMask	   = pDstImage->getAspectMask();
 	region.imageSubresource.mipLevel	   = dstMipLevel;
 	region.imageSubresource.baseArrayLayer = dstArrayLayer;
 	region.imageSubresource.layerCount	   = 1;
 	region.imageOffset					   = { 0, 0, 0 };
 	region.imageExtent					   = { srcWidth, srcHeight, 1 };
 
+	internalCopyToImage( pSrcBuffer, { region }, pDstImage );
+}
+
+void Device::recordCopyToImage(
+	VkCommandBuffer						  commandBuffer,
+	vk::Buffer							 *pSrcBuffer,
+	const std::vector<VkBufferImageCopy> &regions,
+	vk::Image							 *pDstImage )
+{
+	// Only the subresources that are written to are transitioned so
+	// that previously uploaded mip levels and array layers are not
+	// discarded by the transition from UNDEFINED. Earlier submissions
+	// may still be sampling them.
+	vk::CommandBuffer::BarrierBatch barriers;
+	for ( const auto &region : regions ) {
+		const VkImageSubresourceLayers &subres = region.imageSubresource;
+		barriers.setImageState( pDstImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR, 0, subres.mipLevel, 1, subres.baseArrayLayer, subres.layerCount );
+	}
+
+	// Transition image layout to VK_IMAGE_LAYOUT_TRANSFER_DST
+	for ( const auto &region : regions ) {
+		const VkImageSubresourceLayers &subres = region.imageSubresource;
+		barriers.imageBarrier( pDstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR, VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR, subres.mipLevel, 1, subres.baseArrayLayer, subres.layerCount );
+	}
+	barriers.flush( this, commandBuffer );
+
+	// Copy command
 	vkfn()->CmdCopyBufferToImage(
-		mCopyCommandBuffer,
+		commandBuffer,
 		pSrcBuffer->getBufferHandle(),
 		pDstImage->getImageHandle(),
 		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		1,
-		&region );
+		countU32( regions ),
+		dataPtr( regions ) );
 
 	// Transition image layout to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-	vk::cmdTransitionImageLayout(
-		vkfn()->CmdPipelineBarrier,
-		mCopyCommandBuffer,
-		pDstImage->getImageHandle(),
-		aspectMask,
-		0,
-		dstNumMipLevels,
-		0,
-		dstNumArrayLayers,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_PIPELINE_STAGE_VERTEX_SHADER_BIT );
+	const VkPipelineStageFlags2KHR shaderStages = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT_KHR |
+												  VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR |
+												  VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR;
+	for ( const auto &region : regions ) {
+		const VkImageSubresourceLayers &subres = region.imageSubresource;
+		barriers.imageBarrier( pDstImage, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, shaderStages, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR, subres.mipLevel, 1, subres.baseArrayLayer, subres.layerCount );
+	}
+	barriers.flush( this, commandBuffer );
+}
+
+void Device::internalCopyToImage(
+	vk::Buffer							 *pSrcBuffer,
+	const std::vector<VkBufferImageCopy> &regions,
+	vk::Image							 *pDstImage )
+{
+	if ( regions.empty() ) {
+		return;
+	}
+
+	// Begin command buffer
+	VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	beginInfo.flags					   = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo		   = nullptr;
+
+	VkResult vkres = CI_VK_DEVICE_FN( BeginCommandBuffer( mCopyCommandBuffer, &beginInfo ) );
+	if ( vkres != VK_SUCCESS ) {
+		throw VulkanFnFailedExc( "vkBeginCommandBuffer", vkres );
+	}
+
+	recordCopyToImage( mCopyCommandBuffer, pSrcBuffer, regions, pDstImage );
 
 	// End command buffer
 	vkres = CI_VK_DEVICE_FN( EndCommandBuffer( mCopyCommandBuffer ) );
@@ -1135,6 +1287,207 @@ void Device::copyToImage(
 	stagingBuffer->unmap();
 }
 
+void Device::copyToImage(
+	uint64_t							  srcDataSize,
+	const void							 *pSrcData,
+	const std::vector<VkBufferImageCopy> &regions,
+	vk::Image							 *pDstImage )
+{
+	if ( ( srcDataSize == 0 ) || ( pSrcData == nullptr ) || regions.empty() || ( pDstImage == nullptr ) ) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock( mCopyMutex );
+	initializeStagingBuffer();
+
+	// Make sure none of the regions read past the end of the source data
+	for ( const auto &region : regions ) {
+		if ( region.bufferOffset >= srcDataSize ) {
+			throw VulkanExc( "copy region buffer offset exceeds source data size" );
+		}
+	}
+
+	// Figure out which staging buffer to use
+	vk::BufferRef stagingBuffer = mStagingBuffer;
+	if ( srcDataSize > mStagingBufferSize ) {
+		stagingBuffer = vk::Buffer::create(
+			srcDataSize,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			MemoryUsage::CPU_TO_GPU,
+			vk::Buffer::Options(),
+			shared_from_this() );
+	}
+
+	// Map staging buffer
+	void *pMappedAddress = nullptr;
+	stagingBuffer->map( &pMappedAddress );
+
+	// Copy source data to staging buffer
+	memcpy( pMappedAddress, pSrcData, static_cast<size_t>( srcDataSize ) );
+
+	// Do the copy
+	internalCopyToImage( stagingBuffer.get(), regions, pDstImage );
+
+	// Unmap staging buffer
+	stagingBuffer->unmap();
+}
+
+uint64_t Device::copyToImageAsync(
+	uint64_t							  srcDataSize,
+	const void							 *pSrcData,
+	const std::vector<VkBufferImageCopy> &regions,
+	vk::Image							 *pDstImage )
+{
+	if ( ( srcDataSize == 0 ) || ( pSrcData == nullptr ) || regions.empty() || ( pDstImage == nullptr ) ) {
+		return 0;
+	}
+
+	// Make sure none of the regions read past the end of the source data
+	for ( const auto &region : regions ) {
+		if ( region.bufferOffset >= srcDataSize ) {
+			throw VulkanExc( "copy region buffer offset exceeds source data size" );
+		}
+	}
+
+	// Each async copy gets its own staging buffer so the shared one
+	// is never held while the copy is in flight. Filling it does not
+	// need the lock.
+	AsyncCopy copy	   = {};
+	copy.stagingBuffer = vk::Buffer::create(
+		srcDataSize,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		MemoryUsage::CPU_TO_GPU,
+		vk::Buffer::Options(),
+		shared_from_this() );
+
+	void *pMappedAddress = nullptr;
+	copy.stagingBuffer->map( &pMappedAddress );
+	memcpy( pMappedAddress, pSrcData, static_cast<size_t>( srcDataSize ) );
+	copy.stagingBuffer->unmap();
+
+	std::lock_guard<std::mutex> lock( mAsyncCopyMutex );
+
+	// Free resources of copies that have finished
+	retireAsyncCopies();
+
+	VkCommandBufferAllocateInfo vkai = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+	vkai.pNext						 = nullptr;
+	vkai.commandPool				 = mAsyncCopyCommandPool;
+	vkai.level						 = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	vkai.commandBufferCount			 = 1;
+
+	VkResult vkres = CI_VK_DEVICE_FN( AllocateCommandBuffers( mDeviceHandle, &vkai, &copy.commandBuffer ) );
+	if ( vkres != VK_SUCCESS ) {
+		throw VulkanFnFailedExc( "vkAllocateCommandBuffers", vkres );
+	}
+
+	VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	beginInfo.flags					   = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo		   = nullptr;
+
+	vkres = CI_VK_DEVICE_FN( BeginCommandBuffer( copy.commandBuffer, &beginInfo ) );
+	if ( vkres != VK_SUCCESS ) {
+		CI_VK_DEVICE_FN( FreeCommandBuffers( mDeviceHandle, mAsyncCopyCommandPool, 1, &copy.commandBuffer ) );
+		throw VulkanFnFailedExc( "vkBeginCommandBuffer", vkres );
+	}
+
+	recordCopyToImage( copy.commandBuffer, copy.stagingBuffer.get(), regions, pDstImage );
+
+	vkres = CI_VK_DEVICE_FN( EndCommandBuffer( copy.commandBuffer ) );
+	if ( vkres != VK_SUCCESS ) {
+		CI_VK_DEVICE_FN( FreeCommandBuffers( mDeviceHandle, mAsyncCopyCommandPool, 1, &copy.commandBuffer ) );
+		throw VulkanFnFailedExc( "vkEndCommandBuffer", vkres );
+	}
+
+	// Values must be submitted in increasing order, which is
+	// guaranteed since the lock is held until after submission.
+	copy.value = mAsyncCopyValue + 1;
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo = { VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
+	timelineInfo.pNext						   = nullptr;
+	timelineInfo.waitSemaphoreValueCount	   = 0;
+	timelineInfo.pWaitSemaphoreValues		   = nullptr;
+	timelineInfo.signalSemaphoreValueCount	   = 1;
+	timelineInfo.pSignalSemaphoreValues		   = &copy.value;
+
+	VkSubmitInfo submitInfo			= { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+	submitInfo.pNext				= &timelineInfo;
+	submitInfo.waitSemaphoreCount	= 0;
+	submitInfo.pWaitSemaphores		= nullptr;
+	submitInfo.pWaitDstStageMask	= nullptr;
+	submitInfo.commandBufferCount	= 1;
+	submitInfo.pCommandBuffers		= &copy.commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores	= &mAsyncCopySemaphore;
+
+	vkres = submitGraphics( &submitInfo, VK_NULL_HANDLE, false );
+	if ( vkres != VK_SUCCESS ) {
+		CI_VK_DEVICE_FN( FreeCommandBuffers( mDeviceHandle, mAsyncCopyCommandPool, 1, &copy.commandBuffer ) );
+		throw VulkanFnFailedExc( "vkQueueSubmit", vkres );
+	}
+
+	mAsyncCopyValue = copy.value;
+	mPendingAsyncCopies.push_back( copy );
+
+	return copy.value;
+}
+
+bool Device::isAsyncCopyComplete( uint64_t value ) const
+{
+	if ( value == 0 ) {
+		return true;
+	}
+
+	uint64_t counterValue = 0;
+	VkResult vkres		  = CI_VK_DEVICE_FN( GetSemaphoreCounterValue( mDeviceHandle, mAsyncCopySemaphore, &counterValue ) );
+	if ( vkres != VK_SUCCESS ) {
+		throw VulkanFnFailedExc( "vkGetSemaphoreCounterValue", vkres );
+	}
+	return ( counterValue >= value );
+}
+
+void Device::waitAsyncCopy( uint64_t value, uint64_t timeout )
+{
+	if ( value == 0 ) {
+		return;
+	}
+
+	VkSemaphoreWaitInfo info = { VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
+	info.pNext				 = nullptr;
+	info.flags				 = 0;
+	info.semaphoreCount		 = 1;
+	info.pSemaphores		 = &mAsyncCopySemaphore;
+	info.pValues			 = &value;
+
+	VkResult vkres = CI_VK_DEVICE_FN( WaitSemaphores( mDeviceHandle, &info, timeout ) );
+	if ( ( vkres != VK_SUCCESS ) && ( vkres != VK_TIMEOUT ) ) {
+		throw VulkanFnFailedExc( "vkWaitSemaphores", vkres );
+	}
+}
+
+void Device::retireAsyncCopies()
+{
+	if ( mPendingAsyncCopies.empty() ) {
+		return;
+	}
+
+	uint64_t counterValue = 0;
+	VkResult vkres		  = CI_VK_DEVICE_FN( GetSemaphoreCounterValue( mDeviceHandle, mAsyncCopySemaphore, &counterValue ) );
+	if ( vkres != VK_SUCCESS ) {
+		throw VulkanFnFailedExc( "vkGetSemaphoreCounterValue", vkres );
+	}
+
+	auto itRetired = std::partition(
+		mPendingAsyncCopies.begin(),
+		mPendingAsyncCopies.end(),
+		[counterValue]( const AsyncCopy &copy ) -> bool { return copy.value > counterValue; } );
+
+	for ( auto it = itRetired; it != mPendingAsyncCopies.end(); ++it ) {
+		CI_VK_DEVICE_FN( FreeCommandBuffers( mDeviceHandle, mAsyncCopyCommandPool, 1, &it->commandBuffer ) );
+	}
+	mPendingAsyncCopies.erase( itRetired, mPendingAsyncCopies.end() );
+}
+
 void *Device::beginCopyToImage(
 	uint32_t   srcWidth,
 	uint32_t   srcHeight,
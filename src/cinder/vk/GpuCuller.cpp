@@ -0,0 +1,695 @@
+#include "cinder/vk/GpuCuller.h"
+#include "cinder/vk/Buffer.h"
+#include "cinder/vk/Command.h"
+#include "cinder/vk/Context.h"
+#include "cinder/vk/Descriptor.h"
+#include "cinder/vk/Device.h"
+#include "cinder/vk/Image.h"
+#include "cinder/vk/Pipeline.h"
+#include "cinder/vk/Sampler.h"
+#include "cinder/vk/ShaderProg.h"
+#include "cinder/app/RendererVk.h"
+#include "cinder/Log.h"
+
+#include <cmath>
+
+namespace cinder::vk {
+
+static_assert( sizeof( GpuCuller::Object ) == 48, "GpuCuller::Object must match the std430 layout of CullObject" );
+
+static const uint32_t CULL_GROUP_SIZE	= 64;
+static const uint32_t REDUCE_GROUP_SIZE = 8;
+
+static const uint32_t CULL_FLAG_OCCLUSION = 0x1;
+static const uint32_t CULL_FLAG_COMPACT	  = 0x2;
+
+// Compute shaders are compiled with the CS binding shifts, see Constants.h
+static const uint32_t REDUCE_SRC_BINDING	  = CINDER_CONTEXT_CS_BINDING_SHIFT_TEXTURE + 0;
+static const uint32_t REDUCE_DST_BINDING	  = CINDER_CONTEXT_CS_BINDING_SHIFT_IMAGE + 1;
+static const uint32_t CULL_PARAMS_BINDING	  = CINDER_CONTEXT_CS_BINDING_SHIFT_UBO + 0;
+static const uint32_t CULL_OBJECTS_BINDING	  = CINDER_CONTEXT_CS_BINDING_SHIFT_SSBO + 1;
+static const uint32_t CULL_TRANSFORMS_BINDING = CINDER_CONTEXT_CS_BINDING_SHIFT_SSBO + 2;
+static const uint32_t CULL_DRAWS_BINDING	  = CINDER_CONTEXT_CS_BINDING_SHIFT_SSBO + 3;
+static const uint32_t CULL_COUNT_BINDING	  = CINDER_CONTEXT_CS_BINDING_SHIFT_SSBO + 4;
+static const uint32_t CULL_HIZ_BINDING		  = CINDER_CONTEXT_CS_BINDING_SHIFT_TEXTURE + 5;
+
+// Matches CullParams in sCullComp (std140)
+struct CullParams
+{
+	mat4	 prevViewProjection;
+	vec4	 frustumPlanes[6];
+	ivec2	 depthSize;
+	uint32_t objectCount;
+	uint32_t flags;
+};
+
+// Matches ReduceParams in sReduceComp
+struct ReduceParams
+{
+	ivec2 srcSize;
+	ivec2 dstSize;
+};
+
+// Writes the max depth of each 2x2 footprint of the source level into
+// the destination level. Level sizes are rounded down, so the last row
+// and column also fold in the leftover texels of odd sized sources.
+static const char *sReduceComp = R"comp(
+#version 460
+
+layout( local_size_x = 8, local_size_y = 8 ) in;
+
+layout( binding = 0 ) uniform sampler2D uSrc;
+layout( binding = 1, r32f ) uniform writeonly image2D uDst;
+
+layout( push_constant ) uniform ReduceParams {
+	ivec2 uSrcSize;
+	ivec2 uDstSize;
+};
+
+void main()
+{
+	ivec2 dst = ivec2( gl_GlobalInvocationID.xy );
+	if ( any( greaterThanEqual( dst, uDstSize ) ) ) {
+		return;
+	}
+
+	ivec2 srcMin = dst * 2;
+	ivec2 srcMax = min( srcMin + 1, uSrcSize - 1 );
+	if ( dst.x == ( uDstSize.x - 1 ) ) {
+		srcMax.x = uSrcSize.x - 1;
+	}
+	if ( dst.y == ( uDstSize.y - 1 ) ) {
+		srcMax.y = uSrcSize.y - 1;
+	}
+
+	float depth = 0.0;
+	for ( int y = srcMin.y; y <= srcMax.y; ++y ) {
+		for ( int x = srcMin.x; x <= srcMax.x; ++x ) {
+			depth = max( depth, texelFetch( uSrc, ivec2( x, y ), 0 ).r );
+		}
+	}
+
+	imageStore( uDst, dst, vec4( depth ) );
+}
+)comp";
+
+static const char *sCullComp = R"comp(
+#version 460
+
+#define CULL_FLAG_OCCLUSION 0x1
+#define CULL_FLAG_COMPACT   0x2
+
+layout( local_size_x = 64 ) in;
+
+struct DrawCommand {
+	uint indexCount;
+	uint instanceCount;
+	uint firstIndex;
+	int  vertexOffset;
+	uint firstInstance;
+};
+
+struct CullObject {
+	vec4        boundingSphere;
+	DrawCommand command;
+};
+
+layout( std140, binding = 0 ) uniform CullParams {
+	mat4  uPrevViewProjection;
+	vec4  uFrustumPlanes[6];
+	ivec2 uDepthSize;
+	uint  uObjectCount;
+	uint  uFlags;
+};
+
+layout( std430, binding = 1 ) readonly buffer CullObjects { CullObject objects[]; };
+layout( std430, binding = 2 ) readonly buffer CullTransforms { mat4 transforms[]; };
+layout( std430, binding = 3 ) writeonly buffer CullDraws { DrawCommand draws[]; };
+layout( std430, binding = 4 ) buffer CullCount { uint drawCount; };
+
+layout( binding = 5 ) uniform sampler2D uHiZ;
+
+bool isInsideFrustum( vec3 center, float radius )
+{
+	for ( int i = 0; i < 6; ++i ) {
+		if ( ( dot( uFrustumPlanes[i].xyz, center ) + uFrustumPlanes[i].w ) < -radius ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool isOccluded( vec3 center, float radius )
+{
+	// The pyramid holds last frame's depth so the bounds are
+	// projected with last frame's matrix.
+	vec3 ndcMin = vec3( 1.0e30 );
+	vec3 ndcMax = vec3( -1.0e30 );
+	for ( int i = 0; i < 8; ++i ) {
+		vec3 corner = center + radius * vec3( ( ( i & 1 ) != 0 ) ? 1.0 : -1.0, ( ( i & 2 ) != 0 ) ? 1.0 : -1.0, ( ( i & 4 ) != 0 ) ? 1.0 : -1.0 );
+		vec4 clip	= uPrevViewProjection * vec4( corner, 1.0 );
+		// Bounds crossing the near plane can't be tested
+		if ( clip.w <= 1.0e-5 ) {
+			return false;
+		}
+		vec3 ndc = clip.xyz / clip.w;
+		ndcMin	 = min( ndcMin, ndc );
+		ndcMax	 = max( ndcMax, ndc );
+	}
+
+	// Bounds that were partially off screen have no depth to test against
+	if ( any( lessThan( ndcMin.xy, vec2( -1.0 ) ) ) || any( greaterThan( ndcMax.xy, vec2( 1.0 ) ) ) ) {
+		return false;
+	}
+
+	// The viewport is flipped, NDC y = +1 is the top row of the depth buffer
+	vec2 pixelMin = vec2( 0.5 + 0.5 * ndcMin.x, 0.5 - 0.5 * ndcMax.y ) * vec2( uDepthSize );
+	vec2 pixelMax = vec2( 0.5 + 0.5 * ndcMax.x, 0.5 - 0.5 * ndcMin.y ) * vec2( uDepthSize );
+	float extent  = max( pixelMax.x - pixelMin.x, pixelMax.y - pixelMin.y );
+
+	// Pyramid level 0 is half the depth resolution. Pick the level where
+	// the bounds cover at most 2x2 texels.
+	int   levelCount = textureQueryLevels( uHiZ );
+	int   level		 = clamp( int( ceil( log2( max( extent, 1.0 ) ) ) ) - 1, 0, levelCount - 1 );
+	ivec2 size		 = textureSize( uHiZ, level );
+	int   shift		 = level + 1;
+	ivec2 t0		 = min( ivec2( pixelMin ) >> shift, size - 1 );
+	ivec2 t1		 = min( ivec2( pixelMax ) >> shift, size - 1 );
+
+	float maxDepth = max(
+		max( texelFetch( uHiZ, t0, level ).r, texelFetch( uHiZ, ivec2( t1.x, t0.y ), level ).r ),
+		max( texelFetch( uHiZ, ivec2( t0.x, t1.y ), level ).r, texelFetch( uHiZ, t1, level ).r ) );
+
+	return ndcMin.z > maxDepth;
+}
+
+void main()
+{
+	uint index = gl_GlobalInvocationID.x;
+	if ( index >= uObjectCount ) {
+		return;
+	}
+
+	CullObject object	 = objects[index];
+	mat4	   transform = transforms[index];
+
+	vec3  center = ( transform * vec4( object.boundingSphere.xyz, 1.0 ) ).xyz;
+	float scale	 = max( max( length( transform[0].xyz ), length( transform[1].xyz ) ), length( transform[2].xyz ) );
+	float radius = object.boundingSphere.w * scale;
+
+	bool visible = isInsideFrustum( center, radius );
+	if ( visible && ( ( uFlags & CULL_FLAG_OCCLUSION ) != 0 ) ) {
+		visible = !isOccluded( center, radius );
+	}
+
+	if ( ( uFlags & CULL_FLAG_COMPACT ) != 0 ) {
+		if ( visible ) {
+			uint slot	= atomicAdd( drawCount, 1 );
+			draws[slot] = object.command;
+		}
+	}
+	else {
+		DrawCommand command	  = object.command;
+		command.instanceCount = visible ? command.instanceCount : 0;
+		draws[index]		  = command;
+	}
+}
+)comp";
+
+static VkMemoryBarrier2KHR memoryBarrier(
+	VkPipelineStageFlags2KHR srcStageMask,
+	VkAccessFlags2KHR		 srcAccessMask,
+	VkPipelineStageFlags2KHR dstStageMask,
+	VkAccessFlags2KHR		 dstAccessMask )
+{
+	VkMemoryBarrier2KHR barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER_2_KHR };
+	barrier.pNext				= nullptr;
+	barrier.srcStageMask		= srcStageMask;
+	barrier.srcAccessMask		= srcAccessMask;
+	barrier.dstStageMask		= dstStageMask;
+	barrier.dstAccessMask		= dstAccessMask;
+	return barrier;
+}
+
+static VkImageMemoryBarrier2KHR depthLayoutBarrier(
+	const vk::Image			*pImage,
+	VkImageLayout			 oldLayout,
+	VkImageLayout			 newLayout,
+	VkPipelineStageFlags2KHR srcStageMask,
+	VkAccessFlags2KHR		 srcAccessMask,
+	VkPipelineStageFlags2KHR dstStageMask,
+	VkAccessFlags2KHR		 dstAccessMask )
+{
+	VkImageMemoryBarrier2KHR barrier		= { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR };
+	barrier.pNext							= nullptr;
+	barrier.srcStageMask					= srcStageMask;
+	barrier.srcAccessMask					= srcAccessMask;
+	barrier.dstStageMask					= dstStageMask;
+	barrier.dstAccessMask					= dstAccessMask;
+	barrier.oldLayout						= oldLayout;
+	barrier.newLayout						= newLayout;
+	barrier.srcQueueFamilyIndex				= VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex				= VK_QUEUE_FAMILY_IGNORED;
+	barrier.image							= pImage->getImageHandle();
+	barrier.subresourceRange.aspectMask		= pImage->getAspectMask();
+	barrier.subresourceRange.baseMipLevel	= 0;
+	barrier.subresourceRange.levelCount		= 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount		= 1;
+	return barrier;
+}
+
+static void pipelineBarrier(
+	vk::CommandBuffer							*pCommandBuffer,
+	const std::vector<VkMemoryBarrier2KHR>	    &memoryBarriers,
+	const std::vector<VkImageMemoryBarrier2KHR>	&imageBarriers = {} )
+{
+	VkDependencyInfoKHR dependencyInfo		= { VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR };
+	dependencyInfo.pNext					= nullptr;
+	dependencyInfo.dependencyFlags			= 0;
+	dependencyInfo.memoryBarrierCount		= countU32( memoryBarriers );
+	dependencyInfo.pMemoryBarriers			= dataPtr( memoryBarriers );
+	dependencyInfo.bufferMemoryBarrierCount = 0;
+	dependencyInfo.pBufferMemoryBarriers	= nullptr;
+	dependencyInfo.imageMemoryBarrierCount	= countU32( imageBarriers );
+	dependencyInfo.pImageMemoryBarriers		= dataPtr( imageBarriers );
+
+	pCommandBuffer->pipelineBarrier2( dependencyInfo );
+}
+
+static VkWriteDescriptorSet writeDescriptor( uint32_t binding, VkDescriptorType type, const VkDescriptorImageInfo *pImageInfo, const VkDescriptorBufferInfo *pBufferInfo )
+{
+	VkWriteDescriptorSet write = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+	write.pNext				   = nullptr;
+	write.dstSet			   = VK_NULL_HANDLE; // ignored
+	write.dstBinding		   = binding;
+	write.dstArrayElement	   = 0;
+	write.descriptorCount	   = 1;
+	write.descriptorType	   = type;
+	write.pImageInfo		   = pImageInfo;
+	write.pBufferInfo		   = pBufferInfo;
+	write.pTexelBufferView	   = nullptr;
+	return write;
+}
+
+static VkDescriptorBufferInfo bufferInfo( const vk::Buffer *pBuffer )
+{
+	return VkDescriptorBufferInfo{ pBuffer->getBufferHandle(), 0, VK_WHOLE_SIZE };
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// GpuCuller
+
+GpuCullerRef GpuCuller::create( const Options &options, vk::DeviceRef device )
+{
+	if ( !device ) {
+		device = app::RendererVk::getCurrentRenderer()->getDevice();
+	}
+
+	return GpuCullerRef( new GpuCuller( device, options ) );
+}
+
+GpuCuller::GpuCuller( vk::DeviceRef device, const Options &options )
+	: vk::DeviceChildObject( device ),
+	  mOcclusionCulling( options.mOcclusionCulling ),
+	  mCompacting( device->isDrawIndirectCountSupported() )
+{
+	vk::Sampler::Options samplerOptions = vk::Sampler::Options()
+											  .addressModeU( VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE )
+											  .addressModeV( VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE )
+											  .addressModeW( VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE );
+	mSampler = vk::Sampler::create( samplerOptions, device );
+
+	// Bound in place of the pyramid when occlusion culling is skipped
+	{
+		vk::Image::Usage usage = vk::Image::Usage().sampledImage();
+		mDummyHiZ			   = vk::Image::create( 1, 1, VK_FORMAT_R32_SFLOAT, usage, vk::MemoryUsage::GPU_ONLY, vk::Image::Options(), device );
+		mDummyHiZView		   = vk::ImageView::create( mDummyHiZ, device );
+
+		device->transitionImageLayout(
+			mDummyHiZ->getImageHandle(),
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			0,
+			1,
+			0,
+			1,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT );
+	}
+}
+
+GpuCuller::~GpuCuller()
+{
+}
+
+void GpuCuller::initPipelines( vk::Context *ctx )
+{
+	if ( mCullPipeline ) {
+		return;
+	}
+
+	vk::ContextRef context = ctx->shared_from_this();
+
+	// Hi-Z reduction
+	{
+		mReduceProg = vk::GlslProg::create( context, std::string( sReduceComp ), VK_SHADER_STAGE_COMPUTE_BIT );
+
+		vk::DescriptorSetLayout::Options setOptions = vk::DescriptorSetLayout::Options()
+														  .pushDescriptor()
+														  .addCombinedImageSampler( REDUCE_SRC_BINDING, 1, VK_SHADER_STAGE_COMPUTE_BIT )
+														  .addStorageImage( REDUCE_DST_BINDING, 1, VK_SHADER_STAGE_COMPUTE_BIT );
+		mReduceSetLayout = vk::DescriptorSetLayout::create( setOptions, getDevice() );
+
+		vk::PipelineLayout::Options layoutOptions = vk::PipelineLayout::Options()
+														.addSetLayout( mReduceSetLayout )
+														.addPushConstantRange( 0, sizeof( ReduceParams ), VK_SHADER_STAGE_COMPUTE_BIT );
+		mReducePipelineLayout = vk::PipelineLayout::create( layoutOptions, getDevice() );
+
+		vk::Pipeline::ComputePipelineCreateInfo createInfo = {};
+		createInfo.comp									   = mReduceProg->getComputeShader();
+		createInfo.pipelineLayout						   = mReducePipelineLayout.get();
+		mReducePipeline									   = vk::Pipeline::create( createInfo, getDevice() );
+	}
+
+	// Cull
+	{
+		mCullProg = vk::GlslProg::create( context, std::string( sCullComp ), VK_SHADER_STAGE_COMPUTE_BIT );
+
+		vk::DescriptorSetLayout::Options setOptions = vk::DescriptorSetLayout::Options()
+														  .pushDescriptor()
+														  .addUniformBuffer( CULL_PARAMS_BINDING, 1, VK_SHADER_STAGE_COMPUTE_BIT )
+														  .addStorageBuffer( CULL_OBJECTS_BINDING, 1, VK_SHADER_STAGE_COMPUTE_BIT )
+														  .addStorageBuffer( CULL_TRANSFORMS_BINDING, 1, VK_SHADER_STAGE_COMPUTE_BIT )
+														  .addStorageBuffer( CULL_DRAWS_BINDING, 1, VK_SHADER_STAGE_COMPUTE_BIT )
+														  .addStorageBuffer( CULL_COUNT_BINDING, 1, VK_SHADER_STAGE_COMPUTE_BIT )
+														  .addCombinedImageSampler( CULL_HIZ_BINDING, 1, VK_SHADER_STAGE_COMPUTE_BIT );
+		mCullSetLayout = vk::DescriptorSetLayout::create( setOptions, getDevice() );
+
+		vk::PipelineLayout::Options layoutOptions = vk::PipelineLayout::Options().addSetLayout( mCullSetLayout );
+		mCullPipelineLayout						  = vk::PipelineLayout::create( layoutOptions, getDevice() );
+
+		vk::Pipeline::ComputePipelineCreateInfo createInfo = {};
+		createInfo.comp									   = mCullProg->getComputeShader();
+		createInfo.pipelineLayout						   = mCullPipelineLayout.get();
+		mCullPipeline									   = vk::Pipeline::create( createInfo, getDevice() );
+	}
+}
+
+void GpuCuller::updateFrame( vk::Context *ctx, uint32_t objectCount )
+{
+	// Buffers are per frame in flight so a frame can cull while the
+	// previous one is still drawing from its results.
+	//
+	const uint32_t numFrames = ctx->getNumFramesInFlight();
+	if ( countU32( mFrames ) != numFrames ) {
+		mFrames.clear();
+		mFrames.resize( numFrames );
+	}
+
+	mFrameIndex	 = ctx->getFrameIndex();
+	Frame &frame = mFrames[mFrameIndex];
+
+	if ( !frame.params ) {
+		vk::Buffer::Usage	paramsUsage	  = vk::Buffer::Usage().uniformBuffer();
+		vk::Buffer::Options paramsOptions = vk::Buffer::Options().persisentMap();
+		frame.params					  = vk::Buffer::create( sizeof( CullParams ), paramsUsage, vk::MemoryUsage::CPU_TO_GPU, paramsOptions, getDevice() );
+
+		vk::Buffer::Usage countUsage = vk::Buffer::Usage().storageBuffer().indirectBuffer().transferDst();
+		frame.count					 = vk::Buffer::create( sizeof( uint32_t ), countUsage, vk::MemoryUsage::GPU_ONLY, vk::Buffer::Options(), getDevice() );
+	}
+
+	if ( frame.capacity < objectCount ) {
+		vk::Buffer::Usage drawsUsage = vk::Buffer::Usage().storageBuffer().indirectBuffer();
+		frame.draws					 = vk::Buffer::create( objectCount * sizeof( VkDrawIndexedIndirectCommand ), drawsUsage, vk::MemoryUsage::GPU_ONLY, vk::Buffer::Options(), getDevice() );
+		frame.capacity				 = objectCount;
+	}
+}
+
+bool GpuCuller::buildHiZ( vk::Context *ctx )
+{
+	// Multisampled depth can't be read with texelFetch on a sampler2D
+	if ( ctx->getSampleCount() != VK_SAMPLE_COUNT_1_BIT ) {
+		return false;
+	}
+
+	// With a single frame in flight the previous frame's depth image
+	// is the one being rendered to.
+	if ( ctx->getNumFramesInFlight() < 2 ) {
+		return false;
+	}
+
+	vk::ImageRef depth = ctx->getPreviousDepthStencil();
+	if ( !depth ) {
+		return false;
+	}
+
+	const VkExtent3D &depthExtent = depth->getExtent();
+
+	// (Re)create the pyramid if the depth size changed
+	if ( !mHiZ.image || ( mHiZ.depthExtent.width != depthExtent.width ) || ( mHiZ.depthExtent.height != depthExtent.height ) ) {
+		const uint32_t width	 = std::max<uint32_t>( 1, depthExtent.width / 2 );
+		const uint32_t height	 = std::max<uint32_t>( 1, depthExtent.height / 2 );
+		const uint32_t mipLevels = 1 + static_cast<uint32_t>( std::floor( std::log2( std::max( width, height ) ) ) );
+
+		vk::Image::Usage   usage   = vk::Image::Usage().sampledImage().storageImage();
+		vk::Image::Options options = vk::Image::Options().mipLevels( mipLevels );
+		mHiZ.image				   = vk::Image::create( width, height, VK_FORMAT_R32_SFLOAT, usage, vk::MemoryUsage::GPU_ONLY, options, getDevice() );
+		mHiZ.view				   = vk::ImageView::create( mHiZ.image, getDevice() );
+
+		// The pyramid stays in GENERAL so levels can be written and read back to back
+		getDevice()->transitionImageLayout(
+			mHiZ.image->getImageHandle(),
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			0,
+			mipLevels,
+			0,
+			1,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT );
+
+		mHiZ.mipViews.clear();
+		for ( uint32_t level = 0; level < mipLevels; ++level ) {
+			vk::ImageView::Options viewOptions = vk::ImageView::Options( mHiZ.image.get() ).mipLevels( level, 1 );
+			mHiZ.mipViews.push_back( vk::ImageView::create( mHiZ.image, viewOptions, getDevice() ) );
+		}
+
+		mHiZ.depthImage.reset();
+		mHiZ.depthView.reset();
+		mHiZ.depthExtent = { depthExtent.width, depthExtent.height };
+	}
+
+	// Depth only view of the previous frame's depth stencil
+	if ( mHiZ.depthImage != depth ) {
+		vk::ImageView::Options viewOptions = vk::ImageView::Options( depth.get() ).aspectMask( VK_IMAGE_ASPECT_DEPTH_BIT );
+		mHiZ.depthView					   = vk::ImageView::create( depth, viewOptions, getDevice() );
+		mHiZ.depthImage					   = depth;
+	}
+
+	vk::CommandBuffer *cmd = ctx->getCurrentCommandBuffer();
+
+	// Depth writes from the previous frame must land before the first
+	// reduction, and last frame's culling must be done reading the pyramid.
+	pipelineBarrier(
+		cmd,
+		{ memoryBarrier( VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, 0, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, 0 ) },
+		{ depthLayoutBarrier(
+			depth.get(),
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR,
+			VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR,
+			VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR ) } );
+
+	cmd->bindPipeline( VK_PIPELINE_BIND_POINT_COMPUTE, mReducePipeline );
+
+	const uint32_t levelCount = countU32( mHiZ.mipViews );
+	for ( uint32_t level = 0; level < levelCount; ++level ) {
+		ReduceParams params = {};
+		if ( level == 0 ) {
+			params.srcSize = ivec2( depthExtent.width, depthExtent.height );
+		}
+		else {
+			params.srcSize = ivec2( std::max<uint32_t>( 1, mHiZ.image->getExtent().width >> ( level - 1 ) ), std::max<uint32_t>( 1, mHiZ.image->getExtent().height >> ( level - 1 ) ) );
+		}
+		params.dstSize = ivec2( std::max<uint32_t>( 1, mHiZ.image->getExtent().width >> level ), std::max<uint32_t>( 1, mHiZ.image->getExtent().height >> level ) );
+
+		VkDescriptorImageInfo srcInfo = {};
+		srcInfo.sampler				  = mSampler->getSamplerHandle();
+		srcInfo.imageView			  = ( level == 0 ) ? mHiZ.depthView->getImageViewHandle() : mHiZ.mipViews[level - 1]->getImageViewHandle();
+		srcInfo.imageLayout			  = ( level == 0 ) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+		VkDescriptorImageInfo dstInfo = {};
+		dstInfo.sampler				  = VK_NULL_HANDLE;
+		dstInfo.imageView			  = mHiZ.mipViews[level]->getImageViewHandle();
+		dstInfo.imageLayout			  = VK_IMAGE_LAYOUT_GENERAL;
+
+		std::vector<VkWriteDescriptorSet> writes = {
+			writeDescriptor( REDUCE_SRC_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &srcInfo, nullptr ),
+			writeDescriptor( REDUCE_DST_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &dstInfo, nullptr ) };
+
+		cmd->pushDescriptors( VK_PIPELINE_BIND_POINT_COMPUTE, mReducePipelineLayout.get(), 0, writes );
+		cmd->pushConstants( mReducePipelineLayout.get(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( params ), &params );
+		cmd->dispatch(
+			( params.dstSize.x + REDUCE_GROUP_SIZE - 1 ) / REDUCE_GROUP_SIZE,
+			( params.dstSize.y + REDUCE_GROUP_SIZE - 1 ) / REDUCE_GROUP_SIZE,
+			1 );
+
+		pipelineBarrier(
+			cmd,
+			{ memoryBarrier( VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR ) } );
+	}
+
+	// Give the depth buffer back to rendering
+	pipelineBarrier(
+		cmd,
+		{},
+		{ depthLayoutBarrier(
+			depth.get(),
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR,
+			0,
+			VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR,
+			VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR ) } );
+
+	return true;
+}
+
+void GpuCuller::cull( vk::Context *ctx, const vk::Buffer *objects, const vk::Buffer *transforms, uint32_t objectCount, const mat4 &viewProjection )
+{
+	// The params and draw buffers of a frame are written on the host and
+	// read by the GPU later, a second call would overwrite them under the
+	// first call's draws. It would also lose the previous frame's matrix.
+	const uint64_t frameCount = ctx->getFrameCount();
+	if ( mHasCulled && ( mCullFrame == frameCount ) ) {
+		throw VulkanExc( "GpuCuller::cull() can only be called once per frame, use a GpuCuller for each cull" );
+	}
+
+	initPipelines( ctx );
+	updateFrame( ctx, objectCount );
+
+	mPrevViewProjectionValid = mHasCulled && ( ( mCullFrame + 1 ) == frameCount );
+	mPrevViewProjection		 = mViewProjection;
+	mViewProjection			 = viewProjection;
+	mHiZValid				 = false;
+	mCullFrame				 = frameCount;
+	mHasCulled				 = true;
+
+	mObjectCount = objectCount;
+	if ( objectCount == 0 ) {
+		return;
+	}
+
+	// The Hi-Z pyramid is built from the previous frame's depth, which
+	// the context discards if it was set to skip storing it
+	if ( mOcclusionCulling && ( ctx->getAttachmentOps().depthStencilStoreOp != VK_ATTACHMENT_STORE_OP_STORE ) ) {
+		vk::Context::AttachmentOps ops = ctx->getAttachmentOps();
+		ops.depthStencilStoreOp		   = VK_ATTACHMENT_STORE_OP_STORE;
+		ctx->setAttachmentOps( ops );
+	}
+
+	vk::CommandBuffer *cmd = ctx->getCurrentCommandBuffer();
+
+	// Dispatches can't be recorded inside dynamic rendering
+	ctx->suspendRendering();
+
+	if ( mOcclusionCulling && mPrevViewProjectionValid ) {
+		mHiZValid = buildHiZ( ctx );
+	}
+	const bool occlusion = mOcclusionCulling && mPrevViewProjectionValid && mHiZValid;
+
+	// Params
+	{
+		CullParams params		  = {};
+		params.prevViewProjection = mPrevViewProjection;
+		params.depthSize		  = ivec2( mHiZ.depthExtent.width, mHiZ.depthExtent.height );
+		params.objectCount		  = objectCount;
+		params.flags			  = ( occlusion ? CULL_FLAG_OCCLUSION : 0 ) | ( mCompacting ? CULL_FLAG_COMPACT : 0 );
+
+		// Planes are extracted from the rows of the matrix. Near uses
+		// w + z which is conservative for both [-1, 1] and [0, 1] depth.
+		const mat4 &m  = viewProjection;
+		const vec4	r0 = vec4( m[0][0], m[1][0], m[2][0], m[3][0] );
+		const vec4	r1 = vec4( m[0][1], m[1][1], m[2][1], m[3][1] );
+		const vec4	r2 = vec4( m[0][2], m[1][2], m[2][2], m[3][2] );
+		const vec4	r3 = vec4( m[0][3], m[1][3], m[2][3], m[3][3] );
+
+		const vec4 planes[6] = { r3 + r0, r3 - r0, r3 + r1, r3 - r1, r3 + r2, r3 - r2 };
+		for ( uint32_t i = 0; i < 6; ++i ) {
+			const float len			= glm::length( vec3( planes[i] ) );
+			params.frustumPlanes[i] = ( len > 0.0f ) ? ( planes[i] / len ) : planes[i];
+		}
+
+		void *pMappedAddress = nullptr;
+		mFrames[mFrameIndex].params->map( &pMappedAddress );
+		memcpy( pMappedAddress, &params, sizeof( params ) );
+		mFrames[mFrameIndex].params->unmap();
+	}
+
+	const Frame &frame = mFrames[mFrameIndex];
+
+	// Earlier draws from this frame's buffers must be done before they're rewritten
+	pipelineBarrier(
+		cmd,
+		{ memoryBarrier( VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT_KHR, 0, VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, 0 ) } );
+
+	if ( mCompacting ) {
+		cmd->fillBuffer( frame.count, 0, sizeof( uint32_t ), 0 );
+
+		pipelineBarrier(
+			cmd,
+			{ memoryBarrier( VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR, VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_STORAGE_READ_BIT_KHR | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR ) } );
+	}
+
+	// Cull
+	{
+		VkDescriptorBufferInfo paramsInfo	  = bufferInfo( frame.params.get() );
+		VkDescriptorBufferInfo objectsInfo	  = bufferInfo( objects );
+		VkDescriptorBufferInfo transformsInfo = bufferInfo( transforms );
+		VkDescriptorBufferInfo drawsInfo	  = bufferInfo( frame.draws.get() );
+		VkDescriptorBufferInfo countInfo	  = bufferInfo( frame.count.get() );
+
+		VkDescriptorImageInfo hizInfo = {};
+		hizInfo.sampler				  = mSampler->getSamplerHandle();
+		hizInfo.imageView			  = occlusion ? mHiZ.view->getImageViewHandle() : mDummyHiZView->getImageViewHandle();
+		hizInfo.imageLayout			  = VK_IMAGE_LAYOUT_GENERAL;
+
+		std::vector<VkWriteDescriptorSet> writes = {
+			writeDescriptor( CULL_PARAMS_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, nullptr, &paramsInfo ),
+			writeDescriptor( CULL_OBJECTS_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &objectsInfo ),
+			writeDescriptor( CULL_TRANSFORMS_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &transformsInfo ),
+			writeDescriptor( CULL_DRAWS_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &drawsInfo ),
+			writeDescriptor( CULL_COUNT_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &countInfo ),
+			writeDescriptor( CULL_HIZ_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &hizInfo, nullptr ) };
+
+		cmd->bindPipeline( VK_PIPELINE_BIND_POINT_COMPUTE, mCullPipeline );
+		cmd->pushDescriptors( VK_PIPELINE_BIND_POINT_COMPUTE, mCullPipelineLayout.get(), 0, writes );
+		cmd->dispatch( ( objectCount + CULL_GROUP_SIZE - 1 ) / CULL_GROUP_SIZE, 1, 1 );
+	}
+
+	pipelineBarrier(
+		cmd,
+		{ memoryBarrier( VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT_KHR, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT_KHR ) } );
+
+	ctx->resumeRendering();
+}
+
+void GpuCuller::drawIndirect( vk::Context *ctx )
+{
+	if ( mObjectCount == 0 ) {
+		return;
+	}
+
+	const Frame &frame = mFrames[mFrameIndex];
+	if ( mCompacting ) {
+		ctx->drawIndexedIndirectCount( frame.draws, 0, frame.count, 0, mObjectCount );
+	}
+	else {
+		ctx->drawIndexedIndirect( frame.draws, 0, mObjectCount );
+	}
+}
+
+} // namespace cinder::vk
@@ -163,6 +163,17 @@ Image::~Image()
 	}
 }
 
+bool Image::isLazilyAllocated() const
+{
+	if ( mAllocation == VK_NULL_HANDLE ) {
+		return false;
+	}
+
+	VkMemoryPropertyFlags flags = 0;
+	vmaGetMemoryTypeProperties( getDevice()->getAllocatorHandle(), mAllocationinfo.memoryType, &flags );
+	return ( flags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT ) != 0;
+}
+
 void Image::map( void **ppMappedAddress )
 {
 	if ( ppMappedAddress == nullptr ) {
@@ -1,8 +1,26 @@
 #include "cinder/vk/Mesh.h"
+#include "cinder/vk/Device.h"
+#include "cinder/vk/MeshOptimize.h"
 #include "cinder/vk/Util.h"
+#include "cinder/vk/VertexEncoding.h"
 #include "cinder/app/RendererVk.h"
 #include "cinder/Log.h"
 
+#include <cstring>
+#include <fstream>
+
+#if defined( CINDER_MSW_DESKTOP )
+#if !defined( NOMINMAX )
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace cinder::vk {
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
@@ -11,20 +29,22 @@ namespace cinder::vk {
 class BufferedMeshGeomTarget : public geom::Target
 {
 public:
+	//! Attributes are written straight into mapped memory: the vertex
+	//! buffer itself if it's host visible, otherwise a staging buffer
+	//! that copyBuffers() copies from on the GPU.
 	struct BufferData
 	{
-		BufferData( const geom::BufferLayout &layout, uint8_t *data, size_t dataSize )
-			: mLayout( layout ), mData( data ), mDataSize( dataSize )
-		{
-		}
-		BufferData( BufferData &&rhs )
-			: mLayout( rhs.mLayout ), mData( std::move( rhs.mData ) ), mDataSize( rhs.mDataSize )
+		BufferData( const geom::BufferLayout &layout, const vk::BufferRef &staging, uint8_t *data, size_t dataSize )
+			: mLayout( layout ), mStaging( staging ), mData( data ), mDataSize( dataSize )
 		{
 		}
 
-		geom::BufferLayout		   mLayout;
-		std::unique_ptr<uint8_t[]> mData;
-		size_t					   mDataSize;
+		geom::BufferLayout				mLayout;
+		vk::BufferRef					mStaging; // Null if mData points into the vertex buffer
+		uint8_t						   *mData;
+		size_t							mDataSize;
+		bool							mWasMapped	  = false;
+		const vk::BufferedMesh::Layout *mSourceLayout = nullptr; // Attribute encodings
 	};
 
 	BufferedMeshGeomTarget( geom::Primitive prim, vk::BufferedMesh *pMesh )
@@ -33,25 +53,58 @@ public:
 		// this may be replaced later with a copyIndices call
 		mMesh->mNumIndices = 0;
 
-		// create a vector of temporary data that parallels the VboMesh's vertexData
-		for ( const auto &vertexBuffer : mMesh->getVertexBuffers() ) {
-			size_t requiredBytes = vertexBuffer.first.calcRequiredStorage( mMesh->mNumVertices );
-			mBufferData.push_back( BufferData( vertexBuffer.first, new uint8_t[requiredBytes], requiredBytes ) );
+		// map storage that parallels the BufferedMesh's vertex buffers
+		for ( size_t i = 0; i < mMesh->getVertexBuffers().size(); ++i ) {
+			const auto &vertexBuffer = mMesh->getVertexBuffers()[i];
+			// calcRequiredStorage() assumes 32-bit components, encoded attributes are smaller
+			size_t requiredBytes = std::min<size_t>( vertexBuffer.first.calcRequiredStorage( mMesh->mNumVertices ), vertexBuffer.second->getSize() );
+
+			// Dynamic meshes are loaded into their shadow copy, it's copied to the ring when it's bound
+			if ( mMesh->isDynamic() ) {
+				auto &shadow = mMesh->mDynamicBuffers[i].shadow;
+				mBufferData.push_back( BufferData( vertexBuffer.first, nullptr, shadow.data(), std::min<size_t>( requiredBytes, shadow.size() ) ) );
+				mBufferData.back().mWasMapped	 = true;
+				mBufferData.back().mSourceLayout = &mMesh->mVertexLayouts[i];
+				continue;
+			}
+
+			vk::BufferRef staging;
+			vk::Buffer	 *pMapBuffer = vertexBuffer.second.get();
+			if ( vertexBuffer.second->getMemoryUsage() == vk::MemoryUsage::GPU_ONLY ) {
+				staging	   = vk::Buffer::create( requiredBytes, vk::Buffer::Usage().transferSrc(), vk::MemoryUsage::CPU_ONLY, vk::Buffer::Options(), mMesh->getDevice() );
+				pMapBuffer = staging.get();
+			}
+
+			bool  wasMapped = pMapBuffer->isMapped();
+			void *pData		= nullptr;
+			pMapBuffer->map( &pData );
+
+			mBufferData.push_back( BufferData( vertexBuffer.first, staging, static_cast<uint8_t *>( pData ), requiredBytes ) );
+			mBufferData.back().mWasMapped	 = wasMapped;
+			mBufferData.back().mSourceLayout = &mMesh->mVertexLayouts[i];
 		}
 	}
 
+	~BufferedMeshGeomTarget()
+	{
+		unmapBuffers();
+	}
+
 	virtual geom::Primitive getPrimitive() const;
 	uint8_t					getAttribDims( geom::Attrib attr ) const override;
 	void					copyAttrib( geom::Attrib attr, uint8_t dims, size_t strideBytes, const float *srcData, size_t count ) override;
 	void					copyIndices( geom::Primitive primitive, const uint32_t *source, size_t numIndices, uint8_t requiredBytesPerIndex ) override;
 
-	//! Must be called in order to upload temporary 'mBufferData' to VBOs
+	//! Must be called in order to copy the staging buffers to the vertex buffers
 	void copyBuffers();
 
 	//! Fill out attribute with default data
 	void fillBuffer( geom::Attrib attr, size_t count );
 
 protected:
+	//! Unmaps and releases whatever copyBuffers() hasn't
+	void unmapBuffers();
+
 	geom::Primitive			mPrimitive;
 	std::vector<BufferData> mBufferData;
 	vk::BufferedMesh		 *mMesh;
@@ -75,16 +128,20 @@ void BufferedMeshGeomTarget::copyAttrib( geom::Attrib attr, uint8_t dims, size_t
 	}
 
 	// we need to find which element of 'mBufferData' containts 'attr'
-	uint8_t *dstData = nullptr;
-	uint8_t	 dstDims;
-	size_t	 dstStride, dstDataSize;
+	uint8_t			  *dstData = nullptr;
+	uint8_t			   dstDims;
+	size_t			   dstStride, dstDataSize;
+	vk::VertexEncoding encoding	= vk::VertexEncoding::FLOAT32;
+	float			   scale	= 1.0f;
 	for ( const auto &bufferData : mBufferData ) {
 		if ( bufferData.mLayout.hasAttrib( attr ) ) {
 			auto attrInfo = bufferData.mLayout.getAttribInfo( attr );
 			dstDims		  = attrInfo.getDims();
 			dstStride	  = attrInfo.getStride();
-			dstData		  = bufferData.mData.get() + attrInfo.getOffset();
+			dstData		  = bufferData.mData + attrInfo.getOffset();
 			dstDataSize	  = bufferData.mDataSize;
+			encoding	  = bufferData.mSourceLayout->getEncoding( attr );
+			scale		  = bufferData.mSourceLayout->getEncodingScale( attr );
 			break;
 		}
 	}
@@ -104,19 +161,36 @@ void BufferedMeshGeomTarget::copyAttrib( geom::Attrib attr, uint8_t dims, size_t
 	}
 
 	if ( dstData ) {
-		geom::copyData( dims, srcData, count, dstDims, dstStride, reinterpret_cast<float *>( dstData ) );
+		if ( encoding != vk::VertexEncoding::FLOAT32 ) {
+			vk::encodeVertexData( encoding, scale, dims, srcData, count, dstDims, dstStride, dstData );
+		}
+		else {
+			geom::copyData( dims, srcData, count, dstDims, dstStride, reinterpret_cast<float *>( dstData ) );
+		}
 	}
 }
 
 void BufferedMeshGeomTarget::fillBuffer( geom::Attrib attr, size_t count )
 {
 	for ( const auto &bufferData : mBufferData ) {
+		// Encoded attributes get their defaults as floats and go through the encoder
+		if ( bufferData.mLayout.hasAttrib( attr ) && ( bufferData.mSourceLayout->getEncoding( attr ) != vk::VertexEncoding::FLOAT32 ) ) {
+			if ( ( attr != geom::COLOR ) && ( attr != geom::NORMAL ) ) {
+				throw VulkanExc( "unhandled attribute type" );
+			}
+
+			uint8_t			   dims = bufferData.mLayout.getAttribInfo( attr ).getDims();
+			std::vector<float> values( count * dims, ( attr == geom::COLOR ) ? 1.0f : 0.0f );
+			copyAttrib( attr, dims, 0, values.data(), count );
+			continue;
+		}
+
 		if ( bufferData.mLayout.hasAttrib( attr ) ) {
 			auto	 attrInfo = bufferData.mLayout.getAttribInfo( attr );
 			size_t	 stride	  = attrInfo.getStride();
 			size_t	 offset	  = attrInfo.getOffset();
 			uint8_t	 dims	  = attrInfo.getDims();
-			uint8_t *data	  = bufferData.mData.get() + offset;
+			uint8_t *data	  = bufferData.mData + offset;
 
 			for ( size_t i = 0; i < count; ++i ) {
 				switch ( attrInfo.getDataType() ) {
@@ -151,46 +225,347 @@ void BufferedMeshGeomTarget::copyIndices( geom::Primitive /*primitive*/, const u
 	mMesh->mNumIndices = (uint32_t)numIndices;
 	if ( mMesh->mNumIndices == 0 ) {
 		mMesh->mIndices.reset();
+		return;
 	}
-	else if ( requiredBytesPerIndex <= 2 ) {
-		const uint64_t srcDataSize = numIndices * sizeof( uint16_t );
-		mMesh->mIndexType		   = VK_INDEX_TYPE_UINT16;
-		std::unique_ptr<uint16_t[]> indices( new uint16_t[numIndices] );
-		copyIndexData( source, numIndices, indices.get() );
-		if ( !mMesh->mIndices ) {
-			vk::Buffer::Usage	usage	= vk::Buffer::Usage().indexBuffer().transferSrc().transferDst();
-			vk::Buffer::Options options = vk::Buffer::Options();
-			mMesh->mIndices				= vk::Buffer::create( srcDataSize, indices.get(), usage, vk::MemoryUsage::GPU_ONLY, options, mMesh->getDevice() );
-		}
-		else {
-			mMesh->mIndices->copyData( srcDataSize, indices.get() );
-		}
+
+	const bool	   is16Bit	   = ( requiredBytesPerIndex <= 2 );
+	const uint64_t srcDataSize = numIndices * ( is16Bit ? sizeof( uint16_t ) : sizeof( uint32_t ) );
+	mMesh->mIndexType		   = is16Bit ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	if ( !mMesh->mIndices ) {
+		vk::Buffer::Usage	usage	= vk::Buffer::Usage().indexBuffer().transferSrc().transferDst();
+		vk::Buffer::Options options = vk::Buffer::Options();
+		mMesh->mIndices				= vk::Buffer::create( srcDataSize, usage, vk::MemoryUsage::GPU_ONLY, options, mMesh->getDevice() );
+	}
+
+	// Convert straight into the device's staging buffer
+	vk::Buffer *pIndexBuffer = mMesh->mIndices.get();
+	void	   *pDstData	 = mMesh->getDevice()->beginCopyToBuffer( srcDataSize, pIndexBuffer );
+	if ( is16Bit ) {
+		copyIndexData( source, numIndices, static_cast<uint16_t *>( pDstData ) );
 	}
 	else {
-		const uint64_t srcDataSize = numIndices * sizeof( uint32_t );
-		mMesh->mIndexType		   = VK_INDEX_TYPE_UINT32;
-		std::unique_ptr<uint32_t[]> indices( new uint32_t[numIndices] );
-		copyIndexData( source, numIndices, indices.get() );
-		if ( !mMesh->mIndices ) {
-			vk::Buffer::Usage	usage	= vk::Buffer::Usage().indexBuffer().transferSrc().transferDst();
-			vk::Buffer::Options options = vk::Buffer::Options();
-			mMesh->mIndices				= vk::Buffer::create( srcDataSize, indices.get(), usage, vk::MemoryUsage::GPU_ONLY, options, mMesh->getDevice() );
-		}
-		else {
-			mMesh->mIndices->copyData( srcDataSize, indices.get() );
-		}
+		std::memcpy( pDstData, source, srcDataSize );
 	}
+	mMesh->getDevice()->endCopyToBuffer( srcDataSize, pIndexBuffer );
 }
 
 void BufferedMeshGeomTarget::copyBuffers()
 {
-	// iterate all the buffers in mBufferData and upload them to the corresponding VBO in the VboMesh
+	// iterate all the buffers in mBufferData and copy the staged ones to the corresponding vertex buffer in the BufferedMesh
 	for ( auto bufferDataIt = mBufferData.begin(); bufferDataIt != mBufferData.end(); ++bufferDataIt ) {
+		if ( !bufferDataIt->mStaging ) {
+			continue;
+		}
+
 		auto vertexArrayIt = mMesh->mVertexBuffers.begin() + std::distance( mBufferData.begin(), bufferDataIt );
-		vertexArrayIt->second->copyData( bufferDataIt->mDataSize, bufferDataIt->mData.get() );
+		bufferDataIt->mStaging->unmap();
+		mMesh->getDevice()->copyBufferToBuffer( bufferDataIt->mDataSize, bufferDataIt->mStaging.get(), 0, vertexArrayIt->second.get(), 0 );
+		bufferDataIt->mStaging.reset();
+		bufferDataIt->mData = nullptr;
 	}
+
+	unmapBuffers();
 }
 
+void BufferedMeshGeomTarget::unmapBuffers()
+{
+	for ( auto bufferDataIt = mBufferData.begin(); bufferDataIt != mBufferData.end(); ++bufferDataIt ) {
+		if ( bufferDataIt->mData == nullptr ) {
+			continue;
+		}
+
+		if ( bufferDataIt->mStaging ) {
+			bufferDataIt->mStaging->unmap();
+			bufferDataIt->mStaging.reset();
+		}
+		else if ( !bufferDataIt->mWasMapped ) {
+			auto vertexArrayIt = mMesh->mVertexBuffers.begin() + std::distance( mBufferData.begin(), bufferDataIt );
+			vertexArrayIt->second->unmap();
+		}
+		bufferDataIt->mData = nullptr;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// BufferedMeshCaptureTarget
+
+//! Holds on to everything a geom::Source emits so it can be reordered
+//! before it's passed on to a BufferedMeshGeomTarget.
+class BufferedMeshCaptureTarget : public geom::Target
+{
+public:
+	struct AttribData
+	{
+		uint8_t			   dims;
+		std::vector<float> data;
+	};
+
+	BufferedMeshCaptureTarget( const geom::Source &source )
+		: mSource( source ) {}
+
+	uint8_t getAttribDims( geom::Attrib attr ) const override { return mSource.getAttribDims( attr ); }
+
+	void copyAttrib( geom::Attrib attr, uint8_t dims, size_t /*strideBytes*/, const float *srcData, size_t count ) override
+	{
+		AttribData &attrib = mAttribs[attr];
+		attrib.dims		   = dims;
+		attrib.data.assign( srcData, srcData + count * dims );
+	}
+
+	void copyIndices( geom::Primitive /*primitive*/, const uint32_t *source, size_t numIndices, uint8_t requiredBytesPerIndex ) override
+	{
+		mIndices.assign( source, source + numIndices );
+		mRequiredBytesPerIndex = requiredBytesPerIndex;
+	}
+
+	//! Runs the vertex cache, overdraw and vertex fetch passes over the captured data
+	vk::BufferedMesh::OptimizeStats optimize( uint32_t numVertices, const vk::BufferedMesh::Options &options );
+
+	//! Passes the captured data on to \a target
+	void replay( geom::Target *target, size_t numVertices ) const
+	{
+		for ( const auto &it : mAttribs ) {
+			target->copyAttrib( it.first, it.second.dims, 0, it.second.data.data(), numVertices );
+		}
+		if ( !mIndices.empty() ) {
+			target->copyIndices( mSource.getPrimitive(), mIndices.data(), mIndices.size(), mRequiredBytesPerIndex );
+		}
+	}
+
+private:
+	const geom::Source				  &mSource;
+	std::map<geom::Attrib, AttribData> mAttribs;
+	std::vector<uint32_t>			   mIndices;
+	uint8_t							   mRequiredBytesPerIndex = 4;
+};
+
+vk::BufferedMesh::OptimizeStats BufferedMeshCaptureTarget::optimize( uint32_t numVertices, const vk::BufferedMesh::Options &options )
+{
+	vk::BufferedMesh::OptimizeStats stats = {};
+	if ( ( mSource.getPrimitive() != geom::TRIANGLES ) || mIndices.empty() ) {
+		CI_LOG_W( "BufferedMesh optimization skipped, only indexed geom::TRIANGLES sources are supported" );
+		return stats;
+	}
+
+	const uint32_t cacheSize = options.getVertexCacheSize();
+	stats.acmrBefore		 = calcAcmr( mIndices.data(), mIndices.size(), numVertices, cacheSize );
+	stats.atvrBefore		 = calcAtvr( mIndices.data(), mIndices.size(), numVertices, cacheSize );
+
+	std::vector<uint32_t> clusters;
+	optimizeVertexCache( mIndices.data(), mIndices.size(), numVertices, cacheSize, &clusters );
+
+	// Overdraw ordering needs positions
+	auto positions = mAttribs.find( geom::POSITION );
+	if ( positions != mAttribs.end() ) {
+		optimizeOverdraw(
+			mIndices.data(),
+			mIndices.size(),
+			positions->second.data.data(),
+			positions->second.dims,
+			numVertices,
+			clusters,
+			cacheSize,
+			options.getOverdrawThreshold() );
+	}
+
+	// Vertex fetch order, doesn't change the ACMR
+	const std::vector<uint32_t> remap = optimizeVertexFetch( mIndices.data(), mIndices.size(), numVertices );
+	for ( auto &it : mAttribs ) {
+		const size_t	   dims = it.second.dims;
+		std::vector<float> remapped( it.second.data.size() );
+		for ( uint32_t i = 0; i < numVertices; ++i ) {
+			std::copy_n( it.second.data.data() + i * dims, dims, remapped.data() + remap[i] * dims );
+		}
+		it.second.data.swap( remapped );
+	}
+
+	stats.optimized = true;
+	stats.acmrAfter = calcAcmr( mIndices.data(), mIndices.size(), numVertices, cacheSize );
+	stats.atvrAfter = calcAtvr( mIndices.data(), mIndices.size(), numVertices, cacheSize );
+	return stats;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// BufferedMesh file format
+
+//! Header of files written by BufferedMesh::save(), followed by the vertex
+//! buffer table, the attribute table and the buffer data. Buffer data
+//! starts on kMeshFileAlignment boundaries so it can be copied straight
+//! out of a memory mapped file.
+struct MeshFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t numVertices;
+	uint32_t numIndices;
+	uint32_t primitive;
+	uint32_t indexType;
+	uint32_t vertexBufferCount;
+	uint32_t attribCount;
+	uint64_t indexDataOffset;
+	uint64_t indexDataSize;
+};
+
+struct MeshFileVertexBuffer
+{
+	uint32_t interleave;
+	uint32_t firstAttrib;
+	uint32_t attribCount;
+	uint32_t reserved;
+	uint64_t dataOffset;
+	uint64_t dataSize;
+};
+
+struct MeshFileAttrib
+{
+	uint32_t attrib;
+	uint32_t dims;
+	uint32_t encoding;
+	float	 scale;
+	uint64_t offset;
+	uint64_t stride;
+};
+
+static const uint32_t kMeshFileMagic	 = 0x4D564943; // 'CIVM'
+static const uint32_t kMeshFileVersion	 = 1;
+static const uint64_t kMeshFileAlignment = 4096;
+
+namespace {
+
+template <typename T>
+static T readValue( const uint8_t *pData, size_t dataSize, size_t offset )
+{
+	if ( ( offset + sizeof( T ) ) > dataSize ) {
+		throw VulkanExc( "unexpected end of mesh file" );
+	}
+	T value = {};
+	memcpy( &value, pData + offset, sizeof( T ) );
+	return value;
+}
+
+//! Read only memory mapping of a whole file
+class MappedFile
+{
+public:
+	MappedFile( const fs::path &path )
+	{
+#if defined( CINDER_MSW_DESKTOP )
+		mFile = CreateFileW( path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+		if ( mFile == INVALID_HANDLE_VALUE ) {
+			throw VulkanExc( "failed to open mesh file: " + path.string() );
+		}
+
+		LARGE_INTEGER size = {};
+		GetFileSizeEx( mFile, &size );
+		mSize = static_cast<size_t>( size.QuadPart );
+		if ( mSize > 0 ) {
+			mMapping = CreateFileMappingW( mFile, nullptr, PAGE_READONLY, 0, 0, nullptr );
+			mData	 = mMapping ? static_cast<const uint8_t *>( MapViewOfFile( mMapping, FILE_MAP_READ, 0, 0, 0 ) ) : nullptr;
+		}
+#else
+		mFile = open( path.string().c_str(), O_RDONLY );
+		if ( mFile < 0 ) {
+			throw VulkanExc( "failed to open mesh file: " + path.string() );
+		}
+
+		struct stat st = {};
+		fstat( mFile, &st );
+		mSize = static_cast<size_t>( st.st_size );
+		if ( mSize > 0 ) {
+			void *pData = mmap( nullptr, mSize, PROT_READ, MAP_PRIVATE, mFile, 0 );
+			mData		= ( pData != MAP_FAILED ) ? static_cast<const uint8_t *>( pData ) : nullptr;
+			if ( mData ) {
+				// Buffers are read front to back exactly once
+				madvise( pData, mSize, MADV_SEQUENTIAL );
+			}
+		}
+#endif
+		if ( ( mSize > 0 ) && ( mData == nullptr ) ) {
+			close();
+			throw VulkanExc( "failed to map mesh file: " + path.string() );
+		}
+	}
+
+	~MappedFile()
+	{
+		close();
+	}
+
+	const uint8_t *getData() const { return mData; }
+	size_t		   getSize() const { return mSize; }
+
+private:
+	void close()
+	{
+#if defined( CINDER_MSW_DESKTOP )
+		if ( mData ) {
+			UnmapViewOfFile( mData );
+		}
+		if ( mMapping ) {
+			CloseHandle( mMapping );
+		}
+		if ( mFile != INVALID_HANDLE_VALUE ) {
+			CloseHandle( mFile );
+		}
+		mMapping = nullptr;
+		mFile	 = INVALID_HANDLE_VALUE;
+#else
+		if ( mData ) {
+			munmap( const_cast<uint8_t *>( mData ), mSize );
+		}
+		if ( mFile >= 0 ) {
+			::close( mFile );
+		}
+		mFile = -1;
+#endif
+		mData = nullptr;
+	}
+
+#if defined( CINDER_MSW_DESKTOP )
+	HANDLE mFile	= INVALID_HANDLE_VALUE;
+	HANDLE mMapping = nullptr;
+#else
+	int mFile = -1;
+#endif
+	const uint8_t *mData = nullptr;
+	size_t		   mSize = 0;
+};
+
+//! Writes the first \a size bytes of \a pBuffer to \a os, GPU only
+//! buffers are read back through a GPU_TO_CPU buffer first.
+static void writeBufferData( vk::Buffer *pBuffer, uint64_t size, std::ostream &os )
+{
+	vk::BufferRef readback;
+	vk::Buffer	 *pMapBuffer = pBuffer;
+	if ( pBuffer->getMemoryUsage() == vk::MemoryUsage::GPU_ONLY ) {
+		readback   = vk::Buffer::create( size, vk::Buffer::Usage().transferDst(), vk::MemoryUsage::GPU_TO_CPU, vk::Buffer::Options(), pBuffer->getDevice() );
+		pMapBuffer = readback.get();
+		pBuffer->getDevice()->copyBufferToBuffer( size, pBuffer, 0, pMapBuffer, 0 );
+	}
+
+	bool  wasMapped = pMapBuffer->isMapped();
+	void *pData		= nullptr;
+	pMapBuffer->map( &pData );
+	os.write( static_cast<const char *>( pData ), size );
+	if ( !wasMapped ) {
+		pMapBuffer->unmap();
+	}
+}
+
+static uint64_t alignFileOffset( uint64_t offset )
+{
+	return ( offset + kMeshFileAlignment - 1 ) & ~( kMeshFileAlignment - 1 );
+}
+
+//! Pads \a os with zeros from \a offset up to the next kMeshFileAlignment boundary
+static void writePadding( std::ostream &os, uint64_t offset )
+{
+	static const char kZeros[kMeshFileAlignment] = {};
+	os.write( kZeros, static_cast<std::streamsize>( alignFileOffset( offset ) - offset ) );
+}
+
+} // namespace
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // BufferedMesh::Layout
 
@@ -202,6 +577,7 @@ BufferedMesh::Layout &BufferedMesh::Layout::attrib( geom::Attrib attrib, uint8_t
 BufferedMesh::Layout &BufferedMesh::Layout::attrib( const geom::AttribInfo &attribInfo )
 {
 	geom::Attrib attrib = attribInfo.getAttrib();
+	mEncodings.erase( attrib );
 
 	auto it = std::find_if(
 		mAttribInfos.begin(),
@@ -220,6 +596,41 @@ BufferedMesh::Layout &BufferedMesh::Layout::attrib( const geom::AttribInfo &attr
 	return *this;
 }
 
+BufferedMesh::Layout &BufferedMesh::Layout::attrib( geom::Attrib attrib, uint8_t dims, vk::VertexEncoding encoding, float scale )
+{
+	if ( vk::toVkFormat( encoding, dims ) == VK_FORMAT_UNDEFINED ) {
+		throw VulkanExc( "unsupported vertex encoding for attribute dimensions" );
+	}
+
+	this->attrib( geom::AttribInfo( attrib, dims, 0, 0 ) );
+	if ( encoding != vk::VertexEncoding::FLOAT32 ) {
+		mEncodings[attrib] = { encoding, scale };
+	}
+
+	return *this;
+}
+
+vk::VertexEncoding BufferedMesh::Layout::getEncoding( geom::Attrib attrib ) const
+{
+	auto it = mEncodings.find( attrib );
+	return ( it != mEncodings.end() ) ? it->second.encoding : vk::VertexEncoding::FLOAT32;
+}
+
+float BufferedMesh::Layout::getEncodingScale( geom::Attrib attrib ) const
+{
+	auto it = mEncodings.find( attrib );
+	return ( it != mEncodings.end() ) ? it->second.scale : 1.0f;
+}
+
+VkFormat BufferedMesh::Layout::getFormat( const geom::AttribInfo &attribInfo ) const
+{
+	auto it = mEncodings.find( attribInfo.getAttrib() );
+	if ( it == mEncodings.end() ) {
+		return vk::toVkFormat( attribInfo );
+	}
+	return vk::toVkFormat( it->second.encoding, attribInfo.getDims() );
+}
+
 bool BufferedMesh::Layout::hasAttrib( geom::Attrib attrib ) const
 {
 	auto it = std::find_if(
@@ -233,21 +644,26 @@ bool BufferedMesh::Layout::hasAttrib( geom::Attrib attrib ) const
 	return found;
 }
 
-void BufferedMesh::Layout::allocate( vk::DeviceRef device, size_t numVertices, geom::BufferLayout *resultBufferLayout, vk::BufferRef *resultVertexBuffer ) const
+void BufferedMesh::Layout::allocate( vk::DeviceRef device, size_t numVertices, geom::BufferLayout *resultBufferLayout, vk::BufferRef *resultVertexBuffer, size_t *resultDataBytes ) const
 {
 	auto attribInfos = mAttribInfos;
 
+	// Encoded attributes are smaller than AttribInfo::getByteSize()
+	auto byteSize = [this]( const geom::AttribInfo &attrib ) -> size_t {
+		return vk::formatSize( getFormat( attrib ) );
+	};
+
 	// setup offsets and strides based on interleaved or planar
 	size_t totalDataBytes;
 	if ( mInterleave ) {
 		size_t totalStride = 0;
 		for ( const auto &attrib : attribInfos )
-			totalStride += attrib.getByteSize();
+			totalStride += byteSize( attrib );
 		size_t currentOffset = 0;
 		for ( auto &attrib : attribInfos ) {
 			attrib.setOffset( currentOffset );
 			attrib.setStride( totalStride );
-			currentOffset += attrib.getByteSize();
+			currentOffset += byteSize( attrib );
 		}
 		totalDataBytes = currentOffset * numVertices;
 	}
@@ -255,13 +671,16 @@ void BufferedMesh::Layout::allocate( vk::DeviceRef device, size_t numVertices, g
 		size_t currentOffset = 0;
 		for ( auto &attrib : attribInfos ) {
 			attrib.setOffset( currentOffset );
-			attrib.setStride( attrib.getByteSize() );
-			currentOffset += attrib.getByteSize() * numVertices;
+			attrib.setStride( byteSize( attrib ) );
+			currentOffset += byteSize( attrib ) * numVertices;
 		}
 		totalDataBytes = currentOffset;
 	}
 
 	*resultBufferLayout = geom::BufferLayout( attribInfos );
+	if ( resultDataBytes ) {
+		*resultDataBytes = totalDataBytes;
+	}
 
 	if ( resultVertexBuffer ) {
 		if ( *resultVertexBuffer ) { // non-null shared_ptr means the VBO should be resized
@@ -285,10 +704,30 @@ vk::BufferedMeshRef BufferedMesh::create( const geom::Source &source, vk::Device
 	}
 
 	// Pass an empty std::vector<pair<Layout,BufferRef>> to imply we want to pull data from the Source
-	return vk::BufferedMeshRef( new vk::BufferedMesh( device, source, std::vector<std::pair<vk::BufferedMesh::Layout, vk::BufferRef>>(), nullptr ) );
+	return vk::BufferedMeshRef( new vk::BufferedMesh( device, source, std::vector<std::pair<vk::BufferedMesh::Layout, vk::BufferRef>>(), nullptr, Options() ) );
 }
 
 vk::BufferedMeshRef BufferedMesh::create( const geom::Source &source, const std::vector<vk::BufferedMesh::Layout> &layouts, vk::DeviceRef device )
+{
+	return vk::BufferedMesh::create( source, layouts, Options(), device );
+}
+
+vk::BufferedMeshRef BufferedMesh::create( const geom::Source &source, const vk::BufferedMesh::Layout &layout, vk::DeviceRef device )
+{
+	std::vector<vk::BufferedMesh::Layout> layouts = { layout };
+	return vk::BufferedMesh::create( source, layouts, Options(), device );
+}
+
+vk::BufferedMeshRef BufferedMesh::create( const geom::Source &source, const Options &options, vk::DeviceRef device )
+{
+	if ( !device ) {
+		device = app::RendererVk::getCurrentRenderer()->getDevice();
+	}
+
+	return vk::BufferedMeshRef( new vk::BufferedMesh( device, source, std::vector<std::pair<vk::BufferedMesh::Layout, vk::BufferRef>>(), nullptr, options ) );
+}
+
+vk::BufferedMeshRef BufferedMesh::create( const geom::Source &source, const std::vector<vk::BufferedMesh::Layout> &layouts, const Options &options, vk::DeviceRef device )
 {
 	if ( !device ) {
 		device = app::RendererVk::getCurrentRenderer()->getDevice();
@@ -299,13 +738,31 @@ vk::BufferedMeshRef BufferedMesh::create( const geom::Source &source, const std:
 		layoutVbos.push_back( std::make_pair( layout, ( vk::BufferRef ) nullptr ) );
 	}
 
-	return vk::BufferedMeshRef( new vk::BufferedMesh( device, source, layoutVbos, nullptr ) );
+	return vk::BufferedMeshRef( new vk::BufferedMesh( device, source, layoutVbos, nullptr, options ) );
 }
 
-vk::BufferedMeshRef BufferedMesh::create( const geom::Source &source, const vk::BufferedMesh::Layout &layout, vk::DeviceRef device )
+vk::BufferedMeshRef BufferedMesh::create( const geom::Source &source, const vk::BufferedMesh::Layout &layout, const Options &options, vk::DeviceRef device )
 {
 	std::vector<vk::BufferedMesh::Layout> layouts = { layout };
-	return vk::BufferedMesh::create( source, layouts, device );
+	return vk::BufferedMesh::create( source, layouts, options, device );
+}
+
+vk::BufferedMeshRef BufferedMesh::create( uint32_t numVertices, geom::Primitive primitive, const std::vector<vk::BufferedMesh::Layout> &layouts, const Options &options, vk::DeviceRef device )
+{
+	if ( !device ) {
+		device = app::RendererVk::getCurrentRenderer()->getDevice();
+	}
+
+	std::vector<std::pair<vk::BufferedMesh::Layout, vk::BufferRef>> vertexBuffers;
+	for ( const auto &layout : layouts ) {
+		vertexBuffers.push_back( std::make_pair( layout, nullptr ) );
+	}
+
+	vk::BufferedMeshRef mesh = vk::BufferedMeshRef( new vk::BufferedMesh( device ) );
+	mesh->mNumVertices		 = numVertices;
+	mesh->mPrimitive		 = toVkPrimitive( primitive );
+	mesh->allocateVertexBuffers( vertexBuffers, options );
+	return mesh;
 }
 
 /*
@@ -327,7 +784,7 @@ BufferedMeshRef BufferedMesh::create( const geom::Source &source, const geom::At
 }
 */
 
-BufferedMesh::BufferedMesh( vk::DeviceRef device, const geom::Source &source, std::vector<std::pair<vk::BufferedMesh::Layout, vk::BufferRef>> vertexBuffers, const vk::BufferRef &indexBuffer )
+BufferedMesh::BufferedMesh( vk::DeviceRef device, const geom::Source &source, std::vector<std::pair<vk::BufferedMesh::Layout, vk::BufferRef>> vertexBuffers, const vk::BufferRef &indexBuffer, const Options &options )
 	: vk::DeviceChildObject( device )
 {
 	//
@@ -386,14 +843,7 @@ BufferedMesh::BufferedMesh( vk::DeviceRef device, const geom::Source &source, st
 	mNumVertices = (uint32_t)source.getNumVertices();
 	mPrimitive	 = toVkPrimitive( source.getPrimitive() );
 
-	// iterate 'vertexArrayBuffers' and allocate mVertexArrayVbos, which is the parallel vector of <geom::BufferLayout,VboRef> pairs
-	for ( const auto &vertexBuffer : vertexBuffers ) {
-		geom::BufferLayout bufferLayout;
-		vk::BufferRef	   buffer = vertexBuffer.second;
-		// we pass nullptr for the VBO if we already have one, to prevent re-allocation by allocate()
-		vertexBuffer.first.allocate( device, mNumVertices, &bufferLayout, &buffer );
-		mVertexBuffers.push_back( make_pair( bufferLayout, buffer ) );
-	}
+	allocateVertexBuffers( vertexBuffers, options );
 
 	// Set our indices to indexBuffer, which may well be empty, so that the target doesn't blow it away. Must do this before we loadInto().
 	mIndices = indexBuffer;
@@ -401,7 +851,28 @@ BufferedMesh::BufferedMesh( vk::DeviceRef device, const geom::Source &source, st
 	// create target
 	BufferedMeshGeomTarget target( source.getPrimitive(), this );
 	// Load data from souce into target
-	source.loadInto( &target, requestedAttribs );
+	if ( options.getOptimize() ) {
+		// Optimizing reorders vertices and indices so everything has to be
+		// captured first. Positions are needed for overdraw ordering even
+		// if the layouts don't have them.
+		//
+		geom::AttribSet captureAttribs = requestedAttribs;
+		if ( source.getAttribDims( geom::POSITION ) > 0 ) {
+			captureAttribs.insert( geom::POSITION );
+		}
+
+		BufferedMeshCaptureTarget capture( source );
+		source.loadInto( &capture, captureAttribs );
+		mOptimizeStats = capture.optimize( mNumVertices, options );
+		capture.replay( &target, mNumVertices );
+
+		if ( mOptimizeStats.optimized ) {
+			CI_LOG_I( "BufferedMesh optimized: ACMR " << mOptimizeStats.acmrBefore << " -> " << mOptimizeStats.acmrAfter << ", ATVR " << mOptimizeStats.atvrBefore << " -> " << mOptimizeStats.atvrAfter );
+		}
+	}
+	else {
+		source.loadInto( &target, requestedAttribs );
+	}
 	// Fill out attributes that need data with some default values.
 	for ( auto &attrib : needsDataAttribs ) {
 		target.fillBuffer( attrib, mNumVertices );
@@ -409,6 +880,11 @@ BufferedMesh::BufferedMesh( vk::DeviceRef device, const geom::Source &source, st
 	// we need to let the target know it can copy from its internal buffers to our vertexData VBOs
 	target.copyBuffers();
 
+	// Every frame's region of a dynamic ring starts out stale
+	for ( size_t i = 0; i < mDynamicBuffers.size(); ++i ) {
+		markDirty( i, 0, mDynamicBuffers[i].shadow.size() );
+	}
+
 	/*
 	// determine the requestedAttribs by iterating all the Layouts
 	geom::AttribSet requestedAttribs;
@@ -462,6 +938,210 @@ BufferedMesh::BufferedMesh( vk::DeviceRef device, const geom::Source &source, st
 */
 }
 
+BufferedMesh::BufferedMesh( vk::DeviceRef device )
+	: vk::DeviceChildObject( device )
+{
+}
+
+void BufferedMesh::allocateVertexBuffers( const std::vector<std::pair<Layout, vk::BufferRef>> &vertexBuffers, const Options &options )
+{
+	// Dynamic meshes get a region per frame in flight
+	uint32_t numFrames = 0;
+	if ( options.getDynamic() ) {
+		vk::Context *pContext = vk::Context::getCurrentContext();
+		if ( pContext == nullptr ) {
+			throw VulkanExc( "dynamic BufferedMesh requires a current context" );
+		}
+		numFrames		  = pContext->getNumFramesInFlight();
+		mNumDynamicFrames = numFrames;
+	}
+
+	// iterate 'vertexArrayBuffers' and allocate mVertexArrayVbos, which is the parallel vector of <geom::BufferLayout,VboRef> pairs
+	for ( const auto &vertexBuffer : vertexBuffers ) {
+		geom::BufferLayout bufferLayout;
+		vk::BufferRef	   buffer	 = vertexBuffer.second;
+		size_t			   dataBytes = 0;
+		if ( numFrames > 0 ) {
+			if ( buffer ) {
+				throw VulkanExc( "dynamic BufferedMesh can't use existing vertex buffers" );
+			}
+
+			vertexBuffer.first.allocate( getDevice(), mNumVertices, &bufferLayout, nullptr, &dataBytes );
+
+			// Region offsets are kept aligned for any vertex format
+			DynamicBuffer dynamicBuffer = {};
+			dynamicBuffer.shadow.resize( dataBytes );
+			dynamicBuffer.frameStride = ( dataBytes + 255 ) & ~static_cast<uint64_t>( 255 );
+			dynamicBuffer.dirty.resize( numFrames, std::make_pair( UINT64_MAX, 0 ) );
+			dynamicBuffer.written.resize( numFrames, UINT64_MAX );
+			mDynamicBuffers.push_back( dynamicBuffer );
+
+			vk::Buffer::Usage	usage		  = vk::Buffer::Usage().vertexBuffer().transferSrc();
+			vk::Buffer::Options bufferOptions = vk::Buffer::Options().persisentMap();
+			buffer							  = vk::Buffer::create( std::max<uint64_t>( dynamicBuffer.frameStride * numFrames, 1 ), usage, vk::MemoryUsage::CPU_TO_GPU, bufferOptions, getDevice() );
+		}
+		else {
+			// we pass nullptr for the VBO if we already have one, to prevent re-allocation by allocate()
+			vertexBuffer.first.allocate( getDevice(), mNumVertices, &bufferLayout, &buffer );
+		}
+		mVertexBuffers.push_back( make_pair( bufferLayout, buffer ) );
+		mVertexLayouts.push_back( vertexBuffer.first );
+
+		std::vector<VkFormat> formats;
+		for ( const auto &attribInfo : bufferLayout.getAttribs() ) {
+			formats.push_back( vertexBuffer.first.getFormat( attribInfo ) );
+		}
+		mVertexFormats.push_back( formats );
+	}
+}
+
+size_t BufferedMesh::findDynamicAttrib( geom::Attrib attr, geom::AttribInfo *pAttribInfo, VkFormat *pFormat ) const
+{
+	if ( !isDynamic() ) {
+		throw VulkanExc( "only dynamic BufferedMesh attributes can be updated" );
+	}
+
+	for ( size_t i = 0; i < mVertexBuffers.size(); ++i ) {
+		const auto &attribs = mVertexBuffers[i].first.getAttribs();
+		for ( size_t j = 0; j < attribs.size(); ++j ) {
+			if ( attribs[j].getAttrib() == attr ) {
+				*pAttribInfo = attribs[j];
+				*pFormat	 = mVertexFormats[i][j];
+				return i;
+			}
+		}
+	}
+
+	throw VulkanExc( "BufferedMesh doesn't have attribute: " + geom::attribToString( attr ) );
+}
+
+void BufferedMesh::markDirty( size_t bufferIndex, uint64_t begin, uint64_t end )
+{
+	for ( auto &range : mDynamicBuffers[bufferIndex].dirty ) {
+		range.first	 = std::min( range.first, begin );
+		range.second = std::max( range.second, end );
+	}
+}
+
+void BufferedMesh::syncFrame( uint32_t frameIndex, uint64_t frameCount, uint32_t numFramesInFlight, std::vector<uint64_t> *pOffsets )
+{
+	if ( !isDynamic() ) {
+		pOffsets->insert( pOffsets->end(), mVertexBuffers.size(), 0 );
+		return;
+	}
+
+	// Fewer regions than frames in flight would hand a region to a frame
+	// while an earlier one is still reading it
+	if ( numFramesInFlight > mNumDynamicFrames ) {
+		throw VulkanExc( "dynamic BufferedMesh was created for fewer frames in flight than the context binding it" );
+	}
+
+	for ( size_t i = 0; i < mDynamicBuffers.size(); ++i ) {
+		DynamicBuffer &dynamicBuffer = mDynamicBuffers[i];
+		const uint32_t frame		 = frameIndex % mNumDynamicFrames;
+		const uint64_t offset		 = frame * dynamicBuffer.frameStride;
+
+		auto &range = dynamicBuffer.dirty[frame];
+		if ( range.first < range.second ) {
+			// Draws recorded earlier this frame still read the region
+			if ( dynamicBuffer.written[frame] == frameCount ) {
+				throw VulkanExc( "dynamic BufferedMesh was updated again after it was bound this frame" );
+			}
+			dynamicBuffer.written[frame] = frameCount;
+
+			void *pMappedAddress = nullptr;
+			mVertexBuffers[i].second->map( &pMappedAddress );
+			memcpy( static_cast<uint8_t *>( pMappedAddress ) + offset + range.first, dynamicBuffer.shadow.data() + range.first, range.second - range.first );
+			range = std::make_pair( UINT64_MAX, 0 );
+		}
+
+		pOffsets->push_back( offset );
+	}
+}
+
+void BufferedMesh::bufferAttrib( geom::Attrib attr, size_t dataSizeBytes, const void *data, uint32_t firstVertex )
+{
+	geom::AttribInfo attribInfo;
+	VkFormat		 format		 = VK_FORMAT_UNDEFINED;
+	size_t			 bufferIndex = findDynamicAttrib( attr, &attribInfo, &format );
+
+	const size_t elementSize = vk::formatSize( format );
+	const size_t count		 = dataSizeBytes / elementSize;
+	if ( count == 0 ) {
+		return;
+	}
+	if ( ( firstVertex + count ) > mNumVertices ) {
+		throw VulkanExc( "bufferAttrib() data is larger than the mesh" );
+	}
+
+	const size_t   stride = attribInfo.getStride();
+	const uint64_t begin  = attribInfo.getOffset() + firstVertex * stride;
+	uint8_t		  *pDst	  = mDynamicBuffers[bufferIndex].shadow.data() + begin;
+	const uint8_t *pSrc	  = static_cast<const uint8_t *>( data );
+	if ( stride == elementSize ) {
+		memcpy( pDst, pSrc, count * elementSize );
+	}
+	else {
+		for ( size_t i = 0; i < count; ++i ) {
+			memcpy( pDst + i * stride, pSrc + i * elementSize, elementSize );
+		}
+	}
+
+	markDirty( bufferIndex, begin, begin + ( count - 1 ) * stride + elementSize );
+}
+
+uint8_t *BufferedMesh::mapAttribData( geom::Attrib attr, uint8_t dims, uint32_t firstVertex, uint32_t *pCount, size_t *pStride, size_t *pBufferIndex, uint64_t *pBegin )
+{
+	geom::AttribInfo attribInfo;
+	VkFormat		 format		 = VK_FORMAT_UNDEFINED;
+	size_t			 bufferIndex = findDynamicAttrib( attr, &attribInfo, &format );
+	if ( format != vk::toVkFormat( geom::AttribInfo( attr, geom::FLOAT, dims, 0, 0, 0 ) ) ) {
+		throw VulkanExc( "mapped attribute type doesn't match the attribute's format" );
+	}
+
+	uint32_t count = ( *pCount > 0 ) ? *pCount : ( mNumVertices - std::min( firstVertex, mNumVertices ) );
+	if ( ( count == 0 ) || ( ( static_cast<uint64_t>( firstVertex ) + count ) > mNumVertices ) ) {
+		throw VulkanExc( "mapped attribute range is out of bounds" );
+	}
+
+	const size_t   stride = attribInfo.getStride();
+	const uint64_t begin  = attribInfo.getOffset() + firstVertex * stride;
+
+	*pCount		  = count;
+	*pStride	  = stride;
+	*pBufferIndex = bufferIndex;
+	*pBegin		  = begin;
+	return mDynamicBuffers[bufferIndex].shadow.data() + begin;
+}
+
+void BufferedMesh::appendInstanceBuffer( const Layout &layout, const vk::BufferRef &buffer )
+{
+	if ( !buffer ) {
+		throw VulkanExc( "instance buffer is null" );
+	}
+
+	// Planar layouts need the element count to compute attribute offsets
+	size_t bytesPerInstance = 0;
+	for ( const auto &attrib : layout.getAttribs() ) {
+		bytesPerInstance += vk::formatSize( layout.getFormat( attrib ) );
+	}
+	if ( bytesPerInstance == 0 ) {
+		throw VulkanExc( "instance buffer layout has no attributes" );
+	}
+	const size_t numInstances = static_cast<size_t>( buffer->getSize() / bytesPerInstance );
+
+	geom::BufferLayout bufferLayout;
+	vk::BufferRef	   instanceBuffer = buffer;
+	layout.allocate( getDevice(), numInstances, &bufferLayout, &instanceBuffer );
+	mInstanceBuffers.push_back( std::make_pair( bufferLayout, instanceBuffer ) );
+
+	std::vector<VkFormat> formats;
+	for ( const auto &attribInfo : bufferLayout.getAttribs() ) {
+		formats.push_back( layout.getFormat( attribInfo ) );
+	}
+	mInstanceFormats.push_back( formats );
+}
+
 uint8_t BufferedMesh::getAttribDims( geom::Attrib attr ) const
 {
 	for ( const auto &vertexBuffer : mVertexBuffers ) {
@@ -476,4 +1156,197 @@ uint8_t BufferedMesh::getAttribDims( geom::Attrib attr ) const
 	return 0;
 }
 
+vk::VertexEncoding BufferedMesh::getAttribEncoding( geom::Attrib attr ) const
+{
+	for ( const auto &layout : mVertexLayouts ) {
+		if ( layout.hasAttrib( attr ) ) {
+			return layout.getEncoding( attr );
+		}
+	}
+	return vk::VertexEncoding::FLOAT32;
+}
+
+float BufferedMesh::getAttribEncodingScale( geom::Attrib attr ) const
+{
+	for ( const auto &layout : mVertexLayouts ) {
+		if ( layout.hasAttrib( attr ) ) {
+			return layout.getEncodingScale( attr );
+		}
+	}
+	return 1.0f;
+}
+
+void BufferedMesh::save( const fs::path &path ) const
+{
+	MeshFileHeader header	 = {};
+	header.magic			 = kMeshFileMagic;
+	header.version			 = kMeshFileVersion;
+	header.numVertices		 = mNumVertices;
+	header.numIndices		 = mIndices ? mNumIndices : 0;
+	header.primitive		 = static_cast<uint32_t>( mPrimitive );
+	header.indexType		 = static_cast<uint32_t>( mIndexType );
+	header.vertexBufferCount = static_cast<uint32_t>( mVertexBuffers.size() );
+
+	std::vector<MeshFileVertexBuffer> vertexBuffers;
+	std::vector<MeshFileAttrib>		  attribs;
+	for ( size_t i = 0; i < mVertexBuffers.size(); ++i ) {
+		const auto &bufferLayout = mVertexBuffers[i].first;
+
+		MeshFileVertexBuffer vertexBuffer = {};
+		vertexBuffer.interleave			  = mVertexLayouts[i].getInterleave() ? 1 : 0;
+		vertexBuffer.firstAttrib		  = static_cast<uint32_t>( attribs.size() );
+		vertexBuffer.attribCount		  = static_cast<uint32_t>( bufferLayout.getAttribs().size() );
+		vertexBuffer.dataSize			  = isDynamic() ? mDynamicBuffers[i].shadow.size() : mVertexBuffers[i].second->getSize();
+		vertexBuffers.push_back( vertexBuffer );
+
+		for ( const auto &attribInfo : bufferLayout.getAttribs() ) {
+			MeshFileAttrib attrib = {};
+			attrib.attrib		  = static_cast<uint32_t>( attribInfo.getAttrib() );
+			attrib.dims			  = attribInfo.getDims();
+			attrib.encoding		  = static_cast<uint32_t>( mVertexLayouts[i].getEncoding( attribInfo.getAttrib() ) );
+			attrib.scale		  = mVertexLayouts[i].getEncodingScale( attribInfo.getAttrib() );
+			attrib.offset		  = attribInfo.getOffset();
+			attrib.stride		  = attribInfo.getStride();
+			attribs.push_back( attrib );
+		}
+	}
+	header.attribCount = static_cast<uint32_t>( attribs.size() );
+
+	// Lay out the buffer data after the tables, each on its own page
+	uint64_t offset = sizeof( MeshFileHeader ) + vertexBuffers.size() * sizeof( MeshFileVertexBuffer ) + attribs.size() * sizeof( MeshFileAttrib );
+	for ( auto &vertexBuffer : vertexBuffers ) {
+		vertexBuffer.dataOffset = alignFileOffset( offset );
+		offset					= vertexBuffer.dataOffset + vertexBuffer.dataSize;
+	}
+	if ( header.numIndices > 0 ) {
+		header.indexDataOffset = alignFileOffset( offset );
+		header.indexDataSize   = header.numIndices * ( ( mIndexType == VK_INDEX_TYPE_UINT16 ) ? sizeof( uint16_t ) : sizeof( uint32_t ) );
+	}
+
+	std::error_code ec;
+	fs::create_directories( path.parent_path(), ec );
+
+	// Write to a temporary file first so that concurrent loads never see a
+	// partial file, each saver gets its own so they can't interleave
+	const fs::path tmpPath = uniqueTempPath( path );
+
+	std::ofstream os( tmpPath, std::ios::binary );
+	if ( !os ) {
+		throw VulkanExc( "failed to open mesh file for writing: " + tmpPath.string() );
+	}
+	os.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+	os.write( reinterpret_cast<const char *>( vertexBuffers.data() ), vertexBuffers.size() * sizeof( MeshFileVertexBuffer ) );
+	os.write( reinterpret_cast<const char *>( attribs.data() ), attribs.size() * sizeof( MeshFileAttrib ) );
+	offset = sizeof( MeshFileHeader ) + vertexBuffers.size() * sizeof( MeshFileVertexBuffer ) + attribs.size() * sizeof( MeshFileAttrib );
+	for ( size_t i = 0; i < vertexBuffers.size(); ++i ) {
+		writePadding( os, offset );
+		if ( isDynamic() ) {
+			os.write( reinterpret_cast<const char *>( mDynamicBuffers[i].shadow.data() ), vertexBuffers[i].dataSize );
+		}
+		else {
+			writeBufferData( mVertexBuffers[i].second.get(), vertexBuffers[i].dataSize, os );
+		}
+		offset = vertexBuffers[i].dataOffset + vertexBuffers[i].dataSize;
+	}
+	if ( header.numIndices > 0 ) {
+		writePadding( os, offset );
+		writeBufferData( mIndices.get(), header.indexDataSize, os );
+	}
+	os.close();
+	if ( !os ) {
+		fs::remove( tmpPath, ec );
+		throw VulkanExc( "failed to write mesh file: " + tmpPath.string() );
+	}
+
+	fs::rename( tmpPath, path, ec );
+	if ( ec ) {
+		fs::remove( tmpPath, ec );
+		throw VulkanExc( "failed to rename mesh file: " + path.string() );
+	}
+}
+
+vk::BufferedMeshRef BufferedMesh::load( const fs::path &path, vk::DeviceRef device )
+{
+	if ( !device ) {
+		device = app::RendererVk::getCurrentRenderer()->getDevice();
+	}
+
+	MappedFile	   file( path );
+	const uint8_t *pFileData	= file.getData();
+	const size_t   fileDataSize = file.getSize();
+
+	MeshFileHeader header = readValue<MeshFileHeader>( pFileData, fileDataSize, 0 );
+	if ( header.magic != kMeshFileMagic ) {
+		throw VulkanExc( "not a mesh file: " + path.string() );
+	}
+	if ( header.version != kMeshFileVersion ) {
+		throw VulkanExc( "unsupported mesh file version: " + std::to_string( header.version ) );
+	}
+	if ( ( header.indexType != VK_INDEX_TYPE_UINT16 ) && ( header.indexType != VK_INDEX_TYPE_UINT32 ) ) {
+		throw VulkanExc( "invalid mesh file index type" );
+	}
+
+	auto checkRange = [fileDataSize]( uint64_t offset, uint64_t size ) {
+		if ( ( offset > fileDataSize ) || ( size > ( fileDataSize - offset ) ) ) {
+			throw VulkanExc( "mesh file is truncated" );
+		}
+	};
+
+	vk::BufferedMeshRef mesh = vk::BufferedMeshRef( new vk::BufferedMesh( device ) );
+	mesh->mNumVertices		 = header.numVertices;
+	mesh->mNumIndices		 = header.numIndices;
+	mesh->mPrimitive		 = static_cast<VkPrimitiveTopology>( header.primitive );
+	mesh->mIndexType		 = static_cast<VkIndexType>( header.indexType );
+
+	const size_t attribTableOffset = sizeof( MeshFileHeader ) + header.vertexBufferCount * sizeof( MeshFileVertexBuffer );
+	for ( uint32_t i = 0; i < header.vertexBufferCount; ++i ) {
+		auto vertexBuffer = readValue<MeshFileVertexBuffer>( pFileData, fileDataSize, sizeof( MeshFileHeader ) + i * sizeof( MeshFileVertexBuffer ) );
+		checkRange( vertexBuffer.dataOffset, vertexBuffer.dataSize );
+
+		Layout						  layout = Layout().interleave( vertexBuffer.interleave != 0 );
+		std::vector<geom::AttribInfo> attribInfos;
+		for ( uint32_t j = 0; j < vertexBuffer.attribCount; ++j ) {
+			auto attrib = readValue<MeshFileAttrib>( pFileData, fileDataSize, attribTableOffset + ( vertexBuffer.firstAttrib + j ) * sizeof( MeshFileAttrib ) );
+
+			geom::Attrib	   semantic = static_cast<geom::Attrib>( attrib.attrib );
+			vk::VertexEncoding encoding = static_cast<vk::VertexEncoding>( attrib.encoding );
+			if ( encoding != vk::VertexEncoding::FLOAT32 ) {
+				layout.attrib( semantic, static_cast<uint8_t>( attrib.dims ), encoding, attrib.scale );
+			}
+			else {
+				layout.attrib( semantic, static_cast<uint8_t>( attrib.dims ) );
+			}
+			attribInfos.push_back( geom::AttribInfo( semantic, attrib.dims, attrib.stride, attrib.offset ) );
+		}
+
+		// Straight from the mapped file into the staging buffer
+		vk::Buffer::Usage usage	 = vk::Buffer::Usage().vertexBuffer().transferSrc().transferDst();
+		vk::BufferRef	  buffer = vk::Buffer::create( vertexBuffer.dataSize, usage, vk::MemoryUsage::GPU_ONLY, vk::Buffer::Options(), device );
+		device->copyToBuffer( vertexBuffer.dataSize, pFileData + vertexBuffer.dataOffset, buffer.get() );
+
+		geom::BufferLayout	  bufferLayout( attribInfos );
+		std::vector<VkFormat> formats;
+		for ( const auto &attribInfo : bufferLayout.getAttribs() ) {
+			formats.push_back( layout.getFormat( attribInfo ) );
+		}
+		mesh->mVertexBuffers.push_back( std::make_pair( bufferLayout, buffer ) );
+		mesh->mVertexLayouts.push_back( layout );
+		mesh->mVertexFormats.push_back( formats );
+	}
+
+	if ( header.numIndices > 0 ) {
+		const uint64_t indexSize = ( header.indexType == VK_INDEX_TYPE_UINT16 ) ? sizeof( uint16_t ) : sizeof( uint32_t );
+		if ( header.indexDataSize < ( header.numIndices * indexSize ) ) {
+			throw VulkanExc( "mesh file is truncated" );
+		}
+		checkRange( header.indexDataOffset, header.indexDataSize );
+
+		vk::Buffer::Usage usage = vk::Buffer::Usage().indexBuffer().transferSrc().transferDst();
+		mesh->mIndices			= vk::Buffer::create( header.indexDataSize, usage, vk::MemoryUsage::GPU_ONLY, vk::Buffer::Options(), device );
+		device->copyToBuffer( header.indexDataSize, pFileData + header.indexDataOffset, mesh->mIndices.get() );
+	}
+
+	return mesh;
+}
+
 } // namespace cinder::vk
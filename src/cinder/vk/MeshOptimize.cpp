@@ -0,0 +1,330 @@
+#include "cinder/vk/MeshOptimize.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace cinder::vk {
+
+namespace {
+
+//! Simulates a FIFO post transform cache with time stamps: a vertex is
+//! in the cache if fewer than cacheSize misses happened since it was
+//! last transformed.
+struct FifoCache
+{
+	FifoCache( uint32_t numVertices, uint32_t cacheSize )
+		: stamps( numVertices, 0 ), size( cacheSize ), time( cacheSize + 1 ) {}
+
+	//! Returns true on a miss
+	bool access( uint32_t vertex )
+	{
+		if ( ( time - stamps[vertex] ) > size ) {
+			stamps[vertex] = time++;
+			return true;
+		}
+		return false;
+	}
+
+	//! Evicts every vertex
+	void flush() { time += size + 1; }
+
+	std::vector<uint32_t> stamps;
+	uint32_t			  size;
+	uint32_t			  time;
+};
+
+//! Triangles adjacent to each vertex in compressed row form
+struct Adjacency
+{
+	Adjacency( const uint32_t *pIndices, size_t numIndices, uint32_t numVertices )
+		: counts( numVertices, 0 ), offsets( numVertices + 1, 0 ), triangles( numIndices )
+	{
+		for ( size_t i = 0; i < numIndices; ++i ) {
+			++counts[pIndices[i]];
+		}
+
+		for ( uint32_t i = 0; i < numVertices; ++i ) {
+			offsets[i + 1] = offsets[i] + counts[i];
+		}
+
+		std::vector<uint32_t> cursor( offsets.begin(), offsets.end() - 1 );
+		for ( size_t i = 0; i < numIndices; ++i ) {
+			triangles[cursor[pIndices[i]]++] = static_cast<uint32_t>( i / 3 );
+		}
+	}
+
+	std::vector<uint32_t> counts;
+	std::vector<uint32_t> offsets;
+	std::vector<uint32_t> triangles;
+};
+
+} // namespace
+
+float calcAcmr( const uint32_t *pIndices, size_t numIndices, uint32_t numVertices, uint32_t cacheSize )
+{
+	if ( numIndices < 3 ) {
+		return 0.0f;
+	}
+
+	FifoCache cache( numVertices, cacheSize );
+	size_t	  misses = 0;
+	for ( size_t i = 0; i < numIndices; ++i ) {
+		misses += cache.access( pIndices[i] ) ? 1 : 0;
+	}
+
+	return static_cast<float>( misses ) / static_cast<float>( numIndices / 3 );
+}
+
+float calcAtvr( const uint32_t *pIndices, size_t numIndices, uint32_t numVertices, uint32_t cacheSize )
+{
+	if ( numVertices == 0 ) {
+		return 0.0f;
+	}
+
+	return calcAcmr( pIndices, numIndices, numVertices, cacheSize ) * static_cast<float>( numIndices / 3 ) / static_cast<float>( numVertices );
+}
+
+void optimizeVertexCache( uint32_t *pIndices, size_t numIndices, uint32_t numVertices, uint32_t cacheSize, std::vector<uint32_t> *pClusters )
+{
+	const size_t numTriangles = numIndices / 3;
+	if ( pClusters ) {
+		pClusters->clear();
+	}
+	if ( ( numTriangles == 0 ) || ( numVertices == 0 ) ) {
+		return;
+	}
+
+	const Adjacency adjacency( pIndices, numIndices, numVertices );
+
+	std::vector<uint32_t> liveTriangles = adjacency.counts;
+	std::vector<uint32_t> cacheTime( numVertices, 0 );
+	std::vector<bool>	  emitted( numTriangles, false );
+	std::vector<uint32_t> deadEnd;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> output;
+	output.reserve( numTriangles * 3 );
+
+	uint32_t time		= cacheSize + 1;
+	uint32_t scanCursor = 0;
+
+	// Returns the next vertex with live triangles from the dead end stack,
+	// or in input order if the stack runs dry. The cache is cold at this
+	// point so it starts a new cluster.
+	auto skipDeadEnd = [&]() -> int64_t {
+		while ( !deadEnd.empty() ) {
+			uint32_t vertex = deadEnd.back();
+			deadEnd.pop_back();
+			if ( liveTriangles[vertex] > 0 ) {
+				return vertex;
+			}
+		}
+		while ( scanCursor < numVertices ) {
+			if ( liveTriangles[scanCursor] > 0 ) {
+				return scanCursor;
+			}
+			++scanCursor;
+		}
+		return -1;
+	};
+
+	int64_t fanning = skipDeadEnd();
+	while ( fanning >= 0 ) {
+		if ( pClusters && ( output.empty() || candidates.empty() ) ) {
+			pClusters->push_back( static_cast<uint32_t>( output.size() / 3 ) );
+		}
+
+		// Emit every remaining triangle around the fanning vertex
+		candidates.clear();
+		const uint32_t fanVertex = static_cast<uint32_t>( fanning );
+		for ( uint32_t i = adjacency.offsets[fanVertex]; i < adjacency.offsets[fanVertex + 1]; ++i ) {
+			const uint32_t triangle = adjacency.triangles[i];
+			if ( emitted[triangle] ) {
+				continue;
+			}
+
+			for ( uint32_t j = 0; j < 3; ++j ) {
+				const uint32_t vertex = pIndices[triangle * 3 + j];
+				output.push_back( vertex );
+				deadEnd.push_back( vertex );
+				candidates.push_back( vertex );
+				--liveTriangles[vertex];
+				if ( ( time - cacheTime[vertex] ) > cacheSize ) {
+					cacheTime[vertex] = time++;
+				}
+			}
+			emitted[triangle] = true;
+		}
+
+		// Prefer the oldest candidate that will still be in the cache
+		// after its remaining triangles are emitted. As in Tipsify's
+		// getNextVertex the best priority starts below 0, so any live
+		// candidate is taken before falling back to the dead end stack.
+		int64_t next		 = -1;
+		int64_t bestPriority = -1;
+		for ( uint32_t vertex : candidates ) {
+			if ( liveTriangles[vertex] == 0 ) {
+				continue;
+			}
+
+			int64_t priority = 0;
+			if ( ( ( time - cacheTime[vertex] ) + 2 * liveTriangles[vertex] ) <= cacheSize ) {
+				priority = time - cacheTime[vertex];
+			}
+			if ( priority > bestPriority ) {
+				next		 = vertex;
+				bestPriority = priority;
+			}
+		}
+
+		if ( next < 0 ) {
+			next = skipDeadEnd();
+			candidates.clear();
+		}
+
+		fanning = next;
+	}
+
+	std::copy( output.begin(), output.end(), pIndices );
+}
+
+void optimizeOverdraw(
+	uint32_t					*pIndices,
+	size_t						 numIndices,
+	const float					*pPositions,
+	uint32_t					 positionDims,
+	uint32_t					 numVertices,
+	const std::vector<uint32_t> &clusters,
+	uint32_t					 cacheSize,
+	float						 threshold )
+{
+	const uint32_t numTriangles = static_cast<uint32_t>( numIndices / 3 );
+	if ( ( numTriangles == 0 ) || ( positionDims < 2 ) ) {
+		return;
+	}
+
+	auto position = [&]( uint32_t vertex ) -> vec3 {
+		const float *p = pPositions + static_cast<size_t>( vertex ) * positionDims;
+		return vec3( p[0], p[1], ( positionDims > 2 ) ? p[2] : 0.0f );
+	};
+
+	// Split the cold start clusters wherever the piece so far already has
+	// an ACMR close to the whole list's; restarting there costs little.
+	std::vector<uint32_t> hardClusters = clusters;
+	if ( hardClusters.empty() || ( hardClusters[0] != 0 ) ) {
+		hardClusters.insert( hardClusters.begin(), 0 );
+	}
+	hardClusters.push_back( numTriangles );
+
+	const float targetAcmr = calcAcmr( pIndices, numIndices, numVertices, cacheSize ) * threshold;
+
+	std::vector<uint32_t> softClusters;
+	FifoCache			  cache( numVertices, cacheSize );
+	for ( size_t i = 0; ( i + 1 ) < hardClusters.size(); ++i ) {
+		const uint32_t begin = hardClusters[i];
+		const uint32_t end	 = hardClusters[i + 1];
+		if ( begin >= end ) {
+			continue;
+		}
+
+		softClusters.push_back( begin );
+		cache.flush();
+
+		uint32_t misses		  = 0;
+		uint32_t numClustered = 0;
+		for ( uint32_t triangle = begin; triangle < end; ++triangle ) {
+			for ( uint32_t j = 0; j < 3; ++j ) {
+				misses += cache.access( pIndices[triangle * 3 + j] ) ? 1 : 0;
+			}
+			++numClustered;
+
+			if ( ( ( triangle + 1 ) < end ) && ( static_cast<float>( misses ) <= ( targetAcmr * static_cast<float>( numClustered ) ) ) ) {
+				softClusters.push_back( triangle + 1 );
+				cache.flush();
+				misses		 = 0;
+				numClustered = 0;
+			}
+		}
+	}
+	softClusters.push_back( numTriangles );
+
+	// Area weighted centroid and normal of each cluster
+	const size_t	  numClusters = softClusters.size() - 1;
+	std::vector<vec3> centroids( numClusters, vec3( 0.0f ) );
+	std::vector<vec3> normals( numClusters, vec3( 0.0f ) );
+	vec3			  meshCentroid = vec3( 0.0f );
+	float			  meshArea	   = 0.0f;
+	for ( size_t i = 0; i < numClusters; ++i ) {
+		float clusterArea = 0.0f;
+		for ( uint32_t triangle = softClusters[i]; triangle < softClusters[i + 1]; ++triangle ) {
+			const vec3 p0 = position( pIndices[triangle * 3 + 0] );
+			const vec3 p1 = position( pIndices[triangle * 3 + 1] );
+			const vec3 p2 = position( pIndices[triangle * 3 + 2] );
+
+			const vec3	cross = glm::cross( p1 - p0, p2 - p0 );
+			const float area  = glm::length( cross );
+			const vec3	mid	  = ( p0 + p1 + p2 ) / 3.0f;
+
+			centroids[i] += mid * area;
+			normals[i] += cross;
+			clusterArea += area;
+		}
+
+		meshCentroid += centroids[i];
+		meshArea += clusterArea;
+		centroids[i] = ( clusterArea > 0.0f ) ? ( centroids[i] / clusterArea ) : vec3( 0.0f );
+	}
+	meshCentroid = ( meshArea > 0.0f ) ? ( meshCentroid / meshArea ) : vec3( 0.0f );
+
+	// Clusters facing away from the center are likely in front of the
+	// rest of the mesh, draw those first.
+	std::vector<float> sortKeys( numClusters, 0.0f );
+	for ( size_t i = 0; i < numClusters; ++i ) {
+		const float length = glm::length( normals[i] );
+		if ( length > 0.0f ) {
+			sortKeys[i] = glm::dot( centroids[i] - meshCentroid, normals[i] / length );
+		}
+	}
+
+	std::vector<uint32_t> order( numClusters );
+	std::iota( order.begin(), order.end(), 0 );
+	std::stable_sort(
+		order.begin(),
+		order.end(),
+		[&sortKeys]( uint32_t a, uint32_t b ) -> bool {
+			return sortKeys[a] > sortKeys[b];
+		} );
+
+	std::vector<uint32_t> output;
+	output.reserve( numTriangles * 3 );
+	for ( uint32_t cluster : order ) {
+		output.insert( output.end(), pIndices + softClusters[cluster] * 3, pIndices + softClusters[cluster + 1] * 3 );
+	}
+
+	std::copy( output.begin(), output.end(), pIndices );
+}
+
+std::vector<uint32_t> optimizeVertexFetch( uint32_t *pIndices, size_t numIndices, uint32_t numVertices )
+{
+	const uint32_t kUnused = UINT32_MAX;
+
+	std::vector<uint32_t> remap( numVertices, kUnused );
+	uint32_t			  nextVertex = 0;
+	for ( size_t i = 0; i < numIndices; ++i ) {
+		uint32_t &newIndex = remap[pIndices[i]];
+		if ( newIndex == kUnused ) {
+			newIndex = nextVertex++;
+		}
+		pIndices[i] = newIndex;
+	}
+
+	for ( auto &newIndex : remap ) {
+		if ( newIndex == kUnused ) {
+			newIndex = nextVertex++;
+		}
+	}
+
+	return remap;
+}
+
+} // namespace cinder::vk
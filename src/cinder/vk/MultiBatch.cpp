@@ -0,0 +1,422 @@
+#include "cinder/vk/MultiBatch.h"
+#include "cinder/vk/Context.h"
+#include "cinder/vk/ShaderProg.h"
+#include "cinder/vk/Util.h"
+#include "cinder/vk/wrapper.h"
+#include "cinder/app/RendererVk.h"
+#include "cinder/Log.h"
+
+#include <cstring>
+#include <limits>
+
+namespace cinder::vk {
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// MultiBatch::PackingTarget
+
+//! Writes a source's attributes into the packed attribute arrays at a vertex offset
+class MultiBatch::PackingTarget : public geom::Target
+{
+public:
+	PackingTarget( MultiBatch *pBatch, uint32_t vertexOffset, uint32_t numVertices )
+		: mBatch( pBatch ), mVertexOffset( vertexOffset ), mNumVertices( numVertices ) {}
+
+	uint8_t getAttribDims( geom::Attrib attr ) const override
+	{
+		auto it = mBatch->mAttribs.find( attr );
+		return ( it != mBatch->mAttribs.end() ) ? it->second.dims : 0;
+	}
+
+	void copyAttrib( geom::Attrib attr, uint8_t dims, size_t /*strideBytes*/, const float *srcData, size_t count ) override
+	{
+		auto it = mBatch->mAttribs.find( attr );
+		if ( it == mBatch->mAttribs.end() ) {
+			return;
+		}
+
+		if ( count != mNumVertices ) {
+			CI_LOG_E( "copyAttrib() called with " << count << " elements. " << mNumVertices << " expected." );
+			return;
+		}
+
+		auto  &packed  = it->second;
+		float *dstData = packed.data.data() + static_cast<size_t>( mVertexOffset ) * packed.dims;
+		geom::copyData( dims, srcData, count, packed.dims, 0, dstData );
+	}
+
+	void copyIndices( geom::Primitive /*primitive*/, const uint32_t *source, size_t numIndices, uint8_t /*requiredBytesPerIndex*/ ) override
+	{
+		mBatch->mIndices.insert( mBatch->mIndices.end(), source, source + numIndices );
+	}
+
+private:
+	MultiBatch *mBatch;
+	uint32_t	mVertexOffset;
+	uint32_t	mNumVertices;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// MultiBatch::PackedSource
+
+//! Presents the packed arrays as a single geom::Source so BufferedMesh can upload them
+class MultiBatch::PackedSource : public geom::Source
+{
+public:
+	PackedSource( const MultiBatch *pBatch )
+		: mBatch( pBatch ) {}
+
+	size_t			getNumVertices() const override { return mBatch->mNumVertices; }
+	size_t			getNumIndices() const override { return mBatch->mIndices.size(); }
+	geom::Primitive getPrimitive() const override { return geom::TRIANGLES; }
+	PackedSource   *clone() const override { return new PackedSource( *this ); }
+
+	uint8_t getAttribDims( geom::Attrib attr ) const override
+	{
+		auto it = mBatch->mAttribs.find( attr );
+		return ( it != mBatch->mAttribs.end() ) ? it->second.dims : 0;
+	}
+
+	geom::AttribSet getAvailableAttribs() const override
+	{
+		geom::AttribSet attribs;
+		for ( const auto &it : mBatch->mAttribs ) {
+			attribs.insert( it.first );
+		}
+		return attribs;
+	}
+
+	void loadInto( geom::Target *target, const geom::AttribSet &requestedAttribs ) const override
+	{
+		for ( const auto &it : mBatch->mAttribs ) {
+			if ( requestedAttribs.count( it.first ) > 0 ) {
+				target->copyAttrib( it.first, it.second.dims, 0, it.second.data.data(), mBatch->mNumVertices );
+			}
+		}
+
+		// Indices are relative to each mesh's vertex offset so the
+		// index size only depends on the largest mesh.
+		//
+		const uint8_t bytesPerIndex = ( mBatch->mMaxMeshVertices <= 65536 ) ? 2 : 4;
+		target->copyIndices( geom::TRIANGLES, mBatch->mIndices.data(), mBatch->mIndices.size(), bytesPerIndex );
+	}
+
+private:
+	const MultiBatch *mBatch;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// MultiBatch
+
+MultiBatchRef MultiBatch::create( const vk::ShaderProgRef &shaderProg, uint32_t transformsBinding, vk::DeviceRef device )
+{
+	if ( !device ) {
+		device = app::RendererVk::getCurrentRenderer()->getDevice();
+	}
+
+	return MultiBatchRef( new MultiBatch( device, shaderProg, transformsBinding ) );
+}
+
+MultiBatch::MultiBatch( vk::DeviceRef device, const vk::ShaderProgRef &shaderProg, uint32_t transformsBinding )
+	: vk::DeviceChildObject( device ),
+	  mShaderProg( shaderProg ),
+	  mTransformsBinding( transformsBinding )
+{
+	// Every packed mesh shares one layout derived from the shader
+	// program. Attributes a source doesn't provide are filled with
+	// defaults so all meshes stay compatible.
+	//
+	const auto &shaderAttribs = shaderProg->getVertexAttributes();
+	for ( auto &attrib : shaderAttribs ) {
+		geom::Attrib semantic = attrib.getSemantic();
+		if ( semantic == geom::Attrib::USER_DEFINED ) {
+			CI_LOG_W( "MultiBatch skipping vertex attribute with unknown semantic" );
+			continue;
+		}
+
+		uint8_t dims = static_cast<uint8_t>( vk::formatComponentCount( attrib.getFormat() ) );
+		mLayout.attrib( semantic, dims );
+		mAttribs[semantic].dims = dims;
+	}
+}
+
+MultiBatch::~MultiBatch()
+{
+}
+
+uint32_t MultiBatch::addMesh( const geom::Source &source )
+{
+	if ( source.getPrimitive() != geom::TRIANGLES ) {
+		throw VulkanExc( "MultiBatch only supports geom::TRIANGLES sources" );
+	}
+
+	const uint32_t numVertices	= static_cast<uint32_t>( source.getNumVertices() );
+	const uint32_t vertexOffset = mNumVertices;
+	const uint32_t firstIndex	= countU32( mIndices );
+
+	// Grow the packed arrays and fill them with default values
+	geom::AttribSet requestedAttribs;
+	for ( auto &it : mAttribs ) {
+		const float defaultValue = ( it.first == geom::COLOR ) ? 1.0f : 0.0f;
+		it.second.data.resize( static_cast<size_t>( vertexOffset + numVertices ) * it.second.dims, defaultValue );
+
+		if ( source.getAttribDims( it.first ) > 0 ) {
+			requestedAttribs.insert( it.first );
+		}
+	}
+
+	PackingTarget target( this, vertexOffset, numVertices );
+	source.loadInto( &target, requestedAttribs );
+
+	// Non-indexed sources get a trivial index list
+	if ( countU32( mIndices ) == firstIndex ) {
+		for ( uint32_t i = 0; i < numVertices; ++i ) {
+			mIndices.push_back( i );
+		}
+	}
+
+	MeshRange range		 = {};
+	range.firstIndex	 = firstIndex;
+	range.indexCount	 = countU32( mIndices ) - firstIndex;
+	range.vertexOffset	 = static_cast<int32_t>( vertexOffset );
+	range.boundingSphere = calcBoundingSphere( vertexOffset, numVertices );
+	mMeshes.push_back( range );
+
+	mNumVertices += numVertices;
+	mMaxMeshVertices = std::max( mMaxMeshVertices, numVertices );
+	mMeshDirty		 = true;
+	++mDrawsVersion;
+
+	return countU32( mMeshes ) - 1;
+}
+
+vec4 MultiBatch::calcBoundingSphere( uint32_t vertexOffset, uint32_t numVertices ) const
+{
+	auto it = mAttribs.find( geom::POSITION );
+	if ( ( it == mAttribs.end() ) || ( numVertices == 0 ) ) {
+		return vec4( 0.0f );
+	}
+
+	// Sphere around the bounding box, looser than a minimal sphere but
+	// cheap and good enough for culling.
+	//
+	const uint8_t dims	= std::min<uint8_t>( it->second.dims, 3 );
+	const float	 *pData = it->second.data.data() + static_cast<size_t>( vertexOffset ) * it->second.dims;
+
+	vec3 minPos = vec3( std::numeric_limits<float>::max() );
+	vec3 maxPos = vec3( -std::numeric_limits<float>::max() );
+	for ( uint32_t i = 0; i < numVertices; ++i, pData += it->second.dims ) {
+		vec3 pos = vec3( 0.0f );
+		for ( uint8_t j = 0; j < dims; ++j ) {
+			pos[j] = pData[j];
+		}
+		minPos = glm::min( minPos, pos );
+		maxPos = glm::max( maxPos, pos );
+	}
+
+	const vec3 center = 0.5f * ( minPos + maxPos );
+	return vec4( center, glm::length( maxPos - center ) );
+}
+
+uint32_t MultiBatch::addDraw( uint32_t meshIndex, const mat4 &transform )
+{
+	if ( meshIndex >= countU32( mMeshes ) ) {
+		throw VulkanExc( "MultiBatch mesh index out of range" );
+	}
+
+	mDraws.push_back( { meshIndex, transform } );
+	++mDrawsVersion;
+	++mTransformsVersion;
+
+	return countU32( mDraws ) - 1;
+}
+
+void MultiBatch::setTransform( uint32_t drawIndex, const mat4 &transform )
+{
+	if ( drawIndex >= countU32( mDraws ) ) {
+		throw VulkanExc( "MultiBatch draw index out of range" );
+	}
+
+	mDraws[drawIndex].transform = transform;
+	++mTransformsVersion;
+}
+
+const mat4 &MultiBatch::getTransform( uint32_t drawIndex ) const
+{
+	if ( drawIndex >= countU32( mDraws ) ) {
+		throw VulkanExc( "MultiBatch draw index out of range" );
+	}
+
+	return mDraws[drawIndex].transform;
+}
+
+vk::BufferedMeshRef MultiBatch::getMesh()
+{
+	updateMesh();
+	return mMesh;
+}
+
+void MultiBatch::updateMesh()
+{
+	if ( !mMeshDirty ) {
+		return;
+	}
+
+	mMesh	   = vk::BufferedMesh::create( PackedSource( this ), mLayout, getDevice() );
+	mMeshDirty = false;
+}
+
+static void writeMappedBuffer( vk::BufferRef &buffer, const vk::Buffer::Usage &usage, uint64_t size, const void *pData, vk::DeviceRef device )
+{
+	if ( !buffer || ( buffer->getSize() < size ) ) {
+		vk::Buffer::Options options = vk::Buffer::Options().persisentMap();
+		buffer						= vk::Buffer::create( size, usage, vk::MemoryUsage::CPU_TO_GPU, options, device );
+	}
+
+	void *pMappedAddress = nullptr;
+	buffer->map( &pMappedAddress );
+	std::memcpy( pMappedAddress, pData, static_cast<size_t>( size ) );
+	buffer->unmap();
+}
+
+const MultiBatch::DrawBuffers &MultiBatch::updateDrawBuffers( vk::Context *ctx )
+{
+	// One set per frame in flight like the transforms, earlier frames may
+	// still be reading the commands and cull inputs they were drawn with.
+	//
+	const uint32_t numFrames = ctx->getNumFramesInFlight();
+	if ( countU32( mDrawBuffers ) != numFrames ) {
+		mDrawBuffers.assign( numFrames, DrawBuffers() );
+	}
+
+	DrawBuffers &buffers = mDrawBuffers[ctx->getFrameIndex()];
+	if ( buffers.drawsVersion == mDrawsVersion ) {
+		return buffers;
+	}
+
+	std::vector<VkDrawIndexedIndirectCommand> commands( mDraws.size() );
+	for ( uint32_t i = 0; i < countU32( mDraws ); ++i ) {
+		const MeshRange &mesh = mMeshes[mDraws[i].meshIndex];
+
+		commands[i].indexCount	  = mesh.indexCount;
+		commands[i].instanceCount = 1;
+		commands[i].firstIndex	  = mesh.firstIndex;
+		commands[i].vertexOffset  = mesh.vertexOffset;
+		// Lets the shader index the transforms with gl_InstanceIndex
+		commands[i].firstInstance = i;
+	}
+
+	writeMappedBuffer( buffers.indirect, vk::Buffer::Usage().indirectBuffer(), commands.size() * sizeof( VkDrawIndexedIndirectCommand ), commands.data(), getDevice() );
+
+	// Cull inputs, same commands plus each mesh's bounds
+	if ( mCuller ) {
+		std::vector<vk::GpuCuller::Object> objects( mDraws.size() );
+		for ( uint32_t i = 0; i < countU32( mDraws ); ++i ) {
+			objects[i].boundingSphere = mMeshes[mDraws[i].meshIndex].boundingSphere;
+			objects[i].command		  = commands[i];
+		}
+
+		writeMappedBuffer( buffers.cullObjects, vk::Buffer::Usage().storageBuffer(), objects.size() * sizeof( vk::GpuCuller::Object ), objects.data(), getDevice() );
+	}
+
+	buffers.drawsVersion = mDrawsVersion;
+	return buffers;
+}
+
+vk::Buffer *MultiBatch::updateTransformBuffer( vk::Context *ctx )
+{
+	// One buffer per frame in flight so transforms can be rewritten
+	// without waiting on frames the GPU is still reading from.
+	//
+	const uint32_t numFrames = ctx->getNumFramesInFlight();
+	if ( countU32( mTransformBuffers ) != numFrames ) {
+		mTransformBuffers.assign( numFrames, vk::BufferRef() );
+		mTransformBufferVersions.assign( numFrames, 0 );
+	}
+
+	const uint32_t frameIndex = ctx->getFrameIndex();
+	auto		  &buffer	  = mTransformBuffers[frameIndex];
+
+	const uint64_t size = mDraws.size() * sizeof( mat4 );
+	if ( !buffer || ( buffer->getSize() < size ) ) {
+		vk::Buffer::Usage	usage	= vk::Buffer::Usage().storageBuffer();
+		vk::Buffer::Options options = vk::Buffer::Options().persisentMap();
+		buffer						= vk::Buffer::create( size, usage, vk::MemoryUsage::CPU_TO_GPU, options, getDevice() );
+
+		mTransformBufferVersions[frameIndex] = 0;
+	}
+
+	if ( mTransformBufferVersions[frameIndex] != mTransformsVersion ) {
+		void *pMappedAddress = nullptr;
+		buffer->map( &pMappedAddress );
+
+		mat4 *pTransforms = static_cast<mat4 *>( pMappedAddress );
+		for ( const auto &draw : mDraws ) {
+			*pTransforms++ = draw.transform;
+		}
+
+		buffer->unmap();
+
+		mTransformBufferVersions[frameIndex] = mTransformsVersion;
+	}
+
+	return buffer.get();
+}
+
+void MultiBatch::draw()
+{
+	if ( mDraws.empty() ) {
+		return;
+	}
+
+	updateMesh();
+
+	auto ctx = vk::context();
+	ctx->flushShapes();
+
+	const DrawBuffers &drawBuffers	   = updateDrawBuffers( ctx );
+	vk::Buffer		  *transformBuffer = updateTransformBuffer( ctx );
+
+	// Culling records compute work so it has to happen before the
+	// graphics state below is bound.
+	//
+	if ( mCuller ) {
+		mCuller->cull( ctx, drawBuffers.cullObjects.get(), transformBuffer, getNumDraws(), vk::getModelViewProjection() );
+	}
+
+	ctx->bindShaderProg( mShaderProg );
+	ctx->setDefaultShaderVars();
+	ctx->bindStorageBuffer( transformBuffer, mTransformsBinding );
+	ctx->bindDefaultDescriptorSet();
+	// Descriptor set has been written, don't leak the binding into later draws
+	ctx->unbindStorageBuffer( mTransformsBinding );
+	ctx->bindIndexBuffers( mMesh );
+	ctx->bindVertexBuffers( mMesh );
+	ctx->bindGraphicsPipeline();
+	if ( mCuller ) {
+		mCuller->drawIndirect( ctx );
+	}
+	else {
+		ctx->drawIndexedIndirect( drawBuffers.indirect, 0, getNumDraws() );
+	}
+}
+
+void MultiBatch::enableGpuCulling( const vk::GpuCuller::Options &options )
+{
+	if ( mAttribs.find( geom::POSITION ) == mAttribs.end() ) {
+		throw VulkanExc( "MultiBatch GPU culling requires a POSITION attribute" );
+	}
+
+	mCuller = vk::GpuCuller::create( options, getDevice() );
+	// Builds the cull inputs on the next draw
+	++mDrawsVersion;
+}
+
+void MultiBatch::disableGpuCulling()
+{
+	mCuller.reset();
+	for ( auto &buffers : mDrawBuffers ) {
+		buffers.cullObjects.reset();
+	}
+}
+
+} // namespace cinder::vk
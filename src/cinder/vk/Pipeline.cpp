@@ -192,9 +192,24 @@ vk::PipelineRef Pipeline::create( const vk::Pipeline::GraphicsPipelineCreateInfo
 	return vk::PipelineRef( new vk::Pipeline( device, createInfo ) );
 }
 
+vk::PipelineRef Pipeline::create( const vk::Pipeline::ComputePipelineCreateInfo &createInfo, vk::DeviceRef device )
+{
+	if ( !device ) {
+		device = app::RendererVk::getCurrentRenderer()->getDevice();
+	}
+
+	return vk::PipelineRef( new vk::Pipeline( device, createInfo ) );
+}
+
 uint64_t Pipeline::calculateHash( const vk::Pipeline::GraphicsPipelineCreateInfo* createInfo )
 {
-	XXH64_hash_t hash = XXH64( createInfo, sizeof( createInfo ), 0xF33DC0D3 );
+	XXH64_hash_t hash = XXH64( createInfo, sizeof( *createInfo ), 0xF33DC0D3 );
+	return static_cast<uint64_t>( hash );
+}
+
+uint64_t Pipeline::calculateHash( const vk::Pipeline::ComputePipelineCreateInfo *createInfo )
+{
+	XXH64_hash_t hash = XXH64( createInfo, sizeof( *createInfo ), 0xC0C0C0D3 );
 	return static_cast<uint64_t>( hash );
 }
 
@@ -204,6 +219,12 @@ Pipeline::Pipeline( vk::DeviceRef device, const GraphicsPipelineCreateInfo &crea
 	initGraphicsPipeline( createInfo );
 }
 
+Pipeline::Pipeline( vk::DeviceRef device, const ComputePipelineCreateInfo &createInfo )
+	: vk::DeviceChildObject( device )
+{
+	initComputePipeline( createInfo );
+}
+
 Pipeline::~Pipeline()
 {
 	if ( mPipelineHandle ) {
@@ -641,4 +662,36 @@ void Pipeline::initGraphicsPipeline( const GraphicsPipelineCreateInfo &createInf
 	// }
 }
 
+void Pipeline::initComputePipeline( const ComputePipelineCreateInfo &createInfo )
+{
+	if ( ( createInfo.comp == nullptr ) || ( createInfo.pipelineLayout == nullptr ) ) {
+		throw VulkanExc( "compute pipeline requires a compute shader and a pipeline layout" );
+	}
+
+	VkComputePipelineCreateInfo vkci = { VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+	vkci.pNext						 = nullptr;
+	vkci.flags						 = 0;
+	vkci.stage.sType				 = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	vkci.stage.pNext				 = nullptr;
+	vkci.stage.flags				 = 0;
+	vkci.stage.stage				 = VK_SHADER_STAGE_COMPUTE_BIT;
+	vkci.stage.module				 = createInfo.comp->getShaderModuleHandle();
+	vkci.stage.pName				 = createInfo.comp->getEntryPoint().c_str();
+	vkci.stage.pSpecializationInfo	 = nullptr;
+	vkci.layout						 = createInfo.pipelineLayout->getPipelineLayoutHandle();
+	vkci.basePipelineHandle			 = VK_NULL_HANDLE;
+	vkci.basePipelineIndex			 = -1;
+
+	VkResult vkres = CI_VK_DEVICE_FN( CreateComputePipelines(
+		getDeviceHandle(),
+		VK_NULL_HANDLE,
+		1,
+		&vkci,
+		nullptr,
+		&mPipelineHandle ) );
+	if ( vkres != VK_SUCCESS ) {
+		throw VulkanFnFailedExc( "vkCreateComputePipelines", vkres );
+	}
+}
+
 } // namespace cinder::vk
@@ -0,0 +1,55 @@
+#include "cinder/vk/Query.h"
+#include "cinder/vk/Device.h"
+#include "cinder/app/RendererVk.h"
+
+namespace cinder::vk {
+
+QueryPoolRef QueryPool::create( VkQueryType queryType, uint32_t queryCount, vk::DeviceRef device )
+{
+	if ( !device ) {
+		device = app::RendererVk::getCurrentRenderer()->getDevice();
+	}
+
+	return QueryPoolRef( new QueryPool( device, queryType, queryCount ) );
+}
+
+QueryPool::QueryPool( vk::DeviceRef device, VkQueryType queryType, uint32_t queryCount )
+	: vk::DeviceChildObject( device ),
+	  mQueryType( queryType ),
+	  mQueryCount( queryCount )
+{
+	VkQueryPoolCreateInfo vkci = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+	vkci.pNext				   = nullptr;
+	vkci.flags				   = 0;
+	vkci.queryType			   = queryType;
+	vkci.queryCount			   = queryCount;
+	vkci.pipelineStatistics	   = 0;
+
+	VkResult vkres = CI_VK_DEVICE_FN( CreateQueryPool( getDeviceHandle(), &vkci, nullptr, &mQueryPoolHandle ) );
+	if ( vkres != VK_SUCCESS ) {
+		throw VulkanFnFailedExc( "vkCreateQueryPool", vkres );
+	}
+}
+
+QueryPool::~QueryPool()
+{
+	if ( mQueryPoolHandle != VK_NULL_HANDLE ) {
+		CI_VK_DEVICE_FN( DestroyQueryPool( getDeviceHandle(), mQueryPoolHandle, nullptr ) );
+		mQueryPoolHandle = VK_NULL_HANDLE;
+	}
+}
+
+VkResult QueryPool::getResults( uint32_t firstQuery, uint32_t queryCount, uint64_t *pResults ) const
+{
+	return CI_VK_DEVICE_FN( GetQueryPoolResults(
+		getDeviceHandle(),
+		mQueryPoolHandle,
+		firstQuery,
+		queryCount,
+		queryCount * sizeof( uint64_t ),
+		pResults,
+		sizeof( uint64_t ),
+		VK_QUERY_RESULT_64_BIT ) );
+}
+
+} // namespace cinder::vk
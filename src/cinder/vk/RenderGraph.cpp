@@ -0,0 +1,969 @@
+#include "cinder/vk/RenderGraph.h"
+#include "cinder/vk/Buffer.h"
+#include "cinder/vk/Command.h"
+#include "cinder/vk/Context.h"
+#include "cinder/vk/Device.h"
+#include "cinder/vk/Image.h"
+#include "cinder/vk/Texture.h"
+#include "cinder/app/RendererVk.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace cinder::vk {
+
+static VkPipelineStageFlags2KHR shaderStages( RenderGraph::PassType type )
+{
+	switch ( type ) {
+		case RenderGraph::PassType::GRAPHICS: return VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR;
+		case RenderGraph::PassType::COMPUTE: return VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR;
+		default: break;
+	}
+	throw VulkanExc( "transfer passes can't access resources from shaders" );
+}
+
+static VkImageUsageFlags imageUsage( VkImageLayout layout )
+{
+	switch ( layout ) {
+		case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: return VK_IMAGE_USAGE_SAMPLED_BIT;
+		case VK_IMAGE_LAYOUT_GENERAL: return VK_IMAGE_USAGE_STORAGE_BIT;
+		case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL: return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		default: break;
+	}
+	return 0;
+}
+
+static const char *layoutName( VkImageLayout layout )
+{
+	switch ( layout ) {
+		case VK_IMAGE_LAYOUT_UNDEFINED: return "UNDEFINED";
+		case VK_IMAGE_LAYOUT_GENERAL: return "GENERAL";
+		case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: return "COLOR_ATTACHMENT_OPTIMAL";
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: return "DEPTH_STENCIL_ATTACHMENT_OPTIMAL";
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL: return "DEPTH_STENCIL_READ_ONLY_OPTIMAL";
+		case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: return "SHADER_READ_ONLY_OPTIMAL";
+		case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL: return "TRANSFER_SRC_OPTIMAL";
+		case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: return "TRANSFER_DST_OPTIMAL";
+		case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR: return "PRESENT_SRC";
+		default: break;
+	}
+	return "<other>";
+}
+
+static const char *loadOpName( VkAttachmentLoadOp loadOp )
+{
+	switch ( loadOp ) {
+		case VK_ATTACHMENT_LOAD_OP_LOAD: return "LOAD";
+		case VK_ATTACHMENT_LOAD_OP_CLEAR: return "CLEAR";
+		case VK_ATTACHMENT_LOAD_OP_DONT_CARE: return "DONT_CARE";
+		default: break;
+	}
+	return "<other>";
+}
+
+static const char *storeOpName( VkAttachmentStoreOp storeOp )
+{
+	switch ( storeOp ) {
+		case VK_ATTACHMENT_STORE_OP_STORE: return "STORE";
+		case VK_ATTACHMENT_STORE_OP_DONT_CARE: return "DONT_CARE";
+		default: break;
+	}
+	return "<other>";
+}
+
+static const char *passTypeName( RenderGraph::PassType type )
+{
+	switch ( type ) {
+		case RenderGraph::PassType::GRAPHICS: return "GRAPHICS";
+		case RenderGraph::PassType::COMPUTE: return "COMPUTE";
+		case RenderGraph::PassType::TRANSFER: return "TRANSFER";
+	}
+	return "<other>";
+}
+
+template <typename FlagsT>
+static std::string flagNames( FlagsT flags, const std::vector<std::pair<FlagsT, const char *>> &names )
+{
+	if ( flags == 0 ) {
+		return "NONE";
+	}
+
+	std::string result;
+	for ( const auto &name : names ) {
+		if ( ( flags & name.first ) == name.first ) {
+			result += ( result.empty() ? "" : "|" ) + std::string( name.second );
+			flags &= ~name.first;
+		}
+	}
+	if ( flags != 0 ) {
+		std::stringstream ss;
+		ss << std::hex << "0x" << static_cast<uint64_t>( flags );
+		result += ( result.empty() ? "" : "|" ) + ss.str();
+	}
+	return result;
+}
+
+static std::string stageNames( VkPipelineStageFlags2KHR stages )
+{
+	static const std::vector<std::pair<VkPipelineStageFlags2KHR, const char *>> sNames = {
+		{ VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR, "ALL_COMMANDS" },
+		{ VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT_KHR, "DRAW_INDIRECT" },
+		{ VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT_KHR, "INDEX_INPUT" },
+		{ VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT_KHR, "VERTEX_ATTRIBUTE_INPUT" },
+		{ VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT_KHR, "VERTEX_SHADER" },
+		{ VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR, "EARLY_FRAGMENT_TESTS" },
+		{ VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR, "FRAGMENT_SHADER" },
+		{ VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR, "LATE_FRAGMENT_TESTS" },
+		{ VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, "COLOR_ATTACHMENT_OUTPUT" },
+		{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, "COMPUTE_SHADER" },
+		{ VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR, "TRANSFER" },
+	};
+	return flagNames( stages, sNames );
+}
+
+static std::string accessNames( VkAccessFlags2KHR access )
+{
+	static const std::vector<std::pair<VkAccessFlags2KHR, const char *>> sNames = {
+		{ VK_ACCESS_2_MEMORY_READ_BIT_KHR, "MEMORY_READ" },
+		{ VK_ACCESS_2_MEMORY_WRITE_BIT_KHR, "MEMORY_WRITE" },
+		{ VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT_KHR, "INDIRECT_COMMAND_READ" },
+		{ VK_ACCESS_2_INDEX_READ_BIT_KHR, "INDEX_READ" },
+		{ VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT_KHR, "VERTEX_ATTRIBUTE_READ" },
+		{ VK_ACCESS_2_UNIFORM_READ_BIT_KHR, "UNIFORM_READ" },
+		{ VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR, "SHADER_SAMPLED_READ" },
+		{ VK_ACCESS_2_SHADER_STORAGE_READ_BIT_KHR, "SHADER_STORAGE_READ" },
+		{ VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR, "SHADER_STORAGE_WRITE" },
+		{ VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT_KHR, "COLOR_ATTACHMENT_READ" },
+		{ VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR, "COLOR_ATTACHMENT_WRITE" },
+		{ VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR, "DEPTH_STENCIL_ATTACHMENT_READ" },
+		{ VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR, "DEPTH_STENCIL_ATTACHMENT_WRITE" },
+		{ VK_ACCESS_2_TRANSFER_READ_BIT_KHR, "TRANSFER_READ" },
+		{ VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR, "TRANSFER_WRITE" },
+	};
+	return flagNames( access, sNames );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// RenderGraph::ImageDesc
+
+bool RenderGraph::ImageDesc::operator==( const ImageDesc &rhs ) const
+{
+	return ( mExtent.width == rhs.mExtent.width ) &&
+		   ( mExtent.height == rhs.mExtent.height ) &&
+		   ( mExtent.depth == rhs.mExtent.depth ) &&
+		   ( mFormat == rhs.mFormat ) &&
+		   ( mSamples == rhs.mSamples ) &&
+		   ( mMipLevels == rhs.mMipLevels );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// RenderGraph::PassBuilder
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::image( ImageHandle handle, VkPipelineStageFlags2KHR stageMask, VkAccessFlags2KHR accessMask, VkImageLayout layout )
+{
+	mGraph->checkImage( handle );
+
+	Pass &pass = mGraph->getPass( mPassIndex );
+	if ( ( pass.type == PassType::GRAPHICS ) && ( stageMask & VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR ) ) {
+		throw VulkanExc( "graphics pass '" + pass.name + "' can't record transfers" );
+	}
+
+	auto it = std::find_if( pass.imageAccesses.begin(), pass.imageAccesses.end(), [handle]( const Access &access ) { return access.resource == handle.index; } );
+	if ( it == pass.imageAccesses.end() ) {
+		pass.imageAccesses.push_back( Access{ handle.index, stageMask, accessMask, layout } );
+	}
+	else {
+		if ( it->layout != layout ) {
+			throw VulkanExc( "pass '" + pass.name + "' accesses image '" + mGraph->mImages[handle.index].name + "' in two layouts" );
+		}
+		it->stageMask |= stageMask;
+		it->accessMask |= accessMask;
+	}
+
+	mGraph->mCompiled = false;
+	return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::buffer( BufferHandle handle, VkPipelineStageFlags2KHR stageMask, VkAccessFlags2KHR accessMask )
+{
+	mGraph->checkBuffer( handle );
+
+	Pass &pass = mGraph->getPass( mPassIndex );
+	if ( ( pass.type == PassType::GRAPHICS ) && ( stageMask & VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR ) ) {
+		throw VulkanExc( "graphics pass '" + pass.name + "' can't record transfers" );
+	}
+
+	auto it = std::find_if( pass.bufferAccesses.begin(), pass.bufferAccesses.end(), [handle]( const Access &access ) { return access.resource == handle.index; } );
+	if ( it == pass.bufferAccesses.end() ) {
+		pass.bufferAccesses.push_back( Access{ handle.index, stageMask, accessMask, VK_IMAGE_LAYOUT_UNDEFINED } );
+	}
+	else {
+		it->stageMask |= stageMask;
+		it->accessMask |= accessMask;
+	}
+
+	mGraph->mCompiled = false;
+	return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::colorAttachment( ImageHandle handle, VkAttachmentLoadOp loadOp, const VkClearColorValue &clearValue )
+{
+	Pass &pass = mGraph->getPass( mPassIndex );
+	if ( pass.type != PassType::GRAPHICS ) {
+		throw VulkanExc( "pass '" + pass.name + "' isn't a graphics pass and can't have attachments" );
+	}
+	if ( pass.colorAttachments.size() >= CINDER_MAX_RENDER_TARGETS ) {
+		throw VulkanExc( "pass '" + pass.name + "' exceeds the maximum number of color attachments" );
+	}
+
+	VkAccessFlags2KHR accessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR;
+	if ( loadOp == VK_ATTACHMENT_LOAD_OP_LOAD ) {
+		accessMask |= VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT_KHR;
+	}
+	image( handle, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, accessMask, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL );
+
+	Attachment attachment		= {};
+	attachment.image			= handle.index;
+	attachment.loadOp			= loadOp;
+	attachment.clearValue.color = clearValue;
+	pass.colorAttachments.push_back( attachment );
+
+	return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::depthStencilAttachment( ImageHandle handle, VkAttachmentLoadOp loadOp, float depthClearValue, uint32_t stencilClearValue )
+{
+	Pass &pass = mGraph->getPass( mPassIndex );
+	if ( pass.type != PassType::GRAPHICS ) {
+		throw VulkanExc( "pass '" + pass.name + "' isn't a graphics pass and can't have attachments" );
+	}
+	if ( pass.depthStencilAttachment.image != UINT32_MAX ) {
+		throw VulkanExc( "pass '" + pass.name + "' already has a depth stencil attachment" );
+	}
+
+	// Depth testing reads the attachment whatever the load op is
+	image(
+		handle,
+		VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR,
+		VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL );
+
+	Attachment &attachment					   = pass.depthStencilAttachment;
+	attachment								   = {};
+	attachment.image						   = handle.index;
+	attachment.loadOp						   = loadOp;
+	attachment.clearValue.depthStencil.depth   = depthClearValue;
+	attachment.clearValue.depthStencil.stencil = stencilClearValue;
+
+	return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::sampledImage( ImageHandle handle )
+{
+	return image( handle, shaderStages( mGraph->getPass( mPassIndex ).type ), VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::storageImage( ImageHandle handle, bool write )
+{
+	VkAccessFlags2KHR accessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT_KHR | ( write ? VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR : 0 );
+	return image( handle, shaderStages( mGraph->getPass( mPassIndex ).type ), accessMask, VK_IMAGE_LAYOUT_GENERAL );
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::storageBuffer( BufferHandle handle, bool write )
+{
+	VkAccessFlags2KHR accessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT_KHR | ( write ? VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR : 0 );
+	return buffer( handle, shaderStages( mGraph->getPass( mPassIndex ).type ), accessMask );
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::uniformBuffer( BufferHandle handle )
+{
+	return buffer( handle, shaderStages( mGraph->getPass( mPassIndex ).type ), VK_ACCESS_2_UNIFORM_READ_BIT_KHR );
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::vertexBuffer( BufferHandle handle )
+{
+	return buffer( handle, VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT_KHR, VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT_KHR );
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::indexBuffer( BufferHandle handle )
+{
+	return buffer( handle, VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT_KHR, VK_ACCESS_2_INDEX_READ_BIT_KHR );
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::indirectBuffer( BufferHandle handle )
+{
+	return buffer( handle, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT_KHR, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT_KHR );
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::transferSrc( ImageHandle handle )
+{
+	return image( handle, VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR, VK_ACCESS_2_TRANSFER_READ_BIT_KHR, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL );
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::transferDst( ImageHandle handle )
+{
+	return image( handle, VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR, VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL );
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::transferSrc( BufferHandle handle )
+{
+	return buffer( handle, VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR, VK_ACCESS_2_TRANSFER_READ_BIT_KHR );
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::transferDst( BufferHandle handle )
+{
+	return buffer( handle, VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR, VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// RenderGraph
+
+RenderGraphRef RenderGraph::create( vk::DeviceRef device )
+{
+	if ( !device ) {
+		device = app::RendererVk::getCurrentRenderer()->getDevice();
+	}
+
+	return RenderGraphRef( new RenderGraph( device ) );
+}
+
+RenderGraph::RenderGraph( vk::DeviceRef device )
+	: vk::DeviceChildObject( device )
+{
+}
+
+RenderGraph::~RenderGraph()
+{
+}
+
+RenderGraph::Pass &RenderGraph::getPass( uint32_t passIndex )
+{
+	return mPasses[passIndex];
+}
+
+void RenderGraph::checkImage( ImageHandle handle ) const
+{
+	if ( handle.index >= countU32( mImages ) ) {
+		throw VulkanExc( "invalid render graph image handle" );
+	}
+}
+
+void RenderGraph::checkBuffer( BufferHandle handle ) const
+{
+	if ( handle.index >= countU32( mBuffers ) ) {
+		throw VulkanExc( "invalid render graph buffer handle" );
+	}
+}
+
+RenderGraph::ImageHandle RenderGraph::createImage( const std::string &name, const ImageDesc &desc )
+{
+	if ( ( desc.mExtent.width == 0 ) || ( desc.mExtent.height == 0 ) || ( desc.mFormat == VK_FORMAT_UNDEFINED ) ) {
+		throw VulkanExc( "render graph image '" + name + "' needs an extent and a format" );
+	}
+
+	ImageResource resource = {};
+	resource.name		   = name;
+	resource.desc		   = desc;
+	mImages.push_back( resource );
+
+	mCompiled = false;
+	return ImageHandle{ countU32( mImages ) - 1 };
+}
+
+RenderGraph::ImageHandle RenderGraph::importImage( const std::string &name, const vk::ImageRef &image, VkImageLayout initialLayout, VkImageLayout finalLayout )
+{
+	ImageResource resource = {};
+	resource.name		   = name;
+	resource.imported	   = true;
+	resource.initialLayout = initialLayout;
+	resource.finalLayout   = ( finalLayout != VK_IMAGE_LAYOUT_UNDEFINED ) ? finalLayout : initialLayout;
+	mImages.push_back( resource );
+
+	ImageHandle handle = ImageHandle{ countU32( mImages ) - 1 };
+	setImportedImage( handle, image );
+
+	mCompiled = false;
+	return handle;
+}
+
+RenderGraph::ImageHandle RenderGraph::importTexture( const std::string &name, const vk::TextureBaseRef &texture )
+{
+	if ( !texture ) {
+		throw VulkanExc( "render graph texture '" + name + "' is null" );
+	}
+
+	ImageResource resource = {};
+	resource.name		   = name;
+	resource.imported	   = true;
+	resource.texture	   = texture;
+	resource.pImage		   = texture->getImage();
+	resource.initialLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	resource.finalLayout   = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	resource.view		   = vk::ImageView::create( resource.pImage->getImageHandle(), resource.pImage->getSamples(), vk::ImageView::Options( resource.pImage ), getDevice() );
+	mImages.push_back( resource );
+
+	mCompiled = false;
+	return ImageHandle{ countU32( mImages ) - 1 };
+}
+
+RenderGraph::BufferHandle RenderGraph::importBuffer( const std::string &name, const vk::BufferRef &buffer )
+{
+	if ( !buffer ) {
+		throw VulkanExc( "render graph buffer '" + name + "' is null" );
+	}
+
+	BufferResource resource = {};
+	resource.name			= name;
+	resource.buffer			= buffer;
+	mBuffers.push_back( resource );
+
+	mCompiled = false;
+	return BufferHandle{ countU32( mBuffers ) - 1 };
+}
+
+void RenderGraph::setImportedImage( ImageHandle handle, const vk::ImageRef &image )
+{
+	checkImage( handle );
+
+	ImageResource &resource = mImages[handle.index];
+	if ( !resource.imported || resource.texture ) {
+		throw VulkanExc( "render graph image '" + resource.name + "' wasn't declared with importImage()" );
+	}
+	if ( !image ) {
+		throw VulkanExc( "render graph image '" + resource.name + "' is null" );
+	}
+
+	if ( resource.image != image ) {
+		resource.image	= image;
+		resource.pImage = image.get();
+		resource.view	= vk::ImageView::create( image, getDevice() );
+	}
+}
+
+void RenderGraph::setImportedBuffer( BufferHandle handle, const vk::BufferRef &buffer )
+{
+	checkBuffer( handle );
+
+	if ( !buffer ) {
+		throw VulkanExc( "render graph buffer '" + mBuffers[handle.index].name + "' is null" );
+	}
+
+	mBuffers[handle.index].buffer = buffer;
+}
+
+RenderGraph::PassBuilder RenderGraph::addPass( const std::string &name, PassType type, ExecuteFn fn )
+{
+	Pass pass = {};
+	pass.name = name;
+	pass.type = type;
+	pass.fn	  = fn;
+	mPasses.push_back( pass );
+
+	mCompiled = false;
+	return PassBuilder( this, countU32( mPasses ) - 1 );
+}
+
+void RenderGraph::computeLifetimes()
+{
+	for ( auto &image : mImages ) {
+		image.firstPass = UINT32_MAX;
+		image.lastPass	= UINT32_MAX;
+		image.usage		= 0;
+	}
+	for ( auto &buffer : mBuffers ) {
+		buffer.firstPass = UINT32_MAX;
+		buffer.lastPass	 = UINT32_MAX;
+	}
+
+	for ( uint32_t passIndex = 0; passIndex < countU32( mPasses ); ++passIndex ) {
+		const Pass &pass = mPasses[passIndex];
+		if ( ( pass.type == PassType::GRAPHICS ) && pass.colorAttachments.empty() && ( pass.depthStencilAttachment.image == UINT32_MAX ) ) {
+			throw VulkanExc( "graphics pass '" + pass.name + "' has no attachments" );
+		}
+
+		for ( const auto &access : pass.imageAccesses ) {
+			ImageResource &image = mImages[access.resource];
+			if ( !image.imported && ( image.firstPass == UINT32_MAX ) && ( ( access.accessMask & vk::AccessState::WRITE_ACCESS_MASK ) == 0 ) ) {
+				throw VulkanExc( "pass '" + pass.name + "' reads image '" + image.name + "' before any pass writes it" );
+			}
+
+			image.firstPass = std::min( image.firstPass, passIndex );
+			image.lastPass	= passIndex;
+			image.usage |= imageUsage( access.layout );
+		}
+
+		for ( const auto &access : pass.bufferAccesses ) {
+			BufferResource &buffer = mBuffers[access.resource];
+			buffer.firstPass	   = std::min( buffer.firstPass, passIndex );
+			buffer.lastPass		   = passIndex;
+		}
+	}
+
+	// Attachments only need to be stored if something reads them later
+	for ( uint32_t passIndex = 0; passIndex < countU32( mPasses ); ++passIndex ) {
+		Pass &pass = mPasses[passIndex];
+		for ( auto &attachment : pass.colorAttachments ) {
+			const ImageResource &image = mImages[attachment.image];
+			attachment.storeOp		   = ( image.imported || ( image.lastPass > passIndex ) ) ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		}
+		if ( pass.depthStencilAttachment.image != UINT32_MAX ) {
+			const ImageResource &image			= mImages[pass.depthStencilAttachment.image];
+			pass.depthStencilAttachment.storeOp	= ( image.imported || ( image.lastPass > passIndex ) ) ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		}
+	}
+}
+
+void RenderGraph::aliasTransientImages()
+{
+	std::vector<PhysicalImage> previousImages = std::move( mPhysicalImages );
+	mPhysicalImages.clear();
+
+	std::vector<uint32_t> transientImages;
+	for ( uint32_t imageIndex = 0; imageIndex < countU32( mImages ); ++imageIndex ) {
+		ImageResource &image = mImages[imageIndex];
+		if ( image.imported ) {
+			continue;
+		}
+
+		image.physical = UINT32_MAX;
+		image.pImage   = nullptr;
+		image.view.reset();
+
+		// Images no pass uses don't get memory
+		if ( image.firstPass != UINT32_MAX ) {
+			transientImages.push_back( imageIndex );
+		}
+	}
+
+	// Greedy interval assignment: each image takes the first compatible image
+	// that's free by the time its lifetime starts.
+	std::stable_sort( transientImages.begin(), transientImages.end(), [this]( uint32_t a, uint32_t b ) { return mImages[a].firstPass < mImages[b].firstPass; } );
+
+	for ( uint32_t imageIndex : transientImages ) {
+		ImageResource &image = mImages[imageIndex];
+
+		auto it = std::find_if( mPhysicalImages.begin(), mPhysicalImages.end(), [&image]( const PhysicalImage &physical ) { return ( physical.desc == image.desc ) && ( physical.lastPass < image.firstPass ); } );
+		if ( it == mPhysicalImages.end() ) {
+			PhysicalImage physical = {};
+			physical.desc		   = image.desc;
+			mPhysicalImages.push_back( physical );
+			it = mPhysicalImages.end() - 1;
+		}
+
+		it->usage |= image.usage;
+		it->lastPass = image.lastPass;
+		it->aliases.push_back( imageIndex );
+		image.physical = static_cast<uint32_t>( it - mPhysicalImages.begin() );
+	}
+
+	// Keep images from the last compile if they still fit
+	for ( auto &physical : mPhysicalImages ) {
+		auto previous = std::find_if( previousImages.begin(), previousImages.end(), [&physical]( const PhysicalImage &image ) { return image.image && ( image.desc == physical.desc ) && ( image.usage == physical.usage ); } );
+		if ( previous != previousImages.end() ) {
+			physical.image = std::move( previous->image );
+			physical.view  = std::move( previous->view );
+		}
+		else {
+			vk::Image::Options options = vk::Image::Options().samples( physical.desc.mSamples ).mipLevels( physical.desc.mMipLevels );
+			physical.image			   = vk::Image::create( VK_IMAGE_TYPE_2D, physical.desc.mExtent, physical.desc.mFormat, vk::Image::Usage( physical.usage ), vk::MemoryUsage::GPU_ONLY, options, getDevice() );
+			physical.view			   = vk::ImageView::create( physical.image, getDevice() );
+		}
+
+		for ( uint32_t imageIndex : physical.aliases ) {
+			mImages[imageIndex].pImage = physical.image.get();
+			mImages[imageIndex].view   = physical.view;
+		}
+
+		mStats.transientBytes += physical.image->getAllocationSize();
+	}
+
+	// Frames in flight may still use the images that weren't kept
+	auto retired = std::find_if( previousImages.begin(), previousImages.end(), []( const PhysicalImage &image ) { return image.image != nullptr; } );
+	if ( retired != previousImages.end() ) {
+		getDevice()->waitIdleGraphics();
+	}
+
+	mStats.numTransientImages = countU32( transientImages );
+	mStats.numAllocatedImages = countU32( mPhysicalImages );
+}
+
+void RenderGraph::placeBarriers()
+{
+	std::vector<State> imageStates( mImages.size() );
+	std::vector<State> physicalStates( mPhysicalImages.size() );
+	std::vector<State> bufferStates( mBuffers.size() );
+
+	// Imported resources may still be read by earlier work, so the first write
+	// or transition waits for everything. Writes made outside the graph have
+	// to be visible before execute().
+	for ( uint32_t imageIndex = 0; imageIndex < countU32( mImages ); ++imageIndex ) {
+		const ImageResource &image = mImages[imageIndex];
+		if ( image.imported ) {
+			imageStates[imageIndex].layout	   = image.initialLayout;
+			imageStates[imageIndex].readStages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR;
+		}
+	}
+	for ( auto &state : bufferStates ) {
+		state.readStages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR;
+	}
+
+	// Transient images are shared between frames in flight, the first use in a
+	// frame waits for the last use in the previous one. If that use wrote the
+	// image its writes have to be made available too.
+	for ( uint32_t physicalIndex = 0; physicalIndex < countU32( mPhysicalImages ); ++physicalIndex ) {
+		const PhysicalImage &physical = mPhysicalImages[physicalIndex];
+		const uint32_t		 last	  = physical.aliases.back();
+		const Pass			&pass	  = mPasses[mImages[last].lastPass];
+		State				&state	  = physicalStates[physicalIndex];
+		for ( const auto &access : pass.imageAccesses ) {
+			if ( access.resource != last ) {
+				continue;
+			}
+			if ( ( access.accessMask & vk::AccessState::WRITE_ACCESS_MASK ) != 0 ) {
+				state.writeStages |= access.stageMask;
+				state.writeAccess |= access.accessMask & vk::AccessState::WRITE_ACCESS_MASK;
+			}
+			else {
+				state.readStages |= access.stageMask;
+			}
+		}
+	}
+
+	for ( uint32_t passIndex = 0; passIndex < countU32( mPasses ); ++passIndex ) {
+		Pass &pass = mPasses[passIndex];
+		pass.barriers.clear();
+
+		for ( const auto &access : pass.imageAccesses ) {
+			const ImageResource &image = mImages[access.resource];
+
+			State &state = image.imported ? imageStates[access.resource] : physicalStates[image.physical];
+			if ( !image.imported && ( passIndex == image.firstPass ) ) {
+				// Whatever the previous alias left behind is discarded
+				state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			}
+
+			Barrier barrier	 = {};
+			barrier.resource = access.resource;
+			barrier.image	 = true;
+			if ( state.transition( access.layout, access.stageMask, access.accessMask, &barrier ) ) {
+				pass.barriers.push_back( barrier );
+			}
+		}
+
+		for ( const auto &access : pass.bufferAccesses ) {
+			Barrier barrier	 = {};
+			barrier.resource = access.resource;
+			barrier.image	 = false;
+			if ( bufferStates[access.resource].transition( VK_IMAGE_LAYOUT_UNDEFINED, access.stageMask, access.accessMask, &barrier ) ) {
+				pass.barriers.push_back( barrier );
+			}
+		}
+
+		if ( !pass.barriers.empty() ) {
+			++mStats.numBarrierBatches;
+		}
+	}
+
+	// Return imported resources to their final layout and make the graph's
+	// writes visible to whatever comes next, including the next frame.
+	mFinalBarriers.clear();
+	for ( uint32_t imageIndex = 0; imageIndex < countU32( mImages ); ++imageIndex ) {
+		const ImageResource &image = mImages[imageIndex];
+		const State			&state = imageStates[imageIndex];
+		if ( !image.imported || ( image.firstPass == UINT32_MAX ) ) {
+			continue;
+		}
+		if ( ( state.layout == image.finalLayout ) && ( state.writeAccess == 0 ) ) {
+			continue;
+		}
+
+		Barrier barrier		  = {};
+		barrier.resource	  = imageIndex;
+		barrier.image		  = true;
+		barrier.srcStageMask  = state.writeStages | state.readStages;
+		barrier.srcAccessMask = state.writeAccess;
+		barrier.dstStageMask  = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR;
+		barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT_KHR | VK_ACCESS_2_MEMORY_WRITE_BIT_KHR;
+		barrier.oldLayout	  = state.layout;
+		barrier.newLayout	  = image.finalLayout;
+		mFinalBarriers.push_back( barrier );
+	}
+	for ( uint32_t bufferIndex = 0; bufferIndex < countU32( mBuffers ); ++bufferIndex ) {
+		const State &state = bufferStates[bufferIndex];
+		if ( state.writeAccess == 0 ) {
+			continue;
+		}
+
+		Barrier barrier		  = {};
+		barrier.resource	  = bufferIndex;
+		barrier.image		  = false;
+		barrier.srcStageMask  = state.writeStages;
+		barrier.srcAccessMask = state.writeAccess;
+		barrier.dstStageMask  = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR;
+		barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT_KHR | VK_ACCESS_2_MEMORY_WRITE_BIT_KHR;
+		mFinalBarriers.push_back( barrier );
+	}
+	if ( !mFinalBarriers.empty() ) {
+		++mStats.numBarrierBatches;
+	}
+
+	for ( const auto &pass : mPasses ) {
+		for ( const auto &barrier : pass.barriers ) {
+			++( barrier.image ? mStats.numImageBarriers : mStats.numBufferBarriers );
+		}
+	}
+	for ( const auto &barrier : mFinalBarriers ) {
+		++( barrier.image ? mStats.numImageBarriers : mStats.numBufferBarriers );
+	}
+}
+
+void RenderGraph::compile()
+{
+	for ( const auto &image : mImages ) {
+		if ( image.imported && !image.pImage ) {
+			throw VulkanExc( "render graph image '" + image.name + "' is null" );
+		}
+	}
+
+	mStats			 = {};
+	mStats.numPasses = countU32( mPasses );
+
+	computeLifetimes();
+	aliasTransientImages();
+	placeBarriers();
+
+	mCompiled = true;
+}
+
+void RenderGraph::recordBarriers( vk::CommandBuffer *cmd, const std::vector<Barrier> &barriers )
+{
+	if ( barriers.empty() ) {
+		return;
+	}
+
+	mImageBarrierScratch.clear();
+	mBufferBarrierScratch.clear();
+
+	for ( const auto &barrier : barriers ) {
+		if ( barrier.image ) {
+			const vk::Image *pImage = mImages[barrier.resource].pImage;
+
+			VkImageMemoryBarrier2KHR vkimb		  = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR };
+			vkimb.pNext							  = nullptr;
+			vkimb.srcStageMask					  = barrier.srcStageMask;
+			vkimb.srcAccessMask					  = barrier.srcAccessMask;
+			vkimb.dstStageMask					  = barrier.dstStageMask;
+			vkimb.dstAccessMask					  = barrier.dstAccessMask;
+			vkimb.oldLayout						  = barrier.oldLayout;
+			vkimb.newLayout						  = barrier.newLayout;
+			vkimb.srcQueueFamilyIndex			  = VK_QUEUE_FAMILY_IGNORED;
+			vkimb.dstQueueFamilyIndex			  = VK_QUEUE_FAMILY_IGNORED;
+			vkimb.image							  = pImage->getImageHandle();
+			vkimb.subresourceRange.aspectMask	  = pImage->getAspectMask();
+			vkimb.subresourceRange.baseMipLevel	  = 0;
+			vkimb.subresourceRange.levelCount	  = VK_REMAINING_MIP_LEVELS;
+			vkimb.subresourceRange.baseArrayLayer = 0;
+			vkimb.subresourceRange.layerCount	  = VK_REMAINING_ARRAY_LAYERS;
+			mImageBarrierScratch.push_back( vkimb );
+		}
+		else {
+			VkBufferMemoryBarrier2KHR vkbmb = { VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR };
+			vkbmb.pNext						= nullptr;
+			vkbmb.srcStageMask				= barrier.srcStageMask;
+			vkbmb.srcAccessMask				= barrier.srcAccessMask;
+			vkbmb.dstStageMask				= barrier.dstStageMask;
+			vkbmb.dstAccessMask				= barrier.dstAccessMask;
+			vkbmb.srcQueueFamilyIndex		= VK_QUEUE_FAMILY_IGNORED;
+			vkbmb.dstQueueFamilyIndex		= VK_QUEUE_FAMILY_IGNORED;
+			vkbmb.buffer					= mBuffers[barrier.resource].buffer->getBufferHandle();
+			vkbmb.offset					= 0;
+			vkbmb.size						= VK_WHOLE_SIZE;
+			mBufferBarrierScratch.push_back( vkbmb );
+		}
+	}
+
+	VkDependencyInfoKHR dependencyInfo		= { VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR };
+	dependencyInfo.pNext					= nullptr;
+	dependencyInfo.dependencyFlags			= 0;
+	dependencyInfo.memoryBarrierCount		= 0;
+	dependencyInfo.pMemoryBarriers			= nullptr;
+	dependencyInfo.bufferMemoryBarrierCount = countU32( mBufferBarrierScratch );
+	dependencyInfo.pBufferMemoryBarriers	= dataPtr( mBufferBarrierScratch );
+	dependencyInfo.imageMemoryBarrierCount	= countU32( mImageBarrierScratch );
+	dependencyInfo.pImageMemoryBarriers		= dataPtr( mImageBarrierScratch );
+
+	cmd->pipelineBarrier2( dependencyInfo );
+}
+
+void RenderGraph::recordPass( vk::CommandBuffer *cmd, const Pass &pass )
+{
+	if ( pass.type != PassType::GRAPHICS ) {
+		if ( pass.fn ) {
+			pass.fn( cmd, *this );
+		}
+		return;
+	}
+
+	const uint32_t	 firstAttachment = pass.colorAttachments.empty() ? pass.depthStencilAttachment.image : pass.colorAttachments[0].image;
+	const VkRect2D &area			 = mImages[firstAttachment].pImage->getArea();
+
+	vk::CommandBuffer::RenderingInfo ri = vk::CommandBuffer::RenderingInfo( area );
+	for ( uint32_t i = 0; i < countU32( pass.colorAttachments ); ++i ) {
+		const Attachment &attachment = pass.colorAttachments[i];
+		ri.addColorAttachment( mImages[attachment.image].view );
+		ri.setColorAttachmentOps( i, attachment.loadOp, attachment.storeOp, attachment.clearValue.color );
+	}
+	if ( pass.depthStencilAttachment.image != UINT32_MAX ) {
+		const Attachment &attachment = pass.depthStencilAttachment;
+		ri.setDepthStencilAttachment( mImages[attachment.image].view );
+		ri.setDepthAttachmentOps( attachment.loadOp, attachment.storeOp, attachment.clearValue.depthStencil.depth );
+		ri.setStencilAttachmentOps( attachment.loadOp, attachment.storeOp, attachment.clearValue.depthStencil.stencil );
+	}
+
+	cmd->beginRendering( ri );
+	cmd->setViewport( static_cast<float>( area.offset.x ), static_cast<float>( area.offset.y ), static_cast<float>( area.extent.width ), static_cast<float>( area.extent.height ) );
+	cmd->setScissor( area.offset.x, area.offset.y, area.extent.width, area.extent.height );
+
+	if ( pass.fn ) {
+		pass.fn( cmd, *this );
+	}
+
+	cmd->endRendering();
+}
+
+void RenderGraph::execute( vk::Context *ctx )
+{
+	if ( !mCompiled ) {
+		compile();
+	}
+
+	ctx->suspendRendering();
+
+	vk::CommandBuffer *cmd = ctx->getCurrentCommandBuffer();
+	for ( const auto &pass : mPasses ) {
+		recordBarriers( cmd, pass.barriers );
+		recordPass( cmd, pass );
+	}
+	recordBarriers( cmd, mFinalBarriers );
+
+	ctx->resumeRendering();
+}
+
+const vk::Image *RenderGraph::getImage( ImageHandle handle ) const
+{
+	checkImage( handle );
+	return mImages[handle.index].pImage;
+}
+
+const vk::ImageView *RenderGraph::getImageView( ImageHandle handle ) const
+{
+	checkImage( handle );
+	return mImages[handle.index].view.get();
+}
+
+const vk::Buffer *RenderGraph::getBuffer( BufferHandle handle ) const
+{
+	checkBuffer( handle );
+	return mBuffers[handle.index].buffer.get();
+}
+
+std::string RenderGraph::toString() const
+{
+	auto resourceName = [this]( const Barrier &barrier ) -> const std::string & {
+		return barrier.image ? mImages[barrier.resource].name : mBuffers[barrier.resource].name;
+	};
+
+	auto writeBarriers = [&resourceName]( std::stringstream &ss, const std::vector<Barrier> &barriers ) {
+		for ( const auto &barrier : barriers ) {
+			ss << "    barrier " << resourceName( barrier ) << ": ";
+			if ( barrier.image ) {
+				ss << layoutName( barrier.oldLayout ) << " -> " << layoutName( barrier.newLayout ) << ", ";
+			}
+			ss << stageNames( barrier.srcStageMask ) << " (" << accessNames( barrier.srcAccessMask ) << ")";
+			ss << " -> " << stageNames( barrier.dstStageMask ) << " (" << accessNames( barrier.dstAccessMask ) << ")\n";
+		}
+	};
+
+	std::stringstream ss;
+	ss << "RenderGraph" << ( mCompiled ? "" : " (not compiled)" ) << ": ";
+	ss << mStats.numPasses << " passes, ";
+	ss << mStats.numImageBarriers << " image and " << mStats.numBufferBarriers << " buffer barriers in " << mStats.numBarrierBatches << " batches, ";
+	ss << mStats.numTransientImages << " transient images in " << mStats.numAllocatedImages << " allocations (" << mStats.transientBytes << " bytes)\n";
+
+	ss << "Images:\n";
+	for ( uint32_t imageIndex = 0; imageIndex < countU32( mImages ); ++imageIndex ) {
+		const ImageResource &image = mImages[imageIndex];
+		ss << "  [" << imageIndex << "] " << image.name << ": ";
+		if ( image.imported ) {
+			ss << "imported, " << layoutName( image.initialLayout ) << " -> " << layoutName( image.finalLayout );
+		}
+		else {
+			ss << image.desc.mExtent.width << "x" << image.desc.mExtent.height << " format " << image.desc.mFormat << " samples " << image.desc.mSamples;
+			if ( image.physical != UINT32_MAX ) {
+				ss << ", allocation " << image.physical;
+			}
+		}
+		if ( image.firstPass != UINT32_MAX ) {
+			ss << ", passes " << image.firstPass << "-" << image.lastPass;
+		}
+		else {
+			ss << ", unused";
+		}
+		ss << "\n";
+	}
+
+	ss << "Buffers:\n";
+	for ( uint32_t bufferIndex = 0; bufferIndex < countU32( mBuffers ); ++bufferIndex ) {
+		const BufferResource &buffer = mBuffers[bufferIndex];
+		ss << "  [" << bufferIndex << "] " << buffer.name;
+		if ( buffer.firstPass != UINT32_MAX ) {
+			ss << ": passes " << buffer.firstPass << "-" << buffer.lastPass;
+		}
+		else {
+			ss << ": unused";
+		}
+		ss << "\n";
+	}
+
+	ss << "Passes:\n";
+	for ( uint32_t passIndex = 0; passIndex < countU32( mPasses ); ++passIndex ) {
+		const Pass &pass = mPasses[passIndex];
+		ss << "  [" << passIndex << "] " << pass.name << " (" << passTypeName( pass.type ) << ")\n";
+		writeBarriers( ss, pass.barriers );
+		for ( const auto &attachment : pass.colorAttachments ) {
+			ss << "    color " << mImages[attachment.image].name << ": " << loadOpName( attachment.loadOp ) << "/" << storeOpName( attachment.storeOp ) << "\n";
+		}
+		if ( pass.depthStencilAttachment.image != UINT32_MAX ) {
+			const Attachment &attachment = pass.depthStencilAttachment;
+			ss << "    depth stencil " << mImages[attachment.image].name << ": " << loadOpName( attachment.loadOp ) << "/" << storeOpName( attachment.storeOp ) << "\n";
+		}
+		for ( const auto &access : pass.imageAccesses ) {
+			ss << "    image " << mImages[access.resource].name << ": " << stageNames( access.stageMask ) << " (" << accessNames( access.accessMask ) << ")\n";
+		}
+		for ( const auto &access : pass.bufferAccesses ) {
+			ss << "    buffer " << mBuffers[access.resource].name << ": " << stageNames( access.stageMask ) << " (" << accessNames( access.accessMask ) << ")\n";
+		}
+	}
+
+	if ( !mFinalBarriers.empty() ) {
+		ss << "Final:\n";
+		writeBarriers( ss, mFinalBarriers );
+	}
+
+	ss << "Aliasing:\n";
+	for ( uint32_t physicalIndex = 0; physicalIndex < countU32( mPhysicalImages ); ++physicalIndex ) {
+		const PhysicalImage &physical = mPhysicalImages[physicalIndex];
+		ss << "  allocation " << physicalIndex << " (" << ( physical.image ? physical.image->getAllocationSize() : 0 ) << " bytes):";
+		for ( uint32_t imageIndex : physical.aliases ) {
+			ss << " " << mImages[imageIndex].name;
+		}
+		ss << "\n";
+	}
+
+	return ss.str();
+}
+
+} // namespace cinder::vk
@@ -61,6 +61,16 @@ static std::map<std::string, geom::Attrib> sDefaultAttribNameToSemanticMap = {
 	{ "ciColor", geom::Attrib::COLOR },
 	{ "ciBoneIndex", geom::Attrib::BONE_INDEX },
 	{ "ciBoneWeight", geom::Attrib::BONE_WEIGHT },
+	{ "ciCustom0", geom::Attrib::CUSTOM_0 },
+	{ "ciCustom1", geom::Attrib::CUSTOM_1 },
+	{ "ciCustom2", geom::Attrib::CUSTOM_2 },
+	{ "ciCustom3", geom::Attrib::CUSTOM_3 },
+	{ "ciCustom4", geom::Attrib::CUSTOM_4 },
+	{ "ciCustom5", geom::Attrib::CUSTOM_5 },
+	{ "ciCustom6", geom::Attrib::CUSTOM_6 },
+	{ "ciCustom7", geom::Attrib::CUSTOM_7 },
+	{ "ciCustom8", geom::Attrib::CUSTOM_8 },
+	{ "ciCustom9", geom::Attrib::CUSTOM_9 },
 	// HLSL
 	{ "in.var.POSTIION", geom::Attrib::POSITION },
 	{ "in.var.NORMAL", geom::Attrib::NORMAL },
@@ -75,6 +85,16 @@ static std::map<std::string, geom::Attrib> sDefaultAttribNameToSemanticMap = {
 	{ "in.var.COLOR", geom::Attrib::COLOR },
 	{ "in.var.BONEINDEX", geom::Attrib::BONE_INDEX },
 	{ "in.var.BONEWEIGHT", geom::Attrib::BONE_WEIGHT },
+	{ "in.var.CUSTOM0", geom::Attrib::CUSTOM_0 },
+	{ "in.var.CUSTOM1", geom::Attrib::CUSTOM_1 },
+	{ "in.var.CUSTOM2", geom::Attrib::CUSTOM_2 },
+	{ "in.var.CUSTOM3", geom::Attrib::CUSTOM_3 },
+	{ "in.var.CUSTOM4", geom::Attrib::CUSTOM_4 },
+	{ "in.var.CUSTOM5", geom::Attrib::CUSTOM_5 },
+	{ "in.var.CUSTOM6", geom::Attrib::CUSTOM_6 },
+	{ "in.var.CUSTOM7", geom::Attrib::CUSTOM_7 },
+	{ "in.var.CUSTOM8", geom::Attrib::CUSTOM_8 },
+	{ "in.var.CUSTOM9", geom::Attrib::CUSTOM_9 },
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -958,7 +978,7 @@ ShaderProgRef ShaderProg::create(
 	vk::ShaderModuleRef	  vertOrCompModule,
 	VkShaderStageFlagBits shaderStage )
 {
-	if ( ( shaderStage != VK_SHADER_STAGE_VERTEX_BIT ) || ( shaderStage != VK_SHADER_STAGE_COMPUTE_BIT ) ) {
+	if ( ( shaderStage != VK_SHADER_STAGE_VERTEX_BIT ) && ( shaderStage != VK_SHADER_STAGE_COMPUTE_BIT ) ) {
 		throw VulkanExc( "invalid shader stage" );
 	}
 
@@ -1097,6 +1117,22 @@ ShaderProg::ShaderProg(
 	VkShaderStageFlagBits shaderStage )
 	: vk::ContextChildObject( context )
 {
+	if ( ( shaderStage != VK_SHADER_STAGE_VERTEX_BIT ) && ( shaderStage != VK_SHADER_STAGE_COMPUTE_BIT ) ) {
+		throw VulkanExc( "invalid shader stage" );
+	}
+
+	if ( vsOrCsSpirv.empty() ) {
+		throw VulkanExc( "missing SPIR-V" );
+	}
+
+	if ( shaderStage == VK_SHADER_STAGE_VERTEX_BIT ) {
+		mVs = vk::ShaderModule::create( vsOrCsSpirv, context->getDevice() );
+	}
+	else {
+		mCs = vk::ShaderModule::create( vsOrCsSpirv, context->getDevice() );
+	}
+
+	parseModules();
 }
 
 static std::vector<SpvReflectInterfaceVariable *> getInputVariables(
@@ -1699,6 +1735,25 @@ vk::GlslProgRef GlslProg::create( const vk::GlslProg::Format &format )
 	return create( format.mVert, format.mFrag, format.mGeom, format.mTese, format.mTesc );
 }
 
+vk::GlslProgRef GlslProg::create(
+	const DataSourceRef	&vsOrCsTextDataSource,
+	VkShaderStageFlagBits shaderStage )
+{
+	vk::ContextRef context = app::RendererVk::getCurrentRenderer()->getContext();
+	return vk::GlslProg::create( context, vsOrCsTextDataSource, shaderStage );
+}
+
+vk::GlslProgRef GlslProg::create(
+	vk::ContextRef		  context,
+	const DataSourceRef	&vsOrCsTextDataSource,
+	VkShaderStageFlagBits shaderStage )
+{
+	std::string text;
+	loadShaderText( vsOrCsTextDataSource, text );
+
+	return vk::GlslProg::create( context, text, shaderStage );
+}
+
 vk::GlslProgRef GlslProg::create(
 	const DataSourceRef &vertTextDataSource,
 	const DataSourceRef &fragTextDataSource,
@@ -1733,6 +1788,24 @@ vk::GlslProgRef GlslProg::create(
 	return vk::GlslProg::create( context, vertText, fragText, geomText, teseText, tescText );
 }
 
+vk::GlslProgRef GlslProg::create(
+	const std::string	  &vsOrCsText,
+	VkShaderStageFlagBits shaderStage )
+{
+	vk::ContextRef context = app::RendererVk::getCurrentRenderer()->getContext();
+	return vk::GlslProg::create( context, vsOrCsText, shaderStage );
+}
+
+vk::GlslProgRef GlslProg::create(
+	vk::ContextRef		  context,
+	const std::string	  &vsOrCsText,
+	VkShaderStageFlagBits shaderStage )
+{
+	auto spirv = compileShader( context->getDevice(), vsOrCsText, shaderStage );
+
+	return vk::GlslProgRef( new GlslProg( context, std::move( spirv ), shaderStage ) );
+}
+
 vk::GlslProgRef GlslProg::create(
 	const std::string &vertText,
 	const std::string &fragText,
@@ -1917,6 +1990,14 @@ std::vector<char> GlslProg::compileShader(
 			glslang_shader_shift_binding( shader, GLSLANG_RESOURCE_TYPE_SSBO, CINDER_CONTEXT_PS_BINDING_SHIFT_SSBO );
 			glslang_shader_shift_binding( shader, GLSLANG_RESOURCE_TYPE_UAV, CINDER_CONTEXT_PS_BINDING_SHIFT_UAV );
 		}; break;
+		case VK_SHADER_STAGE_COMPUTE_BIT: {
+			glslang_shader_shift_binding( shader, GLSLANG_RESOURCE_TYPE_TEXTURE, CINDER_CONTEXT_CS_BINDING_SHIFT_TEXTURE );
+			glslang_shader_shift_binding( shader, GLSLANG_RESOURCE_TYPE_UBO, CINDER_CONTEXT_CS_BINDING_SHIFT_UBO );
+			glslang_shader_shift_binding( shader, GLSLANG_RESOURCE_TYPE_IMAGE, CINDER_CONTEXT_CS_BINDING_SHIFT_IMAGE );
+			glslang_shader_shift_binding( shader, GLSLANG_RESOURCE_TYPE_SAMPLER, CINDER_CONTEXT_CS_BINDING_SHIFT_SAMPLER );
+			glslang_shader_shift_binding( shader, GLSLANG_RESOURCE_TYPE_SSBO, CINDER_CONTEXT_CS_BINDING_SHIFT_SSBO );
+			glslang_shader_shift_binding( shader, GLSLANG_RESOURCE_TYPE_UAV, CINDER_CONTEXT_CS_BINDING_SHIFT_UAV );
+		}; break;
 	}
 
 	// Options
@@ -2150,6 +2231,11 @@ std::vector<char> HlslProg::compileShader(
 	const std::u16string kGsShiftSArg = toUtf16( std::to_string( CINDER_CONTEXT_GS_BINDING_SHIFT_TEXTURE ) );
 	const std::u16string kGsShiftUArg = toUtf16( std::to_string( CINDER_CONTEXT_GS_BINDING_SHIFT_UAV ) );
 
+	const std::u16string kCsShiftTArg = toUtf16( std::to_string( CINDER_CONTEXT_CS_BINDING_SHIFT_TEXTURE ) );
+	const std::u16string kCsShiftBArg = toUtf16( std::to_string( CINDER_CONTEXT_CS_BINDING_SHIFT_UBO ) );
+	const std::u16string kCsShiftSArg = toUtf16( std::to_string( CINDER_CONTEXT_CS_BINDING_SHIFT_TEXTURE ) );
+	const std::u16string kCsShiftUArg = toUtf16( std::to_string( CINDER_CONTEXT_CS_BINDING_SHIFT_UAV ) );
+
 	std::string profileUtf8;
 	std::string defaultEntryPoint;
 	// clang-format off
@@ -2265,6 +2351,16 @@ std::vector<char> HlslProg::compileShader(
 			};
 			// clang-format on
 		} break;
+		case VK_SHADER_STAGE_COMPUTE_BIT: {
+			// clang-format off
+			shiftArgs = {
+				L"-fvk-t-shift", (LPCWSTR)kCsShiftTArg.c_str(), L"0",
+				L"-fvk-b-shift", (LPCWSTR)kCsShiftBArg.c_str(), L"0",
+				L"-fvk-s-shift", (LPCWSTR)kCsShiftSArg.c_str(), L"0",
+				L"-fvk-u-shift", (LPCWSTR)kCsShiftUArg.c_str(), L"0",
+			};
+			// clang-format on
+		} break;
 	}
 
 	std::copy( shiftArgs.begin(), shiftArgs.end(), std::back_inserter( arguments ) );
@@ -0,0 +1,276 @@
+#include "cinder/vk/ShapeBatch.h"
+#include "cinder/vk/Command.h"
+#include "cinder/vk/Context.h"
+#include "cinder/vk/Texture.h"
+
+#include <cstddef>
+#include <cstring>
+
+namespace cinder::vk {
+
+static const uint32_t kInitialVertexCapacity = 4096;
+static const uint32_t kInitialIndexCapacity	 = 6 * 4096;
+static const uint32_t kInitialSpriteCapacity = 1024;
+
+static uint32_t packColor( const ColorAf &color )
+{
+	const ColorA8u c = color;
+	return static_cast<uint32_t>( c.r ) | ( static_cast<uint32_t>( c.g ) << 8 ) | ( static_cast<uint32_t>( c.b ) << 16 ) | ( static_cast<uint32_t>( c.a ) << 24 );
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// ShapeBatch
+
+bool ShapeBatch::RunState::operator==( const RunState &rhs ) const
+{
+	return ( texture == rhs.texture ) &&
+		   ( viewProjection == rhs.viewProjection ) &&
+		   ( blendEnable == rhs.blendEnable ) &&
+		   ( blendFactors[0] == rhs.blendFactors[0] ) &&
+		   ( blendFactors[1] == rhs.blendFactors[1] ) &&
+		   ( blendFactors[2] == rhs.blendFactors[2] ) &&
+		   ( blendFactors[3] == rhs.blendFactors[3] ) &&
+		   ( depthTest == rhs.depthTest ) &&
+		   ( depthWrite == rhs.depthWrite );
+}
+
+ShapeBatch::ShapeBatch( vk::ContextRef context )
+	: vk::ContextChildObject( context )
+{
+}
+
+ShapeBatch::~ShapeBatch()
+{
+}
+
+void ShapeBatch::flightSync( uint32_t currentFrameIndex, uint32_t previousFrameIndex )
+{
+	// The context has waited on this frame so its rings can be rewound
+	if ( currentFrameIndex < mFrames.size() ) {
+		Frame &frame		 = mFrames[currentFrameIndex];
+		frame.vertices.count = 0;
+		frame.indices.count	 = 0;
+		frame.sprites.count	 = 0;
+		frame.retiredBuffers.clear();
+	}
+
+	mNumDrawsThisFrame = 0;
+}
+
+ShapeBatch::RunState ShapeBatch::currentState( const vk::Texture2d *texture ) const
+{
+	vk::Context *ctx = getContext().get();
+
+	RunState state		 = {};
+	state.texture		 = texture;
+	state.viewProjection = ctx->getProjectionMatrixStack().back() * ctx->getViewMatrixStack().back();
+	state.blendEnable	 = ctx->isBlendEnabled();
+	ctx->getBlendFuncSeparate( &state.blendFactors[0], &state.blendFactors[1], &state.blendFactors[2], &state.blendFactors[3] );
+	state.depthTest	 = ctx->isDepthTestEnabled();
+	state.depthWrite = ctx->isDepthWriteEnabled();
+	return state;
+}
+
+void ShapeBatch::grow( Frame &frame, Ring &ring, uint32_t count, uint32_t initialCapacity, uint32_t elementSize, const vk::Buffer::Usage &usage )
+{
+	// Double until the ring holds what this frame has appended so far, so
+	// it settles at the frame's peak size after a few frames.
+	const uint64_t required = static_cast<uint64_t>( ring.count ) + count;
+	uint32_t	   capacity = ring.buffer ? ( ring.capacity * 2 ) : initialCapacity;
+	while ( capacity < required ) {
+		capacity *= 2;
+	}
+
+	vk::BufferRef buffer = vk::Buffer::create( static_cast<uint64_t>( capacity ) * elementSize, usage, vk::MemoryUsage::CPU_TO_GPU, vk::Buffer::Options().persisentMap(), getContext()->getDevice() );
+
+	void *pData = nullptr;
+	buffer->map( &pData );
+
+	// Pending runs keep their offsets, so carry the contents over instead
+	// of flushing them. Draws already recorded keep the old buffer alive.
+	if ( ring.buffer ) {
+		std::memcpy( pData, ring.pData, static_cast<size_t>( ring.count ) * elementSize );
+		frame.retiredBuffers.push_back( ring.buffer );
+	}
+
+	ring.buffer	  = buffer;
+	ring.pData	  = static_cast<uint8_t *>( pData );
+	ring.capacity = capacity;
+}
+
+void ShapeBatch::reserve( uint32_t numVertices, uint32_t numIndices, uint32_t numSprites )
+{
+	vk::Context *ctx = getContext().get();
+	if ( mFrames.empty() ) {
+		mFrames.resize( ctx->getNumFramesInFlight() );
+	}
+
+	Frame &frame = mFrames[ctx->getFrameIndex()];
+	if ( ( frame.vertices.count + numVertices ) > frame.vertices.capacity ) {
+		grow( frame, frame.vertices, numVertices, kInitialVertexCapacity, sizeof( Vertex ), vk::Buffer::Usage().vertexBuffer() );
+	}
+	if ( ( frame.indices.count + numIndices ) > frame.indices.capacity ) {
+		grow( frame, frame.indices, numIndices, kInitialIndexCapacity, sizeof( uint32_t ), vk::Buffer::Usage().indexBuffer() );
+	}
+	if ( ( frame.sprites.count + numSprites ) > frame.sprites.capacity ) {
+		grow( frame, frame.sprites, numSprites, kInitialSpriteCapacity, sizeof( Sprite ), vk::Buffer::Usage().vertexBuffer() );
+	}
+}
+
+void ShapeBatch::appendRun( const RunState &state, const vk::Texture2dRef &texture, uint32_t first, uint32_t count )
+{
+	if ( !mRuns.empty() && ( mRuns.back().state == state ) ) {
+		mRuns.back().count += count;
+	}
+	else {
+		mRuns.push_back( { state, texture, first, count } );
+	}
+}
+
+void ShapeBatch::appendTriangles( const vec2 *pPositions, uint32_t numVertices, const uint32_t *pIndices, uint32_t numIndices )
+{
+	if ( ( numVertices == 0 ) || ( numIndices == 0 ) ) {
+		return;
+	}
+
+	vk::Context	  *ctx	 = getContext().get();
+	const RunState state = currentState( nullptr );
+
+	reserve( numVertices, numIndices, 0 );
+
+	Frame &frame = mFrames[ctx->getFrameIndex()];
+
+	// Positions are transformed here so shapes with different model
+	// matrices can still share a draw.
+	const mat4	   model	  = ctx->getModelMatrixStack().back();
+	const uint32_t color	  = packColor( ctx->getCurrentColor() );
+	const uint32_t baseVertex = frame.vertices.count;
+
+	Vertex *pDstVertices = reinterpret_cast<Vertex *>( frame.vertices.pData ) + baseVertex;
+	for ( uint32_t i = 0; i < numVertices; ++i ) {
+		pDstVertices[i].position = vec3( model * vec4( pPositions[i], 0.0f, 1.0f ) );
+		pDstVertices[i].color	 = color;
+	}
+
+	uint32_t *pDstIndices = reinterpret_cast<uint32_t *>( frame.indices.pData ) + frame.indices.count;
+	for ( uint32_t i = 0; i < numIndices; ++i ) {
+		pDstIndices[i] = baseVertex + pIndices[i];
+	}
+
+	appendRun( state, nullptr, frame.indices.count, numIndices );
+
+	frame.vertices.count += numVertices;
+	frame.indices.count += numIndices;
+}
+
+void ShapeBatch::appendTexturedQuad( const vk::Texture2dRef &texture, const Rectf &texCoords, const Rectf &dstRect )
+{
+	vk::Context	  *ctx	 = getContext().get();
+	const RunState state = currentState( texture.get() );
+
+	reserve( 0, 0, 1 );
+
+	Frame	  &frame = mFrames[ctx->getFrameIndex()];
+	const mat4 model = ctx->getModelMatrixStack().back();
+
+	Sprite *pSprite	   = reinterpret_cast<Sprite *>( frame.sprites.pData ) + frame.sprites.count;
+	pSprite->origin	   = vec3( model * vec4( dstRect.getUpperLeft(), 0.0f, 1.0f ) );
+	pSprite->axisX	   = vec3( model * vec4( dstRect.getWidth(), 0.0f, 0.0f, 0.0f ) );
+	pSprite->axisY	   = vec3( model * vec4( 0.0f, dstRect.getHeight(), 0.0f, 0.0f ) );
+	pSprite->texCoords = vec4( texCoords.getUpperLeft(), texCoords.getSize() );
+
+	appendRun( state, texture, frame.sprites.count, 1 );
+
+	frame.sprites.count += 1;
+}
+
+void ShapeBatch::flush()
+{
+	// Binding the stock programs below can come back through the context
+	if ( mFlushing || mRuns.empty() ) {
+		return;
+	}
+	mFlushing = true;
+
+	vk::Context				 *ctx					= getContext().get();
+	vk::CommandBuffer		 *cmd					= ctx->getCurrentCommandBuffer();
+	Frame					 &frame					= mFrames[ctx->getFrameIndex()];
+	vk::StockShaderManager	 *stockShaders			= ctx->getStockShaderManager();
+	const vk::PipelineLayout *colorPipelineLayout	= stockShaders->getDrawColorPipelineLayout();
+	const vk::PipelineLayout *texturePipelineLayout	= stockShaders->getDrawTexturePipelineLayout();
+
+	geom::BufferLayout vertexLayout;
+	vertexLayout.append( geom::POSITION, 3, sizeof( Vertex ), offsetof( Vertex, position ) );
+	vertexLayout.append( geom::COLOR, 4, sizeof( Vertex ), offsetof( Vertex, color ) );
+
+	geom::BufferLayout spriteLayout;
+	spriteLayout.append( geom::CUSTOM_0, 3, sizeof( Sprite ), offsetof( Sprite, origin ), 1 );
+	spriteLayout.append( geom::CUSTOM_1, 3, sizeof( Sprite ), offsetof( Sprite, axisX ), 1 );
+	spriteLayout.append( geom::CUSTOM_2, 3, sizeof( Sprite ), offsetof( Sprite, axisY ), 1 );
+	spriteLayout.append( geom::CUSTOM_3, 4, sizeof( Sprite ), offsetof( Sprite, texCoords ), 1 );
+
+	// Runs change the blend and depth state, restore it afterwards
+	const bool	  blendEnable = ctx->isBlendEnabled();
+	VkBlendFactor blendFactors[4];
+	ctx->getBlendFuncSeparate( &blendFactors[0], &blendFactors[1], &blendFactors[2], &blendFactors[3] );
+	const bool depthTest  = ctx->isDepthTestEnabled();
+	const bool depthWrite = ctx->isDepthWriteEnabled();
+
+	{
+		// Push onto this batch's context explicitly, the current context
+		// may be a different one when a recorder is flushed.
+		ctx->pushGlslProg( stockShaders->getDrawColorProg() );
+
+		// Shapes share one set of vertex and index buffers, only rebind
+		// them after textured quads have replaced them.
+		bool shapeBuffersBound = false;
+
+		for ( const auto &run : mRuns ) {
+			ctx->enableBlend( run.state.blendEnable );
+			ctx->blendFuncSeparate( run.state.blendFactors[0], run.state.blendFactors[1], run.state.blendFactors[2], run.state.blendFactors[3] );
+			ctx->enableDepthTest( run.state.depthTest );
+			ctx->enableDepthWrite( run.state.depthWrite );
+
+			if ( !run.texture ) {
+				if ( !shapeBuffersBound ) {
+					ctx->bindGlslProg( stockShaders->getDrawColorProg() );
+					ctx->bindVertexBuffers( { { vertexLayout, frame.vertices.buffer } }, { { VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R8G8B8A8_UNORM } } );
+					cmd->bindIndexBuffer( frame.indices.buffer, 0, VK_INDEX_TYPE_UINT32 );
+					shapeBuffersBound = true;
+				}
+
+				ctx->bindGraphicsPipeline( colorPipelineLayout );
+				cmd->pushConstants( colorPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof( mat4 ), &run.state.viewProjection );
+				ctx->drawIndexed( static_cast<int32_t>( run.first ), static_cast<int32_t>( run.count ) );
+			}
+			else {
+				// The instance buffer is bound at the run's first quad so the draw starts at instance 0
+				ctx->bindGlslProg( stockShaders->getDrawTextureProg( run.texture->getUnnormalizedCoordinates() ) );
+				ctx->bindVertexBuffers(
+					{ { spriteLayout, frame.sprites.buffer } },
+					{ { VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT } },
+					{ static_cast<uint64_t>( run.first ) * sizeof( Sprite ) },
+					0 );
+				shapeBuffersBound = false;
+
+				ctx->bindGraphicsPipeline( texturePipelineLayout );
+				cmd->pushConstants( texturePipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof( mat4 ), &run.state.viewProjection );
+				cmd->pushDescriptor( VK_PIPELINE_BIND_POINT_GRAPHICS, texturePipelineLayout, 0 + CINDER_CONTEXT_PS_BINDING_SHIFT_TEXTURE, 0, run.texture.get() );
+				ctx->draw( 0, 6, run.count );
+			}
+			++mNumDrawsThisFrame;
+		}
+
+		ctx->popGlslProg();
+	}
+
+	ctx->enableBlend( blendEnable );
+	ctx->blendFuncSeparate( blendFactors[0], blendFactors[1], blendFactors[2], blendFactors[3] );
+	ctx->enableDepthTest( depthTest );
+	ctx->enableDepthWrite( depthWrite );
+
+	mRuns.clear();
+	mFlushing = false;
+}
+
+} // namespace cinder::vk
@@ -54,23 +54,18 @@ static const char *sDrawTextureVert = R"vert(
 #version 450
 
 layout(push_constant) uniform constants {
-	mat4 ciModelViewProjection;
-	vec2 uPositionOffset, uPositionScale;
-	vec2 uTexCoordOffset, uTexCoordScale;
+	mat4 ciViewProjection;
 };
 
+// Per instance: quad origin and edges in world space, texcoord offset (xy) and scale (zw)
+layout( location = 0 ) in  vec3 ciCustom0;
+layout( location = 1 ) in  vec3 ciCustom1;
+layout( location = 2 ) in  vec3 ciCustom2;
+layout( location = 3 ) in  vec4 ciCustom3;
 layout( location = 0 ) out vec2 TexCoord;
 
 void main( void ) {
-    const vec2 positions[6] = vec2[6](
-        vec2(1, 0),
-        vec2(0, 0),
-        vec2(1, 1),
-        vec2(0, 1),
-        vec2(0, 0),
-        vec2(1, 1));
-        
-    const vec2 texCoords[6] = vec2[6](
+    const vec2 corners[6] = vec2[6](
         vec2(1, 0),
         vec2(0, 0),
         vec2(1, 1),
@@ -78,8 +73,9 @@ void main( void ) {
         vec2(0, 0),
         vec2(1, 1));
 
-	gl_Position = ciModelViewProjection * ( vec4( uPositionOffset, 0, 0 ) + vec4( uPositionScale, 1, 1 ) * vec4(positions[gl_VertexID], 0, 1) );
-	TexCoord = uTexCoordOffset + uTexCoordScale * texCoords[gl_VertexID];
+	vec2 corner = corners[gl_VertexIndex];
+	gl_Position = ciViewProjection * vec4( ciCustom0 + corner.x * ciCustom1 + corner.y * ciCustom2, 1 );
+	TexCoord = ciCustom3.xy + ciCustom3.zw * corner;
 }
 )vert";
 
@@ -109,6 +105,34 @@ void main( void ) {
 }
 )frag";
 
+static const char *sDrawColorVert = R"vert(
+#version 450
+
+layout(push_constant) uniform constants {
+	mat4 ciViewProjection;
+};
+
+layout( location = 0 ) in  vec4 ciPosition;
+layout( location = 1 ) in  vec4 ciColor;
+layout( location = 0 ) out vec4 Color;
+
+void main( void ) {
+	gl_Position = ciViewProjection * ciPosition;
+	Color = ciColor;
+}
+)vert";
+
+static const char *sDrawColorFrag = R"frag(
+#version 450
+
+layout( location = 0 ) in  vec4 Color;
+layout( location = 0 ) out vec4 oColor;
+
+void main( void ) {
+	oColor = Color;
+}
+)frag";
+
 StockShaderManager::StockShaderManager( vk::ContextRef context )
 	: vk::ContextChildObject( context )
 {
@@ -117,7 +141,7 @@ StockShaderManager::StockShaderManager( vk::ContextRef context )
 															.pushDescriptor();
 	mDrawTextureSetLayout = vk::DescriptorSetLayout::create( setLayoutOptions, context->getDevice() );
 
-	uint32_t					size	  = sizeof( mat4 ) + 4 * sizeof( vec2 );
+	uint32_t					size	  = sizeof( mat4 );
 	vk::PipelineLayout::Options plOptions = vk::PipelineLayout::Options()
 												.addPushConstantRange( 0, size, VK_SHADER_STAGE_VERTEX_BIT )
 												.addSetLayout( mDrawTextureSetLayout );
@@ -125,6 +149,13 @@ StockShaderManager::StockShaderManager( vk::ContextRef context )
 
 	mDrawTextureProg		  = vk::GlslProg::create( getContext(), std::string( sDrawTextureVert ), std::string( sDrawTextureFrag ) );
 	mDrawTextureRectangleProg = vk::GlslProg::create( getContext(), std::string( sDrawTextureVert ), std::string( sDrawTextureRectangleFrag ) );
+
+	// Positions are already in world space, only the view projection is pushed
+	vk::PipelineLayout::Options colorPlOptions = vk::PipelineLayout::Options()
+													 .addPushConstantRange( 0, sizeof( mat4 ), VK_SHADER_STAGE_VERTEX_BIT );
+	mDrawColorPipelineLayout = vk::PipelineLayout::create( colorPlOptions, context->getDevice() );
+
+	mDrawColorProg = vk::GlslProg::create( getContext(), std::string( sDrawColorVert ), std::string( sDrawColorFrag ) );
 }
 
 StockShaderManager::~StockShaderManager()
@@ -141,4 +172,14 @@ const vk::GlslProg *StockShaderManager::getDrawTextureProg( bool rectangle ) con
 	return rectangle ? mDrawTextureRectangleProg.get() : mDrawTextureProg.get();
 }
 
+const vk::PipelineLayout *StockShaderManager::getDrawColorPipelineLayout() const
+{
+	return mDrawColorPipelineLayout.get();
+}
+
+const vk::GlslProg *StockShaderManager::getDrawColorProg() const
+{
+	return mDrawColorProg.get();
+}
+
 } // namespace cinder::vk
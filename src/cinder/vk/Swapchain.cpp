@@ -100,6 +100,15 @@ void Swapchain::init( const VkExtent2D &extent, const Options &options )
 	}
 	mUsageFlags = surfaceCaps.supportedUsageFlags;
 
+	mMinImageCount = surfaceCaps.minImageCount;
+	if ( options.mNumAcquiredImages > 0 ) {
+		mNumBuffers = surfaceCaps.minImageCount + options.mNumAcquiredImages;
+	}
+	mNumBuffers = std::max( mNumBuffers, surfaceCaps.minImageCount );
+	if ( surfaceCaps.maxImageCount > 0 ) {
+		mNumBuffers = std::min( mNumBuffers, surfaceCaps.maxImageCount );
+	}
+
 	uint32_t count = 0;
 	vkres		   = CI_VK_INSTANCE_FN( GetPhysicalDeviceSurfaceFormatsKHR(
 		 getGpuHandle(),
@@ -198,6 +207,7 @@ void Swapchain::init( const VkExtent2D &extent, const Options &options )
 				Image::Options(),
 				getDevice() );
 			mImages.push_back( image );
+			mImageViews.push_back( ImageView::create( image, getDevice() ) );
 
 			// Create sync objects
 			Sync sync				 = {};
@@ -214,7 +224,8 @@ void Swapchain::init( const VkExtent2D &extent, const Options &options )
 //
 VkResult Swapchain::acquireNextImage( uint64_t timeout, AcquireInfo *pAcquireInfo )
 {
-	uint32_t	 frameIndex			   = mPresentCount % mNumBuffers;
+	// Indexed by acquire count since images can be acquired ahead of present
+	uint32_t	 frameIndex			   = static_cast<uint32_t>( mAcquireCount % mSyncs.size() );
 	SemaphoreRef imageReadySemaphore   = mSyncs[frameIndex].imageReadySemaphore;
 	VkFence		 imageReadyFenceHandle = mSyncs[frameIndex].imageReadyFence->getFenceHandle();
 
@@ -242,6 +253,8 @@ VkResult Swapchain::acquireNextImage( uint64_t timeout, AcquireInfo *pAcquireInf
 	pAcquireInfo->image		 = mImages[pAcquireInfo->imageIndex];
 	pAcquireInfo->imageReady = imageReadySemaphore;
 
+	++mAcquireCount;
+
 	return VK_SUCCESS;
 }
 
@@ -262,16 +275,15 @@ VkResult Swapchain::present( const PresentInfo *pPresentInfo )
 	presentInfo.pImageIndices	   = &pPresentInfo->imageIndex;
 	presentInfo.pResults		   = nullptr;
 
-	VkResult vkres = CI_VK_DEVICE_FN( QueuePresentKHR(
-		getDevice()->getGraphicsQueueHandle(),
-		&presentInfo ) );
-	if ( vkres != VK_SUCCESS ) {
+	VkResult vkres = getDevice()->presentGraphics( &presentInfo );
+	if ( ( vkres != VK_SUCCESS ) && ( vkres != VK_SUBOPTIMAL_KHR ) ) {
 		return vkres;
 	}
 
+	// A suboptimal present still releases the image
 	++mPresentCount;
 
-	return VK_SUCCESS;
+	return vkres;
 }
 
 } // namespace cinder::vk
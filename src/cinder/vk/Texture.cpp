@@ -1,13 +1,29 @@
 #include "cinder/vk/Texture.h"
 #include "cinder/vk//Context.h"
+#include "cinder/vk/BlockCompression.h"
 #include "cinder/vk/Device.h"
 #include "cinder/vk/Image.h"
+#include "cinder/vk/Util.h"
+#include "cinder/vk/VertexEncoding.h"
 #include "cinder/vk/wrapper.h"
 #include "cinder/app/RendererVk.h"
 #include "cinder/ip/Flip.h"
 #include "cinder/ip/Resize.h"
 #include "cinder/ImageIo.h"
 
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <numeric>
+#include <thread>
+
+#include "xxh3.h"
+
+#if defined( __SSSE3__ ) || defined( __AVX__ )
+#include <immintrin.h>
+#define CI_VK_TEXTURE_SSSE3
+#endif
+
 namespace cinder::vk {
 
 /////////////////////////////////////////////////////////////////////////////////
@@ -79,6 +95,439 @@ void *ImageTargetTexture<T>::getRowPointer( int32_t row )
 	return mDataBaseAddress + ( row * mRowInc );
 }
 
+/////////////////////////////////////////////////////////////////////////////////
+// PrecompressedTextureData
+
+//! Pre-laid out texel data for mip levels and array layers (or cube faces) that
+//! can be copied to an image as is. Offsets are relative to the start of buffer.
+struct PrecompressedTextureData
+{
+	struct Subresource
+	{
+		uint32_t mipLevel;
+		uint32_t arrayLayer;
+		uint32_t width;
+		uint32_t height;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	ci::BufferRef			 buffer;
+	VkFormat				 format		 = VK_FORMAT_UNDEFINED;
+	uint32_t				 width		 = 0;
+	uint32_t				 height		 = 0;
+	uint32_t				 mipLevels	 = 0;
+	uint32_t				 arrayLayers = 0;
+	bool					 isCubeMap	 = false;
+	std::vector<Subresource> subresources;
+};
+
+//! Header of files written to the block compression cache, followed by the
+//! subresource table and the block data
+struct CompressionCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipLevels;
+	uint32_t arrayLayers;
+	uint32_t subresourceCount;
+	uint64_t sourceHash;
+};
+
+static const uint32_t kCompressionCacheMagic   = 0x43424943; // 'CIBC'
+static const uint32_t kCompressionCacheVersion = 1;
+
+namespace {
+
+template <typename T>
+static T readValue( const uint8_t *pData, size_t dataSize, size_t offset )
+{
+	if ( ( offset + sizeof( T ) ) > dataSize ) {
+		throw VulkanExc( "unexpected end of texture file" );
+	}
+	T value = {};
+	memcpy( &value, pData + offset, sizeof( T ) );
+	return value;
+}
+
+static void addSubresource( PrecompressedTextureData *pData, uint32_t mipLevel, uint32_t arrayLayer, uint64_t offset )
+{
+	uint32_t width	= std::max<uint32_t>( pData->width >> mipLevel, 1 );
+	uint32_t height = std::max<uint32_t>( pData->height >> mipLevel, 1 );
+	uint64_t size	= formatDataSize( pData->format, width, height );
+
+	if ( ( offset + size ) > pData->buffer->getSize() ) {
+		throw VulkanExc( "texture file is truncated" );
+	}
+
+	pData->subresources.push_back( { mipLevel, arrayLayer, width, height, offset, size } );
+}
+
+// KTX2 spec: https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html
+//
+PrecompressedTextureData parseKtx( const DataSourceRef &dataSource )
+{
+	static const uint8_t kIdentifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+	struct Header
+	{
+		uint32_t vkFormat;
+		uint32_t typeSize;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t layerCount;
+		uint32_t faceCount;
+		uint32_t levelCount;
+		uint32_t supercompressionScheme;
+	};
+
+	struct LevelIndex
+	{
+		uint64_t byteOffset;
+		uint64_t byteLength;
+		uint64_t uncompressedByteLength;
+	};
+
+	// Header (48) + index (32)
+	const size_t kLevelIndexOffset = sizeof( kIdentifier ) + sizeof( Header ) + 32;
+
+	PrecompressedTextureData result = {};
+	result.buffer					= dataSource->getBuffer();
+
+	const uint8_t *pFileData	= static_cast<const uint8_t *>( result.buffer->getData() );
+	const size_t   fileDataSize = result.buffer->getSize();
+
+	if ( ( fileDataSize < kLevelIndexOffset ) || ( memcmp( pFileData, kIdentifier, sizeof( kIdentifier ) ) != 0 ) ) {
+		throw VulkanExc( "not a KTX2 file" );
+	}
+
+	Header header = readValue<Header>( pFileData, fileDataSize, sizeof( kIdentifier ) );
+	if ( header.supercompressionScheme != 0 ) {
+		throw VulkanExc( "supercompressed KTX2 files are not supported" );
+	}
+	if ( header.vkFormat == VK_FORMAT_UNDEFINED ) {
+		throw VulkanExc( "KTX2 files without a Vulkan format (ex: Basis Universal) are not supported" );
+	}
+	if ( ( header.pixelWidth == 0 ) || ( header.pixelHeight == 0 ) || ( header.pixelDepth > 1 ) ) {
+		throw VulkanExc( "only 2D KTX2 textures are supported" );
+	}
+	if ( ( header.faceCount != 1 ) && ( header.faceCount != 6 ) ) {
+		throw VulkanExc( "invalid KTX2 face count" );
+	}
+
+	result.format	   = static_cast<VkFormat>( header.vkFormat );
+	result.width	   = header.pixelWidth;
+	result.height	   = header.pixelHeight;
+	result.mipLevels   = std::max<uint32_t>( header.levelCount, 1 );
+	result.isCubeMap   = ( header.faceCount == 6 );
+	result.arrayLayers = std::max<uint32_t>( header.layerCount, 1 ) * header.faceCount;
+
+	if ( formatSize( result.format ) == 0 ) {
+		throw VulkanExc( "unrecognized KTX2 format" );
+	}
+
+	// Each level stores layers, then faces, then z slices, tightly packed
+	for ( uint32_t mipLevel = 0; mipLevel < result.mipLevels; ++mipLevel ) {
+		LevelIndex levelIndex = readValue<LevelIndex>( pFileData, fileDataSize, kLevelIndexOffset + mipLevel * sizeof( LevelIndex ) );
+
+		uint64_t offset = levelIndex.byteOffset;
+		for ( uint32_t arrayLayer = 0; arrayLayer < result.arrayLayers; ++arrayLayer ) {
+			addSubresource( &result, mipLevel, arrayLayer, offset );
+			offset += result.subresources.back().size;
+		}
+
+		if ( ( offset - levelIndex.byteOffset ) > levelIndex.byteLength ) {
+			throw VulkanExc( "KTX2 level size does not match format" );
+		}
+	}
+
+	return result;
+}
+
+static VkFormat dxgiToVkFormat( uint32_t dxgiFormat )
+{
+	// clang-format off
+	switch ( dxgiFormat ) {
+		default: break;
+		case  2: return VK_FORMAT_R32G32B32A32_SFLOAT;		// DXGI_FORMAT_R32G32B32A32_FLOAT
+		case 10: return VK_FORMAT_R16G16B16A16_SFLOAT;		// DXGI_FORMAT_R16G16B16A16_FLOAT
+		case 11: return VK_FORMAT_R16G16B16A16_UNORM;		// DXGI_FORMAT_R16G16B16A16_UNORM
+		case 16: return VK_FORMAT_R32G32_SFLOAT;			// DXGI_FORMAT_R32G32_FLOAT
+		case 24: return VK_FORMAT_A2B10G10R10_UNORM_PACK32;	// DXGI_FORMAT_R10G10B10A2_UNORM
+		case 26: return VK_FORMAT_B10G11R11_UFLOAT_PACK32;	// DXGI_FORMAT_R11G11B10_FLOAT
+		case 28: return VK_FORMAT_R8G8B8A8_UNORM;			// DXGI_FORMAT_R8G8B8A8_UNORM
+		case 29: return VK_FORMAT_R8G8B8A8_SRGB;			// DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+		case 34: return VK_FORMAT_R16G16_SFLOAT;			// DXGI_FORMAT_R16G16_FLOAT
+		case 35: return VK_FORMAT_R16G16_UNORM;				// DXGI_FORMAT_R16G16_UNORM
+		case 41: return VK_FORMAT_R32_SFLOAT;				// DXGI_FORMAT_R32_FLOAT
+		case 49: return VK_FORMAT_R8G8_UNORM;				// DXGI_FORMAT_R8G8_UNORM
+		case 54: return VK_FORMAT_R16_SFLOAT;				// DXGI_FORMAT_R16_FLOAT
+		case 56: return VK_FORMAT_R16_UNORM;				// DXGI_FORMAT_R16_UNORM
+		case 61: return VK_FORMAT_R8_UNORM;					// DXGI_FORMAT_R8_UNORM
+		case 71: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;		// DXGI_FORMAT_BC1_UNORM
+		case 72: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;		// DXGI_FORMAT_BC1_UNORM_SRGB
+		case 74: return VK_FORMAT_BC2_UNORM_BLOCK;			// DXGI_FORMAT_BC2_UNORM
+		case 75: return VK_FORMAT_BC2_SRGB_BLOCK;			// DXGI_FORMAT_BC2_UNORM_SRGB
+		case 77: return VK_FORMAT_BC3_UNORM_BLOCK;			// DXGI_FORMAT_BC3_UNORM
+		case 78: return VK_FORMAT_BC3_SRGB_BLOCK;			// DXGI_FORMAT_BC3_UNORM_SRGB
+		case 80: return VK_FORMAT_BC4_UNORM_BLOCK;			// DXGI_FORMAT_BC4_UNORM
+		case 81: return VK_FORMAT_BC4_SNORM_BLOCK;			// DXGI_FORMAT_BC4_SNORM
+		case 83: return VK_FORMAT_BC5_UNORM_BLOCK;			// DXGI_FORMAT_BC5_UNORM
+		case 84: return VK_FORMAT_BC5_SNORM_BLOCK;			// DXGI_FORMAT_BC5_SNORM
+		case 87: return VK_FORMAT_B8G8R8A8_UNORM;			// DXGI_FORMAT_B8G8R8A8_UNORM
+		case 91: return VK_FORMAT_B8G8R8A8_SRGB;			// DXGI_FORMAT_B8G8R8A8_UNORM_SRGB
+		case 95: return VK_FORMAT_BC6H_UFLOAT_BLOCK;		// DXGI_FORMAT_BC6H_UF16
+		case 96: return VK_FORMAT_BC6H_SFLOAT_BLOCK;		// DXGI_FORMAT_BC6H_SF16
+		case 98: return VK_FORMAT_BC7_UNORM_BLOCK;			// DXGI_FORMAT_BC7_UNORM
+		case 99: return VK_FORMAT_BC7_SRGB_BLOCK;			// DXGI_FORMAT_BC7_UNORM_SRGB
+	}
+	// clang-format on
+	return VK_FORMAT_UNDEFINED;
+}
+
+static constexpr uint32_t makeFourCC( char c0, char c1, char c2, char c3 )
+{
+	return static_cast<uint32_t>( c0 ) | ( static_cast<uint32_t>( c1 ) << 8 ) | ( static_cast<uint32_t>( c2 ) << 16 ) | ( static_cast<uint32_t>( c3 ) << 24 );
+}
+
+// DDS spec: https://learn.microsoft.com/en-us/windows/win32/direct3ddds/dx-graphics-dds-pguide
+//
+PrecompressedTextureData parseDds( const DataSourceRef &dataSource )
+{
+	const uint32_t kDdsMagic			= makeFourCC( 'D', 'D', 'S', ' ' );
+	const uint32_t kDdsdMipMapCount		= 0x00020000;
+	const uint32_t kDdsCaps2CubeMap		= 0x00000200;
+	const uint32_t kDdpfFourCC			= 0x00000004;
+	const uint32_t kDdpfRgb				= 0x00000040;
+	const uint32_t kDdpfLuminance		= 0x00020000;
+	const uint32_t kDx10MiscTextureCube = 0x00000004;
+	const uint32_t kDx10DimTexture2d	= 3;
+
+	struct PixelFormat
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t rgbBitCount;
+		uint32_t rBitMask;
+		uint32_t gBitMask;
+		uint32_t bBitMask;
+		uint32_t aBitMask;
+	};
+
+	struct Header
+	{
+		uint32_t	size;
+		uint32_t	flags;
+		uint32_t	height;
+		uint32_t	width;
+		uint32_t	pitchOrLinearSize;
+		uint32_t	depth;
+		uint32_t	mipMapCount;
+		uint32_t	reserved1[11];
+		PixelFormat pixelFormat;
+		uint32_t	caps;
+		uint32_t	caps2;
+		uint32_t	caps3;
+		uint32_t	caps4;
+		uint32_t	reserved2;
+	};
+
+	struct HeaderDx10
+	{
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+
+	PrecompressedTextureData result = {};
+	result.buffer					= dataSource->getBuffer();
+
+	const uint8_t *pFileData	= static_cast<const uint8_t *>( result.buffer->getData() );
+	const size_t   fileDataSize = result.buffer->getSize();
+
+	if ( readValue<uint32_t>( pFileData, fileDataSize, 0 ) != kDdsMagic ) {
+		throw VulkanExc( "not a DDS file" );
+	}
+
+	Header	 header		= readValue<Header>( pFileData, fileDataSize, sizeof( uint32_t ) );
+	uint64_t dataOffset = sizeof( uint32_t ) + sizeof( Header );
+	if ( ( header.size != sizeof( Header ) ) || ( header.pixelFormat.size != sizeof( PixelFormat ) ) ) {
+		throw VulkanExc( "invalid DDS header" );
+	}
+
+	uint32_t		   arraySize = 1;
+	bool			   isCubeMap = ( header.caps2 & kDdsCaps2CubeMap ) != 0;
+	const PixelFormat &pf		 = header.pixelFormat;
+	if ( ( pf.flags & kDdpfFourCC ) && ( pf.fourCC == makeFourCC( 'D', 'X', '1', '0' ) ) ) {
+		HeaderDx10 dx10 = readValue<HeaderDx10>( pFileData, fileDataSize, dataOffset );
+		dataOffset += sizeof( HeaderDx10 );
+
+		if ( dx10.resourceDimension != kDx10DimTexture2d ) {
+			throw VulkanExc( "only 2D DDS textures are supported" );
+		}
+
+		result.format = dxgiToVkFormat( dx10.dxgiFormat );
+		arraySize	  = std::max<uint32_t>( dx10.arraySize, 1 );
+		isCubeMap	  = ( dx10.miscFlag & kDx10MiscTextureCube ) != 0;
+	}
+	else if ( pf.flags & kDdpfFourCC ) {
+		// clang-format off
+		switch ( pf.fourCC ) {
+			default: break;
+			case makeFourCC( 'D', 'X', 'T', '1' ): result.format = VK_FORMAT_BC1_RGBA_UNORM_BLOCK; break;
+			case makeFourCC( 'D', 'X', 'T', '2' ):
+			case makeFourCC( 'D', 'X', 'T', '3' ): result.format = VK_FORMAT_BC2_UNORM_BLOCK; break;
+			case makeFourCC( 'D', 'X', 'T', '4' ):
+			case makeFourCC( 'D', 'X', 'T', '5' ): result.format = VK_FORMAT_BC3_UNORM_BLOCK; break;
+			case makeFourCC( 'A', 'T', 'I', '1' ):
+			case makeFourCC( 'B', 'C', '4', 'U' ): result.format = VK_FORMAT_BC4_UNORM_BLOCK; break;
+			case makeFourCC( 'B', 'C', '4', 'S' ): result.format = VK_FORMAT_BC4_SNORM_BLOCK; break;
+			case makeFourCC( 'A', 'T', 'I', '2' ):
+			case makeFourCC( 'B', 'C', '5', 'U' ): result.format = VK_FORMAT_BC5_UNORM_BLOCK; break;
+			case makeFourCC( 'B', 'C', '5', 'S' ): result.format = VK_FORMAT_BC5_SNORM_BLOCK; break;
+			// D3DFORMAT values stored in the FourCC field
+			case  36: result.format = VK_FORMAT_R16G16B16A16_UNORM; break;
+			case 111: result.format = VK_FORMAT_R16_SFLOAT; break;
+			case 112: result.format = VK_FORMAT_R16G16_SFLOAT; break;
+			case 113: result.format = VK_FORMAT_R16G16B16A16_SFLOAT; break;
+			case 114: result.format = VK_FORMAT_R32_SFLOAT; break;
+			case 115: result.format = VK_FORMAT_R32G32_SFLOAT; break;
+			case 116: result.format = VK_FORMAT_R32G32B32A32_SFLOAT; break;
+		}
+		// clang-format on
+	}
+	else if ( ( pf.flags & kDdpfRgb ) && ( pf.rgbBitCount == 32 ) ) {
+		if ( ( pf.rBitMask == 0x000000FF ) && ( pf.gBitMask == 0x0000FF00 ) && ( pf.bBitMask == 0x00FF0000 ) ) {
+			result.format = VK_FORMAT_R8G8B8A8_UNORM;
+		}
+		else if ( ( pf.rBitMask == 0x00FF0000 ) && ( pf.gBitMask == 0x0000FF00 ) && ( pf.bBitMask == 0x000000FF ) ) {
+			result.format = VK_FORMAT_B8G8R8A8_UNORM;
+		}
+	}
+	else if ( ( pf.flags & kDdpfLuminance ) && ( pf.rgbBitCount == 8 ) ) {
+		result.format = VK_FORMAT_R8_UNORM;
+	}
+
+	if ( result.format == VK_FORMAT_UNDEFINED ) {
+		throw VulkanExc( "unsupported DDS pixel format" );
+	}
+	if ( ( header.width == 0 ) || ( header.height == 0 ) ) {
+		throw VulkanExc( "invalid DDS dimensions" );
+	}
+
+	result.width	   = header.width;
+	result.height	   = header.height;
+	result.mipLevels   = ( header.flags & kDdsdMipMapCount ) ? std::max<uint32_t>( header.mipMapCount, 1 ) : 1;
+	result.isCubeMap   = isCubeMap;
+	result.arrayLayers = arraySize * ( isCubeMap ? 6 : 1 );
+
+	// Each array layer (or cube face) stores its full mip chain, tightly packed
+	uint64_t offset = dataOffset;
+	for ( uint32_t arrayLayer = 0; arrayLayer < result.arrayLayers; ++arrayLayer ) {
+		for ( uint32_t mipLevel = 0; mipLevel < result.mipLevels; ++mipLevel ) {
+			addSubresource( &result, mipLevel, arrayLayer, offset );
+			offset += result.subresources.back().size;
+		}
+	}
+
+	return result;
+}
+
+} // namespace
+
+/////////////////////////////////////////////////////////////////////////////////
+// TextureLoadPool
+
+namespace {
+
+//! Worker threads shared by all createAsync calls
+class TextureLoadPool
+{
+public:
+	static TextureLoadPool *get()
+	{
+		static TextureLoadPool sPool;
+		return &sPool;
+	}
+
+	template <typename T>
+	std::shared_future<T> enqueue( std::function<T()> fn )
+	{
+		auto				  task	 = std::make_shared<std::packaged_task<T()>>( std::move( fn ) );
+		std::shared_future<T> future = task->get_future().share();
+		{
+			std::lock_guard<std::mutex> lock( mMutex );
+			mTasks.push_back( [task]() { ( *task )(); } );
+		}
+		mCondition.notify_one();
+		return future;
+	}
+
+	//! Returns true on the pool's worker threads
+	static bool isWorkerThread() { return sIsWorkerThread; }
+
+private:
+	TextureLoadPool()
+	{
+		// Leave a core for the main thread
+		uint32_t numThreads = std::max<uint32_t>( std::thread::hardware_concurrency(), 2 ) - 1;
+		for ( uint32_t i = 0; i < numThreads; ++i ) {
+			mThreads.emplace_back( [this]() { workerLoop(); } );
+		}
+	}
+
+	~TextureLoadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock( mMutex );
+			mStop = true;
+		}
+		mCondition.notify_all();
+		for ( auto &thread : mThreads ) {
+			thread.join();
+		}
+	}
+
+	void workerLoop()
+	{
+		sIsWorkerThread = true;
+		while ( true ) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock( mMutex );
+				mCondition.wait( lock, [this]() { return mStop || !mTasks.empty(); } );
+				if ( mStop && mTasks.empty() ) {
+					return;
+				}
+				task = std::move( mTasks.front() );
+				mTasks.pop_front();
+			}
+			// Exceptions are captured by the packaged_task
+			task();
+		}
+	}
+
+private:
+	std::vector<std::thread>		  mThreads;
+	std::deque<std::function<void()>> mTasks;
+	std::mutex						  mMutex;
+	std::condition_variable			  mCondition;
+	bool							  mStop = false;
+
+	static thread_local bool sIsWorkerThread;
+};
+
+thread_local bool TextureLoadPool::sIsWorkerThread = false;
+
+} // namespace
+
 /////////////////////////////////////////////////////////////////////////////////
 // TextureBase
 
@@ -212,6 +661,95 @@ void TextureBase::initSampler( const Format &format )
 	}
 }
 
+void TextureBase::initPrecompressed( VkImageCreateFlags createFlags, const PrecompressedTextureData &data, Format format, bool asyncUpload )
+{
+	if ( !getDevice()->isFormatSupported( data.format, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT ) ) {
+		throw VulkanExc( "texture format is not supported for sampling by device" );
+	}
+
+	format.mipLevels( data.mipLevels );
+	format.arrayLayers( data.arrayLayers );
+
+	initImage( createFlags, data.format, format );
+	initSampler( format );
+	initViews();
+
+	uploadData( data, asyncUpload );
+}
+
+void TextureBase::uploadData( const PrecompressedTextureData &data, bool asyncUpload )
+{
+	// Buffer offsets for image copies must be a multiple of the texel
+	// block size and 4. KTX2 guarantees this but DDS does not, so
+	// repack the subresources into an aligned buffer if needed.
+	const uint64_t alignment	  = std::lcm<uint64_t>( 4, formatSize( data.format ) );
+	const uint32_t imageMipLevels = mImage->getMipLevels();
+
+	std::vector<PrecompressedTextureData::Subresource> subresources;
+	bool											   isAligned = true;
+	for ( const auto &subres : data.subresources ) {
+		if ( subres.mipLevel >= imageMipLevels ) {
+			continue;
+		}
+		subresources.push_back( subres );
+		isAligned = isAligned && ( ( subres.offset % alignment ) == 0 );
+	}
+
+	const uint8_t		*pSrcData	 = static_cast<const uint8_t *>( data.buffer->getData() );
+	uint64_t			 srcDataSize = data.buffer->getSize();
+	std::vector<uint8_t> packedData;
+	if ( !isAligned ) {
+		uint64_t packedSize = 0;
+		for ( const auto &subres : subresources ) {
+			packedSize = ( ( packedSize + alignment - 1 ) / alignment ) * alignment + subres.size;
+		}
+		packedData.resize( static_cast<size_t>( packedSize ) );
+
+		uint64_t offset = 0;
+		for ( auto &subres : subresources ) {
+			offset = ( ( offset + alignment - 1 ) / alignment ) * alignment;
+			memcpy( packedData.data() + offset, pSrcData + subres.offset, static_cast<size_t>( subres.size ) );
+			subres.offset = offset;
+			offset += subres.size;
+		}
+
+		pSrcData	= packedData.data();
+		srcDataSize = packedSize;
+	}
+
+	std::vector<VkBufferImageCopy> regions;
+	for ( const auto &subres : subresources ) {
+		VkBufferImageCopy region			   = {};
+		region.bufferOffset					   = subres.offset;
+		region.bufferRowLength				   = 0;
+		region.bufferImageHeight			   = 0;
+		region.imageSubresource.aspectMask	   = mImage->getAspectMask();
+		region.imageSubresource.mipLevel	   = subres.mipLevel;
+		region.imageSubresource.baseArrayLayer = subres.arrayLayer;
+		region.imageSubresource.layerCount	   = 1;
+		region.imageOffset					   = { 0, 0, 0 };
+		region.imageExtent					   = { subres.width, subres.height, 1 };
+		regions.push_back( region );
+	}
+
+	if ( asyncUpload ) {
+		mUploadValue = getDevice()->copyToImageAsync( srcDataSize, pSrcData, regions, mImage.get() );
+	}
+	else {
+		getDevice()->copyToImage( srcDataSize, pSrcData, regions, mImage.get() );
+	}
+}
+
+bool TextureBase::isUploadComplete() const
+{
+	return getDevice()->isAsyncCopyComplete( mUploadValue );
+}
+
+void TextureBase::waitForUpload() const
+{
+	getDevice()->waitAsyncCopy( mUploadValue );
+}
+
 void TextureBase::unbind( uint32_t binding )
 {
 	auto ctx = Context::getCurrentContext();
@@ -347,443 +885,902 @@ Texture2dRef Texture2d::create( ImageSourceRef imageSource, const Format &format
 	}
 }
 
-Texture2d::Texture2d( vk::DeviceRef device, int width, int height, Format format )
-	: TextureBase( device, width, height ),
-	  mCleanBounds( 0, 0, width, height )
+//! Formats that store 1, 2, 3 and 4 channels of T as is
+struct ChannelFormats
 {
+	VkFormat r;
+	VkFormat rg;
+	VkFormat rgb;
+	VkFormat bgr;
+	VkFormat rgba;
+	VkFormat bgra;
+};
+
+template <typename T>
+static ChannelFormats channelFormats();
+
+template <>
+ChannelFormats channelFormats<uint8_t>()
+{
+	return { VK_FORMAT_R8_UNORM, VK_FORMAT_R8G8_UNORM, VK_FORMAT_R8G8B8_UNORM, VK_FORMAT_B8G8R8_UNORM, VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_B8G8R8A8_UNORM };
 }
 
-Texture2d::Texture2d( vk::DeviceRef device, const void *data, VkFormat dataFormat, int width, int height, Format format )
-	: TextureBase( device, width, height ),
-	  mCleanBounds( 0, 0, width, height )
+template <>
+ChannelFormats channelFormats<uint16_t>()
 {
-	initImage( 0, dataFormat, format );
-	initSampler( format );
-	initViews();
+	return { VK_FORMAT_R16_UNORM, VK_FORMAT_R16G16_UNORM, VK_FORMAT_R16G16B16_UNORM, VK_FORMAT_UNDEFINED, VK_FORMAT_R16G16B16A16_UNORM, VK_FORMAT_UNDEFINED };
 }
 
-Texture2d::Texture2d( vk::DeviceRef device, const Surface8u &surface, Format format )
-	: TextureBase( device, surface.getWidth(), surface.getHeight() ),
-	  mCleanBounds( 0, 0, surface.getWidth(), surface.getHeight() )
+template <>
+ChannelFormats channelFormats<float>()
 {
-	int		 channelOrder  = surface.getChannelOrder().getCode();
-	VkFormat imageFormat   = VK_FORMAT_UNDEFINED;
-	bool	 convertToRgba = false;
-	// clang-format off
-	switch ( channelOrder ) {
-		default: break;
-		case SurfaceChannelOrder::RGBA: imageFormat = VK_FORMAT_R8G8B8A8_UNORM; break;
-		case SurfaceChannelOrder::BGRA: imageFormat = VK_FORMAT_B8G8R8A8_UNORM; break;
-		case SurfaceChannelOrder::ARGB: convertToRgba = true; break;
-		case SurfaceChannelOrder::ABGR: imageFormat = VK_FORMAT_A8B8G8R8_UNORM_PACK32; break;
-		case SurfaceChannelOrder::RGBX: imageFormat = VK_FORMAT_R8G8B8A8_UNORM; break;
-		case SurfaceChannelOrder::BGRX: imageFormat = VK_FORMAT_B8G8R8A8_UNORM; break;
-		case SurfaceChannelOrder::XRGB: convertToRgba = true;
-		case SurfaceChannelOrder::XBGR: imageFormat = VK_FORMAT_A8B8G8R8_UNORM_PACK32; break;
-		case SurfaceChannelOrder::RGB : convertToRgba = true; break;
-		case SurfaceChannelOrder::BGR : convertToRgba = true; break;
-	}
-	// clang-format on
+	return { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_UNDEFINED, VK_FORMAT_R32G32B32A32_SFLOAT, VK_FORMAT_UNDEFINED };
+}
 
-	if ( convertToRgba ) {
-		imageFormat = VK_FORMAT_R8G8B8A8_UNORM;
-	}
+template <typename T>
+static VkFormat surfaceToVkFormat( uint8_t pixelInc )
+{
+	return ( pixelInc == 3 ) ? channelFormats<T>().rgb : channelFormats<T>().rgba;
+}
 
-	if ( imageFormat == VK_FORMAT_UNDEFINED ) {
-		throw VulkanExc( "couldn't find matching Vulkan format for surface" );
+//! Lays out \a layers and their generated mips the same way a precompressed
+//! file would so that it can be uploaded with a single copy. Channels are
+//! stored in the order of the surface.
+template <typename T>
+static PrecompressedTextureData layoutSurfaceMips( const std::vector<SurfaceT<T>> &layers, uint32_t requestedMipLevels )
+{
+	const SurfaceT<T> &first = layers.front();
+
+	PrecompressedTextureData result = {};
+	result.format					= surfaceToVkFormat<T>( first.getPixelInc() );
+	result.width					= static_cast<uint32_t>( first.getWidth() );
+	result.height					= static_cast<uint32_t>( first.getHeight() );
+	result.mipLevels				= std::max<uint32_t>( std::min<uint32_t>( requestedMipLevels, countMips( result.width, result.height ) ), 1 );
+	result.arrayLayers				= static_cast<uint32_t>( layers.size() );
+
+	// Subresources are ordered by layer, then mip. Offsets of 3 channel
+	// formats may not satisfy the copy alignment, the upload repacks them.
+	uint64_t offset = 0;
+	for ( uint32_t arrayLayer = 0; arrayLayer < result.arrayLayers; ++arrayLayer ) {
+		for ( uint32_t mipLevel = 0; mipLevel < result.mipLevels; ++mipLevel ) {
+			uint32_t width	= std::max<uint32_t>( result.width >> mipLevel, 1 );
+			uint32_t height = std::max<uint32_t>( result.height >> mipLevel, 1 );
+			uint64_t size	= formatDataSize( result.format, width, height );
+			result.subresources.push_back( { mipLevel, arrayLayer, width, height, offset, size } );
+			offset += size;
+		}
 	}
 
-	initImage( 0, imageFormat, format );
-	initSampler( format );
-	initViews();
+	result.buffer	  = ci::Buffer::create( static_cast<size_t>( offset ) );
+	uint8_t *pBuffer = static_cast<uint8_t *>( result.buffer->getData() );
 
-	const Surface8u *pSrcSurface = &surface;
-	Surface8u		 surfaceRgba;
+	for ( const auto &subres : result.subresources ) {
+		const SurfaceT<T> &mip0		= layers[subres.arrayLayer];
+		const size_t	   rowBytes = static_cast<size_t>( subres.width ) * first.getPixelInc() * sizeof( T );
+		uint8_t			*pDst	  = pBuffer + subres.offset;
 
-	if ( convertToRgba ) {
-		surfaceRgba = Surface8u( surface.getWidth(), surface.getHeight(), true, SurfaceChannelOrder::RGBA );
-		surfaceRgba.copyFrom( surface, surface.getBounds(), glm::ivec2( 0, 0 ) );
-		pSrcSurface = &surface;
+		if ( subres.mipLevel == 0 ) {
+			// Source rows may be padded
+			const uint8_t *pSrc = reinterpret_cast<const uint8_t *>( mip0.getData() );
+			for ( uint32_t y = 0; y < subres.height; ++y ) {
+				memcpy( pDst + y * rowBytes, pSrc + y * mip0.getRowBytes(), rowBytes );
+			}
+		}
+		else {
+			// Scale to current mip from mip 0
+			SurfaceT<T> mipN = SurfaceT<T>( reinterpret_cast<T *>( pDst ), subres.width, subres.height, static_cast<ptrdiff_t>( rowBytes ), mip0.getChannelOrder() );
+			ip::resize( mip0, &mipN, ci::FilterCatmullRom() );
+		}
 	}
 
-	// getDevice()->copyToImage(
-	//	static_cast<uint32_t>( pSrcSurface->getWidth() ),
-	//	static_cast<uint32_t>( pSrcSurface->getHeight() ),
-	//	static_cast<uint32_t>( pSrcSurface->getRowBytes() ),
-	//	pSrcSurface->getData(),
-	//	mImage.get() );
+	return result;
 }
 
-Texture2d::Texture2d( vk::DeviceRef device, const Surface16u &surface, Format format )
-	: TextureBase( device, surface.getWidth(), surface.getHeight() ),
-	  mCleanBounds( 0, 0, surface.getWidth(), surface.getHeight() )
+//! Single channel version of layoutSurfaceMips
+template <typename T>
+static PrecompressedTextureData layoutChannelMips( const ChannelT<T> &channel, uint32_t requestedMipLevels )
 {
-	int		 channelOrder  = surface.getChannelOrder().getCode();
-	VkFormat imageFormat   = VK_FORMAT_UNDEFINED;
-	bool	 convertToRgba = false;
-	// clang-format off
-	switch ( channelOrder ) {
-		default: break;
-		case SurfaceChannelOrder::RGBA: imageFormat = VK_FORMAT_R16G16B16A16_UNORM; break;
-		case SurfaceChannelOrder::BGRA: convertToRgba = true;
-		case SurfaceChannelOrder::ARGB: convertToRgba = true;
-		case SurfaceChannelOrder::ABGR: convertToRgba = true;
-		case SurfaceChannelOrder::RGBX: imageFormat = VK_FORMAT_R16G16B16A16_UNORM; break;
-		case SurfaceChannelOrder::BGRX: convertToRgba = true;
-		case SurfaceChannelOrder::XRGB: convertToRgba = true;
-		case SurfaceChannelOrder::XBGR: convertToRgba = true;
-		case SurfaceChannelOrder::RGB : convertToRgba = true;
-		case SurfaceChannelOrder::BGR : convertToRgba = true;
-	}
-	// clang-format on
-
-	if ( convertToRgba ) {
-		imageFormat = VK_FORMAT_R8G8B8A8_UNORM;
-	}
-
-	if ( imageFormat == VK_FORMAT_UNDEFINED ) {
-		throw VulkanExc( "couldn't find matching Vulkan format for surface" );
+	PrecompressedTextureData result = {};
+	result.format					= channelFormats<T>().r;
+	result.width					= static_cast<uint32_t>( channel.getWidth() );
+	result.height					= static_cast<uint32_t>( channel.getHeight() );
+	result.mipLevels				= std::max<uint32_t>( std::min<uint32_t>( requestedMipLevels, countMips( result.width, result.height ) ), 1 );
+	result.arrayLayers				= 1;
+
+	uint64_t offset = 0;
+	for ( uint32_t mipLevel = 0; mipLevel < result.mipLevels; ++mipLevel ) {
+		uint32_t width	= std::max<uint32_t>( result.width >> mipLevel, 1 );
+		uint32_t height = std::max<uint32_t>( result.height >> mipLevel, 1 );
+		uint64_t size	= formatDataSize( result.format, width, height );
+		result.subresources.push_back( { mipLevel, 0, width, height, offset, size } );
+		offset += size;
+	}
+
+	result.buffer	  = ci::Buffer::create( static_cast<size_t>( offset ) );
+	uint8_t *pBuffer = static_cast<uint8_t *>( result.buffer->getData() );
+
+	for ( const auto &subres : result.subresources ) {
+		const ptrdiff_t rowBytes = static_cast<ptrdiff_t>( subres.width * sizeof( T ) );
+		ChannelT<T>		mipN	 = ChannelT<T>( subres.width, subres.height, rowBytes, 1, reinterpret_cast<T *>( pBuffer + subres.offset ) );
+		if ( subres.mipLevel == 0 ) {
+			// Source may be padded or interleaved
+			mipN.copyFrom( channel, channel.getBounds() );
+		}
+		else {
+			// Scale to current mip from mip 0
+			ip::resize( channel, &mipN, ci::FilterCatmullRom() );
+		}
 	}
 
-	initImage( 0, imageFormat, format );
-	initSampler( format );
-	initViews();
-
-	const Surface16u *pSrcSurface = &surface;
-	Surface16u		  surfaceRgba;
+	return result;
+}
 
-	if ( convertToRgba ) {
-		surfaceRgba = Surface16u( surface.getWidth(), surface.getHeight(), true, SurfaceChannelOrder::RGBA );
-		surfaceRgba.copyFrom( surface, surface.getBounds(), glm::ivec2( 0, 0 ) );
-		pSrcSurface = &surface;
+//! Version of layoutSurfaceMips for interleaved pixel data that has no surface
+//! equivalent (ex: gray with alpha). Mips are generated by filtering each
+//! channel separately.
+template <typename T>
+static PrecompressedTextureData layoutInterleavedMips( T *pMip0, uint32_t width, uint32_t height, uint8_t numChannels, VkFormat format, uint32_t requestedMipLevels )
+{
+	PrecompressedTextureData result = {};
+	result.format					= format;
+	result.width					= width;
+	result.height					= height;
+	result.mipLevels				= std::max<uint32_t>( std::min<uint32_t>( requestedMipLevels, countMips( width, height ) ), 1 );
+	result.arrayLayers				= 1;
+
+	uint64_t offset = 0;
+	for ( uint32_t mipLevel = 0; mipLevel < result.mipLevels; ++mipLevel ) {
+		uint32_t mipWidth  = std::max<uint32_t>( width >> mipLevel, 1 );
+		uint32_t mipHeight = std::max<uint32_t>( height >> mipLevel, 1 );
+		uint64_t size	   = static_cast<uint64_t>( mipWidth ) * mipHeight * numChannels * sizeof( T );
+		result.subresources.push_back( { mipLevel, 0, mipWidth, mipHeight, offset, size } );
+		offset += size;
+	}
+
+	result.buffer	  = ci::Buffer::create( static_cast<size_t>( offset ) );
+	uint8_t *pBuffer = static_cast<uint8_t *>( result.buffer->getData() );
+
+	const ptrdiff_t rowBytes = static_cast<ptrdiff_t>( width * numChannels * sizeof( T ) );
+	memcpy( pBuffer, pMip0, static_cast<size_t>( result.subresources[0].size ) );
+
+	for ( uint32_t mipLevel = 1; mipLevel < result.mipLevels; ++mipLevel ) {
+		const auto	   &subres		= result.subresources[mipLevel];
+		const ptrdiff_t	mipRowBytes	= static_cast<ptrdiff_t>( subres.width * numChannels * sizeof( T ) );
+		T			   *pMipN		= reinterpret_cast<T *>( pBuffer + subres.offset );
+		// Scale each channel to current mip from mip 0
+		for ( uint8_t channel = 0; channel < numChannels; ++channel ) {
+			ChannelT<T> src = ChannelT<T>( width, height, rowBytes, numChannels, pMip0 + channel );
+			ChannelT<T> dst = ChannelT<T>( subres.width, subres.height, mipRowBytes, numChannels, pMipN + channel );
+			ip::resize( src, &dst, ci::FilterCatmullRom() );
+		}
 	}
 
-	// getDevice()->copyToImage(
-	//	static_cast<uint32_t>( pSrcSurface->getWidth() ),
-	//	static_cast<uint32_t>( pSrcSurface->getHeight() ),
-	//	static_cast<uint32_t>( pSrcSurface->getRowBytes() ),
-	//	pSrcSurface->getData(),
-	//	mImage.get() );
+	return result;
 }
 
-Texture2d::Texture2d( vk::DeviceRef device, const Surface32f &surface, Format format )
-	: TextureBase( device, surface.getWidth(), surface.getHeight() ),
-	  mCleanBounds( 0, 0, surface.getWidth(), surface.getHeight() )
+//! Converts 32-bit float texel data to half float. 3 channel data is widened
+//! to 4 channels with an alpha of 1 since RGB half float formats are rarely
+//! sampleable. Data in other formats is returned as is.
+static PrecompressedTextureData toHalfFloat( const PrecompressedTextureData &data )
 {
-	int		 channelOrder  = surface.getChannelOrder().getCode();
-	VkFormat imageFormat   = VK_FORMAT_UNDEFINED;
-	bool	 convertToRgba = false;
+	uint32_t srcChannels = 0;
+	uint32_t dstChannels = 0;
+	VkFormat dstFormat	 = VK_FORMAT_UNDEFINED;
 	// clang-format off
-	switch ( channelOrder ) {
-		default: break;
-		case SurfaceChannelOrder::RGBA: imageFormat = VK_FORMAT_R32G32B32A32_SFLOAT; break;
-		case SurfaceChannelOrder::BGRA: convertToRgba = true;
-		case SurfaceChannelOrder::ARGB: convertToRgba = true;
-		case SurfaceChannelOrder::ABGR: convertToRgba = true;
-		case SurfaceChannelOrder::RGBX: imageFormat = VK_FORMAT_R32G32B32A32_SFLOAT; break;
-		case SurfaceChannelOrder::BGRX: convertToRgba = true;
-		case SurfaceChannelOrder::XRGB: convertToRgba = true;
-		case SurfaceChannelOrder::XBGR: convertToRgba = true;
-		case SurfaceChannelOrder::RGB : convertToRgba = true;
-		case SurfaceChannelOrder::BGR : convertToRgba = true;
+	switch ( data.format ) {
+		default: return data;
+		case VK_FORMAT_R32_SFLOAT          : srcChannels = 1; dstChannels = 1; dstFormat = VK_FORMAT_R16_SFLOAT; break;
+		case VK_FORMAT_R32G32_SFLOAT       : srcChannels = 2; dstChannels = 2; dstFormat = VK_FORMAT_R16G16_SFLOAT; break;
+		case VK_FORMAT_R32G32B32_SFLOAT    : srcChannels = 3; dstChannels = 4; dstFormat = VK_FORMAT_R16G16B16A16_SFLOAT; break;
+		case VK_FORMAT_R32G32B32A32_SFLOAT : srcChannels = 4; dstChannels = 4; dstFormat = VK_FORMAT_R16G16B16A16_SFLOAT; break;
 	}
 	// clang-format on
 
-	if ( convertToRgba ) {
-		imageFormat = VK_FORMAT_R8G8B8A8_UNORM;
-	}
+	PrecompressedTextureData result = data;
+	result.format					= dstFormat;
 
-	if ( imageFormat == VK_FORMAT_UNDEFINED ) {
-		throw VulkanExc( "couldn't find matching Vulkan format for surface" );
+	uint64_t offset = 0;
+	for ( auto &subres : result.subresources ) {
+		subres.offset = offset;
+		subres.size	  = formatDataSize( dstFormat, subres.width, subres.height );
+		offset += subres.size;
 	}
 
-	initImage( 0, imageFormat, format );
-	initSampler( format );
-	initViews();
+	result.buffer = ci::Buffer::create( static_cast<size_t>( offset ) );
+
+	const uint8_t *pSrcBuffer = static_cast<const uint8_t *>( data.buffer->getData() );
+	uint8_t		*pDstBuffer = static_cast<uint8_t *>( result.buffer->getData() );
 
-	const Surface32f *pSrcSurface = &surface;
-	Surface32f		  surfaceRgba;
+	std::vector<float> widened;
+	for ( size_t i = 0; i < result.subresources.size(); ++i ) {
+		const auto	&srcSubres = data.subresources[i];
+		const auto	&dstSubres = result.subresources[i];
+		const size_t numTexels = static_cast<size_t>( srcSubres.width ) * srcSubres.height;
+		const float *pSrc	   = reinterpret_cast<const float *>( pSrcBuffer + srcSubres.offset );
+		uint16_t	 *pDst	   = reinterpret_cast<uint16_t *>( pDstBuffer + dstSubres.offset );
+
+		if ( srcChannels != dstChannels ) {
+			widened.resize( numTexels * dstChannels );
+			for ( size_t t = 0; t < numTexels; ++t ) {
+				widened[t * 4 + 0] = pSrc[t * 3 + 0];
+				widened[t * 4 + 1] = pSrc[t * 3 + 1];
+				widened[t * 4 + 2] = pSrc[t * 3 + 2];
+				widened[t * 4 + 3] = 1.0f;
+			}
+			pSrc = widened.data();
+		}
 
-	if ( convertToRgba ) {
-		surfaceRgba = Surface32f( surface.getWidth(), surface.getHeight(), true, SurfaceChannelOrder::RGBA );
-		surfaceRgba.copyFrom( surface, surface.getBounds(), glm::ivec2( 0, 0 ) );
-		pSrcSurface = &surface;
+		vk::packHalf( pSrc, numTexels * dstChannels, pDst );
 	}
 
-	// getDevice()->copyToImage(
-	//	static_cast<uint32_t>( pSrcSurface->getWidth() ),
-	//	static_cast<uint32_t>( pSrcSurface->getHeight() ),
-	//	static_cast<uint32_t>( pSrcSurface->getRowBytes() ),
-	//	pSrcSurface->getData(),
-	//	mImage.get() );
+	return result;
 }
 
-Texture2d::Texture2d( vk::DeviceRef device, const Channel8u &channel, Format format )
-	: TextureBase( device, channel.getWidth(), channel.getHeight() ),
-	  mCleanBounds( 0, 0, channel.getWidth(), channel.getHeight() )
+//! Reads block compressed levels written by writeCompressionCache. Returns
+//! false if the file is missing or doesn't match the source.
+static bool readCompressionCache( const fs::path &path, uint64_t sourceHash, const PrecompressedTextureData &source, VkFormat format, PrecompressedTextureData *pResult )
 {
-	initImage( 0, VK_FORMAT_R8_UNORM, format );
-	initSampler( format );
-	initViews();
+	std::error_code ec;
+	if ( !fs::exists( path, ec ) ) {
+		return false;
+	}
+
+	try {
+		PrecompressedTextureData result = {};
+		result.buffer					= loadFile( path )->getBuffer();
+
+		const uint8_t *pFileData	= static_cast<const uint8_t *>( result.buffer->getData() );
+		const size_t   fileDataSize = result.buffer->getSize();
 
-	// getDevice()->copyToImage(
-	//	static_cast<uint32_t>( channel.getWidth() ),
-	//	static_cast<uint32_t>( channel.getHeight() ),
-	//	static_cast<uint32_t>( channel.getRowBytes() ),
-	//	channel.getData(),
-	//	mImage.get() );
+		CompressionCacheHeader header = readValue<CompressionCacheHeader>( pFileData, fileDataSize, 0 );
+		if ( ( header.magic != kCompressionCacheMagic ) || ( header.version != kCompressionCacheVersion ) || ( header.sourceHash != sourceHash ) ) {
+			return false;
+		}
+		if ( ( header.format != static_cast<uint32_t>( format ) ) || ( header.width != source.width ) || ( header.height != source.height ) || ( header.mipLevels != source.mipLevels ) || ( header.arrayLayers != source.arrayLayers ) || ( header.subresourceCount != source.subresources.size() ) ) {
+			return false;
+		}
+
+		result.format	   = format;
+		result.width	   = header.width;
+		result.height	   = header.height;
+		result.mipLevels   = header.mipLevels;
+		result.arrayLayers = header.arrayLayers;
+		result.isCubeMap   = source.isCubeMap;
+
+		size_t offset = sizeof( CompressionCacheHeader );
+		for ( uint32_t i = 0; i < header.subresourceCount; ++i ) {
+			auto subres = readValue<PrecompressedTextureData::Subresource>( pFileData, fileDataSize, offset );
+			if ( ( subres.offset + subres.size ) > fileDataSize ) {
+				return false;
+			}
+			result.subresources.push_back( subres );
+			offset += sizeof( PrecompressedTextureData::Subresource );
+		}
+
+		*pResult = result;
+		return true;
+	}
+	catch ( const std::exception & ) {
+		return false;
+	}
 }
 
-Texture2d::Texture2d( vk::DeviceRef device, const Channel16u &channel, Format format )
-	: TextureBase( device, channel.getWidth(), channel.getHeight() ),
-	  mCleanBounds( 0, 0, channel.getWidth(), channel.getHeight() )
+//! Writes block compressed levels to \a path. Failures are ignored, the
+//! cache is only an optimization.
+static void writeCompressionCache( const fs::path &path, uint64_t sourceHash, const PrecompressedTextureData &data )
 {
-	initImage( 0, VK_FORMAT_R16_UNORM, format );
-	initSampler( format );
-	initViews();
-
-	// getDevice()->copyToImage(
-	//	static_cast<uint32_t>( channel.getWidth() ),
-	//	static_cast<uint32_t>( channel.getHeight() ),
-	//	static_cast<uint32_t>( channel.getRowBytes() ),
-	//	channel.getData(),
-	//	mImage.get() );
+	CompressionCacheHeader header = {};
+	header.magic				  = kCompressionCacheMagic;
+	header.version				  = kCompressionCacheVersion;
+	header.format				  = static_cast<uint32_t>( data.format );
+	header.width				  = data.width;
+	header.height				  = data.height;
+	header.mipLevels			  = data.mipLevels;
+	header.arrayLayers			  = data.arrayLayers;
+	header.subresourceCount		  = static_cast<uint32_t>( data.subresources.size() );
+	header.sourceHash			  = sourceHash;
+
+	// Offsets in the file are relative to its start
+	const uint64_t dataOffset = sizeof( CompressionCacheHeader ) + data.subresources.size() * sizeof( PrecompressedTextureData::Subresource );
+	std::vector<PrecompressedTextureData::Subresource> subresources = data.subresources;
+	for ( auto &subres : subresources ) {
+		subres.offset += dataOffset;
+	}
+
+	std::error_code ec;
+	fs::create_directories( path.parent_path(), ec );
+
+	// Write to a temporary file first so that concurrent loads never see a
+	// partial file, each writer gets its own so they can't interleave
+	const fs::path tmpPath = uniqueTempPath( path );
+
+	std::ofstream os( tmpPath, std::ios::binary );
+	if ( !os ) {
+		return;
+	}
+	os.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+	os.write( reinterpret_cast<const char *>( subresources.data() ), subresources.size() * sizeof( PrecompressedTextureData::Subresource ) );
+	os.write( static_cast<const char *>( data.buffer->getData() ), data.buffer->getSize() );
+	os.close();
+	if ( !os ) {
+		fs::remove( tmpPath, ec );
+		return;
+	}
+
+	fs::rename( tmpPath, path, ec );
+	if ( ec ) {
+		fs::remove( tmpPath, ec );
+	}
 }
 
-Texture2d::Texture2d( vk::DeviceRef device, const Channel32f &channel, Format format )
-	: TextureBase( device, channel.getWidth(), channel.getHeight() ),
-	  mCleanBounds( 0, 0, channel.getWidth(), channel.getHeight() )
+//! Block compresses R8G8B8A8 texel data using format.getCompression().
+//! Blocks are encoded on worker threads, unless this already runs on a
+//! TextureLoadPool worker, and, if a cache directory is set, looked up
+//! by a hash of the source texels first. Data in other formats,
+//! or if the device can't sample the compressed format, is returned as is.
+static PrecompressedTextureData compressTextureData( const vk::Device *pDevice, const PrecompressedTextureData &data, const TextureBase::Format &format )
 {
-	initImage( 0, VK_FORMAT_R32_SFLOAT, format );
-	initSampler( format );
-	initViews();
+	const VkFormat dstFormat = toVkFormat( format.getCompression() );
+	if ( ( dstFormat == VK_FORMAT_UNDEFINED ) || ( data.format != VK_FORMAT_R8G8B8A8_UNORM ) || !pDevice->isFormatSupported( dstFormat ) ) {
+		return data;
+	}
+
+	// Mips are derived from mip 0 so hashing it and the level count is enough
+	const auto	   &mip0	   = data.subresources.front();
+	const uint64_t seed		   = ( static_cast<uint64_t>( format.getCompression() ) << 32 ) | data.mipLevels;
+	const uint64_t sourceHash = XXH3_64bits_withSeed( static_cast<const uint8_t *>( data.buffer->getData() ) + mip0.offset, static_cast<size_t>( mip0.size ), seed );
+
+	fs::path cachePath;
+	if ( !format.getCompressionCacheDirectory().empty() ) {
+		char name[32] = {};
+		snprintf( name, sizeof( name ), "%016llx.cibc", static_cast<unsigned long long>( sourceHash ) );
+		cachePath = format.getCompressionCacheDirectory() / name;
+
+		PrecompressedTextureData cached = {};
+		if ( readCompressionCache( cachePath, sourceHash, data, dstFormat, &cached ) ) {
+			return cached;
+		}
+	}
 
-	// getDevice()->copyToImage(
-	//	static_cast<uint32_t>( channel.getWidth() ),
-	//	static_cast<uint32_t>( channel.getHeight() ),
-	//	static_cast<uint32_t>( channel.getRowBytes() ),
-	//	channel.getData(),
-	//	mImage.get() );
+	PrecompressedTextureData result = data;
+	result.format					= dstFormat;
+
+	uint64_t offset = 0;
+	for ( auto &subres : result.subresources ) {
+		subres.offset = offset;
+		subres.size	  = formatDataSize( dstFormat, subres.width, subres.height );
+		offset += subres.size;
+	}
+
+	result.buffer = ci::Buffer::create( static_cast<size_t>( offset ) );
+
+	const uint8_t *pSrcBuffer = static_cast<const uint8_t *>( data.buffer->getData() );
+	uint8_t		*pDstBuffer = static_cast<uint8_t *>( result.buffer->getData() );
+	// Async loads already run one per pool worker, splitting each of them
+	// across every core as well would oversubscribe the CPU
+	const uint32_t numThreads = TextureLoadPool::isWorkerThread() ? 1 : 0;
+	for ( size_t i = 0; i < result.subresources.size(); ++i ) {
+		const auto &srcSubres = data.subresources[i];
+		const auto &dstSubres = result.subresources[i];
+		compressImage( format.getCompression(), srcSubres.width, srcSubres.height, srcSubres.width * 4, pSrcBuffer + srcSubres.offset, pDstBuffer + dstSubres.offset, numThreads );
+	}
+
+	if ( !cachePath.empty() ) {
+		writeCompressionCache( cachePath, sourceHash, result );
+	}
+
+	return result;
 }
 
 template <typename T>
-static void copyMipsToImage(
-	vk::Device		   *pDevice,
-	const ChannelT<T> &mip0,
-	uint32_t		   arrayLayer,
-	vk::Image		  *pDstImage )
-{
-	// Dims for mip 0
-	uint32_t width	   = static_cast<uint32_t>( mip0.getWidth() );
-	uint32_t height	   = static_cast<uint32_t>( mip0.getHeight() );
-	uint32_t rowBytes  = static_cast<uint32_t>( mip0.getRowBytes() );
-	uint32_t increment = mip0.getIncrement();
-	// Copy to mip 0
-	pDevice->copyToImage( width, height, rowBytes, mip0.getData(), 0, arrayLayer, pDstImage );
-	// Scale and copy to remaining mips
-	const uint32_t numMipLevels = pDstImage->getMipLevels();
-	for ( uint32_t mipLevel = 1; mipLevel < numMipLevels; ++mipLevel ) {
-		// Calculate dims for current mip
-		width >>= 1;
-		height >>= 1;
-		rowBytes >>= 1;
-		// Get staging buffer pointer
-		void		 *pStorage = pDevice->beginCopyToImage( width, height, rowBytes, mipLevel, arrayLayer, pDstImage );
-		// Scale to current mip from mip 0
-		ChannelT<T> mipN	 = ChannelT<T>( width, height, rowBytes, increment, reinterpret_cast<uint8_t *>( pStorage ) );
-		ip::resize( mip0, &mipN, ci::FilterCatmullRom() );
-		// Finalize copy
-		pDevice->endCopyToImage( width, height, rowBytes, mipLevel, 0, pDstImage );
+static PrecompressedTextureData decodeImageSource( const ImageSourceRef &imageSource, uint32_t requestedMipLevels )
+{
+	// alpha must always be on
+	std::vector<SurfaceT<T>> layers = { SurfaceT<T>( imageSource, SurfaceConstraints(), true ) };
+	return layoutSurfaceMips<T>( layers, requestedMipLevels );
+}
+
+static PrecompressedTextureData decodeImageSource( const ImageSourceRef &imageSource, uint32_t requestedMipLevels )
+{
+	switch ( imageSource->getDataType() ) {
+		default: break;
+		case ImageIo::DataType::UINT16: return decodeImageSource<uint16_t>( imageSource, requestedMipLevels );
+		case ImageIo::DataType::FLOAT16:
+		case ImageIo::DataType::FLOAT32: return decodeImageSource<float>( imageSource, requestedMipLevels );
 	}
+	return decodeImageSource<uint8_t>( imageSource, requestedMipLevels );
 }
 
-template <typename T>
-static void copyMipsToImage(
-	vk::Device		   *pDevice,
-	const SurfaceT<T> &mip0,
-	uint32_t		   arrayLayer,
-	vk::Image		  *pDstImage )
-{
-	// Dims for mip 0
-	uint32_t width	  = static_cast<uint32_t>( mip0.getWidth() );
-	uint32_t height	  = static_cast<uint32_t>( mip0.getHeight() );
-	uint32_t rowBytes = static_cast<uint32_t>( mip0.getRowBytes() );
-	// Copy to mip 0
-	pDevice->copyToImage( width, height, rowBytes, mip0.getData(), 0, arrayLayer, pDstImage );
-	// Scale and copy to remaining mips
-	const uint32_t numMipLevels = pDstImage->getMipLevels();
-	for ( uint32_t mipLevel = 1; mipLevel < numMipLevels; ++mipLevel ) {
-		// Calculate dims for current mip
-		width >>= 1;
-		height >>= 1;
-		rowBytes >>= 1;
-		// Get staging buffer pointer
-		void		 *pStorage = pDevice->beginCopyToImage( width, height, rowBytes, mipLevel, arrayLayer, pDstImage );
-		// Scale to current mip from mip 0
-		SurfaceT<T> mipN	 = SurfaceT<T>( reinterpret_cast<T *>( pStorage ), width, height, rowBytes, mip0.getChannelOrder() );
-		ip::resize( mip0, &mipN, ci::FilterCatmullRom() );
-		// Finalize copy
-		pDevice->endCopyToImage( width, height, rowBytes, mipLevel, arrayLayer, pDstImage );
+Texture2dFuture Texture2d::createAsync( const DataSourceRef &dataSource, const Format &format, vk::DeviceRef device )
+{
+	// Current renderer is per thread so the device must be resolved here
+	if ( !device ) {
+		device = app::RendererVk::getCurrentRenderer()->getDevice();
 	}
+
+	std::function<Texture2dRef()> task = [dataSource, format, device]() -> Texture2dRef {
+		ImageSourceRef			 imageSource = loadImage( dataSource );
+		PrecompressedTextureData data		 = decodeImageSource( imageSource, format.getMipLevels() );
+		if ( format.getHalfFloat() ) {
+			data = toHalfFloat( data );
+		}
+		data = compressTextureData( device.get(), data, format );
+
+		if ( format.mDeleter ) {
+			return Texture2dRef( new Texture2d( device, data, format, true ), format.mDeleter );
+		}
+		else {
+			return Texture2dRef( new Texture2d( device, data, format, true ) );
+		}
+	};
+
+	return Texture2dFuture( TextureLoadPool::get()->enqueue<Texture2dRef>( task ) );
 }
 
-Texture2d::Texture2d( vk::DeviceRef device, const ImageSourceRef &imageSource, Format format )
-	: TextureBase( device, imageSource->getWidth(), imageSource->getHeight() ),
-	  mCleanBounds( 0, 0, imageSource->getWidth(), imageSource->getHeight() )
+Texture2dFuture Texture2d::createAsync( const ImageSourceRef &imageSource, const Format &format, vk::DeviceRef device )
 {
-	enum ConversionTarget
-	{
-		CONVERSION_TARGET_NONE,
-		CONVERSION_TARGET_RGBA_U8,
-		CONVERSION_TARGET_RGBA_U16,
-		CONVERSION_TARGET_RGBA_32F,
-		CONVERSION_TARGET_RG_32F,
-		CONVERSION_TARGET_R_32F,
+	if ( !device ) {
+		device = app::RendererVk::getCurrentRenderer()->getDevice();
+	}
+
+	std::function<Texture2dRef()> task = [imageSource, format, device]() -> Texture2dRef {
+		PrecompressedTextureData data = decodeImageSource( imageSource, format.getMipLevels() );
+		if ( format.getHalfFloat() ) {
+			data = toHalfFloat( data );
+		}
+		data = compressTextureData( device.get(), data, format );
+
+		if ( format.mDeleter ) {
+			return Texture2dRef( new Texture2d( device, data, format, true ), format.mDeleter );
+		}
+		else {
+			return Texture2dRef( new Texture2d( device, data, format, true ) );
+		}
 	};
 
-	ImageIo::ChannelOrder channelOrder	   = imageSource->getChannelOrder();
-	ImageIo::ColorModel	  colorModel	   = imageSource->getColorModel();
-	ImageIo::DataType	  dataType		   = imageSource->getDataType();
-	bool				  isGray		   = ( colorModel == ImageIo::ColorModel::CM_GRAY );
-	VkFormat			  imageFormat	   = VK_FORMAT_UNDEFINED;
-	ConversionTarget	  conversionTarget = CONVERSION_TARGET_NONE;
+	return Texture2dFuture( TextureLoadPool::get()->enqueue<Texture2dRef>( task ) );
+}
+
+Texture2dRef Texture2d::createFromKtx( const DataSourceRef &dataSource, const Format &format, vk::DeviceRef device )
+{
+	if ( !device ) {
+		device = app::RendererVk::getCurrentRenderer()->getDevice();
+	}
+
+	PrecompressedTextureData data = parseKtx( dataSource );
+	if ( data.isCubeMap || ( data.arrayLayers > 1 ) ) {
+		throw VulkanExc( "KTX2 file is a cube map or array, use TextureCubeMap::createFromKtx for cube maps" );
+	}
+
+	if ( format.mDeleter ) {
+		return Texture2dRef( new Texture2d( device, data, format ), format.mDeleter );
+	}
+	else {
+		return Texture2dRef( new Texture2d( device, data, format ) );
+	}
+}
+
+Texture2dRef Texture2d::createFromDds( const DataSourceRef &dataSource, const Format &format, vk::DeviceRef device )
+{
+	if ( !device ) {
+		device = app::RendererVk::getCurrentRenderer()->getDevice();
+	}
+
+	PrecompressedTextureData data = parseDds( dataSource );
+	if ( data.isCubeMap || ( data.arrayLayers > 1 ) ) {
+		throw VulkanExc( "DDS file is a cube map or array, use TextureCubeMap::createFromDds for cube maps" );
+	}
 
+	if ( format.mDeleter ) {
+		return Texture2dRef( new Texture2d( device, data, format ), format.mDeleter );
+	}
+	else {
+		return Texture2dRef( new Texture2d( device, data, format ) );
+	}
+}
+
+//! Uses the channel order requested instead of the platform default so that
+//! image sources can be loaded without reordering channels
+class SurfaceConstraintsChannelOrder : public SurfaceConstraints
+{
+public:
+	SurfaceConstraintsChannelOrder( const SurfaceChannelOrder &channelOrder )
+		: mChannelOrder( channelOrder ) {}
+
+	SurfaceChannelOrder getChannelOrder( bool alpha ) const override { return mChannelOrder; }
+
+private:
+	SurfaceChannelOrder mChannelOrder;
+};
+
+static SurfaceChannelOrder toSurfaceChannelOrder( ImageIo::ChannelOrder channelOrder )
+{
+	// clang-format off
 	switch ( channelOrder ) {
 		default: break;
-		case ImageIo::ChannelOrder::RGBA:
-		case ImageIo::ChannelOrder::RGBX: {
-			switch ( dataType ) {
-				default: break;
-				case ImageIo::DataType::UINT8: imageFormat = VK_FORMAT_R8G8B8A8_UNORM; break;
-				case ImageIo::DataType::UINT16: imageFormat = VK_FORMAT_R16G16B16A16_UNORM; break;
-				case ImageIo::DataType::FLOAT32: imageFormat = VK_FORMAT_R32G32B32A32_SFLOAT; break;
-				case ImageIo::DataType::FLOAT16: imageFormat = VK_FORMAT_R16G16B16A16_SFLOAT; break;
-			}
-		} break;
+		case ImageIo::ChannelOrder::RGBA: return SurfaceChannelOrder::RGBA;
+		case ImageIo::ChannelOrder::BGRA: return SurfaceChannelOrder::BGRA;
+		case ImageIo::ChannelOrder::ARGB: return SurfaceChannelOrder::ARGB;
+		case ImageIo::ChannelOrder::ABGR: return SurfaceChannelOrder::ABGR;
+		case ImageIo::ChannelOrder::RGBX: return SurfaceChannelOrder::RGBX;
+		case ImageIo::ChannelOrder::BGRX: return SurfaceChannelOrder::BGRX;
+		case ImageIo::ChannelOrder::XRGB: return SurfaceChannelOrder::XRGB;
+		case ImageIo::ChannelOrder::XBGR: return SurfaceChannelOrder::XBGR;
+		case ImageIo::ChannelOrder::RGB : return SurfaceChannelOrder::RGB;
+		case ImageIo::ChannelOrder::BGR : return SurfaceChannelOrder::BGR;
+	}
+	// clang-format on
+	return SurfaceChannelOrder::UNSPECIFIED;
+}
 
-		case ImageIo::ChannelOrder::BGRA:
-		case ImageIo::ChannelOrder::BGRX: {
-			switch ( dataType ) {
-				default: break;
-				case ImageIo::DataType::UINT8: {
-					// imageFormat = VK_FORMAT_B8G8R8A8_UNORM;
-					imageFormat		 = VK_FORMAT_R8G8B8A8_UNORM;
-					conversionTarget = CONVERSION_TARGET_RGBA_U8;
-				} break;
-				case ImageIo::DataType::UINT16: conversionTarget = CONVERSION_TARGET_RGBA_U16; break;
-				case ImageIo::DataType::FLOAT32: conversionTarget = CONVERSION_TARGET_RGBA_32F; break;
-				case ImageIo::DataType::FLOAT16: conversionTarget = CONVERSION_TARGET_RGBA_32F; break;
-			}
-		} break;
+//! Picks an image format and view swizzle that samples surface data in
+//! \a channelOrder as is. Sets \a pExpandToRgba if 3 channel data must be
+//! expanded to 4 channels because the device can't sample it directly.
+template <typename T>
+static VkFormat selectSurfaceFormat( const vk::Device *pDevice, int channelOrder, VkComponentMapping *pComponents, bool *pExpandToRgba )
+{
+	const ChannelFormats formats = channelFormats<T>();
+
+	const VkComponentSwizzle R	 = VK_COMPONENT_SWIZZLE_R;
+	const VkComponentSwizzle G	 = VK_COMPONENT_SWIZZLE_G;
+	const VkComponentSwizzle B	 = VK_COMPONENT_SWIZZLE_B;
+	const VkComponentSwizzle A	 = VK_COMPONENT_SWIZZLE_A;
+	const VkComponentSwizzle ONE = VK_COMPONENT_SWIZZLE_ONE;
+
+	*pExpandToRgba = false;
 
-		case ImageIo::ChannelOrder::ABGR:
-		case ImageIo::ChannelOrder::XBGR: {
-			switch ( dataType ) {
-				default: break;
-				case ImageIo::DataType::UINT8: imageFormat = VK_FORMAT_A8B8G8R8_UNORM_PACK32; break;
-				case ImageIo::DataType::UINT16: conversionTarget = CONVERSION_TARGET_RGBA_U16; break;
-				case ImageIo::DataType::FLOAT32: conversionTarget = CONVERSION_TARGET_RGBA_32F; break;
-				case ImageIo::DataType::FLOAT16: conversionTarget = CONVERSION_TARGET_RGBA_32F; break;
+	// clang-format off
+	switch ( channelOrder ) {
+		default: break;
+		case SurfaceChannelOrder::RGBA: *pComponents = { R, G, B, A   }; return formats.rgba;
+		case SurfaceChannelOrder::RGBX: *pComponents = { R, G, B, ONE }; return formats.rgba;
+		case SurfaceChannelOrder::ARGB: *pComponents = { G, B, A, R   }; return formats.rgba;
+		case SurfaceChannelOrder::XRGB: *pComponents = { G, B, A, ONE }; return formats.rgba;
+		case SurfaceChannelOrder::ABGR: *pComponents = { A, B, G, R   }; return formats.rgba;
+		case SurfaceChannelOrder::XBGR: *pComponents = { A, B, G, ONE }; return formats.rgba;
+
+		case SurfaceChannelOrder::BGRA:
+		case SurfaceChannelOrder::BGRX: {
+			const VkComponentSwizzle alpha = ( channelOrder == SurfaceChannelOrder::BGRA ) ? A : ONE;
+			if ( pDevice->isFormatSupported( formats.bgra ) ) {
+				*pComponents = { R, G, B, alpha };
+				return formats.bgra;
 			}
+			*pComponents = { B, G, R, alpha };
+			return formats.rgba;
 		} break;
 
-		case ImageIo::ChannelOrder::ARGB:
-		case ImageIo::ChannelOrder::XRGB:
-		case ImageIo::ChannelOrder::RGB:
-		case ImageIo::ChannelOrder::BGR: {
-			switch ( dataType ) {
-				default: break;
-				case ImageIo::DataType::UINT8:
-					imageFormat		 = VK_FORMAT_R8G8B8A8_UNORM;
-					conversionTarget = CONVERSION_TARGET_RGBA_U8;
-					break;
-				case ImageIo::DataType::UINT16:
-					imageFormat		 = VK_FORMAT_R16G16B16A16_UNORM;
-					conversionTarget = CONVERSION_TARGET_RGBA_U16;
-					break;
-				case ImageIo::DataType::FLOAT32:
-					imageFormat		 = VK_FORMAT_R32G32B32A32_SFLOAT;
-					conversionTarget = CONVERSION_TARGET_RGBA_32F;
-					break;
-				case ImageIo::DataType::FLOAT16:
-					imageFormat		 = VK_FORMAT_R16G16B16A16_SFLOAT;
-					conversionTarget = CONVERSION_TARGET_RGBA_32F;
-					break;
+		case SurfaceChannelOrder::RGB: {
+			*pComponents = { R, G, B, ONE };
+			if ( pDevice->isFormatSupported( formats.rgb ) ) {
+				return formats.rgb;
 			}
+			*pExpandToRgba = true;
+			return formats.rgba;
 		} break;
 
-		case ImageIo::ChannelOrder::Y: {
-			switch ( dataType ) {
-				default: break;
-				case ImageIo::DataType::UINT8: imageFormat = VK_FORMAT_R8_UNORM; break;
-				case ImageIo::DataType::UINT16: imageFormat = VK_FORMAT_R16_UNORM; break;
-				case ImageIo::DataType::FLOAT32: imageFormat = VK_FORMAT_R32_SFLOAT; break;
-				case ImageIo::DataType::FLOAT16: imageFormat = VK_FORMAT_R16_SFLOAT; break;
+		case SurfaceChannelOrder::BGR: {
+			if ( pDevice->isFormatSupported( formats.bgr ) ) {
+				*pComponents = { R, G, B, ONE };
+				return formats.bgr;
 			}
-			if ( colorModel == ImageIo::ColorModel::CM_GRAY ) {
-				mComponentMapping.r = VK_COMPONENT_SWIZZLE_R;
-				mComponentMapping.g = VK_COMPONENT_SWIZZLE_R;
-				mComponentMapping.b = VK_COMPONENT_SWIZZLE_R;
-				mComponentMapping.a = VK_COMPONENT_SWIZZLE_R;
+			*pComponents = { B, G, R, ONE };
+			if ( pDevice->isFormatSupported( formats.rgb ) ) {
+				return formats.rgb;
 			}
+			*pExpandToRgba = true;
+			return formats.rgba;
 		} break;
+	}
+	// clang-format on
 
-		case ImageIo::ChannelOrder::YA: {
-			switch ( dataType ) {
-				default: break;
-				case ImageIo::DataType::UINT8: imageFormat = VK_FORMAT_R8G8_UNORM; break;
-				case ImageIo::DataType::UINT16: imageFormat = VK_FORMAT_R16G16_UNORM; break;
-				case ImageIo::DataType::FLOAT32: imageFormat = VK_FORMAT_R32G32_SFLOAT; break;
-				case ImageIo::DataType::FLOAT16: imageFormat = VK_FORMAT_R16G16_SFLOAT; break;
-			}
-		} break;
+	return VK_FORMAT_UNDEFINED;
+}
+
+//! Expands \a count packed 3 channel pixels to 4 channels with opaque alpha,
+//! channel order is preserved.
+template <typename T>
+static void expandRgbToRgba( const T *pSrc, T *pDst, uint32_t count )
+{
+	for ( uint32_t i = 0; i < count; ++i ) {
+		pDst[i * 4 + 0] = pSrc[i * 3 + 0];
+		pDst[i * 4 + 1] = pSrc[i * 3 + 1];
+		pDst[i * 4 + 2] = pSrc[i * 3 + 2];
+		pDst[i * 4 + 3] = CHANTRAIT<T>::max();
+	}
+}
+
+template <>
+void expandRgbToRgba<uint8_t>( const uint8_t *pSrc, uint8_t *pDst, uint32_t count )
+{
+	uint32_t i = 0;
+#if defined( CI_VK_TEXTURE_SSSE3 )
+	// 4 pixels per iteration. The 16 byte load reads past the 4th pixel
+	// so stop while there are still 2 pixels left in the row.
+	const __m128i shuffle = _mm_setr_epi8( 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1 );
+	const __m128i alpha	  = _mm_set1_epi32( static_cast<int>( 0xFF000000 ) );
+	for ( ; ( i + 6 ) <= count; i += 4 ) {
+		__m128i src = _mm_loadu_si128( reinterpret_cast<const __m128i *>( pSrc + i * 3 ) );
+		__m128i dst = _mm_or_si128( _mm_shuffle_epi8( src, shuffle ), alpha );
+		_mm_storeu_si128( reinterpret_cast<__m128i *>( pDst + i * 4 ), dst );
+	}
+#endif
+	for ( ; i < count; ++i ) {
+		pDst[i * 4 + 0] = pSrc[i * 3 + 0];
+		pDst[i * 4 + 1] = pSrc[i * 3 + 1];
+		pDst[i * 4 + 2] = pSrc[i * 3 + 2];
+		pDst[i * 4 + 3] = 0xFF;
+	}
+}
+
+template <typename T>
+static SurfaceT<T> expandRgbToRgba( const SurfaceT<T> &surface )
+{
+	// Channel order is only used for mip generation which filters each channel
+	// independently, the view swizzle takes care of the actual order.
+	SurfaceT<T> result = SurfaceT<T>( surface.getWidth(), surface.getHeight(), true, SurfaceChannelOrder::RGBA );
+
+	const uint32_t width  = static_cast<uint32_t>( surface.getWidth() );
+	const int32_t  height = surface.getHeight();
+	for ( int32_t y = 0; y < height; ++y ) {
+		const T *pSrc = reinterpret_cast<const T *>( reinterpret_cast<const uint8_t *>( surface.getData() ) + y * surface.getRowBytes() );
+		T		*pDst = reinterpret_cast<T *>( reinterpret_cast<uint8_t *>( result.getData() ) + y * result.getRowBytes() );
+		expandRgbToRgba<T>( pSrc, pDst, width );
+	}
+
+	return result;
+}
+
+//! Returns the channel order to load an image source with so that its data
+//! is not reordered. 3 channel data the device can't sample directly is
+//! expanded to RGBA by the loader while decoding.
+template <typename T>
+static SurfaceChannelOrder surfaceLoadChannelOrder( const vk::Device *pDevice, ImageIo::ChannelOrder channelOrder )
+{
+	SurfaceChannelOrder surfaceChannelOrder = toSurfaceChannelOrder( channelOrder );
+
+	VkComponentMapping components	= {};
+	bool			   expandToRgba = false;
+	VkFormat		   imageFormat	= selectSurfaceFormat<T>( pDevice, surfaceChannelOrder.getCode(), &components, &expandToRgba );
+	if ( expandToRgba || ( imageFormat == VK_FORMAT_UNDEFINED ) ) {
+		surfaceChannelOrder = SurfaceChannelOrder::RGBA;
+	}
+
+	return surfaceChannelOrder;
+}
+
+template <typename T>
+void Texture2d::initFromSurface( const SurfaceT<T> &surface, const Format &format )
+{
+	if constexpr ( std::is_same<T, uint8_t>::value ) {
+		if ( format.getCompression() != TextureCompression::NONE ) {
+			// Encoders take RGBA so the view needs no swizzle
+			Surface8u rgba = Surface8u( surface.getWidth(), surface.getHeight(), true, SurfaceChannelOrder::RGBA );
+			rgba.copyFrom( surface, surface.getBounds() );
+			initPrecompressed( 0, compressTextureData( getDevice().get(), layoutSurfaceMips<uint8_t>( { rgba }, format.getMipLevels() ), format ), format );
+			return;
+		}
+	}
+
+	bool	 expandToRgba = false;
+	VkFormat imageFormat  = selectSurfaceFormat<T>( getDevice().get(), surface.getChannelOrder().getCode(), &mComponentMapping, &expandToRgba );
+	if ( imageFormat == VK_FORMAT_UNDEFINED ) {
+		throw VulkanExc( "couldn't find matching Vulkan format for surface" );
+	}
+
+	if constexpr ( std::is_same<T, float>::value ) {
+		if ( format.getHalfFloat() ) {
+			// Mips are generated at full precision then narrowed
+			PrecompressedTextureData data = layoutSurfaceMips<T>( { surface }, format.getMipLevels() );
+			initPrecompressed( 0, toHalfFloat( data ), format );
+			return;
+		}
 	}
 
 	initImage( 0, imageFormat, format );
 	initSampler( format );
 	initViews();
 
-	switch ( conversionTarget ) {
-		default: {
-			switch ( dataType ) {
-				default: {
-					throw VulkanExc( "unrecognized data type" );
-				} break;
-
-				case ImageIo::DataType::UINT8: {
-					if ( isGray ) {
-						auto mip0 = Channel8u( imageSource );
-						copyMipsToImage<uint8_t>( getDevice().get(), mip0, 0, mImage.get() );
-					}
-					else {
-						SurfaceConstraints constraints = SurfaceConstraints();
-						auto			   mip0		   = Surface8u( imageSource, constraints, true );
-						copyMipsToImage<uint8_t>( getDevice().get(), mip0, 0, mImage.get() );
-					}
-				} break;
+	if ( expandToRgba ) {
+		SurfaceT<T> surfaceRgba = expandRgbToRgba<T>( surface );
+		uploadData( layoutSurfaceMips<T>( { surfaceRgba }, mImage->getMipLevels() ) );
+	}
+	else {
+		uploadData( layoutSurfaceMips<T>( { surface }, mImage->getMipLevels() ) );
+	}
+}
+
+template <typename T>
+void Texture2d::initFromChannel( const ChannelT<T> &channel, const Format &format )
+{
+	mComponentMapping = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_ONE };
+
+	if constexpr ( std::is_same<T, uint8_t>::value ) {
+		if ( format.getCompression() != TextureCompression::NONE ) {
+			// Encoders take RGBA, replicate the channel so that any format samples it
+			const int32_t width	 = channel.getWidth();
+			const int32_t height = channel.getHeight();
+			Surface8u	  rgba	 = Surface8u( width, height, true, SurfaceChannelOrder::RGBA );
+			for ( int32_t y = 0; y < height; ++y ) {
+				const uint8_t *pSrc = channel.getData( ivec2( 0, y ) );
+				uint8_t		*pDst = rgba.getData( ivec2( 0, y ) );
+				for ( int32_t x = 0; x < width; ++x ) {
+					const uint8_t value = pSrc[x * channel.getIncrement()];
+					pDst[x * 4 + 0]		= value;
+					pDst[x * 4 + 1]		= value;
+					pDst[x * 4 + 2]		= value;
+					pDst[x * 4 + 3]		= 0xFF;
+				}
 			}
-		} break;
+			initPrecompressed( 0, compressTextureData( getDevice().get(), layoutSurfaceMips<uint8_t>( { rgba }, format.getMipLevels() ), format ), format );
+			return;
+		}
+	}
 
-		case CONVERSION_TARGET_RGBA_U8: {
-			SurfaceConstraints constraints = SurfaceConstraints();
-			Surface8u		   mip0		   = Surface8u( imageSource, constraints, true );
-			copyMipsToImage<uint8_t>( getDevice().get(), mip0, 0, mImage.get() );
-		} break;
+	if constexpr ( std::is_same<T, float>::value ) {
+		if ( format.getHalfFloat() ) {
+			PrecompressedTextureData data = layoutChannelMips<T>( channel, format.getMipLevels() );
+			initPrecompressed( 0, toHalfFloat( data ), format );
+			return;
+		}
+	}
+
+	initImage( 0, channelFormats<T>().r, format );
+	initSampler( format );
+	initViews();
+
+	// Interleaved channels are packed by the layout
+	uploadData( layoutChannelMips<T>( channel, mImage->getMipLevels() ) );
+}
+
+template <typename T>
+void Texture2d::initFromGrayAlpha( const ImageSourceRef &imageSource, const Format &format )
+{
+	// Gray with alpha has no surface equivalent so decode straight into RG texels
+	mComponentMapping = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G };
+
+	initImage( 0, channelFormats<T>().rg, format );
+	initSampler( format );
+	initViews();
+
+	std::vector<T> pixels( static_cast<size_t>( getWidth() ) * getHeight() * 2 );
+	auto		   target = ImageTargetTexture<T>::create( this, ImageIo::ChannelOrder::YA, true, true, pixels.data() );
+	imageSource->load( target );
+
+	uploadData( layoutInterleavedMips<T>( pixels.data(), getWidth(), getHeight(), 2, channelFormats<T>().rg, mImage->getMipLevels() ) );
+}
+
+Texture2d::Texture2d( vk::DeviceRef device, int width, int height, Format format )
+	: TextureBase( device, width, height ),
+	  mCleanBounds( 0, 0, width, height )
+{
+}
+
+Texture2d::Texture2d( vk::DeviceRef device, const void *data, VkFormat dataFormat, int width, int height, Format format )
+	: TextureBase( device, width, height ),
+	  mCleanBounds( 0, 0, width, height )
+{
+	initImage( 0, dataFormat, format );
+	initSampler( format );
+	initViews();
+}
+
+Texture2d::Texture2d( vk::DeviceRef device, const Surface8u &surface, Format format )
+	: TextureBase( device, surface.getWidth(), surface.getHeight() ),
+	  mCleanBounds( 0, 0, surface.getWidth(), surface.getHeight() )
+{
+	initFromSurface( surface, format );
+}
+
+Texture2d::Texture2d( vk::DeviceRef device, const Surface16u &surface, Format format )
+	: TextureBase( device, surface.getWidth(), surface.getHeight() ),
+	  mCleanBounds( 0, 0, surface.getWidth(), surface.getHeight() )
+{
+	initFromSurface( surface, format );
+}
+
+Texture2d::Texture2d( vk::DeviceRef device, const Surface32f &surface, Format format )
+	: TextureBase( device, surface.getWidth(), surface.getHeight() ),
+	  mCleanBounds( 0, 0, surface.getWidth(), surface.getHeight() )
+{
+	initFromSurface( surface, format );
+}
+
+Texture2d::Texture2d( vk::DeviceRef device, const Channel8u &channel, Format format )
+	: TextureBase( device, channel.getWidth(), channel.getHeight() ),
+	  mCleanBounds( 0, 0, channel.getWidth(), channel.getHeight() )
+{
+	initFromChannel( channel, format );
+}
+
+Texture2d::Texture2d( vk::DeviceRef device, const Channel16u &channel, Format format )
+	: TextureBase( device, channel.getWidth(), channel.getHeight() ),
+	  mCleanBounds( 0, 0, channel.getWidth(), channel.getHeight() )
+{
+	initFromChannel( channel, format );
+}
 
-		case CONVERSION_TARGET_RGBA_U16: {
+Texture2d::Texture2d( vk::DeviceRef device, const Channel32f &channel, Format format )
+	: TextureBase( device, channel.getWidth(), channel.getHeight() ),
+	  mCleanBounds( 0, 0, channel.getWidth(), channel.getHeight() )
+{
+	initFromChannel( channel, format );
+}
+
+Texture2d::Texture2d( vk::DeviceRef device, const ImageSourceRef &imageSource, Format format )
+	: TextureBase( device, imageSource->getWidth(), imageSource->getHeight() ),
+	  mCleanBounds( 0, 0, imageSource->getWidth(), imageSource->getHeight() )
+{
+	ImageIo::ChannelOrder channelOrder = imageSource->getChannelOrder();
+	ImageIo::DataType	  dataType	   = imageSource->getDataType();
+	bool				  isGray	   = ( imageSource->getColorModel() == ImageIo::ColorModel::CM_GRAY );
+
+	// Half float data is widened to float by the loader, narrow it again on upload
+	if ( dataType == ImageIo::DataType::FLOAT16 ) {
+		format.halfFloat( true );
+	}
+
+	// Block compression takes RGBA, let the loader expand gray and reorder channels
+	if ( ( format.getCompression() != TextureCompression::NONE ) && ( dataType == ImageIo::DataType::UINT8 ) ) {
+		initFromSurface( Surface8u( imageSource, SurfaceConstraintsChannelOrder( SurfaceChannelOrder::RGBA ), true ), format );
+		return;
+	}
+
+	if ( isGray ) {
+		const bool hasAlpha = ( channelOrder == ImageIo::ChannelOrder::YA );
+		switch ( dataType ) {
+			default: {
+				throw VulkanExc( "unrecognized data type" );
+			} break;
+
+			case ImageIo::DataType::UINT8: {
+				hasAlpha ? initFromGrayAlpha<uint8_t>( imageSource, format ) : initFromChannel( Channel8u( imageSource ), format );
+			} break;
+
+			case ImageIo::DataType::UINT16: {
+				hasAlpha ? initFromGrayAlpha<uint16_t>( imageSource, format ) : initFromChannel( Channel16u( imageSource ), format );
+			} break;
+
+			case ImageIo::DataType::FLOAT16:
+			case ImageIo::DataType::FLOAT32: {
+				hasAlpha ? initFromGrayAlpha<float>( imageSource, format ) : initFromChannel( Channel32f( imageSource ), format );
+			} break;
+		}
+		return;
+	}
+
+	// Color data is loaded in its own channel order and sampled through a
+	// matching format or view swizzle instead of being converted to RGBA.
+	switch ( dataType ) {
+		default: {
+			throw VulkanExc( "unrecognized data type" );
 		} break;
 
-		case CONVERSION_TARGET_RGBA_32F: {
+		case ImageIo::DataType::UINT8: {
+			SurfaceChannelOrder surfaceChannelOrder = surfaceLoadChannelOrder<uint8_t>( getDevice().get(), channelOrder );
+			initFromSurface( Surface8u( imageSource, SurfaceConstraintsChannelOrder( surfaceChannelOrder ), surfaceChannelOrder.hasAlpha() ), format );
 		} break;
 
-		case CONVERSION_TARGET_RG_32F: {
+		case ImageIo::DataType::UINT16: {
+			SurfaceChannelOrder surfaceChannelOrder = surfaceLoadChannelOrder<uint16_t>( getDevice().get(), channelOrder );
+			initFromSurface( Surface16u( imageSource, SurfaceConstraintsChannelOrder( surfaceChannelOrder ), surfaceChannelOrder.hasAlpha() ), format );
 		} break;
 
-		case CONVERSION_TARGET_R_32F: {
+		case ImageIo::DataType::FLOAT16:
+		case ImageIo::DataType::FLOAT32: {
+			SurfaceChannelOrder surfaceChannelOrder = surfaceLoadChannelOrder<float>( getDevice().get(), channelOrder );
+			initFromSurface( Surface32f( imageSource, SurfaceConstraintsChannelOrder( surfaceChannelOrder ), surfaceChannelOrder.hasAlpha() ), format );
 		} break;
 	}
 }
 
+Texture2d::Texture2d( vk::DeviceRef device, const PrecompressedTextureData &data, Format format, bool asyncUpload )
+	: TextureBase( device, data.width, data.height ),
+	  mCleanBounds( 0, 0, data.width, data.height )
+{
+	initPrecompressed( 0, data, format, asyncUpload );
+}
+
 Texture2d::~Texture2d()
 {
 }
@@ -972,16 +1969,59 @@ vk::TextureCubeMapRef TextureCubeMap::create( const ImageSourceRef &imageSource,
 		device = app::RendererVk::getCurrentRenderer()->getDevice();
 	}
 
-	if ( imageSource->getDataType() == ImageIo::UINT8 ) {
-		return createTextureCubeMapImpl<uint8_t>( imageSource, format, device );
+	switch ( imageSource->getDataType() ) {
+		default: break;
+		case ImageIo::UINT16: return createTextureCubeMapImpl<uint16_t>( imageSource, format, device );
+		case ImageIo::FLOAT16: {
+			Format halfFormat = format;
+			halfFormat.halfFloat( true );
+			return createTextureCubeMapImpl<float>( imageSource, halfFormat, device );
+		} break;
+		case ImageIo::FLOAT32: return createTextureCubeMapImpl<float>( imageSource, format, device );
+	}
+	return createTextureCubeMapImpl<uint8_t>( imageSource, format, device );
+}
+
+vk::TextureCubeMapRef TextureCubeMap::createFromKtx( const DataSourceRef &dataSource, const Format &format, vk::DeviceRef device )
+{
+	if ( !device ) {
+		device = app::RendererVk::getCurrentRenderer()->getDevice();
+	}
+
+	PrecompressedTextureData data = parseKtx( dataSource );
+	if ( !data.isCubeMap || ( data.arrayLayers != 6 ) ) {
+		throw VulkanExc( "KTX2 file is not a cube map" );
+	}
+
+	if ( format.mDeleter ) {
+		return TextureCubeMapRef( new TextureCubeMap( device, data, format ), format.mDeleter );
+	}
+	else {
+		return TextureCubeMapRef( new TextureCubeMap( device, data, format ) );
+	}
+}
+
+vk::TextureCubeMapRef TextureCubeMap::createFromDds( const DataSourceRef &dataSource, const Format &format, vk::DeviceRef device )
+{
+	if ( !device ) {
+		device = app::RendererVk::getCurrentRenderer()->getDevice();
+	}
+
+	PrecompressedTextureData data = parseDds( dataSource );
+	if ( !data.isCubeMap || ( data.arrayLayers != 6 ) ) {
+		throw VulkanExc( "DDS file is not a cube map" );
+	}
+
+	if ( format.mDeleter ) {
+		return TextureCubeMapRef( new TextureCubeMap( device, data, format ), format.mDeleter );
 	}
 	else {
-		return createTextureCubeMapImpl<float>( imageSource, format, device );
+		return TextureCubeMapRef( new TextureCubeMap( device, data, format ) );
 	}
 }
 
 template <typename T>
-TextureCubeMapRef TextureCubeMap::createTextureCubeMapImpl( const ImageSourceRef &imageSource, const Format &format, vk::DeviceRef device )
+static std::vector<SurfaceT<T>> extractCubeMapFaces( const ImageSourceRef &imageSource )
 {
 	std::vector<CubeMapFaceRegion> faceRegions;
 
@@ -1000,8 +2040,8 @@ TextureCubeMapRef TextureCubeMap::createTextureCubeMapImpl( const ImageSourceRef
 	Area  faceArea = faceRegions.front().mArea;
 	ivec2 faceSize = faceArea.getSize();
 
-	SurfaceT<T> masterSurface( imageSource, SurfaceConstraintsDefault() );
-	SurfaceT<T> images[6];
+	SurfaceT<T>				 masterSurface( imageSource, SurfaceConstraintsDefault() );
+	std::vector<SurfaceT<T>> images( 6 );
 
 	for ( uint8_t f = 0; f < 6; ++f ) {
 		// alpha must always be on
@@ -1014,6 +2054,19 @@ TextureCubeMapRef TextureCubeMap::createTextureCubeMapImpl( const ImageSourceRef
 		}
 	}
 
+	return images;
+}
+
+template <typename T>
+TextureCubeMapRef TextureCubeMap::createTextureCubeMapImpl( const ImageSourceRef &imageSource, const Format &format, vk::DeviceRef device )
+{
+	std::vector<SurfaceT<T>> faces = extractCubeMapFaces<T>( imageSource );
+
+	SurfaceT<T> images[6];
+	for ( uint8_t f = 0; f < 6; ++f ) {
+		images[f] = faces[f];
+	}
+
 	if ( format.mDeleter ) {
 		return TextureCubeMapRef( new TextureCubeMap( device, images, format ), format.mDeleter );
 	}
@@ -1022,29 +2075,97 @@ TextureCubeMapRef TextureCubeMap::createTextureCubeMapImpl( const ImageSourceRef
 	}
 }
 
+TextureCubeMapFuture TextureCubeMap::createAsync( const DataSourceRef &dataSource, const Format &format, vk::DeviceRef device )
+{
+	// Current renderer is per thread so the device must be resolved here
+	if ( !device ) {
+		device = app::RendererVk::getCurrentRenderer()->getDevice();
+	}
+
+	std::function<TextureCubeMapRef()> task = [dataSource, format, device]() -> TextureCubeMapRef {
+		return createAsyncImpl( loadImage( dataSource ), format, device );
+	};
+
+	return TextureCubeMapFuture( TextureLoadPool::get()->enqueue<TextureCubeMapRef>( task ) );
+}
+
+TextureCubeMapFuture TextureCubeMap::createAsync( const ImageSourceRef &imageSource, const Format &format, vk::DeviceRef device )
+{
+	if ( !device ) {
+		device = app::RendererVk::getCurrentRenderer()->getDevice();
+	}
+
+	std::function<TextureCubeMapRef()> task = [imageSource, format, device]() -> TextureCubeMapRef {
+		return createAsyncImpl( imageSource, format, device );
+	};
+
+	return TextureCubeMapFuture( TextureLoadPool::get()->enqueue<TextureCubeMapRef>( task ) );
+}
+
+TextureCubeMapRef TextureCubeMap::createAsyncImpl( const ImageSourceRef &imageSource, const Format &format, vk::DeviceRef device )
+{
+	PrecompressedTextureData data = {};
+	switch ( imageSource->getDataType() ) {
+		default: {
+			data = layoutSurfaceMips<uint8_t>( extractCubeMapFaces<uint8_t>( imageSource ), format.getMipLevels() );
+		} break;
+		case ImageIo::UINT16: {
+			data = layoutSurfaceMips<uint16_t>( extractCubeMapFaces<uint16_t>( imageSource ), format.getMipLevels() );
+		} break;
+		case ImageIo::FLOAT16:
+		case ImageIo::FLOAT32: {
+			data = layoutSurfaceMips<float>( extractCubeMapFaces<float>( imageSource ), format.getMipLevels() );
+		} break;
+	}
+	if ( format.getHalfFloat() || ( imageSource->getDataType() == ImageIo::FLOAT16 ) ) {
+		data = toHalfFloat( data );
+	}
+	data.isCubeMap = true;
+
+	if ( format.mDeleter ) {
+		return TextureCubeMapRef( new TextureCubeMap( device, data, format, true ), format.mDeleter );
+	}
+	else {
+		return TextureCubeMapRef( new TextureCubeMap( device, data, format, true ) );
+	}
+}
+
 template <typename T>
 TextureCubeMap::TextureCubeMap( vk::DeviceRef device, const SurfaceT<T> images[6], Format format )
 	: vk::TextureBase( device, images[0].getWidth(), images[0].getHeight() )
 {
-	VkFormat imageFormat = VK_FORMAT_UNDEFINED;
-	if ( std::is_same<T, uint8_t>::value ) {
-		imageFormat = VK_FORMAT_R8G8B8A8_UNORM;
-	}
-	else if ( std::is_same<T, float>::value ) {
-		imageFormat = VK_FORMAT_R32G32B32A32_SFLOAT;
+	if constexpr ( std::is_same<T, float>::value ) {
+		if ( format.getHalfFloat() ) {
+			std::vector<SurfaceT<T>> faces = std::vector<SurfaceT<T>>( images, images + 6 );
+			PrecompressedTextureData data  = layoutSurfaceMips<T>( faces, format.getMipLevels() );
+			data.isCubeMap				   = true;
+			initPrecompressed( VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT, toHalfFloat( data ), format );
+			return;
+		}
 	}
-	else {
-		throw VulkanExc( "unsupported type T" );
+
+	bool	 expandToRgba = false;
+	VkFormat imageFormat  = selectSurfaceFormat<T>( getDevice().get(), images[0].getChannelOrder().getCode(), &mComponentMapping, &expandToRgba );
+	if ( imageFormat == VK_FORMAT_UNDEFINED ) {
+		throw VulkanExc( "couldn't find matching Vulkan format for surface" );
 	}
 
 	initImage( VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT, imageFormat, format );
 	initSampler( format );
 	initViews();
 
+	// All faces and their mips go up with one copy
+	std::vector<SurfaceT<T>> faces;
 	for ( uint32_t i = 0; i < 6; ++i ) {
-		const SurfaceT<T> &image = images[i];
-		copyMipsToImage<T>( getDevice().get(), image, i, mImage.get() );
+		faces.push_back( expandToRgba ? expandRgbToRgba<T>( images[i] ) : images[i] );
 	}
+	uploadData( layoutSurfaceMips<T>( faces, mImage->getMipLevels() ) );
+}
+
+TextureCubeMap::TextureCubeMap( vk::DeviceRef device, const PrecompressedTextureData &data, Format format, bool asyncUpload )
+	: vk::TextureBase( device, data.width, data.height )
+{
+	initPrecompressed( VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT, data, format, asyncUpload );
 }
 
 TextureCubeMap::~TextureCubeMap()
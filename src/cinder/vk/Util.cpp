@@ -1,6 +1,11 @@
 #include "cinder/vk/Util.h"
 #include "cinder/vk/Device.h"
 
+#include <atomic>
+#include <functional>
+#include <random>
+#include <thread>
+
 namespace cinder::vk {
 
 // Set up data structure with size(bytes) and number of components for each Vulkan format.
@@ -281,6 +286,7 @@ VmaMemoryUsage toVmaMemoryUsage( vk::MemoryUsage value )
 	    case MemoryUsage::CPU_TO_GPU : return VMA_MEMORY_USAGE_CPU_TO_GPU; break;
 	    case MemoryUsage::GPU_ONLY   : return VMA_MEMORY_USAGE_GPU_ONLY; break;
 	    case MemoryUsage::GPU_TO_CPU : return VMA_MEMORY_USAGE_GPU_TO_CPU; break;
+	    case MemoryUsage::GPU_LAZILY_ALLOCATED : return VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED; break;
     };
 	// clang-format on
 	return VMA_MEMORY_USAGE_UNKNOWN;
@@ -360,6 +366,121 @@ uint32_t formatComponentCount( VkFormat format )
 	return ( it != kFormatInfo.end() ) ? it->second.componentCount : 0;
 }
 
+bool isCompressedFormat( VkFormat format )
+{
+	VkExtent2D blockExtent = formatBlockExtent( format );
+	return ( blockExtent.width > 1 ) || ( blockExtent.height > 1 );
+}
+
+VkExtent2D formatBlockExtent( VkFormat format )
+{
+	// clang-format off
+	switch ( format ) {
+		default: break;
+
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		case VK_FORMAT_BC2_UNORM_BLOCK:
+		case VK_FORMAT_BC2_SRGB_BLOCK:
+		case VK_FORMAT_BC3_UNORM_BLOCK:
+		case VK_FORMAT_BC3_SRGB_BLOCK:
+		case VK_FORMAT_BC4_UNORM_BLOCK:
+		case VK_FORMAT_BC4_SNORM_BLOCK:
+		case VK_FORMAT_BC5_UNORM_BLOCK:
+		case VK_FORMAT_BC5_SNORM_BLOCK:
+		case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+		case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+		case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+		case VK_FORMAT_EAC_R11_SNORM_BLOCK:
+		case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+		case VK_FORMAT_EAC_R11G11_SNORM_BLOCK:
+		case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_4x4_SFLOAT_BLOCK_EXT:
+		case VK_FORMAT_PVRTC1_4BPP_UNORM_BLOCK_IMG:
+		case VK_FORMAT_PVRTC1_4BPP_SRGB_BLOCK_IMG:
+		case VK_FORMAT_PVRTC2_4BPP_UNORM_BLOCK_IMG:
+		case VK_FORMAT_PVRTC2_4BPP_SRGB_BLOCK_IMG: return { 4, 4 };
+
+		case VK_FORMAT_PVRTC1_2BPP_UNORM_BLOCK_IMG:
+		case VK_FORMAT_PVRTC1_2BPP_SRGB_BLOCK_IMG:
+		case VK_FORMAT_PVRTC2_2BPP_UNORM_BLOCK_IMG:
+		case VK_FORMAT_PVRTC2_2BPP_SRGB_BLOCK_IMG: return { 8, 4 };
+
+		case VK_FORMAT_ASTC_5x4_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_5x4_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_5x4_SFLOAT_BLOCK_EXT: return { 5, 4 };
+
+		case VK_FORMAT_ASTC_5x5_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_5x5_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_5x5_SFLOAT_BLOCK_EXT: return { 5, 5 };
+
+		case VK_FORMAT_ASTC_6x5_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_6x5_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_6x5_SFLOAT_BLOCK_EXT: return { 6, 5 };
+
+		case VK_FORMAT_ASTC_6x6_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_6x6_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_6x6_SFLOAT_BLOCK_EXT: return { 6, 6 };
+
+		case VK_FORMAT_ASTC_8x5_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_8x5_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_8x5_SFLOAT_BLOCK_EXT: return { 8, 5 };
+
+		case VK_FORMAT_ASTC_8x6_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_8x6_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_8x6_SFLOAT_BLOCK_EXT: return { 8, 6 };
+
+		case VK_FORMAT_ASTC_8x8_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_8x8_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_8x8_SFLOAT_BLOCK_EXT: return { 8, 8 };
+
+		case VK_FORMAT_ASTC_10x5_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_10x5_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_10x5_SFLOAT_BLOCK_EXT: return { 10, 5 };
+
+		case VK_FORMAT_ASTC_10x6_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_10x6_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_10x6_SFLOAT_BLOCK_EXT: return { 10, 6 };
+
+		case VK_FORMAT_ASTC_10x8_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_10x8_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_10x8_SFLOAT_BLOCK_EXT: return { 10, 8 };
+
+		case VK_FORMAT_ASTC_10x10_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_10x10_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_10x10_SFLOAT_BLOCK_EXT: return { 10, 10 };
+
+		case VK_FORMAT_ASTC_12x10_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_12x10_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_12x10_SFLOAT_BLOCK_EXT: return { 12, 10 };
+
+		case VK_FORMAT_ASTC_12x12_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_12x12_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_12x12_SFLOAT_BLOCK_EXT: return { 12, 12 };
+	}
+	// clang-format on
+	return { 1, 1 };
+}
+
+uint64_t formatDataSize( VkFormat format, uint32_t width, uint32_t height )
+{
+	VkExtent2D blockExtent = formatBlockExtent( format );
+	uint64_t   blocksX	   = ( std::max<uint32_t>( width, 1 ) + blockExtent.width - 1 ) / blockExtent.width;
+	uint64_t   blocksY	   = ( std::max<uint32_t>( height, 1 ) + blockExtent.height - 1 ) / blockExtent.height;
+	return blocksX * blocksY * formatSize( format );
+}
+
 VkImageAspectFlags determineAspectMask( VkFormat format )
 {
 	// clang-format off
@@ -659,4 +780,18 @@ VkResult cmdTransitionImageLayout(
 	return VK_SUCCESS;
 }
 
+fs::path uniqueTempPath( const fs::path &path )
+{
+	// The nonce tells processes apart, the thread id and counter tell
+	// apart writers within the process
+	static const uint64_t		 sProcessNonce = ( static_cast<uint64_t>( std::random_device()() ) << 32 ) | std::random_device()();
+	static std::atomic<uint64_t> sCounter	   = 0;
+
+	const uint64_t threadHash = static_cast<uint64_t>( std::hash<std::thread::id>()( std::this_thread::get_id() ) );
+
+	fs::path tmpPath = path;
+	tmpPath += "." + std::to_string( sProcessNonce ) + "." + std::to_string( threadHash ) + "." + std::to_string( sCounter++ ) + ".tmp";
+	return tmpPath;
+}
+
 } // namespace cinder::vk
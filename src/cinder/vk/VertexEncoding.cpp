@@ -0,0 +1,341 @@
+#include "cinder/vk/VertexEncoding.h"
+#include "cinder/vk/Util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined( __F16C__ )
+#define CI_VK_VERTEX_ENCODING_F16C
+#include <immintrin.h>
+#endif
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && ( _M_IX86_FP >= 2 ) )
+#define CI_VK_VERTEX_ENCODING_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined( __aarch64__ ) || defined( _M_ARM64 )
+#define CI_VK_VERTEX_ENCODING_NEON_FP16
+#include <arm_neon.h>
+#endif
+
+namespace cinder::vk {
+
+namespace {
+
+//! Number of components \a dims components are stored in
+uint32_t encodedComponentCount( vk::VertexEncoding encoding, uint8_t dims )
+{
+	return formatComponentCount( toVkFormat( encoding, dims ) );
+}
+
+//! Octahedral mapping of a unit vector to [-1, 1]^2
+void encodeOctahedral( float x, float y, float z, float *pDst )
+{
+	const float l1 = std::fabs( x ) + std::fabs( y ) + std::fabs( z );
+	if ( l1 <= 0.0f ) {
+		pDst[0] = 0.0f;
+		pDst[1] = 0.0f;
+		return;
+	}
+
+	float u = x / l1;
+	float v = y / l1;
+	if ( z < 0.0f ) {
+		const float fu = ( 1.0f - std::fabs( v ) ) * ( ( u >= 0.0f ) ? 1.0f : -1.0f );
+		const float fv = ( 1.0f - std::fabs( u ) ) * ( ( v >= 0.0f ) ? 1.0f : -1.0f );
+		u			   = fu;
+		v			   = fv;
+	}
+	pDst[0] = u;
+	pDst[1] = v;
+}
+
+#if defined( CI_VK_VERTEX_ENCODING_SSE2 )
+//! Packs the low 16 bits of each 32-bit lane of \a lo and \a hi
+__m128i packLow16( __m128i lo, __m128i hi )
+{
+	// Sign extend so the saturating pack keeps the low bits as they are
+	lo = _mm_srai_epi32( _mm_slli_epi32( lo, 16 ), 16 );
+	hi = _mm_srai_epi32( _mm_slli_epi32( hi, 16 ), 16 );
+	return _mm_packs_epi32( lo, hi );
+}
+
+#if !defined( CI_VK_VERTEX_ENCODING_F16C )
+//! SSE2 version of floatToHalf() for 4 values, results are in the low 16 bits of each lane
+__m128i floatToHalf4( __m128 value )
+{
+	const __m128i bits	  = _mm_castps_si128( value );
+	const __m128i sign	  = _mm_and_si128( _mm_srli_epi32( bits, 16 ), _mm_set1_epi32( 0x8000 ) );
+	const __m128i absBits = _mm_and_si128( bits, _mm_set1_epi32( 0x7FFFFFFF ) );
+
+	// Normal range: rebias the exponent and round to nearest even
+	const __m128i odd	 = _mm_and_si128( _mm_srli_epi32( absBits, 13 ), _mm_set1_epi32( 1 ) );
+	const __m128i normal = _mm_srli_epi32( _mm_sub_epi32( _mm_add_epi32( absBits, _mm_add_epi32( odd, _mm_set1_epi32( 0xFFF ) ) ), _mm_set1_epi32( 0x38000000 ) ), 13 );
+
+	// Subnormal range: scale so the mantissa is an integer, cvtps rounds to nearest even
+	const __m128i subnormal = _mm_cvtps_epi32( _mm_mul_ps( _mm_castsi128_ps( absBits ), _mm_set1_ps( 16777216.0f ) ) );
+
+	// Overflow goes to infinity, NaN stays NaN
+	const __m128i isNan		 = _mm_cmpgt_epi32( absBits, _mm_set1_epi32( 0x7F800000 ) );
+	const __m128i isOverflow = _mm_cmpgt_epi32( absBits, _mm_set1_epi32( 0x477FFFFF ) );
+	const __m128i isSub		 = _mm_cmplt_epi32( absBits, _mm_set1_epi32( 0x38800000 ) );
+	const __m128i special	 = _mm_or_si128( _mm_set1_epi32( 0x7C00 ), _mm_and_si128( isNan, _mm_set1_epi32( 0x200 ) ) );
+
+	__m128i result = _mm_or_si128( _mm_and_si128( isSub, subnormal ), _mm_andnot_si128( isSub, normal ) );
+	result		   = _mm_or_si128( _mm_and_si128( isOverflow, special ), _mm_andnot_si128( isOverflow, result ) );
+	return _mm_or_si128( result, sign );
+}
+#endif
+#endif
+
+//! Converts \a count floats to SNORM16, values are clamped to [-1, 1]
+void packSnorm16( const float *pSrc, size_t count, int16_t *pDst )
+{
+	size_t i = 0;
+#if defined( CI_VK_VERTEX_ENCODING_SSE2 )
+	const __m128 lower = _mm_set1_ps( -1.0f );
+	const __m128 upper = _mm_set1_ps( 1.0f );
+	const __m128 range = _mm_set1_ps( 32767.0f );
+	for ( ; ( i + 8 ) <= count; i += 8 ) {
+		const __m128 lo = _mm_mul_ps( _mm_min_ps( _mm_max_ps( _mm_loadu_ps( pSrc + i ), lower ), upper ), range );
+		const __m128 hi = _mm_mul_ps( _mm_min_ps( _mm_max_ps( _mm_loadu_ps( pSrc + i + 4 ), lower ), upper ), range );
+		_mm_storeu_si128( reinterpret_cast<__m128i *>( pDst + i ), _mm_packs_epi32( _mm_cvtps_epi32( lo ), _mm_cvtps_epi32( hi ) ) );
+	}
+#endif
+	for ( ; i < count; ++i ) {
+		pDst[i] = static_cast<int16_t>( std::nearbyint( std::clamp( pSrc[i], -1.0f, 1.0f ) * 32767.0f ) );
+	}
+}
+
+//! Converts \a count floats to SNORM8, values are clamped to [-1, 1]
+void packSnorm8( const float *pSrc, size_t count, int8_t *pDst )
+{
+	size_t i = 0;
+#if defined( CI_VK_VERTEX_ENCODING_SSE2 )
+	const __m128 lower = _mm_set1_ps( -1.0f );
+	const __m128 upper = _mm_set1_ps( 1.0f );
+	const __m128 range = _mm_set1_ps( 127.0f );
+	for ( ; ( i + 16 ) <= count; i += 16 ) {
+		__m128i values[4];
+		for ( size_t j = 0; j < 4; ++j ) {
+			const __m128 v = _mm_mul_ps( _mm_min_ps( _mm_max_ps( _mm_loadu_ps( pSrc + i + j * 4 ), lower ), upper ), range );
+			values[j]	   = _mm_cvtps_epi32( v );
+		}
+		const __m128i lo = _mm_packs_epi32( values[0], values[1] );
+		const __m128i hi = _mm_packs_epi32( values[2], values[3] );
+		_mm_storeu_si128( reinterpret_cast<__m128i *>( pDst + i ), _mm_packs_epi16( lo, hi ) );
+	}
+#endif
+	for ( ; i < count; ++i ) {
+		pDst[i] = static_cast<int8_t>( std::nearbyint( std::clamp( pSrc[i], -1.0f, 1.0f ) * 127.0f ) );
+	}
+}
+
+//! Converts \a count floats divided by \a scale to UNORM16, values are clamped to [0, 1]
+void packUnorm16( const float *pSrc, size_t count, float scale, uint16_t *pDst )
+{
+	const float invScale = ( scale != 0.0f ) ? ( 1.0f / scale ) : 0.0f;
+
+	size_t i = 0;
+#if defined( CI_VK_VERTEX_ENCODING_SSE2 )
+	const __m128 lower = _mm_setzero_ps();
+	const __m128 upper = _mm_set1_ps( 1.0f );
+	const __m128 range = _mm_set1_ps( 65535.0f );
+	const __m128 mul   = _mm_set1_ps( invScale );
+	for ( ; ( i + 8 ) <= count; i += 8 ) {
+		const __m128 lo = _mm_mul_ps( _mm_min_ps( _mm_max_ps( _mm_mul_ps( _mm_loadu_ps( pSrc + i ), mul ), lower ), upper ), range );
+		const __m128 hi = _mm_mul_ps( _mm_min_ps( _mm_max_ps( _mm_mul_ps( _mm_loadu_ps( pSrc + i + 4 ), mul ), lower ), upper ), range );
+		_mm_storeu_si128( reinterpret_cast<__m128i *>( pDst + i ), packLow16( _mm_cvtps_epi32( lo ), _mm_cvtps_epi32( hi ) ) );
+	}
+#endif
+	for ( ; i < count; ++i ) {
+		pDst[i] = static_cast<uint16_t>( std::nearbyint( std::clamp( pSrc[i] * invScale, 0.0f, 1.0f ) * 65535.0f ) );
+	}
+}
+
+} // namespace
+
+VkFormat toVkFormat( vk::VertexEncoding encoding, uint8_t dims )
+{
+	// clang-format off
+	switch ( encoding ) {
+		default: break;
+		case vk::VertexEncoding::FLOAT32: {
+			switch ( dims ) {
+				default: break;
+				case 1: return VK_FORMAT_R32_SFLOAT; break;
+				case 2: return VK_FORMAT_R32G32_SFLOAT; break;
+				case 3: return VK_FORMAT_R32G32B32_SFLOAT; break;
+				case 4: return VK_FORMAT_R32G32B32A32_SFLOAT; break;
+			}
+		} break;
+		case vk::VertexEncoding::FLOAT16: {
+			switch ( dims ) {
+				default: break;
+				case 1: return VK_FORMAT_R16_SFLOAT; break;
+				case 2: return VK_FORMAT_R16G16_SFLOAT; break;
+				case 3: return VK_FORMAT_R16G16B16A16_SFLOAT; break;
+				case 4: return VK_FORMAT_R16G16B16A16_SFLOAT; break;
+			}
+		} break;
+		case vk::VertexEncoding::OCTAHEDRAL_SNORM16: {
+			switch ( dims ) {
+				default: break;
+				case 3: return VK_FORMAT_R16G16_SNORM; break;
+				case 4: return VK_FORMAT_R16G16B16A16_SNORM; break;
+			}
+		} break;
+		case vk::VertexEncoding::OCTAHEDRAL_SNORM8: {
+			switch ( dims ) {
+				default: break;
+				case 3: return VK_FORMAT_R8G8_SNORM; break;
+				case 4: return VK_FORMAT_R8G8B8A8_SNORM; break;
+			}
+		} break;
+		case vk::VertexEncoding::UNORM16: {
+			switch ( dims ) {
+				default: break;
+				case 1: return VK_FORMAT_R16_UNORM; break;
+				case 2: return VK_FORMAT_R16G16_UNORM; break;
+				case 3: return VK_FORMAT_R16G16B16A16_UNORM; break;
+				case 4: return VK_FORMAT_R16G16B16A16_UNORM; break;
+			}
+		} break;
+	}
+	// clang-format on
+
+	return VK_FORMAT_UNDEFINED;
+}
+
+uint16_t floatToHalf( float value )
+{
+	uint32_t bits = 0;
+	std::memcpy( &bits, &value, sizeof( bits ) );
+
+	const uint32_t sign	   = ( bits >> 16 ) & 0x8000;
+	const uint32_t absBits = bits & 0x7FFFFFFF;
+
+	uint32_t result = 0;
+	if ( absBits > 0x7F800000 ) {
+		result = 0x7E00;
+	}
+	else if ( absBits > 0x477FFFFF ) {
+		result = 0x7C00;
+	}
+	else if ( absBits < 0x38800000 ) {
+		float absValue = 0.0f;
+		std::memcpy( &absValue, &absBits, sizeof( absValue ) );
+		result = static_cast<uint32_t>( std::nearbyint( absValue * 16777216.0f ) );
+	}
+	else {
+		result = ( absBits + 0xFFF + ( ( absBits >> 13 ) & 1 ) - 0x38000000 ) >> 13;
+	}
+
+	return static_cast<uint16_t>( result | sign );
+}
+
+void packHalf( const float *pSrc, size_t count, uint16_t *pDst )
+{
+	size_t i = 0;
+#if defined( CI_VK_VERTEX_ENCODING_F16C )
+	for ( ; ( i + 8 ) <= count; i += 8 ) {
+		const __m128i lo = _mm_cvtps_ph( _mm_loadu_ps( pSrc + i ), _MM_FROUND_TO_NEAREST_INT );
+		const __m128i hi = _mm_cvtps_ph( _mm_loadu_ps( pSrc + i + 4 ), _MM_FROUND_TO_NEAREST_INT );
+		_mm_storeu_si128( reinterpret_cast<__m128i *>( pDst + i ), _mm_unpacklo_epi64( lo, hi ) );
+	}
+#elif defined( CI_VK_VERTEX_ENCODING_SSE2 )
+	for ( ; ( i + 8 ) <= count; i += 8 ) {
+		const __m128i lo = floatToHalf4( _mm_loadu_ps( pSrc + i ) );
+		const __m128i hi = floatToHalf4( _mm_loadu_ps( pSrc + i + 4 ) );
+		_mm_storeu_si128( reinterpret_cast<__m128i *>( pDst + i ), packLow16( lo, hi ) );
+	}
+#elif defined( CI_VK_VERTEX_ENCODING_NEON_FP16 )
+	for ( ; ( i + 4 ) <= count; i += 4 ) {
+		const float16x4_t dst = vcvt_f16_f32( vld1q_f32( pSrc + i ) );
+		vst1_u16( pDst + i, vreinterpret_u16_f16( dst ) );
+	}
+#endif
+	for ( ; i < count; ++i ) {
+		pDst[i] = floatToHalf( pSrc[i] );
+	}
+}
+
+void encodeVertexData(
+	vk::VertexEncoding encoding,
+	float			   scale,
+	uint8_t			   srcDims,
+	const float		  *pSrc,
+	size_t			   count,
+	uint8_t			   dims,
+	size_t			   dstStride,
+	uint8_t			  *pDst )
+{
+	const VkFormat format = toVkFormat( encoding, dims );
+	if ( format == VK_FORMAT_UNDEFINED ) {
+		throw VulkanExc( "unsupported vertex encoding for attribute dimensions" );
+	}
+
+	const uint32_t components = encodedComponentCount( encoding, dims );
+	const uint32_t byteSize	  = formatSize( format );
+	if ( dstStride == 0 ) {
+		dstStride = byteSize;
+	}
+
+	// Expand to the stored component layout so the packing below is a
+	// straight conversion over a contiguous array.
+	//
+	std::vector<float> staging( count * components );
+	for ( size_t i = 0; i < count; ++i ) {
+		float		 src[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		const float *pIn	= pSrc + i * srcDims;
+		for ( uint32_t j = 0; j < std::min<uint32_t>( srcDims, 4 ); ++j ) {
+			src[j] = pIn[j];
+		}
+
+		float *pOut = staging.data() + i * components;
+		if ( ( encoding == vk::VertexEncoding::OCTAHEDRAL_SNORM16 ) || ( encoding == vk::VertexEncoding::OCTAHEDRAL_SNORM8 ) ) {
+			encodeOctahedral( src[0], src[1], src[2], pOut );
+			if ( components == 4 ) {
+				pOut[2] = 0.0f;
+				pOut[3] = ( src[3] < 0.0f ) ? -1.0f : 1.0f;
+			}
+		}
+		else {
+			for ( uint32_t j = 0; j < components; ++j ) {
+				pOut[j] = ( j < dims ) ? src[j] : ( ( j == 3 ) ? 1.0f : 0.0f );
+			}
+		}
+	}
+
+	std::vector<uint8_t> packed( count * byteSize );
+	switch ( encoding ) {
+		default: {
+			std::memcpy( packed.data(), staging.data(), packed.size() );
+		} break;
+		case vk::VertexEncoding::FLOAT16: {
+			packHalf( staging.data(), staging.size(), reinterpret_cast<uint16_t *>( packed.data() ) );
+		} break;
+		case vk::VertexEncoding::OCTAHEDRAL_SNORM16: {
+			packSnorm16( staging.data(), staging.size(), reinterpret_cast<int16_t *>( packed.data() ) );
+		} break;
+		case vk::VertexEncoding::OCTAHEDRAL_SNORM8: {
+			packSnorm8( staging.data(), staging.size(), reinterpret_cast<int8_t *>( packed.data() ) );
+		} break;
+		case vk::VertexEncoding::UNORM16: {
+			packUnorm16( staging.data(), staging.size(), scale, reinterpret_cast<uint16_t *>( packed.data() ) );
+		} break;
+	}
+
+	if ( dstStride == byteSize ) {
+		std::memcpy( pDst, packed.data(), packed.size() );
+	}
+	else {
+		for ( size_t i = 0; i < count; ++i ) {
+			std::memcpy( pDst + i * dstStride, packed.data() + i * byteSize, byteSize );
+		}
+	}
+}
+
+} // namespace cinder::vk
@@ -3,16 +3,20 @@
 #include "cinder/vk/Context.h"
 #include "cinder/vk/Mesh.h"
 #include "cinder/vk/Pipeline.h"
+#include "cinder/vk/ShapeBatch.h"
 #include "cinder/vk/Texture.h"
 #include "cinder/vk/scoped.h"
 #include "cinder/vk/wrapper.h"
+#include "cinder/CinderMath.h"
 #include "cinder/Log.h"
 
 namespace cinder::vk {
 
 void draw( const vk::BufferedMeshRef &mesh, int32_t first, int32_t count )
 {
-	auto				ctx			= vk::context();
+	auto ctx = vk::context();
+	ctx->flushShapes();
+
 	const vk::GlslProg *curGlslProg = ctx->getGlslProg();
 	if ( !curGlslProg ) {
 		CI_LOG_E( "No shader program bound" );
@@ -45,52 +49,10 @@ void draw( const vk::Texture2dRef &texture, const Area &srcArea, const Rectf &ds
 	if ( !texture )
 		return;
 
-	auto ctx = context();
-
+	// Quads are batched with the shapes, consecutive draws of the same
+	// texture become one instanced draw.
 	Rectf texRect = texture->getAreaTexCoords( srcArea );
-
-	auto			   prog = ctx->getStockShaderManager()->getDrawTextureProg( texture->getUnnormalizedCoordinates() );
-	vk::ScopedGlslProg glslScp( prog );
-
-	auto pipelineLayout = ctx->getStockShaderManager()->getDrawTexturePipelineLayout();
-
-	auto modelViewProjection = vk::getModelViewProjection();
-	ctx->getCurrentCommandBuffer()->pushConstants( pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof( modelViewProjection ), &modelViewProjection );
-
-	auto uPositionOffset = dstRect.getUpperLeft();
-	auto uPositionScale	 = dstRect.getSize();
-	auto uTexCoordOffset = texRect.getUpperLeft();
-	auto uTexCoordScale	 = texRect.getSize();
-
-	ctx->getCurrentCommandBuffer()->pushConstants( pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, sizeof( modelViewProjection ) + 0 * sizeof( vec2 ), sizeof(vec2), &uPositionOffset );
-	ctx->getCurrentCommandBuffer()->pushConstants( pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, sizeof( modelViewProjection ) + 1 * sizeof( vec2 ), sizeof(vec2), &uPositionScale );
-	ctx->getCurrentCommandBuffer()->pushConstants( pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, sizeof( modelViewProjection ) + 2 * sizeof( vec2 ), sizeof(vec2), &uTexCoordOffset );
-	ctx->getCurrentCommandBuffer()->pushConstants( pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, sizeof( modelViewProjection ) + 3 * sizeof( vec2 ), sizeof(vec2), &uTexCoordScale );
-
-	ctx->getCurrentCommandBuffer()->pushDescriptor(
-		VK_PIPELINE_BIND_POINT_GRAPHICS,
-		pipelineLayout,
-		0 + CINDER_CONTEXT_PS_BINDING_SHIFT_TEXTURE,
-		0,
-		texture.get() );
-
-	ctx->bindGraphicsPipeline( pipelineLayout );
-	ctx->getCurrentCommandBuffer()->draw( 6, 1, 0, 0 );
-
-	// ScopedVao vaoScp( ctx->getDrawTextureVao() );
-	// ScopedBuffer vboScp( ctx->getDrawTextureVbo() );
-	// ScopedTextureBind texBindScope( texture );
-	//
-	// auto glsl = getStockShader( ShaderDef().uniformBasedPosAndTexCoord().color().texture( texture ) );
-	// ScopedGlslProg glslScp( glsl );
-	// glsl->uniform( "uTex0", 0 );
-	// glsl->uniform( "uPositionOffset", dstRect.getUpperLeft() );
-	// glsl->uniform( "uPositionScale", dstRect.getSize() );
-	// glsl->uniform( "uTexCoordOffset", texRect.getUpperLeft() );
-	// glsl->uniform( "uTexCoordScale", texRect.getSize() );
-	//
-	// ctx->setDefaultShaderVars();
-	// ctx->drawArrays( GL_TRIANGLE_STRIP, 0, 4 );
+	vk::context()->getShapeBatch()->appendTexturedQuad( texture, texRect, dstRect );
 }
 
 void draw( const vk::Texture2dRef &texture, const Rectf &dstRect )
@@ -109,4 +71,192 @@ void draw( const vk::Texture2dRef &texture, const vec2 &dstOffset )
 	draw( texture, texture->getBounds(), Rectf( texture->getBounds() ) + dstOffset );
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Shapes
+
+static const float kTwoPi = 2.0f * static_cast<float>( M_PI );
+
+static uint32_t calcNumCircleSegments( float radius, int numSegments )
+{
+	if ( numSegments <= 0 ) {
+		numSegments = static_cast<int>( std::floor( radius * kTwoPi ) );
+	}
+	return static_cast<uint32_t>( std::max( numSegments, 3 ) );
+}
+
+//! Appends a quad strip along the point pairs \a positions[2 * i] and \a positions[2 * i + 1], closing it if \a closed is true
+static void appendStrip( const std::vector<vec2> &positions, bool closed )
+{
+	const uint32_t numPairs	   = static_cast<uint32_t>( positions.size() / 2 );
+	const uint32_t numSegments = closed ? numPairs : ( numPairs - 1 );
+
+	std::vector<uint32_t> indices;
+	indices.reserve( numSegments * 6 );
+	for ( uint32_t i = 0; i < numSegments; ++i ) {
+		const uint32_t a = 2 * i;
+		const uint32_t b = 2 * ( ( i + 1 ) % numPairs );
+		indices.insert( indices.end(), { a, a + 1, b, b, a + 1, b + 1 } );
+	}
+
+	vk::context()->getShapeBatch()->appendTriangles( positions.data(), countU32( positions ), indices.data(), countU32( indices ) );
+}
+
+void drawLine( const vec2 &start, const vec2 &end, float width )
+{
+	const vec2 dir = end - start;
+	if ( glm::length( dir ) == 0.0f ) {
+		return;
+	}
+
+	const vec2	   n			= glm::normalize( vec2( -dir.y, dir.x ) ) * ( 0.5f * width );
+	const vec2	   positions[4] = { start + n, start - n, end + n, end - n };
+	const uint32_t indices[6]	= { 0, 1, 2, 2, 1, 3 };
+	vk::context()->getShapeBatch()->appendTriangles( positions, 4, indices, 6 );
+}
+
+void draw( const PolyLine2f &polyLine, float lineWidth )
+{
+	const auto	  &points	 = polyLine.getPoints();
+	const uint32_t numPoints = countU32( points );
+	const bool	   closed	 = polyLine.isClosed() && ( numPoints > 2 );
+	if ( numPoints < 2 ) {
+		return;
+	}
+
+	auto segmentNormal = [&points, numPoints]( uint32_t i ) -> vec2 {
+		const vec2	dir	   = points[( i + 1 ) % numPoints] - points[i];
+		const float length = glm::length( dir );
+		return ( length > 0.0f ) ? ( vec2( -dir.y, dir.x ) / length ) : vec2( 0.0f );
+	};
+
+	// Each point is pushed out along the miter of its two segments. The
+	// miter length is limited so sharp corners don't spike.
+	const float		  halfWidth = 0.5f * lineWidth;
+	std::vector<vec2> positions;
+	positions.reserve( 2 * numPoints );
+	for ( uint32_t i = 0; i < numPoints; ++i ) {
+		const bool hasPrev = closed || ( i > 0 );
+		const bool hasNext = closed || ( ( i + 1 ) < numPoints );
+
+		const vec2 prev = hasPrev ? segmentNormal( ( i + numPoints - 1 ) % numPoints ) : segmentNormal( i );
+		const vec2 next = hasNext ? segmentNormal( i ) : prev;
+
+		vec2		miter	= prev + next;
+		const float length	= glm::length( miter );
+		miter				= ( length > 0.0f ) ? ( miter / length ) : next;
+		const float cosHalf = std::max( glm::dot( miter, next ), 0.25f );
+		const vec2	offset	= miter * ( halfWidth / cosHalf );
+
+		positions.push_back( points[i] + offset );
+		positions.push_back( points[i] - offset );
+	}
+
+	appendStrip( positions, closed );
+}
+
+void drawSolidRect( const Rectf &r )
+{
+	const vec2	   positions[4] = { r.getUpperLeft(), r.getLowerLeft(), r.getUpperRight(), r.getLowerRight() };
+	const uint32_t indices[6]	= { 0, 1, 2, 2, 1, 3 };
+	vk::context()->getShapeBatch()->appendTriangles( positions, 4, indices, 6 );
+}
+
+void drawStrokedRect( const Rectf &rect, float lineWidth )
+{
+	const Rectf outer = rect.inflated( vec2( 0.5f * lineWidth ) );
+	const Rectf inner = rect.inflated( vec2( -0.5f * lineWidth ) );
+
+	std::vector<vec2> positions = {
+		outer.getUpperLeft(), inner.getUpperLeft(),
+		outer.getUpperRight(), inner.getUpperRight(),
+		outer.getLowerRight(), inner.getLowerRight(),
+		outer.getLowerLeft(), inner.getLowerLeft() };
+	appendStrip( positions, true );
+}
+
+void drawSolidCircle( const vec2 &center, float radius, int numSegments )
+{
+	const uint32_t n = calcNumCircleSegments( radius, numSegments );
+
+	std::vector<vec2>	  positions( n + 1 );
+	std::vector<uint32_t> indices( 3 * n );
+	positions[0] = center;
+	for ( uint32_t i = 0; i < n; ++i ) {
+		const float angle = kTwoPi * static_cast<float>( i ) / static_cast<float>( n );
+		positions[i + 1]  = center + radius * vec2( std::cos( angle ), std::sin( angle ) );
+
+		indices[3 * i + 0] = 0;
+		indices[3 * i + 1] = i + 1;
+		indices[3 * i + 2] = ( ( i + 1 ) % n ) + 1;
+	}
+
+	vk::context()->getShapeBatch()->appendTriangles( positions.data(), countU32( positions ), indices.data(), countU32( indices ) );
+}
+
+void drawStrokedCircle( const vec2 &center, float radius, float lineWidth, int numSegments )
+{
+	const uint32_t n		   = calcNumCircleSegments( radius, numSegments );
+	const float	   outerRadius = radius + 0.5f * lineWidth;
+	const float	   innerRadius = std::max( radius - 0.5f * lineWidth, 0.0f );
+
+	std::vector<vec2> positions( 2 * n );
+	for ( uint32_t i = 0; i < n; ++i ) {
+		const float angle = kTwoPi * static_cast<float>( i ) / static_cast<float>( n );
+		const vec2	dir	  = vec2( std::cos( angle ), std::sin( angle ) );
+
+		positions[2 * i + 0] = center + outerRadius * dir;
+		positions[2 * i + 1] = center + innerRadius * dir;
+	}
+
+	appendStrip( positions, true );
+}
+
+void drawSolidTriangle( const vec2 &pt0, const vec2 &pt1, const vec2 &pt2 )
+{
+	const vec2	   positions[3] = { pt0, pt1, pt2 };
+	const uint32_t indices[3]	= { 0, 1, 2 };
+	vk::context()->getShapeBatch()->appendTriangles( positions, 3, indices, 3 );
+}
+
+void flushShapes()
+{
+	vk::context()->flushShapes();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Compute
+
+static bool bindCompute( vk::Context *ctx )
+{
+	// Shapes draw with the current descriptor set, so they go first
+	ctx->flushShapes();
+
+	const vk::GlslProg *curGlslProg = ctx->getGlslProg();
+	if ( !curGlslProg || !curGlslProg->getComputeShader() ) {
+		CI_LOG_E( "No compute shader program bound" );
+		return false;
+	}
+
+	ctx->setDefaultShaderVars();
+	ctx->bindDefaultDescriptorSet( VK_PIPELINE_BIND_POINT_COMPUTE );
+	ctx->bindComputePipeline();
+	return true;
+}
+
+void dispatch( uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ )
+{
+	auto ctx = vk::context();
+	if ( bindCompute( ctx ) ) {
+		ctx->dispatch( groupCountX, groupCountY, groupCountZ );
+	}
+}
+
+void dispatchIndirect( const vk::BufferRef &buffer, uint64_t offset )
+{
+	auto ctx = vk::context();
+	if ( bindCompute( ctx ) ) {
+		ctx->dispatchIndirect( buffer, offset );
+	}
+}
+
 } // namespace cinder::vk